@@ -0,0 +1,94 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef Benchmark_h
+#define Benchmark_h
+
+// Shared by the benchmark examples. Each renders an offline context a quantum at a time on the calling
+// thread, so that what is timed is the graph and not the audio device.
+
+#include "LabSound.h"
+#include "AudioBus.h"
+#include "AudioContextLock.h"
+#include "HRTFDatabaseLoader.h"
+#include "OfflineAudioDestinationNode.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace LabSound {
+
+    class OfflineBenchmarkContext {
+    public:
+        OfflineBenchmarkContext(float sampleRate = 44100, unsigned numberOfChannels = 2)
+        : m_bus(numberOfChannels, AudioNode::ProcessingSizeInFrames)
+        {
+            ExceptionCode ec = NO_ERR;
+            m_context = AudioContext::createOfflineContext(numberOfChannels, AudioNode::ProcessingSizeInFrames, sampleRate, ec);
+
+            // The destination takes ownership of its render target.
+            m_destination = std::make_shared<OfflineAudioDestinationNode>(m_context, new AudioBuffer(numberOfChannels, AudioNode::ProcessingSizeInFrames, sampleRate));
+            m_context->setDestinationNode(m_destination);
+            m_context->lazyInitialize();
+
+            // Panners and the spatialization nodes wait on the HRTF database; load it before anything is timed.
+            HRTFDatabaseLoader::loader(sampleRate)->waitForLoaderThreadCompletion();
+        }
+
+        ~OfflineBenchmarkContext()
+        {
+            ContextGraphLock g(m_context, "OfflineBenchmarkContext");
+            ContextRenderLock r(m_context, "OfflineBenchmarkContext");
+            m_context->stop(g, r);
+        }
+
+        std::shared_ptr<AudioContext> context() const { return m_context; }
+        std::shared_ptr<AudioDestinationNode> destination() const { return m_destination; }
+        float sampleRate() const { return m_context->sampleRate(); }
+
+        // Renders one quantum as the audio device would, and returns the output.
+        AudioBus& render()
+        {
+            m_destination->render(0, &m_bus, AudioNode::ProcessingSizeInFrames);
+            return m_bus;
+        }
+
+    private:
+        std::shared_ptr<AudioContext> m_context;
+        std::shared_ptr<OfflineAudioDestinationNode> m_destination;
+        AudioBus m_bus;
+    };
+
+    // Times repeated runs of a piece of work, and keeps the fastest, which is the least disturbed by the
+    // rest of the machine.
+    class BenchmarkTimer {
+    public:
+        BenchmarkTimer() : m_best(1e300) { }
+
+        void start() { m_start = std::chrono::high_resolution_clock::now(); }
+
+        // Returns the microseconds since start(), divided by the units of work the run did.
+        double stop(double units = 1)
+        {
+            double elapsed = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - m_start).count() / units;
+            m_best = std::min(m_best, elapsed);
+            return elapsed;
+        }
+
+        double best() const { return m_best; }
+
+    private:
+        std::chrono::high_resolution_clock::time_point m_start;
+        double m_best;
+    };
+
+    inline int intArgument(int argc, char** argv, int index, int defaultValue)
+    {
+        return index < argc ? atoi(argv[index]) : defaultValue;
+    }
+
+}
+
+#endif // Benchmark_h
@@ -0,0 +1,157 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "Biquad.h"
+#include "BiquadBank.h"
+#include "BiquadFilterNode.h"
+#include "GainNode.h"
+#include "OscillatorNode.h"
+#include <cmath>
+#include <vector>
+
+using namespace LabSound;
+using namespace WebCore;
+using namespace std;
+
+// Compares filtering 1 to 32 channels with a Biquad each against filtering them together with a BiquadBank,
+// in single and double precision. Then renders a BiquadFilterNode with an LFO on its frequency, computing
+// coefficients every 1 to 128 frames, against the same filter at k-rate.
+//
+// BiquadBenchmark [quanta]
+
+static void bankAgainstBiquads(int quanta)
+{
+    const size_t frames = AudioNode::ProcessingSizeInFrames;
+    printf("channels  Biquad  bank float  bank double  (microseconds per quantum, lowpass)\n");
+
+    const unsigned channelCounts[] = { 1, 2, 8, 32 };
+    for (unsigned channels : channelCounts) {
+        vector<vector<float>> sources(channels, vector<float>(frames));
+        vector<vector<float>> destinations(channels, vector<float>(frames));
+        vector<const float*> sourcesP(channels);
+        vector<float*> destinationsP(channels);
+        for (unsigned c = 0; c < channels; ++c) {
+            for (size_t i = 0; i < frames; ++i)
+                sources[c][i] = sinf(0.05f * (i + 7 * c));
+            sourcesP[c] = sources[c].data();
+            destinationsP[c] = destinations[c].data();
+        }
+
+        vector<Biquad> biquads(channels);
+        for (Biquad& biquad : biquads)
+            biquad.setLowpassParams(0.05, 6);
+
+        BenchmarkTimer biquadTimer;
+        for (int pass = 0; pass < 5; ++pass) {
+            biquadTimer.start();
+            for (int q = 0; q < quanta; ++q) {
+                for (unsigned c = 0; c < channels; ++c)
+                    biquads[c].process(sourcesP[c], destinationsP[c], frames);
+            }
+            biquadTimer.stop(quanta);
+        }
+
+        double bankTimes[2];
+        for (int precision = 0; precision < 2; ++precision) {
+            BiquadBank bank(channels, 1, precision ? BiquadBank::DoublePrecision : BiquadBank::SinglePrecision);
+            for (unsigned c = 0; c < channels; ++c)
+                bank.setCoefficients(c, 0, biquads[c]);
+
+            BenchmarkTimer bankTimer;
+            for (int pass = 0; pass < 5; ++pass) {
+                bankTimer.start();
+                for (int q = 0; q < quanta; ++q)
+                    bank.process(sourcesP.data(), destinationsP.data(), frames);
+                bankTimer.stop(quanta);
+            }
+            bankTimes[precision] = bankTimer.best();
+        }
+
+        printf("%8u  %6.2f  %10.2f  %11.2f\n", channels, biquadTimer.best(), bankTimes[0], bankTimes[1]);
+    }
+}
+
+// Renders a stereo lowpass swept by a 5Hz LFO, with coefficients every interval frames, or at k-rate for an
+// interval of 0. Returns the microseconds per quantum, and the rendered output.
+static double sweptFilter(unsigned interval, int quanta, vector<float>& output)
+{
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+    auto destination = offline.destination();
+
+    shared_ptr<OscillatorNode> source, lfo;
+    shared_ptr<GainNode> depth;
+    shared_ptr<BiquadFilterNode> filter;
+    {
+        ContextGraphLock g(context, "BiquadBenchmark");
+        ContextRenderLock r(context, "BiquadBenchmark");
+        ExceptionCode ec = NO_ERR;
+
+        source = make_shared<OscillatorNode>(r, offline.sampleRate());
+        source->setType(r, OscillatorNode::SAWTOOTH, ec);
+        source->frequency()->setValue(110);
+        source->start(0);
+
+        filter = make_shared<BiquadFilterNode>(offline.sampleRate());
+        filter->frequency()->setValue(1000);
+        filter->q()->setValue(6);
+        connect(g, r, source.get(), filter.get());
+        connect(g, r, filter.get(), destination.get());
+
+        if (interval) {
+            filter->setCoefficientInterval(interval);
+            lfo = make_shared<OscillatorNode>(r, offline.sampleRate());
+            lfo->frequency()->setValue(5);
+            lfo->start(0);
+            depth = make_shared<GainNode>(offline.sampleRate());
+            depth->gain()->setValue(800);
+            connect(g, r, lfo.get(), depth.get());
+            depth->connect(g, filter->frequency(), 0, ec);
+        }
+    }
+
+    BenchmarkTimer timer;
+    output.clear();
+    for (int pass = 0; pass < 3; ++pass) {
+        timer.start();
+        for (int q = 0; q < quanta; ++q) {
+            AudioBus& bus = offline.render();
+            if (!pass)
+                output.insert(output.end(), bus.channel(0)->data(), bus.channel(0)->data() + bus.length());
+        }
+        timer.stop(quanta);
+    }
+    return timer.best();
+}
+
+static void coefficientIntervals(int quanta)
+{
+    printf("\ninterval  microseconds per quantum  deviation from every frame\n");
+
+    vector<float> reference, output;
+    sweptFilter(1, quanta, reference);
+
+    const unsigned intervals[] = { 1, 8, 16, 32, 128, 0 };
+    for (unsigned interval : intervals) {
+        double time = sweptFilter(interval, quanta, output);
+        if (!interval) {
+            printf("  k-rate  %24.2f\n", time);
+            continue;
+        }
+
+        double deviation = 0;
+        for (size_t i = 0; i < reference.size() && i < output.size(); ++i)
+            deviation = max(deviation, (double) fabs(reference[i] - output[i]));
+        printf("%8u  %24.2f  %26.2g\n", interval, time, deviation);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int quanta = intArgument(argc, argv, 1, 2000);
+
+    bankAgainstBiquads(quanta);
+    coefficientIntervals(quanta);
+    return 0;
+}
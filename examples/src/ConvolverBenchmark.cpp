@@ -0,0 +1,100 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "Reverb.h"
+#include "UniformConvolver.h"
+#include <cmath>
+#include <vector>
+
+using namespace LabSound;
+using namespace WebCore;
+using namespace std;
+
+// Convolves a stereo input with mono, stereo and true-stereo responses of 1 and 4 seconds, with Reverb and with
+// UniformConvolver at several partition sizes, and reports the cost in microseconds per render quantum for each
+// second of response on each path from an input to an output. Reverb's background threads are off, so that all
+// of its work is timed.
+//
+// ConvolverBenchmark [quanta]
+
+static unique_ptr<AudioBus> makeResponse(unsigned numberOfChannels, size_t length, float sampleRate)
+{
+    unique_ptr<AudioBus> response(new AudioBus(numberOfChannels, length));
+    response->setSampleRate(sampleRate);
+    unsigned seed = 1;
+    for (unsigned c = 0; c < numberOfChannels; ++c) {
+        float* data = response->channel(c)->mutableData();
+        for (size_t i = 0; i < length; ++i) {
+            seed = seed * 1664525 + 1013904223;
+            data[i] = ((seed >> 9) / 8388608.0f - 1) * expf(-3.0f * i / length);
+        }
+    }
+    return response;
+}
+
+static void fillInput(AudioBus& input, int quantum)
+{
+    for (unsigned c = 0; c < input.numberOfChannels(); ++c) {
+        float* data = input.channel(c)->mutableData();
+        for (size_t i = 0; i < input.length(); ++i)
+            data[i] = 0.3f * sinf(0.013f * (quantum * input.length() + i) + c);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int quanta = intArgument(argc, argv, 1, 2000);
+    const size_t frames = AudioNode::ProcessingSizeInFrames;
+
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+    const float sampleRate = offline.sampleRate();
+
+    AudioBus input(2, frames), output(2, frames);
+    const size_t partitionSizes[] = { 256, 1024, 4096 };
+
+    printf("response        paths      Reverb  uniform 256  uniform 1024  uniform 4096  (microseconds per quantum per response-second per path)\n");
+    const unsigned channelCounts[] = { 1, 2, 4 };
+    const double seconds[] = { 1, 4 };
+    for (double responseSeconds : seconds) {
+        for (unsigned numberOfChannels : channelCounts) {
+            unique_ptr<AudioBus> response = makeResponse(numberOfChannels, static_cast<size_t>(responseSeconds * sampleRate), sampleRate);
+            vector<UniformConvolver::Path> paths = UniformConvolver::stereoPaths(numberOfChannels);
+            const double scale = 1 / (responseSeconds * paths.size());
+
+            BenchmarkTimer reverbTimer;
+            {
+                Reverb reverb(response.get(), frames, 32768, 2, false, false);
+                ContextGraphLock g(context, "ConvolverBenchmark");
+                ContextRenderLock r(context, "ConvolverBenchmark");
+                for (int pass = 0; pass < 3; ++pass) {
+                    reverbTimer.start();
+                    for (int q = 0; q < quanta; ++q) {
+                        fillInput(input, q);
+                        reverb.process(g, r, &input, &output, frames);
+                    }
+                    reverbTimer.stop(quanta);
+                }
+            }
+            printf("%4.0fs %u channel  %5zu  %10.2f", responseSeconds, numberOfChannels, paths.size(), reverbTimer.best() * scale);
+
+            for (size_t partitionSize : partitionSizes) {
+                UniformConvolver convolver(response.get(), paths, 2, 2, partitionSize, 1);
+                BenchmarkTimer timer;
+                for (int pass = 0; pass < 3; ++pass) {
+                    timer.start();
+                    for (int q = 0; q < quanta; ++q) {
+                        fillInput(input, q);
+                        convolver.process(&input, &output, frames);
+                    }
+                    timer.stop(quanta);
+                }
+                printf("  %12.2f", timer.best() * scale);
+            }
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
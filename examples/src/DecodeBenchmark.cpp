@@ -0,0 +1,101 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "AudioFileDecoder.h"
+#include "AudioFileReader.h"
+#include <string>
+#include <vector>
+
+using namespace LabSound;
+using namespace WebCore;
+using namespace std;
+
+// Decodes the IRCAM impulse responses from memory, so that the disk isn't timed, and reports the throughput in
+// megabytes of file a second: decoding alone, decoding into a bus, and decoding into a bus mixed to mono and
+// resampled in the same pass.
+//
+// DecodeBenchmark [directory] [passes]
+
+static vector<char> readFile(const string& path)
+{
+    vector<char> bytes;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return bytes;
+
+    char block[65536];
+    size_t count;
+    while ((count = fread(block, 1, sizeof(block), file)) > 0)
+        bytes.insert(bytes.end(), block, block + count);
+    fclose(file);
+    return bytes;
+}
+
+enum Mode { Decode, Bus, MonoResampled, ModeCount };
+
+static const char* modeNames[] = { "decode", "bus", "mono at 48kHz" };
+
+static bool run(Mode mode, const vector<char>& file)
+{
+    if (mode == Bus)
+        return !!createBusFromInMemoryAudioFile(file.data(), file.size(), false, 0);
+    if (mode == MonoResampled)
+        return !!createBusFromInMemoryAudioFile(file.data(), file.size(), true, 48000);
+
+    unique_ptr<AudioFileDecoder> decoder = AudioFileDecoder::open(file.data(), file.size());
+    if (!decoder)
+        return false;
+
+    const size_t blockFrames = static_cast<size_t>(min<uint64_t>(decoder->length(), 4096));
+    vector<vector<float>> blocks(decoder->numberOfChannels(), vector<float>(blockFrames));
+    vector<float*> channels(decoder->numberOfChannels());
+    for (size_t c = 0; c < channels.size(); ++c)
+        channels[c] = blocks[c].data();
+    while (decoder->read(channels.data(), blockFrames)) { }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const string directory = argc > 1 ? argv[1] : "HRTF";
+    const int passes = intArgument(argc, argv, 2, 20);
+
+    // The files are named for their azimuth and elevation, as HRTFElevation finds them.
+    vector<vector<char>> files;
+    size_t totalBytes = 0;
+    for (int azimuth = 0; azimuth < 360; azimuth += 15) {
+        for (int elevation = -45; elevation <= 90; elevation += 15) {
+            char name[64];
+            sprintf(name, "/IRC_Composite_C_R0195_T%03d_P%03d.wav", azimuth, elevation < 0 ? elevation + 360 : elevation);
+            vector<char> file = readFile(directory + name);
+            if (file.empty())
+                continue;
+            totalBytes += file.size();
+            files.push_back(move(file));
+        }
+    }
+
+    if (files.empty()) {
+        printf("No IRCAM files found in %s\n", directory.c_str());
+        return 1;
+    }
+    printf("%zu files, %.2f MB\n", files.size(), totalBytes / 1e6);
+
+    for (int mode = 0; mode < ModeCount; ++mode) {
+        BenchmarkTimer timer;
+        for (int pass = 0; pass < passes; ++pass) {
+            timer.start();
+            for (const vector<char>& file : files) {
+                if (!run(static_cast<Mode>(mode), file)) {
+                    printf("Could not decode a file\n");
+                    return 1;
+                }
+            }
+            timer.stop();
+        }
+        printf("%-14s %8.1f MB/s\n", modeNames[mode], totalBytes / timer.best());
+    }
+
+    return 0;
+}
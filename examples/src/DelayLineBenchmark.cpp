@@ -0,0 +1,85 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "DelayLine.h"
+#include <cmath>
+#include <vector>
+
+using namespace LabSound;
+using namespace WebCore;
+using namespace std;
+
+// Times DelayLine with each interpolation over constant and modulated delays, and reports the peak output of
+// white noise through each, which a delay shouldn't much raise. The delays under a frame show whether the
+// allpass stays stable where it has no earlier frame to borrow.
+//
+// DelayLineBenchmark [quanta]
+
+enum DelayShape { ConstantWhole, ConstantFraction, ConstantUnderHalf, Chorus, LongSweep, ShapeCount };
+
+static const char* shapeNames[] = { "441 frames", "441.37 frames", "0.1 frames", "chorus", "long sweep" };
+static const char* interpolationNames[] = { "linear", "lagrange", "allpass" };
+
+static float delayAt(DelayShape shape, size_t frame, float sampleRate)
+{
+    const double pi = 3.14159265358979323846;
+    double t = frame / sampleRate;
+    switch (shape) {
+    case ConstantWhole: return 441;
+    case ConstantFraction: return 441.37f;
+    case ConstantUnderHalf: return 0.1f;
+    case Chorus: return static_cast<float>(882 + 220 * sin(2 * pi * 0.8 * t));
+    default: return static_cast<float>(30000 + 10000 * sin(2 * pi * 0.3 * t));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int quanta = intArgument(argc, argv, 1, 20000);
+    const size_t frames = AudioNode::ProcessingSizeInFrames;
+    const float sampleRate = 44100;
+
+    vector<float> source(frames), destination(frames), delays(frames);
+
+    printf("%-14s %20s %20s %20s\n", "delay", interpolationNames[0], interpolationNames[1], interpolationNames[2]);
+    printf("%-14s %20s %20s %20s\n", "", "us/quantum  peak", "us/quantum  peak", "us/quantum  peak");
+
+    for (int shape = 0; shape < ShapeCount; ++shape) {
+        printf("%-14s", shapeNames[shape]);
+        const bool constant = shape <= ConstantUnderHalf;
+
+        for (int interpolation = 0; interpolation < 3; ++interpolation) {
+            DelayLine line(44100, static_cast<DelayLine::Interpolation>(interpolation));
+            unsigned seed = 1;
+            size_t frame = 0;
+            float peak = 0;
+            double time = 0;
+
+            for (int q = 0; q < quanta; ++q) {
+                for (size_t i = 0; i < frames; ++i) {
+                    seed = seed * 1664525 + 1013904223;
+                    source[i] = ((seed >> 9) / 8388608.0f - 1) * 0.5f;
+                    delays[i] = delayAt(static_cast<DelayShape>(shape), frame + i, sampleRate);
+                }
+
+                BenchmarkTimer timer;
+                timer.start();
+                if (constant)
+                    line.process(source.data(), destination.data(), frames, static_cast<double>(delays[0]));
+                else
+                    line.process(source.data(), destination.data(), frames, delays.data());
+                time += timer.stop();
+
+                for (size_t i = 0; i < frames; ++i)
+                    peak = max(peak, fabsf(destination[i]));
+                frame += frames;
+            }
+
+            printf(" %14.3f %5.2f", time / quanta, peak);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
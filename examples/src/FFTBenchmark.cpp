@@ -0,0 +1,96 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "FFTFrame.h"
+#include <cmath>
+#include <vector>
+
+using namespace LabSound;
+using namespace WebCore;
+using namespace std;
+
+// Checks FFTFrame against a DFT done in double precision, for each power of two size from 32 to 32768, and
+// times its forward and inverse transforms. The error of the forward transform is the largest difference
+// from the DFT, relative to the DFT's largest magnitude; the round trip error is the largest difference of
+// an inverse transform of the forward transform from the input, which lies in [-1, 1].
+//
+// FFTBenchmark [transforms per size]
+
+// FFTFrame's forward transform is scaled by 2, as vDSP's is, and packs the nyquist bin into imagData()[0].
+static double forwardError(const vector<float>& input, const FFTFrame& frame)
+{
+    const size_t size = input.size();
+    vector<double> cosines(size), sines(size);
+    for (size_t i = 0; i < size; ++i) {
+        cosines[i] = cos(2 * M_PI * i / size);
+        sines[i] = -sin(2 * M_PI * i / size);
+    }
+
+    double maxError = 0;
+    double maxMagnitude = 0;
+    for (size_t k = 0; k <= size / 2; ++k) {
+        double real = 0, imag = 0;
+        for (size_t j = 0, phase = 0; j < size; ++j) {
+            real += input[j] * cosines[phase];
+            imag += input[j] * sines[phase];
+            phase += k;
+            if (phase >= size)
+                phase -= size;
+        }
+        real *= 2;
+        imag *= 2;
+
+        double frameReal = k == size / 2 ? frame.imagData()[0] : frame.realData()[k];
+        double frameImag = k == 0 || k == size / 2 ? 0 : frame.imagData()[k];
+        maxError = max(maxError, max(fabs(frameReal - real), fabs(frameImag - imag)));
+        maxMagnitude = max(maxMagnitude, sqrt(real * real + imag * imag));
+    }
+    return maxMagnitude ? maxError / maxMagnitude : maxError;
+}
+
+int main(int argc, char** argv)
+{
+    const int transforms = intArgument(argc, argv, 1, 2000);
+
+    printf("%8s %12s %12s %12s %12s  (microseconds per transform)\n", "size", "error", "round trip", "forward", "inverse");
+
+    unsigned seed = 1;
+    for (unsigned size = 32; size <= 32768; size *= 2) {
+        vector<float> input(size), output(size);
+        for (float& x : input) {
+            seed = seed * 1664525 + 1013904223;
+            x = (seed >> 8) / 8388608.0f - 1;
+        }
+
+        FFTFrame frame(size);
+        frame.doFFT(input.data());
+        double error = forwardError(input, frame);
+
+        FFTFrame inverse(frame);
+        inverse.doInverseFFT(output.data());
+        double roundTripError = 0;
+        for (unsigned i = 0; i < size; ++i)
+            roundTripError = max(roundTripError, (double) fabs(output[i] - input[i]));
+
+        // The larger sizes do fewer transforms a run, so that every size runs for about as long.
+        const int runs = 5;
+        const int transformsPerRun = max(1, static_cast<int>(transforms * 32LL / size));
+        BenchmarkTimer forwardTimer, inverseTimer;
+        for (int run = 0; run < runs; ++run) {
+            forwardTimer.start();
+            for (int i = 0; i < transformsPerRun; ++i)
+                frame.doFFT(input.data());
+            forwardTimer.stop(transformsPerRun);
+
+            inverseTimer.start();
+            for (int i = 0; i < transformsPerRun; ++i)
+                frame.doInverseFFT(output.data());
+            inverseTimer.stop(transformsPerRun);
+        }
+
+        printf("%8u %12.2e %12.2e %12.3f %12.3f\n", size, error, roundTripError, forwardTimer.best(), inverseTimer.best());
+    }
+
+    return 0;
+}
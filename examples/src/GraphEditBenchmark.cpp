@@ -0,0 +1,101 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "GainNode.h"
+#include "OscillatorNode.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace LabSound;
+using namespace std;
+
+// Patches the graph from a control thread thousands of times a second while another thread renders it at the
+// pace of an audio device, and counts the quanta the render thread lost to the context's locks.
+//
+// GraphEditBenchmark [queued] [editsPerSecond] [seconds]
+//
+// queued is 1 to edit through AudioContext::connect() and disconnect(), which queue the edit for the audio
+// thread, or 0 to take a ContextGraphLock and ContextRenderLock and edit through AudioNode::connect().
+int main(int argc, char** argv)
+{
+    const bool queued = intArgument(argc, argv, 1, 1) != 0;
+    const int editsPerSecond = intArgument(argc, argv, 2, 5000);
+    const int seconds = intArgument(argc, argv, 3, 5);
+
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+    auto destination = offline.destination();
+
+    // A tone which always plays, and a pool of gains which the control thread connects between it and the
+    // destination, and disconnects again.
+    const int poolSize = 64;
+    shared_ptr<OscillatorNode> oscillator;
+    vector<shared_ptr<GainNode>> pool;
+    {
+        ContextGraphLock g(context, "GraphEditBenchmark");
+        ContextRenderLock r(context, "GraphEditBenchmark");
+        oscillator = make_shared<OscillatorNode>(r, offline.sampleRate());
+        connect(g, r, oscillator.get(), destination.get());
+        oscillator->start(0);
+        for (int i = 0; i < poolSize; ++i) {
+            auto gain = make_shared<GainNode>(offline.sampleRate());
+            gain->gain()->setValue(1.0f / poolSize);
+            connect(g, r, gain.get(), destination.get());
+            pool.push_back(gain);
+        }
+    }
+
+    atomic<bool> running(true);
+    atomic<size_t> quanta(0);
+
+    thread renderThread([&]() {
+        const chrono::duration<double> quantumDuration(AudioNode::ProcessingSizeInFrames / offline.sampleRate());
+        auto deadline = chrono::steady_clock::now();
+        while (running) {
+            offline.render();
+            ++quanta;
+            deadline += chrono::duration_cast<chrono::steady_clock::duration>(quantumDuration);
+            this_thread::sleep_until(deadline);
+        }
+    });
+
+    size_t edits = 0;
+    size_t failedEdits = 0;
+    const chrono::duration<double> editInterval(1.0 / editsPerSecond);
+    auto start = chrono::steady_clock::now();
+    auto deadline = start;
+    while (chrono::steady_clock::now() - start < chrono::seconds(seconds)) {
+        shared_ptr<GainNode> gain = pool[(edits / 2) % poolSize];
+        const bool connecting = edits % 2 == 0;
+        if (queued) {
+            if (connecting)
+                context->connect(oscillator, gain);
+            else
+                context->disconnect(oscillator);
+        }
+        else {
+            // A lock which can't be taken, because the audio thread holds it, leaves the edit undone.
+            ContextGraphLock g(context, "GraphEditBenchmark");
+            ContextRenderLock r(context, "GraphEditBenchmark");
+            if (!g.context() || !r.context())
+                ++failedEdits;
+            else if (connecting)
+                connect(g, r, oscillator.get(), gain.get());
+            else
+                disconnect(g, r, oscillator.get());
+        }
+        ++edits;
+
+        deadline += chrono::duration_cast<chrono::steady_clock::duration>(editInterval);
+        this_thread::sleep_until(deadline);
+    }
+
+    running = false;
+    renderThread.join();
+
+    printf("%s edits: %zu edits (%zu failed) over %zu quanta, %zu quanta dropped\n",
+           queued ? "queued" : "locked", edits, failedEdits, quanta.load(), destination->droppedQuantumCount());
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "HRTFBatchPannerNode.h"
+#include "OscillatorNode.h"
+#include "PannerNode.h"
+#include <cmath>
+#include <vector>
+
+using namespace LabSound;
+using namespace std;
+
+// Spatializes sources circling the listener, each moved every quantum, at 48kHz: with a PannerNode for each
+// source, and with one HRTFBatchPannerNode for all of them. The sources play four shared oscillators, so that
+// what is timed is the panning. For each way, finds the most sources which render faster than real time on
+// the one thread rendering, the sources per core, and reports the real time load at each count tried.
+//
+// HRTFBatchPannerBenchmark [seconds per count]
+
+enum Panning { PannerNodes, BatchPanner };
+
+// Returns the fraction of real time taken to render the sources.
+static double renderLoad(Panning panning, int sources, int seconds)
+{
+    OfflineBenchmarkContext offline(48000);
+    auto context = offline.context();
+    const float sampleRate = offline.sampleRate();
+
+    vector<shared_ptr<OscillatorNode>> oscillators;
+    vector<shared_ptr<PannerNode>> panners;
+    shared_ptr<HRTFBatchPannerNode> batch;
+    {
+        ContextGraphLock g(context, "HRTFBatchPannerBenchmark");
+        ContextRenderLock r(context, "HRTFBatchPannerBenchmark");
+        ExceptionCode ec = NO_ERR;
+        context->setRenderPlanCapacity(r, sources + 16, 2 * sources + 16);
+
+        for (int i = 0; i < 4; ++i) {
+            auto oscillator = make_shared<OscillatorNode>(r, sampleRate);
+            oscillator->setType(r, i % 2 ? OscillatorNode::SAWTOOTH : OscillatorNode::SINE, ec);
+            oscillator->frequency()->setValue(110.0f * (i + 2) + 7 * i);
+            oscillator->start(0);
+            oscillators.push_back(oscillator);
+        }
+
+        if (panning == BatchPanner) {
+            batch = make_shared<HRTFBatchPannerNode>(sampleRate, sources);
+            for (int i = 0; i < sources; ++i)
+                oscillators[i % 4]->connect(g, r, batch.get(), 0, i, ec);
+            connect(g, r, batch.get(), offline.destination().get());
+        }
+        else {
+            for (int i = 0; i < sources; ++i) {
+                panners.push_back(make_shared<PannerNode>(sampleRate));
+                connect(g, r, oscillators[i % 4].get(), panners[i].get());
+                connect(g, r, panners[i].get(), offline.destination().get());
+            }
+        }
+    }
+
+    auto place = [&](int quantum) {
+        for (int i = 0; i < sources; ++i) {
+            double angle = 2 * M_PI * i / sources + 0.01 * quantum * (1 + i % 3);
+            float x = static_cast<float>(2 * sin(angle));
+            float y = static_cast<float>(0.5 * sin(3 * angle));
+            float z = static_cast<float>(-2 * cos(angle));
+            if (batch)
+                batch->setPosition(i, x, y, z);
+            else
+                panners[i]->setPosition(x, y, z);
+        }
+    };
+
+    // The panners' kernels are set up over the first blocks; that isn't timed.
+    int quantum = 0;
+    for (; quantum < 20; ++quantum) {
+        place(quantum);
+        offline.render();
+    }
+
+    const int quanta = static_cast<int>(seconds * sampleRate / AudioNode::ProcessingSizeInFrames);
+    BenchmarkTimer timer;
+    timer.start();
+    for (int q = 0; q < quanta; ++q, ++quantum) {
+        place(quantum);
+        offline.render();
+    }
+    return timer.stop(seconds * 1e6);
+}
+
+// Doubles the sources until the load passes real time, then halves the interval between the last count under
+// it and the first over.
+static int sourcesPerCore(Panning panning, int seconds)
+{
+    const char* name = panning == BatchPanner ? "batch panner" : "panner nodes";
+    int under = 0;
+    int over = 0;
+    for (int sources = 1; !over; sources *= 2) {
+        double load = renderLoad(panning, sources, seconds);
+        printf("%-14s %6d %10.3f\n", name, sources, load);
+        if (load < 1)
+            under = sources;
+        else
+            over = sources;
+    }
+    while (over - under > max(1, under / 32)) {
+        int sources = (under + over) / 2;
+        double load = renderLoad(panning, sources, seconds);
+        printf("%-14s %6d %10.3f\n", name, sources, load);
+        if (load < 1)
+            under = sources;
+        else
+            over = sources;
+    }
+    return under;
+}
+
+int main(int argc, char** argv)
+{
+    const int seconds = intArgument(argc, argv, 1, 2);
+
+    printf("%-14s %6s %10s  (fraction of real time at 48kHz)\n", "", "sources", "load");
+    int panners = sourcesPerCore(PannerNodes, seconds);
+    int batch = sourcesPerCore(BatchPanner, seconds);
+
+    printf("sources per core: %d with panner nodes, %d with the batch panner\n", panners, batch);
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "HRTFDatabase.h"
+#include <string>
+
+using namespace LabSound;
+using namespace WebCore;
+using namespace std;
+
+// Times building the HRTF database from its resources, against mapping the kernels from a cache file, at
+// 44.1kHz and 48kHz. Then times a context's startup to its first quantum, which waits on the database
+// through the loader, and so reads the loader's own cache if an earlier run left one.
+//
+// HRTFLoadBenchmark [passes]
+
+int main(int argc, char** argv)
+{
+    const int passes = intArgument(argc, argv, 1, 5);
+
+    // The benchmark's cache sits beside the loader's, so as not to replace it.
+    string directory = HRTFDatabaseLoader::cacheDirectory();
+    if (directory.empty()) {
+        printf("The HRTF cache is disabled\n");
+        return 1;
+    }
+
+    printf("sample rate        cold      cached  (milliseconds)\n");
+    const float sampleRates[] = { 44100, 48000 };
+    for (float sampleRate : sampleRates) {
+        BenchmarkTimer cold;
+        unique_ptr<HRTFDatabase> database;
+        for (int pass = 0; pass < passes; ++pass) {
+            cold.start();
+            database = HRTFDatabase::create(sampleRate);
+            cold.stop(1000);
+        }
+
+        string path = HRTFDatabaseLoader::cacheFilePath(sampleRate) + ".benchmark";
+        if (!database || !database->writeCacheFile(path)) {
+            printf("Could not write %s\n", path.c_str());
+            return 1;
+        }
+
+        BenchmarkTimer cached;
+        for (int pass = 0; pass < passes; ++pass) {
+            cached.start();
+            database = HRTFDatabase::createFromCacheFile(path, sampleRate);
+            cached.stop(1000);
+            if (!database) {
+                printf("Could not read %s\n", path.c_str());
+                return 1;
+            }
+        }
+        remove(path.c_str());
+
+        printf("%11.0f  %10.1f  %10.1f\n", sampleRate, cold.best(), cached.best());
+    }
+
+    BenchmarkTimer startup;
+    startup.start();
+    {
+        OfflineBenchmarkContext offline;
+        offline.render();
+        startup.stop(1000);
+    }
+    printf("context startup to first quantum: %.1f milliseconds\n", startup.best());
+
+    return 0;
+}
@@ -0,0 +1,242 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "ADSRNode.h"
+#include "GainNode.h"
+#include "OscillatorNode.h"
+#include "SampledInstrumentNode.h"
+#include "VoicePoolNode.h"
+#include <cmath>
+#include <vector>
+
+using namespace LabSound;
+using namespace std;
+
+// Plays a generated song as MidiSampleApp plays a MIDI file: notes start at random on 16 channels, and each is
+// held for a tenth of a second to a second. It is played three ways. As MidiSampleApp's synth does, with an
+// OscillatorNode and an ADSRNode for each note, made or recycled under the context's locks when the note's
+// quantum comes round. With a VoicePoolNode, and with a SampledInstrumentNode playing cello_pluck.json, each
+// given the notes a tenth of a second ahead, to the frame. Reports the microseconds per quantum, on average and
+// for the slowest, including the time to hand over the notes.
+//
+// MidiBenchmark [notes per second] [seconds]
+
+struct SongEvent {
+    double time;
+    uint8_t channel;
+    uint8_t key; // C0 is 0, as SampledInstrumentNode's zones count
+    uint8_t velocity; // 0 releases the note
+};
+
+static vector<SongEvent> makeSong(int notesPerSecond, int seconds)
+{
+    vector<SongEvent> song;
+    unsigned seed = 1;
+    double time = 0;
+    for (;;) {
+        seed = seed * 1664525 + 1013904223;
+        time += -log(1 - (seed >> 8) / 16777216.0) / notesPerSecond;
+        if (time >= seconds)
+            break;
+
+        SongEvent on = { time, 0, 0, 0 };
+        on.channel = (seed >> 4) % 16;
+        seed = seed * 1664525 + 1013904223;
+        on.key = (seed >> 8) % 46;
+        on.velocity = 1 + (seed >> 16) % 127;
+        seed = seed * 1664525 + 1013904223;
+        SongEvent off = { time + 0.1 + 0.9 * (seed >> 8) / 16777216.0, on.channel, on.key, 0 };
+        song.push_back(on);
+        song.push_back(off);
+    }
+
+    stable_sort(song.begin(), song.end(), [](const SongEvent& a, const SongEvent& b) { return a.time < b.time; });
+    return song;
+}
+
+static float keyFrequency(uint8_t key)
+{
+    return 440.0f * powf(2, (key - 57) / 12.0f);
+}
+
+struct Timing {
+    double mean;
+    double slowest;
+};
+
+// Renders the song, calling dispatch(now) before each quantum to hand over its notes.
+template<typename Dispatch>
+static Timing play(OfflineBenchmarkContext& offline, int seconds, Dispatch dispatch)
+{
+    const int quanta = static_cast<int>(seconds * offline.sampleRate() / AudioNode::ProcessingSizeInFrames);
+    BenchmarkTimer total, quantum;
+    double slowest = 0;
+    total.start();
+    for (int q = 0; q < quanta; ++q) {
+        quantum.start();
+        dispatch(offline.context()->currentTime());
+        offline.render();
+        slowest = max(slowest, quantum.stop());
+    }
+    Timing timing = { total.stop(quanta), slowest };
+    return timing;
+}
+
+static Timing nodePerNote(const vector<SongEvent>& song, int seconds, size_t& nodes)
+{
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+
+    struct NodeNote {
+        shared_ptr<OscillatorNode> oscillator;
+        shared_ptr<ADSRNode> envelope;
+        uint8_t channel;
+        uint8_t key;
+        bool isHeld;
+    };
+    vector<NodeNote> sounding, released;
+
+    shared_ptr<GainNode> mix = make_shared<GainNode>(offline.sampleRate());
+    mix->gain()->setValue(0.05f);
+    {
+        ContextGraphLock g(context, "MidiBenchmark");
+        ContextRenderLock r(context, "MidiBenchmark");
+        context->setRenderPlanCapacity(r, 4096, 8192);
+        connect(g, r, mix.get(), offline.destination().get());
+    }
+
+    const double quantumTime = AudioNode::ProcessingSizeInFrames / offline.sampleRate();
+    size_t next = 0;
+    Timing timing = play(offline, seconds, [&](double now) {
+        for (; next < song.size() && song[next].time < now + quantumTime; ++next) {
+            const SongEvent& event = song[next];
+            ContextGraphLock g(context, "MidiBenchmark");
+            ContextRenderLock r(context, "MidiBenchmark");
+
+            if (!event.velocity) {
+                for (NodeNote& note : sounding) {
+                    if (note.isHeld && note.channel == event.channel && note.key == event.key) {
+                        note.envelope->noteOff(r, now);
+                        note.isHeld = false;
+                    }
+                }
+                continue;
+            }
+
+            // Recycle the notes whose release has finished.
+            for (size_t i = 0; i < sounding.size(); ) {
+                if (!sounding[i].isHeld && sounding[i].envelope->finished(r)) {
+                    released.push_back(sounding[i]);
+                    sounding[i] = sounding.back();
+                    sounding.pop_back();
+                }
+                else
+                    ++i;
+            }
+
+            if (released.empty()) {
+                NodeNote note;
+                ExceptionCode ec = NO_ERR;
+                note.oscillator = make_shared<OscillatorNode>(r, offline.sampleRate());
+                note.oscillator->setType(r, OscillatorNode::SAWTOOTH, ec);
+                note.oscillator->start(0);
+                note.envelope = make_shared<ADSRNode>(offline.sampleRate());
+                connect(g, r, note.oscillator.get(), note.envelope.get());
+                connect(g, r, note.envelope.get(), mix.get());
+                released.push_back(note);
+            }
+
+            NodeNote note = released.back();
+            released.pop_back();
+            note.channel = event.channel;
+            note.key = event.key;
+            note.isHeld = true;
+            note.oscillator->frequency()->setValue(keyFrequency(event.key));
+            note.envelope->noteOn(now);
+            sounding.push_back(note);
+        }
+    });
+
+    nodes = 2 * (sounding.size() + released.size());
+    return timing;
+}
+
+static Timing voicePool(const vector<SongEvent>& song, int seconds, unsigned voices, uint64_t& stolen)
+{
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+
+    auto pool = make_shared<VoicePoolNode>(offline.sampleRate(), voices);
+    {
+        ContextGraphLock g(context, "MidiBenchmark");
+        ContextRenderLock r(context, "MidiBenchmark");
+        connect(g, r, pool.get(), offline.destination().get());
+    }
+
+    vector<VoicePoolNode::Note> held(16 * 128, 0);
+    size_t next = 0;
+    Timing timing = play(offline, seconds, [&](double now) {
+        for (; next < song.size() && song[next].time < now + 0.1; ++next) {
+            const SongEvent& event = song[next];
+            VoicePoolNode::Note& note = held[event.channel * 128 + event.key];
+            if (note)
+                pool->noteOff(note, event.time);
+            note = event.velocity ? pool->noteOn(event.time, keyFrequency(event.key), 0.05f * event.velocity / 127) : 0;
+        }
+    });
+
+    stolen = pool->stolenVoiceCount();
+    return timing;
+}
+
+static Timing sampledInstrument(const vector<SongEvent>& song, int seconds, unsigned voices, uint64_t& stolen)
+{
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+
+    auto instrument = make_shared<SampledInstrumentNode>(offline.sampleRate(), voices);
+    instrument->loadInstrumentConfiguration("cello_pluck.json");
+    instrument->gain()->setValue(0.25f);
+    {
+        ContextGraphLock g(context, "MidiBenchmark");
+        ContextRenderLock r(context, "MidiBenchmark");
+        connect(g, r, instrument.get(), offline.destination().get());
+    }
+
+    // The instrument is taken by the render thread at the start of a quantum; that isn't timed.
+    offline.render();
+
+    size_t next = 0;
+    Timing timing = play(offline, seconds, [&](double now) {
+        for (; next < song.size() && song[next].time < now + 0.1; ++next)
+            instrument->noteOn(song[next].time, song[next].key, song[next].velocity);
+    });
+
+    stolen = instrument->stolenVoiceCount();
+    return timing;
+}
+
+int main(int argc, char** argv)
+{
+    const int notesPerSecond = intArgument(argc, argv, 1, 100);
+    const int seconds = intArgument(argc, argv, 2, 20);
+    const unsigned voices = 128;
+
+    vector<SongEvent> song = makeSong(notesPerSecond, seconds);
+    printf("%zu notes in %d seconds at 44.1kHz\n", song.size() / 2, seconds);
+    printf("%-20s %10s %10s  (microseconds per quantum)\n", "", "mean", "slowest");
+
+    size_t nodes;
+    Timing timing = nodePerNote(song, seconds, nodes);
+    printf("%-20s %10.2f %10.2f  (%zu nodes)\n", "node per note", timing.mean, timing.slowest, nodes);
+
+    uint64_t stolen;
+    timing = voicePool(song, seconds, voices, stolen);
+    printf("%-20s %10.2f %10.2f  (%llu notes stole one of %u voices)\n", "voice pool", timing.mean, timing.slowest, (unsigned long long) stolen, voices);
+
+    timing = sampledInstrument(song, seconds, voices, stolen);
+    printf("%-20s %10.2f %10.2f  (%llu notes stole one of %u voices)\n", "sampled instrument", timing.mean, timing.slowest, (unsigned long long) stolen, voices);
+
+    return 0;
+}
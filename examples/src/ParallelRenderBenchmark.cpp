@@ -0,0 +1,87 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "BiquadFilterNode.h"
+#include "GainNode.h"
+#include "OscillatorNode.h"
+#include <thread>
+#include <vector>
+
+using namespace LabSound;
+using namespace std;
+
+// For each number of render threads, doubles the number of voices until a quantum takes longer to render
+// than it lasts, and reports the most voices which rendered in time. A voice is an oscillator through a
+// filter and a gain, all summed at the destination.
+//
+// ParallelRenderBenchmark [maxThreads] [quanta]
+
+static double renderTime(unsigned threads, int voices, int quanta)
+{
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+    auto destination = offline.destination();
+
+    vector<shared_ptr<AudioNode>> nodes;
+    {
+        ContextGraphLock g(context, "ParallelRenderBenchmark");
+        ContextRenderLock r(context, "ParallelRenderBenchmark");
+        context->setRenderThreadCount(r, threads);
+        context->setRenderPlanCapacity(r, 3 * voices + 16, 3 * voices + 16);
+
+        for (int v = 0; v < voices; ++v) {
+            auto oscillator = make_shared<OscillatorNode>(r, offline.sampleRate());
+            oscillator->frequency()->setValue(110.0f + v);
+            oscillator->start(0);
+
+            auto filter = make_shared<BiquadFilterNode>(offline.sampleRate());
+            filter->frequency()->setValue(1000.0f + v);
+
+            auto gain = make_shared<GainNode>(offline.sampleRate());
+            gain->gain()->setValue(1.0f / voices);
+
+            connect(g, r, oscillator.get(), filter.get());
+            connect(g, r, filter.get(), gain.get());
+            connect(g, r, gain.get(), destination.get());
+            nodes.push_back(oscillator);
+            nodes.push_back(filter);
+            nodes.push_back(gain);
+        }
+    }
+
+    for (int i = 0; i < 16; ++i)
+        offline.render();
+
+    BenchmarkTimer timer;
+    for (int pass = 0; pass < 3; ++pass) {
+        timer.start();
+        for (int q = 0; q < quanta; ++q)
+            offline.render();
+        timer.stop(quanta);
+    }
+    return timer.best();
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned maxThreads = intArgument(argc, argv, 1, max(2u, thread::hardware_concurrency()));
+    const int quanta = intArgument(argc, argv, 2, 200);
+
+    const double deadline = 1e6 * AudioNode::ProcessingSizeInFrames / 44100.0;
+    printf("quantum deadline %.0f microseconds\n", deadline);
+
+    for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+        int voicesInTime = 0;
+        double time = 0;
+        for (int voices = 16; ; voices *= 2) {
+            double t = renderTime(threads, voices, quanta);
+            if (t > deadline)
+                break;
+            voicesInTime = voices;
+            time = t;
+        }
+        printf("%u threads: %d voices in time, %.1f microseconds per quantum\n", threads, voicesInTime, time);
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "AudioParamTimeline.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace LabSound;
+using namespace std;
+
+// Schedules events on many AudioParamTimelines, alternating set values and linear ramps spread over the time
+// rendered, and calculates a quantum of sample accurate values from each as a render quantum would. It is run
+// twice: with the timelines left alone, and while another thread schedules further events on them, each of
+// which publishes a new list of events for rendering to pick up. Reports the microseconds per quantum, on
+// average and for the slowest.
+//
+// ParamTimelineBenchmark [params] [events per param] [seconds]
+
+struct Timing {
+    double mean;
+    double slowest;
+    uint64_t edits;
+};
+
+static Timing run(int params, int eventsPerParam, int seconds, bool editWhileRendering)
+{
+    const double sampleRate = 44100;
+    const unsigned frames = AudioNode::ProcessingSizeInFrames;
+
+    vector<unique_ptr<AudioParamTimeline>> timelines;
+    for (int p = 0; p < params; ++p) {
+        timelines.emplace_back(new AudioParamTimeline());
+        float offset = static_cast<float>(p) / params;
+        for (int e = 0; e < eventsPerParam; ++e) {
+            float time = seconds * (e + offset) / eventsPerParam;
+            float value = (e % 7) / 7.0f;
+            if (e & 1)
+                timelines[p]->linearRampToValueAtTime(value, time);
+            else
+                timelines[p]->setValueAtTime(value, time);
+        }
+    }
+
+    // Schedules set values a little ahead of rendering, on each timeline in turn, until rendering is done.
+    atomic<bool> isRendering(true);
+    atomic<double> renderTime(0);
+    atomic<uint64_t> edits(0);
+    thread editor;
+    if (editWhileRendering) {
+        editor = thread([&]() {
+            unsigned seed = 1;
+            for (int p = 0; isRendering.load(memory_order_relaxed); p = (p + 1) % params) {
+                seed = seed * 1664525 + 1013904223;
+                float time = static_cast<float>(renderTime.load(memory_order_relaxed) + 0.1 + (seed >> 8) / 16777216.0);
+                timelines[p]->setValueAtTime((seed >> 16) / 65536.0f, time);
+                edits.fetch_add(1, memory_order_relaxed);
+            }
+        });
+    }
+
+    vector<float> values(frames);
+    const int quanta = static_cast<int>(seconds * sampleRate / frames);
+    BenchmarkTimer total, quantum;
+    double slowest = 0;
+    total.start();
+    for (int q = 0; q < quanta; ++q) {
+        double startTime = q * frames / sampleRate;
+        double endTime = (q + 1) * frames / sampleRate;
+        quantum.start();
+        for (int p = 0; p < params; ++p)
+            timelines[p]->valuesForTimeRange(startTime, endTime, 0, values.data(), frames, sampleRate, sampleRate);
+        slowest = max(slowest, quantum.stop());
+        renderTime.store(endTime, memory_order_relaxed);
+    }
+    Timing timing = { total.stop(quanta), slowest, 0 };
+
+    isRendering = false;
+    if (editor.joinable())
+        editor.join();
+    timing.edits = edits.load();
+    return timing;
+}
+
+int main(int argc, char** argv)
+{
+    const int params = intArgument(argc, argv, 1, 1000);
+    const int eventsPerParam = intArgument(argc, argv, 2, 10000);
+    const int seconds = intArgument(argc, argv, 3, 10);
+
+    printf("%d params with %d events each, over %d seconds at 44.1kHz\n", params, eventsPerParam, seconds);
+    printf("%-20s %10s %10s  (microseconds per quantum)\n", "", "mean", "slowest");
+
+    Timing timing = run(params, eventsPerParam, seconds, false);
+    printf("%-20s %10.2f %10.2f\n", "no edits", timing.mean, timing.slowest);
+
+    timing = run(params, eventsPerParam, seconds, true);
+    printf("%-20s %10.2f %10.2f  (%llu events scheduled while rendering)\n", "while editing", timing.mean, timing.slowest, (unsigned long long) timing.edits);
+
+    return 0;
+}
@@ -36,11 +36,11 @@ int main(int argc, char *argv[], char *envp[]) {
 
 	RefPtr<EasyVerbNode> perryNode = EasyVerbNode::create(context.get(), 44100); 
 
-	PassRefPtr<SampledInstrumentNode> sampledCello = SampledInstrumentNode::create(context.get(), 44100);
+	std::shared_ptr<SampledInstrumentNode> sampledCello = std::make_shared<SampledInstrumentNode>(44100);
 	sampledCello->loadInstrumentConfiguration("cello_pluck.json");
 
-	// Connect internal output to the reverb
-	sampledCello->gainNode->connect(perryNode.get(), 0, 0, ec);
+	// Connect the instrument to the reverb
+	sampledCello->connect(perryNode.get(), 0, 0, ec);
 
 	// Perry to the master bus 
 	perryNode->connect(context->destination(), 0, 0, ec); 
@@ -53,7 +53,7 @@ int main(int argc, char *argv[], char *envp[]) {
 
 		auto delayTime = delayTimes[std::abs((int)randomTime(mt_rand))];
 
-		sampledCello->noteOn((randomOctave() * 12) + pentatonicMinor[randomScaleDegree()], 0.5);
+		sampledCello->noteOn(0, (randomOctave() * 12) + pentatonicMinor[randomScaleDegree()], 64);
 
 		std::this_thread::sleep_for(std::chrono::milliseconds(delayTime));
 
@@ -0,0 +1,140 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "AllocationCounter.h"
+#include "BiquadFilterNode.h"
+#include "GainNode.h"
+#include "OscillatorNode.h"
+#include <vector>
+
+using namespace LabSound;
+using namespace std;
+
+// Compares rendering synthetic graphs of 10, 100 and 1000 nodes by pulling from the destination with rendering
+// them from the precompiled render plan, and from a plan recompiled every quantum. A bank of LFOs modulates a
+// third of the gains and every filter's frequency, three LFOs to a param, so that the params sum their
+// connections as well.
+//
+// RenderPlanBenchmark [quanta]
+//
+// With the library built with LABSOUND_COUNT_ALLOCATIONS, it also counts the allocations made while pulling and
+// rendering from the plan after the first quantum, and fails if there were any.
+
+enum Mode { Pull, Plan, Recompile };
+
+static double run(int numberOfNodes, Mode mode, int quanta, size_t& allocations)
+{
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+    auto destination = offline.destination();
+    context->setRenderPlanEnabled(mode != Pull);
+
+    // Voices of ten nodes each: an oscillator through eight gains and a filter.
+    vector<shared_ptr<AudioNode>> nodes;
+    shared_ptr<OscillatorNode> spare;
+    {
+        ContextGraphLock g(context, "RenderPlanBenchmark");
+        ContextRenderLock r(context, "RenderPlanBenchmark");
+        ExceptionCode ec = NO_ERR;
+
+        // Each LFO drives the gains and the filter frequencies through a depth of its own for each.
+        const int LFOCount = 4;
+        const int ModulatorsPerParam = 3;
+        vector<shared_ptr<GainNode>> gainDepths, frequencyDepths;
+        for (int i = 0; i < LFOCount; ++i) {
+            auto lfo = make_shared<OscillatorNode>(r, offline.sampleRate());
+            lfo->frequency()->setValue(0.5f + i);
+            lfo->start(0);
+            nodes.push_back(lfo);
+
+            auto gainDepth = make_shared<GainNode>(offline.sampleRate());
+            gainDepth->gain()->setValue(0.003f);
+            connect(g, r, lfo.get(), gainDepth.get());
+            gainDepths.push_back(gainDepth);
+            nodes.push_back(gainDepth);
+
+            auto frequencyDepth = make_shared<GainNode>(offline.sampleRate());
+            frequencyDepth->gain()->setValue(100);
+            connect(g, r, lfo.get(), frequencyDepth.get());
+            frequencyDepths.push_back(frequencyDepth);
+            nodes.push_back(frequencyDepth);
+        }
+
+        for (int v = 0; v < numberOfNodes / 10; ++v) {
+            auto oscillator = make_shared<OscillatorNode>(r, offline.sampleRate());
+            oscillator->frequency()->setValue(220.0f + v);
+            oscillator->start(0);
+            nodes.push_back(oscillator);
+
+            shared_ptr<AudioNode> previous = oscillator;
+            for (int i = 0; i < 8; ++i) {
+                auto gain = make_shared<GainNode>(offline.sampleRate());
+                gain->gain()->setValue(0.99f);
+                if (i % 3 == 0) {
+                    for (int m = 0; m < ModulatorsPerParam; ++m)
+                        gainDepths[(v + i + m) % LFOCount]->connect(g, gain->gain(), 0, ec);
+                }
+                connect(g, r, previous.get(), gain.get());
+                nodes.push_back(gain);
+                previous = gain;
+            }
+
+            auto filter = make_shared<BiquadFilterNode>(offline.sampleRate());
+            for (int m = 0; m < ModulatorsPerParam; ++m)
+                frequencyDepths[(v + m) % LFOCount]->connect(g, filter->frequency(), 0, ec);
+            connect(g, r, previous.get(), filter.get());
+            connect(g, r, filter.get(), destination.get());
+            nodes.push_back(filter);
+        }
+
+        // Connected and disconnected every quantum to dirty the plan.
+        spare = make_shared<OscillatorNode>(r, offline.sampleRate());
+    }
+
+    // The first quantum settles the graph; from then on rendering should allocate nothing.
+    offline.render();
+
+    BenchmarkTimer timer;
+    size_t allocationsBefore = allocationCount();
+    for (int pass = 0; pass < 5; ++pass) {
+        timer.start();
+        for (int q = 0; q < quanta; ++q) {
+            if (mode == Recompile) {
+                if (q % 2)
+                    context->disconnect(spare);
+                else
+                    context->connect(spare, destination);
+            }
+            offline.render();
+        }
+        timer.stop(quanta);
+    }
+
+    // Recompiling queues an edit from this thread every quantum, which allocates by design.
+    allocations = mode == Recompile ? 0 : allocationCount() - allocationsBefore;
+    return timer.best();
+}
+
+int main(int argc, char** argv)
+{
+    const int quanta = intArgument(argc, argv, 1, 1000);
+
+    printf("nodes      pull      plan  recompile  (microseconds per quantum)\n");
+    size_t totalAllocations = 0;
+    const int sizes[] = { 10, 100, 1000 };
+    for (int numberOfNodes : sizes) {
+        size_t pullAllocations, planAllocations, recompileAllocations;
+        double pull = run(numberOfNodes, Pull, quanta, pullAllocations);
+        double plan = run(numberOfNodes, Plan, quanta, planAllocations);
+        double recompile = run(numberOfNodes, Recompile, quanta, recompileAllocations);
+        printf("%5d  %8.2f  %8.2f  %9.2f\n", numberOfNodes, pull, plan, recompile);
+        totalAllocations += pullAllocations + planAllocations;
+    }
+
+    if (allocationCountingEnabled()) {
+        printf("%zu allocations while rendering\n", totalAllocations);
+        return totalAllocations ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "StreamingAudioSourceNode.h"
+#include <atomic>
+#include <thread>
+
+using namespace LabSound;
+using namespace std;
+
+// Streams a looping file, and times a render quantum on its own, and while another thread sets the file over
+// and over, which shouldn't hold rendering up. Then seeks, and times how long the decoder takes to deliver.
+// Rendering runs as fast as it can, so the underruns show how much faster than real time the decoder runs.
+//
+// StreamingBenchmark [file] [quanta]
+
+static bool isSilent(AudioBus& bus)
+{
+    for (unsigned c = 0; c < bus.numberOfChannels(); ++c) {
+        const float* data = bus.channel(c)->data();
+        for (size_t i = 0; i < bus.length(); ++i) {
+            if (data[i])
+                return false;
+        }
+    }
+    return true;
+}
+
+// Renders until the node plays, and returns the microseconds that took.
+static double renderUntilAudible(OfflineBenchmarkContext& offline)
+{
+    BenchmarkTimer timer;
+    timer.start();
+    for (int q = 0; q < 100000 && isSilent(offline.render()); ++q)
+        this_thread::yield();
+    return timer.stop();
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "trainrolling.wav";
+    const int quanta = intArgument(argc, argv, 2, 20000);
+
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+    auto destination = offline.destination();
+
+    // Looping is set first, as the decoder may reach the end of a short file before playback starts.
+    auto node = make_shared<StreamingAudioSourceNode>(offline.sampleRate());
+    node->setLoop(true);
+    if (!node->setFile(path)) {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+    {
+        ContextGraphLock g(context, "StreamingBenchmark");
+        ContextRenderLock r(context, "StreamingBenchmark");
+        connect(g, r, node.get(), destination.get());
+    }
+    node->startGrain(0, 0);
+    printf("%s: %.2f seconds, %u channels\n", path, node->duration(), node->numberOfChannels());
+    printf("first audio after %.0f microseconds\n", renderUntilAudible(offline));
+
+    BenchmarkTimer steady, total;
+    double slowest = 0;
+    uint64_t underruns = node->underrunFrames();
+    total.start();
+    for (int q = 0; q < quanta; ++q) {
+        steady.start();
+        offline.render();
+        slowest = max(slowest, steady.stop());
+    }
+    double seconds = total.stop() * 1e-6;
+    uint64_t delivered = uint64_t(quanta) * AudioNode::ProcessingSizeInFrames - (node->underrunFrames() - underruns);
+    printf("streaming: %.2f microseconds per quantum, slowest %.2f; the decoder delivered %.1f seconds of audio a second\n",
+           steady.best(), slowest, delivered / offline.sampleRate() / seconds);
+
+    // Set the file again and again from another thread while rendering.
+    atomic<bool> done(false);
+    atomic<int> files(0);
+    BenchmarkTimer setFileTimer;
+    thread control([&]() {
+        while (!done.load()) {
+            setFileTimer.start();
+            node->setFile(path);
+            setFileTimer.stop();
+            node->startGrain(0, 0);
+            ++files;
+        }
+    });
+
+    BenchmarkTimer switching;
+    slowest = 0;
+    for (int q = 0; q < quanta; ++q) {
+        switching.start();
+        offline.render();
+        slowest = max(slowest, switching.stop());
+    }
+    done.store(true);
+    control.join();
+    printf("setting the file %d times: %.2f microseconds per quantum, slowest %.2f; setFile took %.0f microseconds at best\n",
+           files.load(), switching.best(), slowest, setFileTimer.best());
+
+    renderUntilAudible(offline);
+    BenchmarkTimer seekTimer;
+    for (int pass = 0; pass < 10; ++pass) {
+        node->seek(node->duration() * pass / 10);
+        underruns = node->underrunFrames();
+        seekTimer.start();
+        renderUntilAudible(offline);
+        seekTimer.stop();
+        if (node->underrunFrames() != underruns)
+            printf("waiting for a seek was counted as an underrun\n");
+    }
+    printf("seek: audio after %.0f microseconds at best\n", seekTimer.best());
+
+    return 0;
+}
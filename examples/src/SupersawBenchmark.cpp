@@ -0,0 +1,123 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "GainNode.h"
+#include "OscillatorNode.h"
+#include "SupersawNode.h"
+#include <vector>
+
+using namespace LabSound;
+using namespace std;
+
+// Times setting up and rendering a SupersawNode of 1, 10 and 100 saws, and banks of 100 oscillators: sines,
+// which take the pure sine path, and sawtooths at a constant frequency and swept by an LFO.
+//
+// SupersawBenchmark [quanta]
+
+static void supersaw(int saws, int quanta)
+{
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+    auto destination = offline.destination();
+
+    BenchmarkTimer setup;
+    shared_ptr<SupersawNode> node;
+    {
+        ContextGraphLock g(context, "SupersawBenchmark");
+        ContextRenderLock r(context, "SupersawBenchmark");
+        setup.start();
+        node = make_shared<SupersawNode>(g, r, offline.sampleRate());
+        node->sawCount()->setValue(static_cast<float>(saws));
+        node->frequency()->setValue(110);
+        node->detune()->setValue(40);
+        node->update(g, r);
+        setup.stop(1000);
+        node->noteOn(0);
+        connect(g, r, node.get(), destination.get());
+    }
+
+    for (int i = 0; i < 16; ++i)
+        offline.render();
+
+    BenchmarkTimer timer;
+    for (int pass = 0; pass < 3; ++pass) {
+        timer.start();
+        for (int q = 0; q < quanta; ++q)
+            offline.render();
+        timer.stop(quanta);
+    }
+    printf("supersaw, %3d saws   %10.2f  %24.2f\n", saws, setup.best(), timer.best());
+}
+
+enum Bank { Sines, Saws, SweptSaws };
+
+static void oscillatorBank(Bank bank, int quanta)
+{
+    const char* names[] = { "100 sines", "100 saws", "100 swept saws" };
+    const int count = 100;
+
+    OfflineBenchmarkContext offline;
+    auto context = offline.context();
+    auto destination = offline.destination();
+
+    BenchmarkTimer setup;
+    vector<shared_ptr<AudioNode>> nodes;
+    {
+        ContextGraphLock g(context, "SupersawBenchmark");
+        ContextRenderLock r(context, "SupersawBenchmark");
+        ExceptionCode ec = NO_ERR;
+
+        shared_ptr<GainNode> depth;
+        if (bank == SweptSaws) {
+            auto lfo = make_shared<OscillatorNode>(r, offline.sampleRate());
+            lfo->frequency()->setValue(3);
+            lfo->start(0);
+            depth = make_shared<GainNode>(offline.sampleRate());
+            depth->gain()->setValue(50);
+            connect(g, r, lfo.get(), depth.get());
+            nodes.push_back(lfo);
+            nodes.push_back(depth);
+        }
+
+        setup.start();
+        for (int i = 0; i < count; ++i) {
+            auto oscillator = make_shared<OscillatorNode>(r, offline.sampleRate());
+            oscillator->setType(r, bank == Sines ? OscillatorNode::SINE : OscillatorNode::SAWTOOTH, ec);
+            oscillator->frequency()->setValue(110.0f + i);
+            oscillator->start(0);
+            if (depth)
+                depth->connect(g, oscillator->frequency(), 0, ec);
+            connect(g, r, oscillator.get(), destination.get());
+            nodes.push_back(oscillator);
+        }
+        setup.stop(1000);
+    }
+
+    for (int i = 0; i < 16; ++i)
+        offline.render();
+
+    BenchmarkTimer timer;
+    for (int pass = 0; pass < 3; ++pass) {
+        timer.start();
+        for (int q = 0; q < quanta; ++q)
+            offline.render();
+        timer.stop(quanta);
+    }
+    printf("%-20s %10.2f  %24.2f\n", names[bank], setup.best(), timer.best());
+}
+
+int main(int argc, char** argv)
+{
+    const int quanta = intArgument(argc, argv, 1, 1000);
+
+    printf("%-20s %10s  %24s\n", "", "setup ms", "microseconds per quantum");
+    const int sawCounts[] = { 1, 10, 100 };
+    for (int saws : sawCounts)
+        supersaw(saws, quanta);
+
+    oscillatorBank(Sines, quanta);
+    oscillatorBank(Saws, quanta);
+    oscillatorBank(SweptSaws, quanta);
+    return 0;
+}
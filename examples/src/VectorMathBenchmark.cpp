@@ -0,0 +1,128 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "VectorMath.h"
+#include <cmath>
+#include <vector>
+
+using namespace LabSound;
+using namespace WebCore::VectorMath;
+using namespace std;
+
+// Times the VectorMath kernels over a render quantum with each instruction set the CPU supports, and checks
+// each against the portable kernels.
+//
+// VectorMathBenchmark [iterations] [frames]
+
+static const char* instructionSetNames[] = { "portable", "avx2", "avx512" };
+
+static const char* kernelNames[] = { "vsma", "vsmul", "vadd", "vmul", "zvmul", "zvmula", "vsvesq", "vmaxmgv", "vclip", "vrampmuladd", "vsum" };
+static const int KernelCount = sizeof(kernelNames) / sizeof(kernelNames[0]);
+
+struct Buffers {
+    Buffers(size_t frames)
+    : frames(frames), x(frames), y(frames), z(frames), w(frames), a(frames), b(frames), result(0)
+    {
+        for (size_t i = 0; i < frames; ++i) {
+            x[i] = sinf(0.01f * i);
+            y[i] = cosf(0.03f * i);
+            z[i] = sinf(0.07f * i + 1);
+            w[i] = cosf(0.11f * i + 2);
+        }
+    }
+
+    // Restores the outputs, so that kernels which accumulate into them do the same work every run.
+    void clear()
+    {
+        fill(a.begin(), a.end(), 0.5f);
+        fill(b.begin(), b.end(), 0.25f);
+        result = 0;
+    }
+
+    void run(int kernel)
+    {
+        float scale = 0.7f, low = -0.5f, high = 0.5f, start = 0.1f, step = 0.001f;
+        const float* sources[3] = { x.data(), y.data(), z.data() };
+        switch (kernel) {
+        case 0: vsma(x.data(), 1, &scale, a.data(), 1, frames); break;
+        case 1: vsmul(x.data(), 1, &scale, a.data(), 1, frames); break;
+        case 2: vadd(x.data(), 1, y.data(), 1, a.data(), 1, frames); break;
+        case 3: vmul(x.data(), 1, y.data(), 1, a.data(), 1, frames); break;
+        case 4: zvmul(x.data(), y.data(), z.data(), w.data(), a.data(), b.data(), frames); break;
+        case 5: zvmula(x.data(), y.data(), z.data(), w.data(), a.data(), b.data(), frames); break;
+        case 6: vsvesq(x.data(), 1, &result, frames); break;
+        case 7: vmaxmgv(x.data(), 1, &result, frames); break;
+        case 8: vclip(x.data(), 1, &low, &high, a.data(), 1, frames); break;
+        case 9: vrampmuladd(x.data(), 1, &start, &step, a.data(), 1, frames); break;
+        case 10: vsum(sources, 3, a.data(), frames); break;
+        }
+    }
+
+    size_t frames;
+    vector<float> x, y, z, w, a, b;
+    float result;
+};
+
+static double difference(const Buffers& reference, const Buffers& buffers)
+{
+    double maxDifference = fabs(reference.result - buffers.result) / (1 + fabs(reference.result));
+    for (size_t i = 0; i < reference.frames; ++i) {
+        maxDifference = max(maxDifference, (double) fabs(reference.a[i] - buffers.a[i]));
+        maxDifference = max(maxDifference, (double) fabs(reference.b[i] - buffers.b[i]));
+    }
+    return maxDifference;
+}
+
+int main(int argc, char** argv)
+{
+    const int iterations = intArgument(argc, argv, 1, 100000);
+    const size_t frames = intArgument(argc, argv, 2, AudioNode::ProcessingSizeInFrames);
+
+    // Asking for an instruction set the CPU lacks selects a narrower one, so only those which stick are timed.
+    vector<InstructionSet> instructionSets;
+    const InstructionSet candidates[] = { InstructionSetPortable, InstructionSetAVX2, InstructionSetAVX512 };
+    for (InstructionSet candidate : candidates) {
+        setInstructionSet(candidate);
+        if (instructionSet() == candidate)
+            instructionSets.push_back(candidate);
+    }
+
+    printf("%-12s", "kernel");
+    for (InstructionSet instructionSet : instructionSets)
+        printf(" %10s", instructionSetNames[instructionSet]);
+    printf("  (nanoseconds per call of %zu frames)\n", frames);
+
+    bool correct = true;
+    for (int kernel = 0; kernel < KernelCount; ++kernel) {
+        Buffers reference(frames);
+        setInstructionSet(InstructionSetPortable);
+        reference.clear();
+        reference.run(kernel);
+
+        printf("%-12s", kernelNames[kernel]);
+        for (InstructionSet instructionSet : instructionSets) {
+            setInstructionSet(instructionSet);
+            Buffers buffers(frames);
+            buffers.clear();
+            buffers.run(kernel);
+            if (difference(reference, buffers) > 1e-4) {
+                printf("\n%s differs from the portable kernel with %s\n", kernelNames[kernel], instructionSetNames[instructionSet]);
+                correct = false;
+            }
+
+            BenchmarkTimer timer;
+            for (int pass = 0; pass < 5; ++pass) {
+                buffers.clear();
+                timer.start();
+                for (int i = 0; i < iterations; ++i)
+                    buffers.run(kernel);
+                timer.stop(iterations);
+            }
+            printf(" %10.1f", 1000 * timer.best());
+        }
+        printf("\n");
+    }
+
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "Benchmark.h"
+#include "ADSRNode.h"
+#include "GainNode.h"
+#include "OscillatorNode.h"
+#include "VoicePoolNode.h"
+#include <cmath>
+#include <vector>
+
+using namespace LabSound;
+using namespace std;
+
+// Plays 1000 sawtooth notes at 48kHz with a VoicePoolNode, against an OscillatorNode and an ADSRNode for each
+// note, mixed by a GainNode, and reports the time to set them up and to render a quantum. Then starts notes
+// faster than a full pool releases them, to time stealing voices.
+//
+// VoicePoolBenchmark [voices] [quanta]
+
+static float noteFrequency(int i)
+{
+    return 55.0f * powf(2, (i % 60) / 12.0f);
+}
+
+static double renderTime(OfflineBenchmarkContext& offline, int quanta)
+{
+    for (int i = 0; i < 16; ++i)
+        offline.render();
+
+    BenchmarkTimer timer;
+    for (int pass = 0; pass < 3; ++pass) {
+        timer.start();
+        for (int q = 0; q < quanta; ++q)
+            offline.render();
+        timer.stop(quanta);
+    }
+    return timer.best();
+}
+
+static void voicePool(int voices, int quanta)
+{
+    OfflineBenchmarkContext offline(48000);
+    auto context = offline.context();
+
+    BenchmarkTimer setup;
+    setup.start();
+    auto pool = make_shared<VoicePoolNode>(offline.sampleRate(), voices);
+    {
+        ContextGraphLock g(context, "VoicePoolBenchmark");
+        ContextRenderLock r(context, "VoicePoolBenchmark");
+        connect(g, r, pool.get(), offline.destination().get());
+    }
+    for (int i = 0; i < voices; ++i)
+        pool->noteOn(0, noteFrequency(i), 1.0f / voices);
+    setup.stop(1000);
+
+    double time = renderTime(offline, quanta);
+    printf("voice pool     %10.2f  %24.2f  (%u voices sounding)\n", setup.best(), time, pool->activeVoiceCount());
+}
+
+static void nodePerVoice(int voices, int quanta)
+{
+    OfflineBenchmarkContext offline(48000);
+    auto context = offline.context();
+
+    BenchmarkTimer setup;
+    vector<shared_ptr<AudioNode>> nodes;
+    {
+        ContextGraphLock g(context, "VoicePoolBenchmark");
+        ContextRenderLock r(context, "VoicePoolBenchmark");
+        ExceptionCode ec = NO_ERR;
+        context->setRenderPlanCapacity(r, 2 * voices + 16, 2 * voices + 16);
+
+        setup.start();
+        auto mix = make_shared<GainNode>(offline.sampleRate());
+        mix->gain()->setValue(1.0f / voices);
+        connect(g, r, mix.get(), offline.destination().get());
+        nodes.push_back(mix);
+
+        for (int i = 0; i < voices; ++i) {
+            auto oscillator = make_shared<OscillatorNode>(r, offline.sampleRate());
+            oscillator->setType(r, OscillatorNode::SAWTOOTH, ec);
+            oscillator->frequency()->setValue(noteFrequency(i));
+            oscillator->start(0);
+
+            auto envelope = make_shared<ADSRNode>(offline.sampleRate());
+            envelope->noteOn(0);
+
+            connect(g, r, oscillator.get(), envelope.get());
+            connect(g, r, envelope.get(), mix.get());
+            nodes.push_back(oscillator);
+            nodes.push_back(envelope);
+        }
+        setup.stop(1000);
+    }
+
+    double time = renderTime(offline, quanta);
+    printf("node per voice %10.2f  %24.2f\n", setup.best(), time);
+}
+
+static void stealing(int voices, int quanta)
+{
+    OfflineBenchmarkContext offline(48000);
+    auto context = offline.context();
+
+    auto pool = make_shared<VoicePoolNode>(offline.sampleRate(), voices);
+    pool->releaseTime()->setValue(1);
+    {
+        ContextGraphLock g(context, "VoicePoolBenchmark");
+        ContextRenderLock r(context, "VoicePoolBenchmark");
+        connect(g, r, pool.get(), offline.destination().get());
+    }
+
+    // Each quantum starts a tenth of the pool's worth of notes, and releases them a quantum later. They start
+    // together, as the voices are rendered in pieces between the frames of the changes in a quantum.
+    const int notesPerQuantum = max(voices / 10, 1);
+    vector<VoicePoolNode::Note> notes;
+    BenchmarkTimer timer;
+    timer.start();
+    for (int q = 0; q < quanta; ++q) {
+        double now = context->currentTime();
+        for (VoicePoolNode::Note note : notes)
+            pool->noteOff(note, now);
+        notes.clear();
+        for (int i = 0; i < notesPerQuantum; ++i)
+            notes.push_back(pool->noteOn(now, noteFrequency(q + i), 1.0f / voices));
+        offline.render();
+    }
+    timer.stop(quanta);
+    printf("stealing       %10s  %24.2f  (%llu notes stole a voice)\n", "", timer.best(), (unsigned long long) pool->stolenVoiceCount());
+}
+
+int main(int argc, char** argv)
+{
+    const int voices = intArgument(argc, argv, 1, 1000);
+    const int quanta = intArgument(argc, argv, 2, 500);
+
+    printf("%d voices at 48kHz\n", voices);
+    printf("%-14s %10s  %24s\n", "", "setup ms", "microseconds per quantum");
+    voicePool(voices, quanta);
+    nodePerVoice(voices, quanta);
+    stealing(voices, quanta);
+    return 0;
+}
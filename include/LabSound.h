@@ -54,6 +54,10 @@ namespace LabSound {
         NodeTypeSpectralMonitor,
         NodeTypeSupersaw,
 		NodeTypeSTK, 
+        NodeTypeStreamingAudioSource,
+        NodeTypeHRTFBatchPanner,
+        NodeTypeVoicePool,
+        NodeTypeSampledInstrument,
 
     };
     
@@ -66,7 +70,8 @@ namespace LabSound {
     // when done with the context call finish
     void finish(std::shared_ptr<LabSound::AudioContext> context);
     
-    // Connect/Disconnect return true on success
+    // Connect/Disconnect return true on success.
+    // The caller holds the context's locks; AudioContext::connect() and disconnect() queue the edit instead.
     bool connect(ContextGraphLock& g, ContextRenderLock& r, AudioNode* thisOutput, AudioNode* toThisInput);
     bool disconnect(ContextGraphLock& g, ContextRenderLock& r, AudioNode* thisOutput);
 }
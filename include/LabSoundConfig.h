@@ -30,6 +30,11 @@
 # endif
 #endif
 
+// Define to 1 to count every allocation the process makes, as described in AllocationCounter.h.
+#ifndef LABSOUND_COUNT_ALLOCATIONS
+#  define LABSOUND_COUNT_ALLOCATIONS 0
+#endif
+
 #if OS(WINDOWS)
 #  ifndef _WIN32_WINNT
 #    define _WIN32_WINNT 0x0500
@@ -16,6 +16,8 @@
 #include "SoundBuffer.h"
 #include "SupersawNode.h"
 #include "SpatializationNode.h"
+#include "HRTFBatchPannerNode.h"
+#include "VoicePoolNode.h"
 #include "SpectralMonitorNode.h"
 
 // Additional WIP Nodes
@@ -0,0 +1,26 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef AllocationCounter_h
+#define AllocationCounter_h
+
+#include <cstddef>
+
+// Built with LABSOUND_COUNT_ALLOCATIONS defined to 1, the library replaces the global operator new and
+// delete with ones which count every allocation in the process. Comparing the count before and after
+// rendering some quanta shows whether the render thread allocated, which it must not do once a graph is
+// settled. Other threads allocate too, so the count is only meaningful while they are quiet.
+//
+// The counting costs an atomic increment per allocation, and is off by default.
+
+namespace LabSound {
+
+    // Returns false when the library was built without LABSOUND_COUNT_ALLOCATIONS.
+    bool allocationCountingEnabled();
+
+    // The allocations made since the program started, or 0 if counting isn't enabled.
+    size_t allocationCount();
+
+}
+
+#endif // AllocationCounter_h
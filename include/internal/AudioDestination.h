@@ -29,6 +29,8 @@
 #ifndef AudioDestination_h
 #define AudioDestination_h
 
+#include <cstddef>
+
 namespace WebCore {
 
 class AudioIOCallback;
@@ -50,6 +52,9 @@ public:
     // Sample-rate conversion may happen in AudioDestination to the hardware sample-rate
     virtual float sampleRate() const = 0;
     static float hardwareSampleRate();
+
+    // The number of times the hardware wanted audio before it was ready, on platforms which report it.
+    virtual size_t xrunCount() const { return 0; }
 };
 
 } // namespace WebCore
@@ -0,0 +1,61 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef AudioFileDecoder_h
+#define AudioFileDecoder_h
+
+#include <memory>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace WebCore {
+
+class AudioBus;
+class AudioFileStream;
+
+// AudioFileDecoder reads uncompressed WAV and AIFF files, and FLAC files, without any platform support.
+// The file is read in large blocks, and samples are decoded at the file's sample-rate with its channels.
+
+class AudioFileDecoder {
+public:
+    // Return null if the file isn't one the decoder understands.
+    // In-memory data isn't copied, and must outlive the decoder.
+    static std::unique_ptr<AudioFileDecoder> open(const char* filePath);
+    static std::unique_ptr<AudioFileDecoder> open(const void* data, size_t dataSize);
+
+    virtual ~AudioFileDecoder() { }
+
+    unsigned numberOfChannels() const { return m_numberOfChannels; }
+    float sampleRate() const { return m_sampleRate; }
+    uint64_t length() const { return m_length; }
+
+    // Returns false if the position couldn't be reached.
+    virtual bool seek(uint64_t frame) = 0;
+
+    // Decodes up to framesToRead frames, one array per channel. Returns the number of frames decoded,
+    // which is less at the end of the file, or where the file is damaged.
+    virtual size_t read(float* const* channels, size_t framesToRead) = 0;
+
+protected:
+    AudioFileDecoder()
+        : m_numberOfChannels(0)
+        , m_sampleRate(0)
+        , m_length(0)
+    {
+    }
+
+    unsigned m_numberOfChannels;
+    float m_sampleRate;
+    uint64_t m_length;
+};
+
+// Reads a decoder as an AudioFileStream, mixing its channels down to mono if asked, and converting to sampleRate
+// as it goes. Pass 0 for sampleRate to keep the file's. Returns null if the decoder is.
+std::unique_ptr<AudioFileStream> createAudioFileStream(std::unique_ptr<AudioFileDecoder>, float sampleRate, bool mixToMono);
+
+// Reads the whole of a stream into a new bus, at the stream's sample-rate.
+std::unique_ptr<AudioBus> createBusFromAudioFileStream(AudioFileStream&);
+
+} // namespace WebCore
+
+#endif // AudioFileDecoder_h
@@ -29,6 +29,8 @@
 #ifndef AudioFileReader_h
 #define AudioFileReader_h
 
+#include <memory>
+#include <stdint.h>
 #include <stdlib.h>
 
 namespace WebCore {
@@ -47,6 +49,28 @@ std::unique_ptr<AudioBus> createBusFromAudioFile(const char* filePath, bool mixT
 // May pass in 0.0 for sampleRate in which case it will use the AudioBus's sampleRate                               
 void writeBusToAudioFile(AudioBus* bus, const char* filePath, double fileSampleRate);
 
+// AudioFileStream decodes a file a block at a time, for files too long to hold in memory.
+// Frames are counted at the stream's sample-rate.
+
+class AudioFileStream {
+public:
+    virtual ~AudioFileStream() { }
+
+    virtual unsigned numberOfChannels() const = 0;
+    virtual float sampleRate() const = 0;
+    virtual uint64_t length() const = 0;
+
+    // Returns false if the position couldn't be reached.
+    virtual bool seek(uint64_t frame) = 0;
+
+    // Decodes up to framesToRead frames into the start of the bus's channels, which must be at least that long
+    // and as many as the stream's. Returns the number of frames decoded, which is less at the end of the file.
+    virtual size_t read(AudioBus*, size_t framesToRead) = 0;
+};
+
+// Returns null if the file can't be opened. The sample-rate is as for the create functions above.
+std::unique_ptr<AudioFileStream> createAudioFileStream(const char* filePath, float sampleRate);
+
 } // namespace WebCore
 
 #endif // AudioFileReader_h
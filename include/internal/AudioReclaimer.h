@@ -0,0 +1,74 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef AudioReclaimer_h
+#define AudioReclaimer_h
+
+#include "LockFreeQueue.h"
+#include "WTF/Threading.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace WebCore {
+
+// AudioReclaimer takes the audio thread's last references to nodes and other objects, and
+// releases them on a thread of its own, so that destructors never run on the audio thread.
+//
+// Raw pointers to a retired object may still be held by the rendering state (the rendering
+// connections of summing junctions, the render plan) until the audio thread next updates it.
+// The audio thread advances an epoch at the end of every render quantum, and an object retired
+// during one epoch is only released once the epoch after it has ended as well, by which time
+// the audio thread has caught up with every graph change made before the object was retired.
+
+class AudioReclaimer {
+public:
+    AudioReclaimer();
+    ~AudioReclaimer();
+
+    // Called from the audio thread and the render plan's worker threads. Takes no lock and never allocates
+    // unless the queue to the reclaimer is full.
+    void retire(std::shared_ptr<void> object);
+
+    // Called from the audio thread at the end of every render quantum.
+    void advanceEpoch();
+
+    // Releases everything retired so far on the calling thread.
+    // Only call this when the audio thread is no longer rendering.
+    void reclaimAll();
+
+private:
+    struct Retired {
+        std::shared_ptr<void> object;
+        uint64_t epoch;
+    };
+
+    static void reclaimerEntry(void* threadData);
+    void reclaimerLoop();
+    void reclaim(uint64_t safeEpoch);
+
+    LabSound::lockfree_queue<Retired> m_retired;
+    std::atomic<uint64_t> m_epoch;
+
+    // Holds what didn't fit in m_retired until the next epoch. Any render thread may spill into it, so
+    // it is only accessed with m_overflowMutex held; m_overflowCount lets retire() pass it by unlocked.
+    std::vector<Retired> m_overflow;
+    std::atomic<size_t> m_overflowCount;
+    std::mutex m_overflowMutex;
+
+    // Only accessed by the reclaimer thread, or with m_reclaimMutex held.
+    std::vector<Retired> m_pending;
+    std::mutex m_reclaimMutex;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_shouldExit;
+    ThreadIdentifier m_thread;
+};
+
+} // namespace WebCore
+
+#endif // AudioReclaimer_h
@@ -0,0 +1,64 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef AudioRenderThreadPool_h
+#define AudioRenderThreadPool_h
+
+#include "WTF/Threading.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace WebCore {
+
+// A fixed set of worker threads which help the audio thread render a quantum.
+// run() wakes the workers, calls job.run() on every worker and on the calling thread,
+// and returns once all of them have returned. The calling thread is participant 0.
+//
+// Between quanta the workers spin briefly and then sleep, so that an idle context costs nothing,
+// and the audio thread only touches the mutex when a worker actually went to sleep.
+// Each worker is pinned to its own core where the platform allows it.
+
+class AudioRenderThreadPool {
+public:
+    class Job {
+    public:
+        virtual ~Job() {}
+        virtual void run(unsigned participant) = 0;
+    };
+
+    // numberOfThreads counts the calling thread, so a pool of one starts no workers.
+    explicit AudioRenderThreadPool(unsigned numberOfThreads);
+    ~AudioRenderThreadPool();
+
+    unsigned numberOfThreads() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+    // Called from the audio thread.
+    void run(Job& job);
+
+private:
+    struct Worker {
+        AudioRenderThreadPool* pool;
+        unsigned participant;
+        ThreadIdentifier thread;
+    };
+
+    static void workerEntry(void* threadData);
+    void workerLoop(unsigned participant);
+
+    std::vector<Worker> m_workers;
+    Job* m_job;
+
+    std::atomic<unsigned> m_epoch;
+    std::atomic<unsigned> m_running;
+    std::atomic<unsigned> m_sleeping;
+    std::atomic<bool> m_shouldExit;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+};
+
+} // namespace WebCore
+
+#endif // AudioRenderThreadPool_h
@@ -71,6 +71,16 @@ public:
     // Resets filter state
     void reset();
 
+    // Takes another biquad's coefficients, keeping this one's filter state.
+    void setCoefficients(const Biquad&);
+
+    // The normalized coefficients, as described below.
+    double b0() const { return m_b0; }
+    double b1() const { return m_b1; }
+    double b2() const { return m_b2; }
+    double a1() const { return m_a1; }
+    double a2() const { return m_a2; }
+
     // Filter response at a set of n frequencies. The magnitude and
     // phase response are returned in magResponse and phaseResponse.
     // The phase response is in radians.
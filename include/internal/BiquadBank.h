@@ -0,0 +1,90 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef BiquadBank_h
+#define BiquadBank_h
+
+#include "AudioArray.h"
+#include <cstddef>
+
+namespace WebCore {
+
+class Biquad;
+
+// Runs a number of biquad filters side by side, each in a lane of a SIMD register, so that the
+// channels of a node are filtered together rather than one at a time. Each lane is a cascade of
+// second order sections, filtered in one pass over the samples.
+//
+// BiquadProcessor keeps a bank per node, with a lane per channel. Lanes are independent, so a bank
+// could filter many nodes' channels at once, but nothing in the render plan gathers filters from
+// different nodes into one bank; a mono filter fills one lane of four.
+//
+// The sections are in transposed direct form II, which keeps its state well conditioned in single
+// precision. DoublePrecision keeps the state and the arithmetic in double, for very low or very
+// sharp filters, at about half the speed.
+
+class BiquadBank {
+public:
+    enum Precision {
+        SinglePrecision,
+        DoublePrecision
+    };
+
+    BiquadBank(unsigned numberOfLanes, unsigned numberOfSections = 1, Precision = SinglePrecision);
+
+    unsigned numberOfLanes() const { return m_numberOfLanes; }
+    unsigned numberOfSections() const { return m_numberOfSections; }
+    Precision precision() const { return m_precision; }
+
+    // The filter is y[n] + a1*y[n-1] + a2*y[n-2] = b0*x[n] + b1*x[n-1] + b2*x[n-2], as for Biquad.
+    // Sections start out as pass-thru.
+    void setCoefficients(unsigned lane, unsigned section, double b0, double b1, double b2, double a1, double a2);
+    void setCoefficients(unsigned lane, unsigned section, const Biquad&);
+
+    // Moves a section's coefficients a step each frame during the next process(), which should be
+    // framesToRamp long, so that they arrive at the biquad's on its last frame. This is how a filter
+    // is swept smoothly between coefficients which are only computed every few frames.
+    void rampCoefficients(unsigned lane, unsigned section, const Biquad&, size_t framesToRamp);
+
+    // Clears the filter memory of every lane.
+    void reset();
+
+    // Filters one channel per lane. A destination may be the same as its source.
+    void process(const float* const* sourcesP, float* const* destsP, size_t framesToProcess);
+
+    // The lanes filtered together in one register.
+    static const unsigned LaneWidth = 4;
+
+private:
+    enum Coefficient { B0, B1, B2, A1, A2, NumberOfCoefficients };
+
+    // Coefficients and state are stored a group of LaneWidth lanes at a time, each value for all the
+    // lanes of a group side by side, so that a group's values load straight into registers.
+    size_t coefficientIndex(unsigned lane, unsigned section, Coefficient) const;
+
+    void processGroupSingle(unsigned group, size_t framesToProcess);
+    void processGroupDouble(unsigned group, size_t framesToProcess);
+
+    unsigned m_numberOfLanes;
+    unsigned m_numberOfSections;
+    unsigned m_numberOfGroups;
+    Precision m_precision;
+
+    AudioFloatArray m_coefficients;
+    AudioDoubleArray m_doubleCoefficients;
+    AudioFloatArray m_state;
+    AudioDoubleArray m_doubleState;
+
+    // Ramps, laid out as the coefficients are. The targets are taken exactly once a ramp is over.
+    bool m_isRamping;
+    AudioFloatArray m_increments;
+    AudioDoubleArray m_doubleIncrements;
+    AudioDoubleArray m_targets;
+
+    // One slice of a group's channels, interleaved.
+    AudioFloatArray m_interleaved;
+};
+
+} // namespace WebCore
+
+#endif // BiquadBank_h
@@ -0,0 +1,67 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef DelayLine_h
+#define DelayLine_h
+
+#include "AudioArray.h"
+#include <cstddef>
+
+namespace WebCore {
+
+// A delay line which writes and reads a block of frames at a time. The buffer is a power of two long,
+// so positions wrap with a mask rather than a modulo. A constant delay is read a contiguous run of the
+// buffer at a time; a delay which changes every frame is read four frames at a time where SIMD is available.
+//
+// Delays are in frames, and may be fractional. They are clamped to [0, maxDelayFrames].
+
+class DelayLine {
+public:
+    enum Interpolation {
+        // Two taps. Cheap, but dulls the high frequencies a little at fractional delays.
+        LinearInterpolation,
+        // Third order Lagrange over four taps, flatter through the audible band. Delays under a frame
+        // are interpolated linearly, since the fourth tap would be in the future.
+        LagrangeInterpolation,
+        // A first order allpass, which has a perfectly flat response, but keeps state and so is suited to
+        // constant or slowly changing delays only. Delays under half a frame are interpolated linearly.
+        AllpassInterpolation
+    };
+
+    explicit DelayLine(size_t maxDelayFrames, Interpolation = LinearInterpolation);
+
+    size_t maxDelayFrames() const { return m_maxDelayFrames; }
+
+    Interpolation interpolation() const { return m_interpolation; }
+    void setInterpolation(Interpolation);
+
+    void reset();
+
+    // Writes the source into the delay line, and reads it back delayed into the destination, which may
+    // be the same as the source. The first form delays every frame alike, the second each frame by its own delay.
+    void process(const float* source, float* destination, size_t framesToProcess, double delayFrames);
+    void process(const float* source, float* destination, size_t framesToProcess, const float* delayFrames);
+
+private:
+    void write(const float* source, size_t framesToProcess);
+
+    // Adds a run of the buffer, scaled, into the destination; or replaces the destination with it if |replace|.
+    void readTap(size_t position, float scale, float* destination, size_t framesToProcess, bool replace);
+
+    void readConstant(float* destination, size_t framesToProcess, double delayFrames);
+    void readModulated(float* destination, size_t framesToProcess, const float* delayFrames);
+
+    AudioFloatArray m_buffer;
+    size_t m_mask;
+    size_t m_maxDelayFrames;
+
+    // Counts frames written, and is only masked when it indexes the buffer.
+    size_t m_writePosition;
+
+    Interpolation m_interpolation;
+    float m_allpassOutput;
+};
+
+} // namespace WebCore
+
+#endif // DelayLine_h
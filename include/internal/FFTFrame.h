@@ -45,11 +45,6 @@
 #include <Accelerate/Accelerate.h>
 #endif // !USE_ACCELERATE_FFT
 
-#if USE(WEBAUDIO_KISSFFT)
-#include <kissfft/kiss_fft.hpp>
-#include <kissfft/kiss_fftr.hpp>
-#endif // USE(WEBAUDIO_KISSFFT)
-
 #include "WTF/Threading.h"
 
 namespace WebCore {
@@ -112,20 +107,20 @@ private:
 #else // !USE_ACCELERATE_FFT
     
 #if USE(WEBAUDIO_KISSFFT)
-    
-    static kiss_fft_cfg contextForSize(unsigned fftSize, int trans);
-
-    kiss_fft_cfg m_forwardContext;
-    kiss_fft_cfg m_inverseContext;
 
-    kiss_fft_cpx* m_cpxInputData;
-    kiss_fft_cpx* m_cpxOutputData;
+    // The sine and cosine tables of Ooura's real FFT, shared by every frame of the same size.
+    struct OouraPlan;
+    static const OouraPlan* planForSize(unsigned fftSize);
 
-	std::vector<kiss_fft_cpx> mOutputBuffer; 
+    const OouraPlan* m_plan;
 
+    // Split complex, laid out like vDSP's: realData()[0] holds DC and imagData()[0] holds nyquist.
     AudioFloatArray m_realData;
     AudioFloatArray m_imagData;
-    
+
+    // The transform is done in place, on interleaved data.
+    AudioFloatArray m_workData;
+
 #endif
 
 #endif // !USE_ACCELERATE_FFT
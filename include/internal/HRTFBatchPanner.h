@@ -0,0 +1,96 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef HRTFBatchPanner_h
+#define HRTFBatchPanner_h
+
+#include "AudioArray.h"
+#include "DelayLine.h"
+#include "FFTFrame.h"
+#include <memory>
+#include <vector>
+
+namespace WebCore {
+
+class AudioBus;
+class HRTFDatabase;
+class HRTFDatabaseLoader;
+
+// HRTFBatchPanner spatializes many mono sources into one binaural output. Where an HRTFPanner per source
+// runs four FFTs a block for each, the batch runs two forward FFTs per source, multiplies each spectrum by
+// the shared database kernels and accumulates it into one spectrum per ear, and then runs a single inverse
+// FFT per ear for all the sources together.
+//
+// Blocks, latency and tail are those of HRTFPanner at the same sample-rate. Moving sources cross-fade between
+// kernels as HRTFPanner does, but a block at a time, by blending the two kernels' spectra.
+
+class HRTFBatchPanner {
+public:
+    HRTFBatchPanner(float sampleRate, unsigned numberOfSources);
+    ~HRTFBatchPanner();
+
+    unsigned numberOfSources() const { return static_cast<unsigned>(m_sources.size()); }
+
+    // Positions a source for the frames processed next. Azimuth is in the range -180 -> +180, as for Panner::pan(),
+    // and gain is the source's distance and cone gain, which is ramped to from the previous gain over the next frames.
+    void setSource(unsigned source, double azimuth, double elevation, float gain);
+
+    // Pans one mono channel per source, summing them into the stereo output. A null source is silent; a source
+    // which has been silent for a whole block is skipped until it sounds again.
+    void pan(const float* const* sourcesP, AudioBus* outputBus, size_t framesToProcess);
+
+    void reset();
+
+    float sampleRate() const { return m_sampleRate; }
+    size_t fftSize() const { return m_fftSize; }
+
+    double tailTime() const;
+    double latencyTime() const;
+
+private:
+    struct Source;
+
+    // Starts any cross-fades needed for sources which have moved since the last block.
+    void beginBlock();
+
+    // Delays a division of a source's input into its block, applying its gain.
+    void delaySource(HRTFDatabase*, Source&, const float* sourceP, size_t framesToProcess);
+
+    // Transforms every sounding source and accumulates it against its kernels, then transforms the sum back.
+    void processBlock(HRTFDatabase*);
+
+    // Multiplies a source spectrum by a kernel, adding the product to an accumulator, as FFTFrame::multiply() would.
+    void accumulate(const FFTFrame& sourceFrame, const FFTFrame& kernel, FFTFrame& accumulator);
+
+    float m_sampleRate;
+    size_t m_fftSize;
+
+    // Shared with every panner at this sample-rate.
+    std::shared_ptr<HRTFDatabaseLoader> m_databaseLoader;
+
+    std::vector<std::unique_ptr<Source>> m_sources;
+
+    // All sources fill their blocks in step, so one index serves them all.
+    size_t m_readWriteIndex;
+
+    // Scratch for the forward transforms and for blending kernels during cross-fades.
+    FFTFrame m_sourceFrame;
+    FFTFrame m_blendedKernel;
+
+    // One spectrum per ear, summed over the sources.
+    FFTFrame m_accumulatorL;
+    FFTFrame m_accumulatorR;
+
+    AudioFloatArray m_outputL;
+    AudioFloatArray m_outputR;
+    AudioFloatArray m_lastOverlapL;
+    AudioFloatArray m_lastOverlapR;
+
+    // Per-frame delays, while a source's inter-aural delay moves, and silence to run through the delay lines.
+    AudioFloatArray m_delayRamp;
+    AudioFloatArray m_silence;
+};
+
+} // namespace WebCore
+
+#endif // HRTFBatchPanner_h
@@ -30,6 +30,7 @@
 #define HRTFDatabase_h
 
 #include "HRTFElevation.h"
+#include <string>
 #include <vector>
 
 namespace WebCore {
@@ -39,13 +40,21 @@ class HRTFKernel;
 class HRTFDatabase {
     HRTFDatabase(const HRTFDatabase&); // noncopyable
 public:
+    // Loads and processes every elevation from resources, spreading the elevations across the machine's cores.
     static std::unique_ptr<HRTFDatabase> create(float sampleRate);
 
+    // Maps a cache file written by writeCacheFile(), and fills the database with its kernels, bypassing the resources.
+    // Returns null if the file is missing, or was written by another version or for another sample-rate.
+    static std::unique_ptr<HRTFDatabase> createFromCacheFile(const std::string& path, float sampleRate);
+
+    // Writes the final, interpolated kernels as a cache file. Returns false if the database is incomplete or the file can't be written.
+    bool writeCacheFile(const std::string& path) const;
+
     // getKernelsFromAzimuthElevation() returns a left and right ear kernel, and an interpolated left and right frame delay for the given azimuth and elevation.
     // azimuthBlend must be in the range 0 -> 1.
     // Valid values for azimuthIndex are 0 -> HRTFElevation::NumberOfTotalAzimuths - 1 (corresponding to angles of 0 -> 360).
     // Valid values for elevationAngle are MinElevation -> MaxElevation.
-    void getKernelsFromAzimuthElevation(double azimuthBlend, unsigned azimuthIndex, double elevationAngle, HRTFKernel* &kernelL, HRTFKernel* &kernelR, double& frameDelayL, double& frameDelayR);
+    void getKernelsFromAzimuthElevation(double azimuthBlend, unsigned azimuthIndex, double elevationAngle, HRTFKernel* &kernelL, HRTFKernel* &kernelR, double& frameDelayL, double& frameDelayR) const;
 
     // Returns the number of different azimuth angles.
     static unsigned numberOfAzimuths() { return HRTFElevation::NumberOfTotalAzimuths; }
@@ -58,6 +67,8 @@ public:
 private:
     explicit HRTFDatabase(float sampleRate);
 
+    void loadElevations();
+
     // Minimum and maximum elevation angles (inclusive) for a HRTFDatabase.
     static const int MinElevation;
     static const int MaxElevation;
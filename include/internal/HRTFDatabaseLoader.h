@@ -32,57 +32,65 @@
 #include "HRTFDatabase.h"
 #include "WTF/ThreadSafeRefCounted.h"
 #include "WTF/RefPtr.h"
+#include <atomic>
 #include <mutex>
+#include <string>
 
 namespace WebCore {
 
-// HRTFDatabaseLoader will asynchronously load the default HRTFDatabase in a new thread.
+// HRTFDatabaseLoader will asynchronously load the HRTFDatabase for a sample-rate in a new thread.
+// There is one loader per sample-rate in the process, shared by every context and panner running at that rate;
+// once loaded, its database is never modified, so any number of audio threads may read it at once.
+// The first load at a sample-rate writes the processed kernels to a cache file, which later loads map instead.
 
 class HRTFDatabaseLoader : public ThreadSafeRefCounted<HRTFDatabaseLoader> {
 public:
-    // Both constructor and destructor must be called from the main thread.
-    // It's expected that the singletons will be accessed instead.
-    // @CBB the guts of the loader should be a private singleton, so that the loader can be constructed without a factory
+    // It's expected that the registered loaders will be accessed instead.
+    // @CBB the guts of the loader should be private, so that the loader can be constructed without a factory
     explicit HRTFDatabaseLoader(float sampleRate);
     
-    // Lazily creates the singleton HRTFDatabaseLoader (if not already created) and starts loading asynchronously (when created the first time).
-    // Returns the singleton HRTFDatabaseLoader.
-    // Must be called from the main thread.
+    // Lazily creates the HRTFDatabaseLoader for sampleRate (if not already created) and starts loading asynchronously (when created the first time).
+    // Returns the loader for sampleRate, which lives as long as the process.
+    // May be called from any thread but the audio thread.
     static std::shared_ptr<HRTFDatabaseLoader> createAndLoadAsynchronouslyIfNecessary(float sampleRate);
 
-    // Returns the singleton HRTFDatabaseLoader.
-    static std::shared_ptr<HRTFDatabaseLoader> loader() { return s_loader; }
+    // Returns the loader for sampleRate, or null if none has been created.
+    static std::shared_ptr<HRTFDatabaseLoader> loader(float sampleRate);
     
-    // Both constructor and destructor must be called from the main thread.
     ~HRTFDatabaseLoader();
     
-    // Returns true once the default database has been completely loaded.
+    // Returns true once the database has been completely loaded.
     bool isLoaded() const;
 
     // waitForLoaderThreadCompletion() may be called more than once and is thread-safe.
     void waitForLoaderThreadCompletion();
     
-    HRTFDatabase* database() { return m_hrtfDatabase.get(); }
+    // Returns null until the database has been loaded. This can be called from any thread.
+    HRTFDatabase* database() const { return m_isLoaded.load(std::memory_order_acquire) ? m_hrtfDatabase.get() : 0; }
 
     float databaseSampleRate() const { return m_databaseSampleRate; }
     
     // Called in asynchronous loading thread.
     void load();
 
-    // defaultHRTFDatabase() gives access to the loaded database.
-    // This can be called from any thread, but it is the callers responsibilty to call this while the context (and thus HRTFDatabaseLoader)
-    // is still alive.  Otherwise this will return 0.
-    static HRTFDatabase* defaultHRTFDatabase();
+    // Where kernel cache files are written; the system's temporary directory by default.
+    // An empty path disables the cache. Takes effect on the next load.
+    static void setCacheDirectory(const std::string&);
+    static std::string cacheDirectory();
+
+    // The cache file for a sample-rate, or an empty path if the cache is disabled.
+    static std::string cacheFilePath(float sampleRate);
 
 private:
     
-    // If it hasn't already been loaded, creates a new thread and initiates asynchronous loading of the default database.
-    // This must be called from the main thread.
+    // If it hasn't already been loaded, creates a new thread and initiates asynchronous loading of the database.
     void loadAsynchronously();
 
-    static std::shared_ptr<HRTFDatabaseLoader> s_loader; // singleton
     std::unique_ptr<HRTFDatabase> m_hrtfDatabase;
 
+    // Set once m_hrtfDatabase is complete, which publishes it to other threads.
+    std::atomic<bool> m_isLoaded;
+
     // Holding a m_threadLock is required when accessing m_databaseLoaderThread.
     std::mutex m_threadLock;
     ThreadIdentifier m_databaseLoaderThread;
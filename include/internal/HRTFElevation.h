@@ -60,7 +60,7 @@ public:
     
     // Returns the left and right kernels for the given azimuth index.
     // The interpolated delays based on azimuthBlend: 0 -> 1 are returned in frameDelayL and frameDelayR.
-    void getKernelsFromAzimuth(double azimuthBlend, unsigned azimuthIndex, HRTFKernel* &kernelL, HRTFKernel* &kernelR, double& frameDelayL, double& frameDelayR);
+    void getKernelsFromAzimuth(double azimuthBlend, unsigned azimuthIndex, HRTFKernel* &kernelL, HRTFKernel* &kernelR, double& frameDelayL, double& frameDelayR) const;
     
     // Spacing, in degrees, between every azimuth loaded from resource.
     static const unsigned AzimuthSpacing;
@@ -88,6 +88,8 @@ public:
                                                              std::shared_ptr<HRTFKernel>& kernelL, std::shared_ptr<HRTFKernel>& kernelR);
 
 private:
+    friend class HRTFDatabase; // creates elevations from a cache file
+
     HRTFElevation(std::unique_ptr<HRTFKernelList> kernelListL, std::unique_ptr<HRTFKernelList> kernelListR, int elevation, float sampleRate)
     : m_kernelListL(std::move(kernelListL))
     , m_kernelListR(std::move(kernelListR))
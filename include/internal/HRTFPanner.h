@@ -31,6 +31,8 @@
 
 namespace WebCore {
 
+class HRTFDatabaseLoader;
+
 class HRTFPanner : public Panner {
 public:
     explicit HRTFPanner(float sampleRate);
@@ -55,6 +57,9 @@ private:
 
     float m_sampleRate;
 
+    // Shared with every other panner at this sample-rate.
+    std::shared_ptr<HRTFDatabaseLoader> m_databaseLoader;
+
     // We maintain two sets of convolvers for smooth cross-faded interpolations when
     // then azimuth and elevation are dynamically changing.
     // When the azimuth and elevation are not changing, we simply process with one of the two sets.
@@ -0,0 +1,59 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef HalfBandResampler_h
+#define HalfBandResampler_h
+
+#include "AudioArray.h"
+#include <cstddef>
+
+namespace WebCore {
+
+// Polyphase half-band filters for oversampling by two. Every other tap of a half-band filter is zero but
+// for the centre, so one phase of the filter is a plain delay, and only the other, a half-sample
+// interpolator, is computed. Each of its taps is applied to a whole block at a time.
+// Chain two of each to oversample by four.
+
+class UpSampler {
+public:
+    explicit UpSampler(size_t inputBlockSize);
+
+    // Writes twice as many frames to the destination as it reads from the source.
+    void process(const float* source, float* destination, size_t sourceFramesToProcess);
+    void reset();
+
+    // The delay of the filter, in frames at the input rate.
+    size_t latencyFrames() const;
+
+private:
+    size_t m_inputBlockSize;
+    AudioFloatArray m_kernel;
+
+    // The end of the last block, followed by the block being processed.
+    AudioFloatArray m_input;
+    AudioFloatArray m_halfSamples;
+};
+
+class DownSampler {
+public:
+    explicit DownSampler(size_t inputBlockSize);
+
+    // Writes half as many frames to the destination as it reads from the source, which must be an even number.
+    void process(const float* source, float* destination, size_t sourceFramesToProcess);
+    void reset();
+
+    // The delay of the filter, in frames at the output rate.
+    size_t latencyFrames() const;
+
+private:
+    size_t m_inputBlockSize;
+    AudioFloatArray m_kernel;
+
+    // The even and odd input frames, each after the end of the last block's.
+    AudioFloatArray m_evenInput;
+    AudioFloatArray m_oddInput;
+};
+
+} // namespace WebCore
+
+#endif // HalfBandResampler_h
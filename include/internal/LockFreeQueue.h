@@ -0,0 +1,127 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+//
+//  LockFreeQueue.h
+//  LabSound
+//
+// Bounded multi-producer queue after Dmitry Vyukov's array based MPMC queue.
+// http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+//
+// Unlike concurrent_queue, neither push nor try_pop ever take a mutex, so it is
+// safe to pop from the audio thread. push fails instead of growing when full.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace LabSound {
+
+template<typename Data>
+class lockfree_queue
+{
+private:
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        Data data;
+    };
+
+    std::unique_ptr<cell[]> the_buffer;
+    size_t the_mask;
+
+    // producers and the consumer hammer on different ends, keep them off each other's cache line
+    char pad0[64];
+    std::atomic<size_t> the_enqueue_pos;
+    char pad1[64];
+    std::atomic<size_t> the_dequeue_pos;
+    char pad2[64];
+
+    lockfree_queue(const lockfree_queue&) = delete;
+    lockfree_queue& operator=(const lockfree_queue&) = delete;
+
+public:
+    // capacity is rounded up to the next power of two
+    explicit lockfree_queue(size_t capacity = 1024)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+
+        the_buffer.reset(new cell[size]);
+        the_mask = size - 1;
+
+        for (size_t i = 0; i < size; ++i)
+            the_buffer[i].sequence.store(i, std::memory_order_relaxed);
+
+        the_enqueue_pos.store(0, std::memory_order_relaxed);
+        the_dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return the_mask + 1; }
+
+    // returns false if the queue is full
+    bool push(Data data)
+    {
+        cell* c;
+        size_t pos = the_enqueue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            c = &the_buffer[pos & the_mask];
+            size_t seq = c->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+            if (dif == 0)
+            {
+                if (the_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = the_enqueue_pos.load(std::memory_order_relaxed);
+        }
+
+        c->data = std::move(data);
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(Data& popped_value)
+    {
+        cell* c;
+        size_t pos = the_dequeue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            c = &the_buffer[pos & the_mask];
+            size_t seq = c->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+            if (dif == 0)
+            {
+                if (the_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = the_dequeue_pos.load(std::memory_order_relaxed);
+        }
+
+        popped_value = std::move(c->data);
+        c->data = Data();
+        c->sequence.store(pos + the_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        size_t pos = the_dequeue_pos.load(std::memory_order_relaxed);
+        const cell& c = the_buffer[pos & the_mask];
+        return (intptr_t) c.sequence.load(std::memory_order_acquire) - (intptr_t) (pos + 1) < 0;
+    }
+};
+
+} // LabSound
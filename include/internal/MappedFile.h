@@ -0,0 +1,54 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef MappedFile_h
+#define MappedFile_h
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace WebCore {
+
+// A whole file mapped read-only into memory. Pages are read from disk as they are first touched,
+// and may be dropped again by the system under memory pressure, since they are backed by the file.
+
+class MappedFile {
+public:
+    // Returns null if the file can't be opened or mapped, or is empty.
+    static std::shared_ptr<MappedFile> open(const char* filePath);
+
+    ~MappedFile();
+
+    const void* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    // Asks the system to start reading the whole file in, so that the pages are likely to be resident by the
+    // time they are touched, on the audio thread say. Returns immediately.
+    void prefetch() const;
+
+private:
+    MappedFile();
+
+    MappedFile(const MappedFile&); // noncopyable
+    MappedFile& operator=(const MappedFile&);
+
+    const void* m_data;
+    size_t m_size;
+
+    // The file mapping object, where the platform keeps one open alongside the view.
+    void* m_mapping;
+};
+
+// Cache files which are mapped are written aside and then moved into place, so that no reader ever maps one
+// half written. Returns a path beside the given one which is unique to the process and the call, so that
+// processes writing the same cache file at once don't write into each other's.
+std::string temporaryPathFor(const std::string& path);
+
+// Moves temporaryPath over path in one step, replacing any file there, so that a reader finds either the old
+// file or the new one. Returns false on failure, and leaves temporaryPath for the caller to remove.
+bool replaceFile(const std::string& temporaryPath, const std::string& path);
+
+} // namespace WebCore
+
+#endif // MappedFile_h
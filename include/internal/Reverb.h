@@ -51,6 +51,9 @@ public:
     size_t impulseResponseLength() const { return m_impulseResponseLength; }
     size_t latencyFrames() const;
 
+    // The scale which brings an impulse response to a standard loudness, as normalize applies.
+    static float calculateNormalizationScale(AudioBus* response);
+
 private:
     void initialize(AudioBus* impulseResponseBuffer, size_t renderSliceSize, size_t maxFFTSize, size_t numberOfChannels, bool useBackgroundThreads);
 
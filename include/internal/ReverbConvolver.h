@@ -35,6 +35,8 @@
 #include "ReverbAccumulationBuffer.h"
 #include "ReverbConvolverStage.h"
 #include "ReverbInputBuffer.h"
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <vector>
 
@@ -68,6 +70,9 @@ public:
     bool useBackgroundThreads() const { return m_useBackgroundThreads; }
     void backgroundThreadEntry();
 
+    // Blocks until the background thread has processed all the input written so far.
+    void waitForBackgroundThread();
+
     size_t latencyFrames() const;
 private:
     std::vector<std::unique_ptr<ReverbConvolverStage> > m_stages;
@@ -89,10 +94,16 @@ private:
     // Background thread and synchronization
     bool m_useBackgroundThreads;
     ThreadIdentifier m_backgroundThread;
-    bool m_wantsToExit;
+    std::atomic<bool> m_wantsToExit;
+
+    // Guarded by m_backgroundThreadLock: whether there is input the background thread hasn't been woken for,
+    // and the input buffer's write index as of when the background thread last caught up.
     bool m_moreInputBuffered;
+    size_t m_backgroundWriteIndex;
+
     mutable std::mutex m_backgroundThreadLock;
     mutable std::condition_variable m_backgroundThreadCondition;
+    mutable std::condition_variable m_backgroundCaughtUpCondition;
 };
 
 } // namespace WebCore
@@ -30,6 +30,7 @@
 #define ReverbInputBuffer_h
 
 #include "AudioArray.h"
+#include <atomic>
 
 namespace WebCore {
 
@@ -44,7 +45,7 @@ public:
     void write(const float* sourceP, size_t numberOfFrames);
 
     // Background threads can call this to check if there's anything to read...
-    size_t writeIndex() const { return m_writeIndex; }
+    size_t writeIndex() const { return m_writeIndex.load(std::memory_order_acquire); }
 
     // The individual background threads read here (and hope that they can keep up with the buffer writing).
     // readIndex is updated with the next readIndex to read from...
@@ -56,7 +57,9 @@ public:
 
 private:
     AudioFloatArray m_buffer;
-    size_t m_writeIndex;
+
+    // Published after the samples are written, so a background thread which sees it sees them too.
+    std::atomic<size_t> m_writeIndex;
 };
 
 } // namespace WebCore
@@ -0,0 +1,91 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef UniformConvolver_h
+#define UniformConvolver_h
+
+#include "AudioArray.h"
+#include "FFTFrame.h"
+#include <memory>
+#include <vector>
+
+namespace WebCore {
+
+class AudioBus;
+
+// UniformConvolver convolves several input channels with a matrix of impulse responses, by uniformly
+// partitioned overlap-save convolution. Each input is transformed once per partition, and its spectra are kept
+// in a frequency-domain delay line which every output it feeds shares, so a true-stereo or ambisonic response
+// costs one forward FFT per input and one inverse FFT per output, whatever the number of paths between them.
+//
+// The first partition of each response is convolved directly in the time domain, so there is no latency. The
+// multiply-accumulates for the rest of the response are spread evenly over the render quanta of each partition.
+
+class UniformConvolver {
+public:
+    enum { DefaultPartitionSize = 1024 };
+
+    // Convolves one input channel with one channel of the impulse response, summing into one output channel.
+    struct Path {
+        unsigned input;
+        unsigned output;
+        unsigned responseChannel;
+    };
+
+    // The paths Reverb uses to process a stereo input to a stereo output with a 1, 2 or 4 channel response.
+    static std::vector<Path> stereoPaths(unsigned numberOfResponseChannels);
+
+    // partitionSize is a power of two, and needn't match the frames processed at a time. Larger partitions
+    // make the tail cheaper, but lengthen the head convolved directly. The response is scaled by scale, and
+    // isn't modified.
+    UniformConvolver(const AudioBus* impulseResponse, const std::vector<Path>& paths, unsigned numberOfInputs, unsigned numberOfOutputs,
+                     size_t partitionSize, float scale);
+    ~UniformConvolver();
+
+    // A mono source bus feeds every input.
+    void process(const AudioBus* sourceBus, AudioBus* destinationBus, size_t framesToProcess);
+    void reset();
+
+    size_t impulseResponseLength() const { return m_impulseResponseLength; }
+    size_t partitionSize() const { return m_partitionSize; }
+    size_t latencyFrames() const { return 0; }
+
+private:
+    struct Input;
+    struct Kernel;
+
+    // Convolves a division of a partition with the first partition of each response.
+    void processHead(size_t framesToProcess);
+
+    // Accumulates the products of partitions [begin, end) of each response with the inputs' delayed spectra.
+    void accumulate(size_t begin, size_t end);
+
+    // Transforms the partition just completed, and transforms back the outputs to be played during the next one.
+    void processPartition();
+
+    size_t m_impulseResponseLength;
+    size_t m_partitionSize;
+    size_t m_numberOfPartitions; // in the frequency domain, after the head
+
+    std::vector<Path> m_paths;
+    std::vector<std::unique_ptr<Input>> m_inputs;
+    std::vector<std::unique_ptr<Kernel>> m_kernels; // one per path
+
+    // One spectrum per output, summed over the paths and partitions, and the outputs for the current partition.
+    std::vector<std::unique_ptr<FFTFrame>> m_accumulators;
+    std::vector<std::unique_ptr<AudioFloatArray>> m_outputs;
+
+    // Where in the current partition the next frame goes, the partitions accumulated so far for the next
+    // partition's outputs, and the slot of the newest spectrum in the delay lines.
+    size_t m_position;
+    size_t m_partitionsAccumulated;
+    size_t m_newestSpectrum;
+
+    // The current block of each output, and scratch for the inverse transforms.
+    std::vector<float*> m_destinations;
+    AudioFloatArray m_inverse;
+};
+
+} // namespace WebCore
+
+#endif // UniformConvolver_h
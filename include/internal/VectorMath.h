@@ -27,6 +27,8 @@
 
 // Defines the interface for several vector math functions whose implementation will ideally be optimized.
 
+#include <cstddef>
+
 namespace WebCore {
 
 namespace VectorMath {
@@ -51,9 +53,46 @@ void vmul(const float* source1P, int sourceStride1, const float* source2P, int s
 // Multiplies two complex vectors.
 void zvmul(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess);
 
+// Multiplies two complex vectors and adds the product to the destination.
+void zvmula(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess);
+
 // Copies elements while clipping values to the threshold inputs.
 void vclip(const float* sourceP, int sourceStride, const float* lowThresholdP, const float* highThresholdP, float* destP, int destStride, size_t framesToProcess);
 
+// Multiplies a vector by a ramp and adds it to the destination: the ramp starts at *startP and
+// increases by *stepP each frame. On return *startP holds the value the ramp would continue from.
+void vrampmuladd(const float* sourceP, int sourceStride, float* startP, const float* stepP, float* destP, int destStride, size_t framesToProcess);
+
+// Fills a vector with a linear ramp, which starts at *startP and increases by *stepP each frame.
+// On return *startP holds the value the ramp would continue from.
+void vramp(float* startP, const float* stepP, float* destP, int destStride, size_t framesToProcess);
+
+// Fills a vector with a geometric series plus a constant: destP[i] = *offsetP + *startP * pow(*ratioP, i).
+// Exponential ramps have no offset, and exponential approaches to a target are offset by the target.
+// On return *startP holds the term the series would continue from.
+void vexpramp(float* startP, const float* ratioP, const float* offsetP, float* destP, int destStride, size_t framesToProcess);
+
+// Sums several vectors into the destination, which may be one of the sources.
+void vsum(const float* const* sourcesP, unsigned numberOfSources, float* destP, size_t framesToProcess);
+
+// Interleaves channels into one vector, scaling them as it goes, and the reverse.
+void vinterleave(const float* const* sourcesP, unsigned numberOfChannels, const float* scale, float* destP, size_t framesToProcess);
+void vdeinterleave(const float* sourceP, unsigned numberOfChannels, const float* scale, float* const* destsP, size_t framesToProcess);
+
+// On x86 the functions above are run with the widest instructions the CPU supports, found when
+// first needed. Everywhere else, and for strides other than one, only InstructionSetPortable is used.
+enum InstructionSet {
+    InstructionSetPortable, // SSE2 or NEON where the compiler targets them, otherwise scalar code.
+    InstructionSetAVX2,     // AVX2 and FMA.
+    InstructionSetAVX512    // AVX-512F.
+};
+
+InstructionSet instructionSet();
+
+// Restricts the functions to an instruction set, which is useful for comparing them.
+// Asking for one the CPU doesn't support selects the best one it does.
+void setInstructionSet(InstructionSet);
+
 } // namespace VectorMath
 
 } // namespace WebCore
@@ -0,0 +1,62 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef VectorMathX86_h
+#define VectorMathX86_h
+
+#include <cstddef>
+
+// AVX2 and AVX-512 versions of the VectorMath functions, which VectorMath.cpp chooses between at run time.
+// They only handle unit strides, and must only be called once the CPU is known to support them.
+// The AVX-512 set leaves out the interleaving functions, which gain nothing from the wider registers.
+
+namespace WebCore {
+
+namespace VectorMath {
+
+bool cpuSupportsAVX2();
+bool cpuSupportsAVX512();
+
+namespace avx2 {
+
+void vsma(const float* sourceP, float scale, float* destP, size_t framesToProcess);
+void vsmul(const float* sourceP, float scale, float* destP, size_t framesToProcess);
+void vadd(const float* source1P, const float* source2P, float* destP, size_t framesToProcess);
+void vmul(const float* source1P, const float* source2P, float* destP, size_t framesToProcess);
+void zvmul(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess);
+void zvmula(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess);
+float vsvesq(const float* sourceP, size_t framesToProcess);
+float vmaxmgv(const float* sourceP, size_t framesToProcess);
+void vclip(const float* sourceP, float lowThreshold, float highThreshold, float* destP, size_t framesToProcess);
+void vrampmuladd(const float* sourceP, float start, float step, float* destP, size_t framesToProcess);
+void vramp(float start, float step, float* destP, size_t framesToProcess);
+float vexpramp(float start, float ratio, float offset, float* destP, size_t framesToProcess);
+void vsum(const float* const* sourcesP, unsigned numberOfSources, float* destP, size_t framesToProcess);
+void vinterleave2(const float* source1P, const float* source2P, float scale, float* destP, size_t framesToProcess);
+void vdeinterleave2(const float* sourceP, float scale, float* dest1P, float* dest2P, size_t framesToProcess);
+
+} // namespace avx2
+
+namespace avx512 {
+
+void vsma(const float* sourceP, float scale, float* destP, size_t framesToProcess);
+void vsmul(const float* sourceP, float scale, float* destP, size_t framesToProcess);
+void vadd(const float* source1P, const float* source2P, float* destP, size_t framesToProcess);
+void vmul(const float* source1P, const float* source2P, float* destP, size_t framesToProcess);
+void zvmul(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess);
+void zvmula(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess);
+float vsvesq(const float* sourceP, size_t framesToProcess);
+float vmaxmgv(const float* sourceP, size_t framesToProcess);
+void vclip(const float* sourceP, float lowThreshold, float highThreshold, float* destP, size_t framesToProcess);
+void vrampmuladd(const float* sourceP, float start, float step, float* destP, size_t framesToProcess);
+void vramp(float start, float step, float* destP, size_t framesToProcess);
+float vexpramp(float start, float ratio, float offset, float* destP, size_t framesToProcess);
+void vsum(const float* const* sourcesP, unsigned numberOfSources, float* destP, size_t framesToProcess);
+
+} // namespace avx512
+
+} // namespace VectorMath
+
+} // namespace WebCore
+
+#endif // VectorMathX86_h
@@ -0,0 +1,156 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef VoiceScheduler_h
+#define VoiceScheduler_h
+
+#include "AudioUtilities.h"
+#include "LockFreeQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+// The scheduling shared by the nodes which play notes from a fixed pool of voices, VoicePoolNode and
+// SampledInstrumentNode. VoiceEventQueue carries a node's note events from any thread to the frames at which
+// they are due, and VoiceEnvelopes allocates the voices and renders their ADSR envelopes. What a voice plays,
+// and how its notes are found, are left to the node.
+
+namespace LabSound {
+
+    // Event is the node's own, with at least
+    //     double when;       // in seconds on the context's timeline
+    //     uint64_t frame;    // when is due, set by the render thread
+    //     uint32_t sequence; // orders events due at the same frame as they were made
+    template<typename Event>
+    class VoiceEventQueue {
+    public:
+        // maxEvents bounds the events which may wait for the render thread at once.
+        explicit VoiceEventQueue(unsigned maxEvents)
+        : m_events(maxEvents)
+        , m_nextSequence(0)
+        {
+            m_pending.reserve(m_events.capacity());
+        }
+
+        // From any thread. Returns false if too many events are waiting.
+        bool push(Event& event)
+        {
+            event.frame = 0;
+            event.sequence = m_nextSequence.fetch_add(1, std::memory_order_relaxed);
+            return m_events.push(event);
+        }
+
+        // On the render thread, true while no events are queued or waiting to be due.
+        bool empty() const { return m_pending.empty() && m_events.empty(); }
+
+        // On the render thread, renders a quantum in pieces between the frames of the events due in it. apply is
+        // called as apply(event, frame) for each event at its frame, and render as render(offset, frames) for
+        // each piece.
+        template<typename Apply, typename Render>
+        void process(uint64_t quantumStartFrame, size_t framesToProcess, double sampleRate, Apply apply, Render render)
+        {
+            collect(quantumStartFrame, sampleRate);
+
+            size_t applied = 0;
+            size_t position = 0;
+            while (position < framesToProcess) {
+                while (applied < m_pending.size() && m_pending[applied].frame <= quantumStartFrame + position) {
+                    apply(m_pending[applied], quantumStartFrame + position);
+                    ++applied;
+                }
+
+                size_t end = framesToProcess;
+                if (applied < m_pending.size() && m_pending[applied].frame < quantumStartFrame + framesToProcess)
+                    end = static_cast<size_t>(m_pending[applied].frame - quantumStartFrame);
+
+                render(position, end - position);
+                position = end;
+            }
+
+            m_pending.erase(m_pending.begin(), m_pending.begin() + applied);
+        }
+
+    private:
+        // Moves newly queued events into m_pending, in the order they are to be applied. Events already past are
+        // due at the start of the quantum.
+        void collect(uint64_t quantumStartFrame, double sampleRate)
+        {
+            Event event;
+            while (m_pending.size() < m_pending.capacity() && m_events.try_pop(event)) {
+                uint64_t frame = event.when > 0 ? WebCore::AudioUtilities::timeToSampleFrame(event.when, sampleRate) : 0;
+                event.frame = std::max(frame, quantumStartFrame);
+
+                // Events mostly arrive in order, so they are inserted from the back.
+                size_t i = m_pending.size();
+                m_pending.push_back(event);
+                while (i > 0 && (m_pending[i - 1].frame > event.frame
+                                 || (m_pending[i - 1].frame == event.frame && static_cast<int32_t>(m_pending[i - 1].sequence - event.sequence) > 0))) {
+                    m_pending[i] = m_pending[i - 1];
+                    --i;
+                }
+                m_pending[i] = event;
+            }
+        }
+
+        lockfree_queue<Event> m_events;
+        std::atomic<uint32_t> m_nextSequence;
+
+        // Owned by the render thread: events not yet due, in order.
+        std::vector<Event> m_pending;
+    };
+
+    // The envelopes of a fixed pool of voices, kept a field to an array, and the lists of the sounding voices and
+    // the rest. Owned by the render thread, but for stolenVoiceCount.
+    class VoiceEnvelopes {
+    public:
+        enum Stage { Attack, Decay, Sustain, Release };
+
+        explicit VoiceEnvelopes(unsigned maxVoices);
+
+        unsigned maxVoices() const { return static_cast<unsigned>(m_levels.size()); }
+
+        // The sounding voices, in no order.
+        const std::vector<unsigned>& activeVoices() const { return m_activeVoices; }
+
+        // Takes a free voice, or steals the quietest released voice, or failing that the oldest, and makes it
+        // sounding. The lowest numbered free voices are taken first.
+        unsigned allocateVoice(uint64_t startFrame);
+
+        // Returns the voice at an index of activeVoices to the free voices, silenced.
+        unsigned freeVoice(unsigned activeIndex);
+
+        // Starts the attack, from the level the voice had reached if it was stolen.
+        void startEnvelope(unsigned voice, uint32_t attackFrames, float peakLevel, uint32_t decayFrames, float sustainLevel);
+
+        // Starts the release, from the voice's level, unless it is releasing already.
+        void releaseVoice(unsigned voice, uint32_t releaseFrames);
+
+        // Adds frames of source to each of the destinations, scaled by the envelope and the destination's gain.
+        // Returns false once the release has ended, having added the frames up to its end.
+        bool mix(unsigned voice, const float* source, size_t frames, float* const* destinations, const float* gains, unsigned numberOfDestinations);
+
+        uint64_t stolenVoiceCount() const { return m_stolenVoiceCount.load(std::memory_order_relaxed); }
+
+    private:
+        // Moves a voice's envelope on to its next stage. Returns false once the release has ended.
+        bool advanceStage(unsigned voice);
+
+        std::vector<float> m_levels;
+        std::vector<float> m_levelSteps;
+        std::vector<uint32_t> m_stageFrames; // left in the stage
+        std::vector<uint8_t> m_stages;
+        std::vector<float> m_peakLevels;
+        std::vector<uint32_t> m_decayFrames;
+        std::vector<float> m_sustainLevels;
+        std::vector<uint64_t> m_startFrames;
+
+        std::vector<unsigned> m_activeVoices;
+        std::vector<unsigned> m_freeVoices;
+
+        std::atomic<uint64_t> m_stolenVoiceCount;
+    };
+
+}
+
+#endif // VoiceScheduler_h
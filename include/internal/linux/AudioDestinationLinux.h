@@ -0,0 +1,102 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef AudioDestinationLinux_h
+#define AudioDestinationLinux_h
+
+#include "AudioBus.h"
+#include "AudioDestination.h"
+#include "AudioSourceProvider.h"
+#include "WTF/Threading.h"
+#include "rtaudio/RtAudio.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace WebCore {
+
+class AudioPullFIFO;
+
+// An AudioDestination for Linux, playing through ALSA, PulseAudio or JACK with the bundled RtAudio,
+// or through a null sink which runs the same render path on a thread of its own, paced by the clock.
+// The null sink optionally writes what it renders to a file, as interleaved 32 bit float samples,
+// so that rendering can be exercised and checked on machines without audio hardware.
+//
+// The settings are read when a destination is created. Each one can be overridden from the
+// environment, which is convenient for headless machines:
+//     LABSOUND_AUDIO_BACKEND   alsa, pulse, jack or null
+//     LABSOUND_PERIOD_FRAMES   frames per hardware period
+//     LABSOUND_CHANNELS        output channels
+//     LABSOUND_SAMPLE_RATE     sample rate in Hz
+//     LABSOUND_SINK_FILE       file the null sink writes to
+
+class AudioDestinationLinux : public AudioDestination, public AudioSourceProvider {
+public:
+    struct Settings {
+        Settings();
+
+        bool useNullSink;
+        RtAudio::Api api;        // UNSPECIFIED uses the first API compiled into RtAudio.
+        unsigned channels;
+        unsigned periodFrames;   // A multiple of AudioNode::ProcessingSizeInFrames renders without copying.
+        float sampleRate;
+        bool realtimePriority;   // Run the render callback with SCHED_FIFO, if the process is permitted to.
+        std::string sinkFile;    // Only used by the null sink; empty discards the audio.
+    };
+
+    // Settings for destinations created from now on.
+    static void setSettings(const Settings&);
+
+    // The settings in effect, including overrides from the environment.
+    static Settings settings();
+
+    AudioDestinationLinux(AudioIOCallback&, const Settings&);
+    virtual ~AudioDestinationLinux();
+
+    virtual void start() override;
+    virtual void stop() override;
+    virtual bool isPlaying() override { return m_isPlaying; }
+
+    virtual float sampleRate() const override { return m_settings.sampleRate; }
+
+    // The number of periods the hardware, or the null sink's clock, wanted before they were ready.
+    virtual size_t xrunCount() const override { return m_xrunCount; }
+
+    // AudioSourceProvider, feeds the FIFO used when the period isn't a whole number of render quanta.
+    virtual void provideInput(AudioBus*, size_t framesToProcess) override;
+
+private:
+    static int outputCallback(void* outputBuffer, void* inputBuffer, unsigned int numberOfFrames, double streamTime, RtAudioStreamStatus, void* userData);
+    static void nullSinkEntry(void* threadData);
+
+    void configure();
+    void render(unsigned numberOfFrames, float* output);
+    void promoteRenderThread();
+    void runNullSink();
+
+    AudioIOCallback& m_callback;
+    Settings m_settings;
+
+    // Channels point straight into the hardware's non-interleaved buffer while rendering.
+    AudioBus m_renderBus;
+    AudioBus m_periodBus;
+    std::unique_ptr<AudioPullFIFO> m_fifo;
+
+    std::unique_ptr<RtAudio> m_dac;
+    bool m_isPlaying;
+    bool m_isRenderThreadPromoted;
+    std::atomic<size_t> m_xrunCount;
+
+    // Null sink.
+    ThreadIdentifier m_nullSinkThread;
+    std::atomic<bool> m_nullSinkRunning;
+    std::vector<float> m_nullSinkBuffer;
+    std::vector<float> m_interleaved;
+    FILE* m_sinkFile;
+};
+
+} // namespace WebCore
+
+#endif // AudioDestinationLinux_h
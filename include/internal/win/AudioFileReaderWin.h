@@ -1,88 +0,0 @@
-/*
- * Copyright (C) 2010 Google Inc. All rights reserved.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- *
- * 1.  Redistributions of source code must retain the above copyright
- *     notice, this list of conditions and the following disclaimer.
- * 2.  Redistributions in binary form must reproduce the above copyright
- *     notice, this list of conditions and the following disclaimer in the
- *     documentation and/or other materials provided with the distribution.
- * 3.  Neither the name of Apple Computer, Inc. ("Apple") nor the names of
- *     its contributors may be used to endorse or promote products derived
- *     from this software without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY APPLE AND ITS CONTRIBUTORS "AS IS" AND ANY
- * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
- * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
- * DISCLAIMED. IN NO EVENT SHALL APPLE OR ITS CONTRIBUTORS BE LIABLE FOR ANY
- * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
- * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
- * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
- * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
- * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
- * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
- 
- */
-#ifndef AudioFileReaderWin_h
-#define AudioFileReaderWin_h
-
-#include "PassOwnPtr.h"
-#include "libsndfile\sndfile.h"
-
-namespace WebCore {
-
-class AudioBus;
-    
-// Wrapper class reading files and in-memory versions of them...
-
-class AudioFileReader {
-
-public:
-
-    AudioFileReader(const char* filePath);
-    AudioFileReader(const void* data, size_t dataSize);
-    ~AudioFileReader();
-
-    // Returns 0 if error
-    std::unique_ptr<AudioBus> createBus(float sampleRate, bool mixToMono);
-
-    const void* data() const { return m_data; }
-    size_t dataSize() const { return m_dataSize; }
-
-private:
-
-    const void* m_data;
-    size_t m_dataSize;
-
-	////////////////////////////////////////////////////////////
-    /// Functions for implementing custom read and write to memory files
-    ////////////////////////////////////////////////////////////
-    static sf_count_t MemoryGetLength(void* UserData);
-    static sf_count_t MemoryRead(void* Ptr, sf_count_t Count, void* UserData);
-    static sf_count_t MemorySeek(sf_count_t Offset, int Whence, void* UserData);
-    static sf_count_t MemoryTell(void* UserData);
-    static sf_count_t MemoryWrite(const void* Ptr, sf_count_t Count, void* UserData);
-
-    ////////////////////////////////////////////////////////////
-    /// Structure holding data related to memory operations
-    ////////////////////////////////////////////////////////////
-    struct MemoryInfos
-    {
-        const char* DataStart; ///< Pointer to the begining of the data
-        const char* DataPtr;   ///< Pointer to the current read / write position
-        sf_count_t  TotalSize; ///< Total size of the data, in bytes
-    };
-
-    ////////////////////////////////////////////////////////////
-    // Member data
-    ////////////////////////////////////////////////////////////
-
-
-};
-
-} // namespace WebCore
- 
-#endif // AudioFileReaderMac_h
@@ -30,6 +30,7 @@
 #define AudioBuffer_h
 
 #include "ExceptionCodes.h"
+#include <memory>
 #include <vector>
 
 namespace WebCore {
@@ -42,6 +43,10 @@ public:
     AudioBuffer(unsigned numberOfChannels, size_t numberOfFrames, float sampleRate);
     explicit AudioBuffer(AudioBus*);
 
+    // Wraps channels which live in storage the buffer doesn't own, such as a MappedFile, and keeps the storage alive.
+    // Such a buffer is read-only; getChannelData() and mutableChannelData() return null for it.
+    AudioBuffer(std::shared_ptr<const void> storage, const std::vector<const float*>& channels, size_t numberOfFrames, float sampleRate);
+
     static std::shared_ptr<AudioBuffer> create(unsigned numberOfChannels, size_t numberOfFrames, float sampleRate);
 
     // Returns 0 if data is not a valid audio file.
@@ -53,9 +58,12 @@ public:
     float sampleRate() const { return m_sampleRate; }
 
     // Channel data access
-    unsigned numberOfChannels() const { return (unsigned) m_channels.size(); }
+    unsigned numberOfChannels() const { return (unsigned) (m_storage ? m_storageChannels.size() : m_channels.size()); }
     std::shared_ptr<std::vector<float>> getChannelData(unsigned channelIndex, ExceptionCode&);
     std::shared_ptr<std::vector<float>> getChannelData(unsigned channelIndex);
+    const float* channelData(unsigned channelIndex) const;
+    float* mutableChannelData(unsigned channelIndex);
+    bool isReadOnly() const { return !!m_storage; }
     void zero();
 
     // Scalar gain
@@ -74,6 +82,10 @@ protected:
     size_t m_length;
 
     std::vector<std::shared_ptr<std::vector<float>>> m_channels;
+
+    // Set instead of m_channels for a buffer wrapping storage it doesn't own.
+    std::shared_ptr<const void> m_storage;
+    std::vector<const float*> m_storageChannels;
 };
 
 } // namespace WebCore
@@ -27,7 +27,9 @@
 
 #include "ConcurrentQueue.h"
 #include "ExceptionCodes.h"
+#include "LockFreeQueue.h"
 #include "WTF/RefPtr.h"
+#include <functional>
 #include <mutex>
 #include <set>
 #include <vector>
@@ -46,9 +48,14 @@ namespace WebCore {
 
     class AudioBuffer;
     class AudioBufferCallback;
+    class AudioBufferSourceNode;
     class AudioDestinationNode;
     class AudioListener;
     class AudioNode;
+    class AudioParam;
+    class AudioReclaimer;
+    class AudioRenderPlan;
+    class AudioRenderThreadPool;
     class AudioScheduledSourceNode;
     class AudioSummingJunction;
     class HRTFDatabaseLoader;
@@ -110,6 +117,7 @@ public:
     std::shared_ptr<MediaStreamAudioSourceNode> createMediaStreamSource(ContextGraphLock& g, ContextRenderLock& r, ExceptionCode&);
 
     // When a source node has no more processing to do (has finished playing), then it tells the context to dereference it.
+    // May be called from any of the render threads.
     void notifyNodeFinishedProcessing(ContextRenderLock&, AudioNode*);
 
     // Called at the start of each render quantum.
@@ -121,10 +129,13 @@ public:
     // Called periodically at the end of each render quantum to dereference finished source nodes.
     void derefFinishedSourceNodes(ContextGraphLock& g, ContextRenderLock& r);
 
-    // We schedule deletion of all marked nodes at the end of each realtime render quantum.
-    void markForDeletion(ContextRenderLock& r, AudioNode*);
+    // Releases everything retired by the audio thread right away. Only for use once rendering has stopped.
     void deleteMarkedNodes();
 
+    // Called from the audio thread, or a render plan worker processing a node, to let go of an object without
+    // destroying it in the render quantum. The reclaimer releases it on its own thread instead.
+    void retire(ContextRenderLock& r, std::shared_ptr<void> object);
+
     // AudioContext can pull node(s) at the end of each render quantum even when they are not connected to any downstream nodes.
     // These two methods are called by the nodes who want to add/remove themselves into/from the automatic pull lists.
     void addAutomaticPullNode(ContextRenderLock& r, std::shared_ptr<AudioNode>);
@@ -133,6 +144,32 @@ public:
     // Called right before handlePostRenderTasks() to handle nodes which need to be pulled even when they are not connected to anything.
     void processAutomaticPullNodes(ContextGraphLock& g, ContextRenderLock&, size_t framesToProcess);
 
+    // When enabled (the default), the destination processes the graph from a precompiled, dependency ordered AudioRenderPlan
+    // rather than by recursively pulling from its input. The plan is recompiled whenever the rendering graph changes.
+    void setRenderPlanEnabled(bool enabled) { m_renderPlanEnabled = enabled; }
+    bool isRenderPlanEnabled() const { return m_renderPlanEnabled; }
+
+    // The number of threads, counting the audio thread, which process the render plan. The default is one.
+    // With more, independent branches of the graph, such as separate voices, are processed concurrently;
+    // graphs with feedback loops are still processed by the audio thread alone.
+    // Starting and stopping the worker threads happens while the caller holds the render lock.
+    void setRenderThreadCount(ContextRenderLock&, unsigned count);
+    unsigned renderThreadCount() const;
+
+    // The render plan's storage is allocated here, and not by the audio thread as the graph grows. The default
+    // is room for 1024 nodes and 4096 connections. A graph which outgrows it is rendered by pulling from the
+    // destination, as it is with the plan disabled, and renderPlanExceedsCapacity() reports it.
+    void setRenderPlanCapacity(ContextRenderLock&, size_t maxNodes, size_t maxConnections);
+    bool renderPlanExceedsCapacity() const;
+
+    // Counts the AudioParams which are driven by a connection but which their node didn't register with
+    // AudioNode::addParam(). The plan can't order their drivers, so while there are any it runs on the
+    // audio thread alone. Called by AudioParam on the audio thread.
+    void updateUnscheduledParamCount(ContextRenderLock&, bool added);
+
+    // Called by the destination after handlePreRenderTasks() to process every node of the render plan.
+    void processRenderPlan(ContextGraphLock& g, ContextRenderLock&, size_t framesToProcess);
+
     // Keeps track of the number of connections made.
     void incrementConnectionCount();
 
@@ -149,6 +186,27 @@ public:
 
     void markSummingJunctionDirty(std::shared_ptr<AudioSummingJunction>);
 
+    // Graph edits which don't require the caller to hold the context's locks.
+    // The edit is queued without blocking and applied by the audio thread at the start of the next render quantum,
+    // so a control thread patching the graph never makes the audio thread fail to acquire its locks.
+    // May be called from any thread.
+    //
+    // AudioNode::connect() and the other edits which take a ContextGraphLock and ContextRenderLock are kept as
+    // they were rather than queued in turn. Their callers already hold both locks when the edit is made, so it
+    // is taking the locks, not making the edit, which may cost the audio thread a quantum, and queueing would
+    // not give it back. The audio thread also makes its edits through them, including the ones queued here.
+    // The audio thread still only tries its locks, and renders silence when another thread holds them; a
+    // program which patches the graph only through these functions never makes it do so. The destination's
+    // droppedQuantumCount() counts the quanta lost, and examples/src/GraphEditBenchmark.cpp compares the two.
+    typedef std::function<void(ContextGraphLock&, ContextRenderLock&)> GraphCommand;
+    void enqueueGraphCommand(GraphCommand command);
+
+    void connect(std::shared_ptr<AudioNode> source, std::shared_ptr<AudioNode> destination, unsigned outputIndex = 0, unsigned inputIndex = 0);
+    void disconnect(std::shared_ptr<AudioNode> source, unsigned outputIndex = 0);
+    void connectParam(std::shared_ptr<AudioParam> param, std::shared_ptr<AudioNode> driver, unsigned outputIndex = 0);
+    void disconnectParam(std::shared_ptr<AudioParam> param, std::shared_ptr<AudioNode> driver, unsigned outputIndex = 0);
+    void setSourceBuffer(std::shared_ptr<AudioBufferSourceNode> source, std::shared_ptr<AudioBuffer> buffer);
+
     void startRendering();
     void fireCompletionEvent();
     
@@ -176,9 +234,6 @@ private:
     bool m_isStopScheduled;
     void clear();
 
-    void scheduleNodeDeletion(ContextGraphLock& g);
-    static void deleteMarkedNodesDispatch(void* userData);
-    
     bool m_isInitialized;
     bool m_isAudioThreadFinished;
 
@@ -186,36 +241,40 @@ private:
     // In turn, these nodes reference all nodes they're connected to.  All nodes are ultimately connected to the AudioDestinationNode.
     // When the context dereferences a source node, it will be deactivated from the rendering graph along with all other nodes it is
     // uniquely connected to.  See the AudioNode::ref() and AudioNode::deref() methods for more details.
+    // Each referenced node knows its index in m_referencedNodes, so finding and removing it is O(1).
     void refNode(ContextGraphLock&, std::shared_ptr<AudioNode>);
-    void derefNode(ContextGraphLock&, ContextRenderLock&, std::shared_ptr<AudioNode>);
+    void derefNode(ContextGraphLock&, ContextRenderLock&, AudioNode*);
 
     // When the context goes away, there might still be some sources which haven't finished playing.
     // Make sure to dereference them here.
     void derefUnfinishedSourceNodes(ContextGraphLock&, ContextRenderLock&);
     
 public:
+    // The context keeps the source alive until it has finished playing, then disconnects and releases it.
+    // May be called from any thread.
     void holdSourceNodeUntilFinished(std::shared_ptr<AudioScheduledSourceNode>);
 
 private:
-    void handleAutomaticSources();
+    void releaseAutomaticSource(ContextGraphLock&, ContextRenderLock&, AudioNode*);
 
 
     std::shared_ptr<AudioDestinationNode> m_destinationNode;
     std::shared_ptr<AudioListener> m_listener;
 
-    // Only accessed in the audio thread.
-    std::vector<std::shared_ptr<AudioNode>> m_finishedNodes;
+    // A list of finished nodes linked through AudioNode::m_nextFinishedNode. Render threads push onto it
+    // concurrently with a compare and swap; only the audio thread takes from it, and it takes the whole list,
+    // so a node is never popped while another thread is pushing past it.
+    // The nodes are kept alive by m_referencedNodes or m_automaticSources until derefFinishedSourceNodes().
+    std::atomic<AudioNode*> m_finishedNodes;
+    void pushFinishedNode(AudioNode*);
 
     // We don't use RefPtr<AudioNode> here because AudioNode has a more complex ref() / deref() implementation
     // with an optional argument for refType.  We need to use the special refType: RefTypeConnection
     // Either accessed when the graph lock is held, or on the main thread when the audio thread has finished.
     std::vector<std::shared_ptr<AudioNode>> m_referencedNodes;
 
-    // Accumulate nodes which need to be deleted here.
-    // This is copied to m_nodesToDelete at the end of a render cycle in handlePostRenderTasks(), where we're assured of a stable graph
-    // state which will have no references to any of the nodes in m_nodesToDelete once the context lock is released
-    // (when handlePostRenderTasks() has completed).
-    std::vector<std::shared_ptr<AudioNode>> m_nodesMarkedForDeletion;
+    // Last references released by the audio thread are retired here rather than destroyed in the render quantum.
+    std::unique_ptr<AudioReclaimer> m_reclaimer;
 
     // m_automaticPullNodesNeedUpdating keeps track if m_automaticPullNodes is modified.
     bool m_automaticPullNodesNeedUpdating;
@@ -223,15 +282,24 @@ private:
     // the queue for added pull nodes, and the vector of known pull nodes
     std::set<std::shared_ptr<AudioNode>> m_automaticPullNodes;
     std::vector<std::shared_ptr<AudioNode>> m_renderingAutomaticPullNodes;
-    
-    // They will be scheduled for deletion (on the main thread) at the end of a render cycle (in realtime thread).
-    std::vector<std::shared_ptr<AudioNode>> m_nodesToDelete;
-    bool m_isDeletionScheduled;
 
     // Only accessed when the graph lock is held.
     LabSound::concurrent_queue<std::shared_ptr<AudioSummingJunction>> m_dirtySummingJunctions;
     void handleDirtyAudioSummingJunctions(ContextGraphLock& g, ContextRenderLock& r);
 
+    // Only accessed in the audio thread.
+    std::unique_ptr<AudioRenderPlan> m_renderPlan;
+    std::unique_ptr<AudioRenderThreadPool> m_renderThreadPool;
+    bool m_renderPlanEnabled;
+    size_t m_renderPlanMaxNodes;
+    size_t m_renderPlanMaxConnections;
+    unsigned m_unscheduledParamCount;
+
+    // Filled by any thread, drained only by the audio thread in handlePreRenderTasks().
+    // The commands are heap allocated by the caller so that the audio thread can retire them, with everything they captured.
+    LabSound::lockfree_queue<std::shared_ptr<GraphCommand>> m_pendingGraphCommands;
+    void handlePendingGraphCommands(ContextGraphLock& g, ContextRenderLock& r);
+
 
     int m_connectionCount;
 
@@ -256,8 +324,8 @@ private:
     // Number of AudioBufferSourceNodes that are active (playing).
     int m_activeSourceCount;
     
-    std::mutex automaticSourcesMutex;
-    std::vector<std::shared_ptr<AudioScheduledSourceNode>> automaticSources;
+    // Only accessed in the audio thread. Each held source knows its index, see holdSourceNodeUntilFinished().
+    std::vector<std::shared_ptr<AudioScheduledSourceNode>> m_automaticSources;
 };
 
 } // WebCore
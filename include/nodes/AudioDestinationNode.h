@@ -30,6 +30,7 @@
 #include "AudioBus.h"
 #include "AudioIOCallback.h"
 #include "AudioSourceProvider.h"
+#include <atomic>
 
 namespace WebCore {
 
@@ -52,6 +53,10 @@ public:
     size_t currentSampleFrame() const { return m_currentSampleFrame; }
     double currentTime() const { return currentSampleFrame() / static_cast<double>(sampleRate()); }
 
+    // The number of render quanta output as silence because the context's locks were held by another thread.
+    // Can be called from any thread.
+    size_t droppedQuantumCount() const { return m_droppedQuantumCount; }
+
     virtual unsigned numberOfChannels() const { return 2; } // FIXME: update when multi-channel (more than stereo) is supported
 
     virtual void startRendering() = 0;
@@ -95,6 +100,8 @@ protected:
     // Counts the number of sample-frames processed by the destination.
     size_t m_currentSampleFrame;
 
+    std::atomic<size_t> m_droppedQuantumCount;
+
     std::shared_ptr<AudioContext> m_context;
     LocalAudioInputProvider m_localAudioInputProvider;
 };
@@ -45,6 +45,7 @@ namespace WebCore {
     class AudioNodeInput;
     class AudioNodeOutput;
     class AudioParam;
+    class AudioRenderPlan;
 
 // An AudioNode is the basic building block for handling audio within an AudioContext.
 // It may be an audio source, an intermediate processing module, or an audio destination.
@@ -125,6 +126,10 @@ public:
     std::shared_ptr<AudioNodeInput> input(unsigned);
     std::shared_ptr<AudioNodeOutput> output(unsigned);
 
+    // The AudioParams whose audio-rate connections are pulled while this node processes.
+    unsigned int numberOfParams() const { return (unsigned int) m_params.size(); }
+    std::shared_ptr<AudioParam> param(unsigned);
+
     void connect(ContextGraphLock& g, ContextRenderLock &r,
                          AudioNode*, unsigned outputIndex, unsigned inputIndex, ExceptionCode&);
     
@@ -139,6 +144,10 @@ public:
     // Called from context's audio thread.
     void processIfNecessary(ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess);
 
+    // True if processIfNecessary() has already run (or is running) for the render quantum starting at time.
+    // Called from context's audio thread.
+    bool isProcessedForTime(double time) const { return m_lastProcessingTime == time; }
+
     // Called when a new connection has been made to one of our inputs or the connection number of channels has changed.
     // This potentially gives us enough information to perform a lazy initialization or, if necessary, a re-initialization.
     // Called from main thread.
@@ -171,6 +180,11 @@ protected:
     // Inputs and outputs must be created before the AudioNode is initialized.
     void addInput(std::shared_ptr<AudioNodeInput>);
     void addOutput(std::shared_ptr<AudioNodeOutput>);
+
+    // Nodes which pull AudioParam connections in process() register the params here,
+    // so that the nodes driving them are rendered ahead of this one. A driven param which isn't registered
+    // keeps the context's render plan on the audio thread alone.
+    void addParam(std::shared_ptr<AudioParam>);
     
     // Called by processIfNecessary() to cause all parts of the rendering graph connected to us to process.
     // Each rendering quantum, the audio data for each of the AudioNode's inputs will be available after this method is called.
@@ -178,11 +192,15 @@ protected:
     virtual void pullInputs(ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess);
 
 private:
+    friend class AudioContext;
+    friend class AudioRenderPlan;
+
     volatile bool m_isInitialized;
     NodeType m_nodeType;
     float m_sampleRate;
     std::vector<std::shared_ptr<AudioNodeInput> > m_inputs;
     std::vector<std::shared_ptr<AudioNodeOutput> > m_outputs;
+    std::vector<std::shared_ptr<AudioParam> > m_params;
 
     double m_lastProcessingTime;
     double m_lastNonSilentTime;
@@ -193,6 +211,18 @@ private:
     
     bool m_isMarkedForDeletion;
     bool m_isDisabled;
+
+    // Visited mark and step index used by AudioRenderPlan::compile().
+    unsigned m_renderPlanGeneration;
+    unsigned m_renderPlanIndex;
+
+    // Index of this node in the context's m_referencedNodes and m_automaticSources, or NotHeldByContext.
+    enum { NotHeldByContext = ~0u };
+    unsigned m_referencedNodeIndex;
+    unsigned m_automaticSourceIndex;
+
+    // The next node in the context's list of finished nodes.
+    AudioNode* m_nextFinishedNode;
     
 #if DEBUG_AUDIONODE_REFERENCES
     static bool s_isNodeCountInitialized;
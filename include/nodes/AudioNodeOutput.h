@@ -52,6 +52,11 @@ public:
     // Called from context's audio thread.
     AudioBus* pull(ContextGraphLock& g, ContextRenderLock& r, AudioBus* inPlaceBus, size_t framesToProcess);
 
+    // Called by the context's AudioRenderPlan just before our node is processed.
+    // Nodes processed from the plan have no downstream in-place bus, so they always render into our internal bus.
+    // Called from context's audio thread.
+    void prepareForScheduledProcessing(ContextGraphLock& g, ContextRenderLock& r);
+
     // bus() will contain the rendered audio after pull() is called for each rendering time quantum.
     // Called from context's audio thread.
     AudioBus* bus() const;
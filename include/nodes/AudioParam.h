@@ -34,6 +34,7 @@
 #include "AudioSummingJunction.h"
 #include <sys/types.h>
 #include <string>
+#include <vector>
 
 namespace WebCore {
 
@@ -54,15 +55,18 @@ public:
     , m_units(units)
     , m_smoothedValue(defaultValue)
     , m_smoothingConstant(DefaultSmoothingConstant)
+    , m_isRegistered(false)
+    , m_isUnscheduledDriven(false)
     {}
     
     virtual ~AudioParam() {}
     
     // AudioSummingJunction
     virtual bool canUpdateState() override { return true; }
-    virtual void didUpdate(ContextGraphLock& g, ContextRenderLock&) override { }
+    virtual void didUpdate(ContextGraphLock& g, ContextRenderLock&) override;
 
-    // Intrinsic value.
+    // Intrinsic value. Nodes read it while rendering through the lock; control threads pass the context.
+    float value(ContextRenderLock&);
     float value(std::shared_ptr<AudioContext>);
     void setValue(float);
 
@@ -84,7 +88,8 @@ public:
 
     // Smoothly exponentially approaches to (de-zippers) the desired value.
     // Returns true if smoothed value has already snapped exactly to value.
-    bool smooth(std::shared_ptr<AudioContext>);
+    // Only called while rendering.
+    bool smooth(ContextRenderLock&);
 
     void resetSmoothedValue() { m_smoothedValue = m_value; }
     void setSmoothingConstant(double k) { m_smoothingConstant = k; }
@@ -108,6 +113,8 @@ public:
     static void disconnect(ContextGraphLock& g, std::shared_ptr<AudioParam>, std::shared_ptr<AudioNodeOutput>);
 
 private:
+    friend class AudioNode;
+
     // sampleAccurate corresponds to a-rate (audio rate) vs. k-rate in the Web Audio specification.
     void calculateFinalValues(ContextGraphLock& g, ContextRenderLock& r, float* values, unsigned numberOfValues, bool sampleAccurate);
     void calculateTimelineValues(ContextRenderLock& r, float* values, unsigned numberOfValues);
@@ -124,6 +131,15 @@ private:
     double m_smoothingConstant;
     
     AudioParamTimeline m_timeline;
+
+    // The channels summed by calculateFinalValues, kept between quanta for their capacity.
+    std::vector<const float*> m_summingSources;
+
+    // Set by AudioNode::addParam(), which lets the render plan schedule the param's drivers.
+    bool m_isRegistered;
+
+    // True while the param has drivers and isn't registered, and so is counted by the context.
+    bool m_isUnscheduledDriven;
 };
 
 } // namespace WebCore
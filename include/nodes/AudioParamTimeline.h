@@ -30,16 +30,24 @@
 #define AudioParamTimeline_h
 
 #include "AudioContext.h"
+#include <atomic>
 #include <mutex>
 #include <vector>
 
 namespace WebCore {
 
+// Events are edited by control threads and read while rendering without either side waiting on the other.
+// Each edit produces a new time ordered list of events, which is published with an atomic pointer swap;
+// the rendering side picks up the newest list at the start of a quantum, and keeps an index to the event
+// it has reached so that it doesn't search the list from the beginning every time. Lists the rendering side
+// has finished with, and events which have already played out, are freed by the next edit.
 class AudioParamTimeline {
 public:
-    AudioParamTimeline()
-    {
-    }
+    AudioParamTimeline();
+    ~AudioParamTimeline();
+
+    AudioParamTimeline(const AudioParamTimeline&) = delete;
+    AudioParamTimeline& operator=(const AudioParamTimeline&) = delete;
 
     void setValueAtTime(float value, float time);
     void linearRampToValueAtTime(float value, float time);
@@ -50,6 +58,9 @@ public:
 
     // hasValue is set to true if a valid timeline value is returned.
     // otherwise defaultValue is returned.
+    // The rendering side reads through its cursor. A control thread, which passes the context, searches the latest
+    // events under m_eventsLock instead, and leaves the cursor alone.
+    float valueForContextTime(ContextRenderLock&, float defaultValue, bool& hasValue);
     float valueForContextTime(std::shared_ptr<AudioContext>, float defaultValue, bool& hasValue);
 
     // Given the time range, calculates parameter values into the values buffer
@@ -59,7 +70,7 @@ public:
     // the render quantum size such that the parameter value changes once per render quantum.
     float valuesForTimeRange(double startTime, double endTime, float defaultValue, float* values, unsigned numberOfValues, double sampleRate, double controlRate);
 
-    bool hasValues() { return m_events.size(); }
+    bool hasValues() { return m_eventCount.load(std::memory_order_relaxed) != 0; }
 
 private:
     class ParamEvent {
@@ -108,7 +119,7 @@ private:
         float time() const { return m_time; }
         float timeConstant() const { return m_timeConstant; }
         float duration() const { return m_duration; }
-        std::shared_ptr<std::vector<float>> curve() { return m_curve; }
+        std::shared_ptr<std::vector<float>> curve() const { return m_curve; }
 
     private:
         unsigned m_type;
@@ -119,12 +130,45 @@ private:
         std::shared_ptr<std::vector<float>> m_curve;
     };
 
+    // A list is never changed once it may be read while rendering.
+    struct EventList {
+        EventList() : nextRetired(0) { }
+        EventList(const EventList& rhs) : events(rhs.events), nextRetired(0) { }
+
+        std::vector<ParamEvent> events;
+        EventList* nextRetired;
+    };
+
+    // The index of the first event still needed to render from time onwards.
+    static size_t firstEventToRender(const std::vector<ParamEvent>&, double time);
+
     void insertEvent(const ParamEvent&);
-    float valuesForTimeRangeImpl(double startTime, double endTime, float defaultValue, float* values, unsigned numberOfValues, double sampleRate, double controlRate);
 
-    std::vector<ParamEvent> m_events;
+    // Called with m_eventsLock held. beginEdit returns a list the caller may change, which publish hands on.
+    EventList* beginEdit();
+    void publish(EventList*);
+
+    // The rendering side's state may only be used between a successful beginRendering and endRendering.
+    // Only called while rendering, as it moves the cursor and the render time on to startTime.
+    bool beginRendering(double startTime);
+    void endRendering();
+
+    float valuesForTimeRangeImpl(const std::vector<ParamEvent>&, size_t& cursor, double startTime, double endTime, float defaultValue, float* values, unsigned numberOfValues, double sampleRate, double controlRate);
 
+    // Edits are serialized by m_eventsLock, which the rendering side never waits on.
     std::mutex m_eventsLock;
+    EventList* m_latest;
+
+    std::atomic<EventList*> m_pending;  // published, but not yet picked up for rendering
+    std::atomic<EventList*> m_retired;  // finished with, waiting for the next edit to free them
+    std::atomic<size_t> m_eventCount;
+    std::atomic<double> m_renderTime;   // how far rendering has got, so that edits can drop expired events
+
+    // Rendering side.
+    std::atomic<bool> m_isRendering;
+    EventList* m_current;
+    size_t m_cursor;
+    double m_cursorTime;
 };
 
 } // namespace WebCore
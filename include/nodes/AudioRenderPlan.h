@@ -0,0 +1,132 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef AudioRenderPlan_h
+#define AudioRenderPlan_h
+
+#include "AudioRenderThreadPool.h"
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace LabSound {
+    class ContextGraphLock;
+    class ContextRenderLock;
+}
+
+namespace WebCore {
+
+    using namespace LabSound;
+
+class AudioNode;
+class AudioNodeOutput;
+
+// AudioRenderPlan is a flattened copy of the rendering graph: every node feeding the destination
+// (and every automatic pull node) listed once, upstream nodes before the nodes they feed.
+// Executing the plan processes each node in order, so by the time a node pulls its inputs
+// the audio is already waiting in the upstream output busses and the pull returns immediately,
+// instead of recursing through the whole graph from the destination.
+//
+// Nodes driving an AudioParam are scheduled ahead of the node which registered the param (see AudioNode::addParam).
+//
+// For parallel rendering the steps are also grouped into tasks. A chain of nodes each feeding only the next,
+// such as a source -> filter -> panner voice, is one task; a node summing several upstream tasks
+// starts a new task which waits for all of them. Tasks are run by the threads of an AudioRenderThreadPool,
+// each taking ready tasks from its own queue and stealing from the others when it runs dry.
+//
+// Compiling never allocates: the plan's storage is reserved ahead for a number of nodes and connections, and
+// a graph which outgrows it is left to the destination's pull until more is reserved.
+//
+// The plan holds the same raw pointers as AudioSummingJunction::m_renderingOutputs, and is
+// only valid between changes to the rendering state. The context invalidates it whenever a
+// summing junction's rendering state is updated.
+
+class AudioRenderPlan {
+public:
+    AudioRenderPlan();
+    ~AudioRenderPlan();
+
+    void invalidate() { m_isDirty = true; }
+    bool isDirty() const { return m_isDirty; }
+
+    // Allocates storage for graphs of up to maxNodes nodes and maxConnections connections, rendered by
+    // numberOfThreads threads, and invalidates the plan. Must not be called while the plan is compiled or executed.
+    void reserve(size_t maxNodes, size_t maxConnections, unsigned numberOfThreads);
+
+    // Rebuilds the schedule by walking the rendering connections upstream from destination and pullNodes.
+    // Must be called on the audio thread with the render lock.
+    void compile(ContextRenderLock&, AudioNode* destination, const std::vector<std::shared_ptr<AudioNode>>& pullNodes);
+
+    // Processes every scheduled node, in dependency order.
+    void execute(ContextGraphLock&, ContextRenderLock&, size_t framesToProcess);
+
+    // Processes every scheduled node on the threads of the pool; independent tasks run concurrently.
+    // Graphs with feedback loops can't be split safely and are executed serially.
+    void execute(ContextGraphLock&, ContextRenderLock&, size_t framesToProcess, AudioRenderThreadPool&);
+
+    size_t numberOfSteps() const { return m_steps.size(); }
+    size_t numberOfTasks() const { return m_tasks.size(); }
+    bool hasFeedback() const { return m_hasFeedback; }
+
+    // True if the last compile found more of the graph than was reserved for, leaving the plan empty.
+    bool exceedsCapacity() const { return m_exceedsCapacity; }
+
+private:
+    struct Step {
+        AudioNode* node;
+        unsigned firstOutput;
+        unsigned numberOfOutputs;
+        unsigned firstProducer;
+        unsigned numberOfProducers;
+    };
+
+    // A run of steps executed by one thread, and the tasks which can't start until it is done.
+    struct Task {
+        unsigned firstStep;
+        unsigned numberOfSteps;
+        unsigned firstDependent;
+        unsigned numberOfDependents;
+        unsigned numberOfDependencies;
+    };
+
+    // A pending node in the depth-first walk, and where the walk is in its input connections.
+    struct Visit {
+        AudioNode* node;
+        unsigned input;
+        unsigned connection;
+    };
+
+    class ParallelJob;
+    struct TaskQueue;
+
+    // These return false when the reserved storage runs out.
+    bool visit(AudioNode* root);
+    bool addProducer(AudioNode* upstream);
+    bool buildTasks();
+    void runStep(const Step&, ContextGraphLock&, ContextRenderLock&, size_t framesToProcess);
+
+    std::vector<Step> m_steps;
+    std::vector<AudioNodeOutput*> m_outputs;
+    std::vector<unsigned> m_producers;
+    std::vector<Visit> m_stack;
+
+    std::vector<Task> m_tasks;
+    std::vector<unsigned> m_taskSteps;
+    std::vector<unsigned> m_dependents;
+    std::vector<unsigned> m_stepTask;
+    std::vector<unsigned> m_stepConsumers;
+    std::vector<std::pair<unsigned, unsigned>> m_edges;
+    std::unique_ptr<std::atomic<unsigned>[]> m_pendingDependencies;
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+    std::atomic<unsigned> m_completedTasks;
+
+    unsigned m_generation;
+    bool m_isDirty;
+    bool m_hasFeedback;
+    bool m_exceedsCapacity;
+};
+
+} // namespace WebCore
+
+#endif // AudioRenderPlan_h
@@ -46,6 +46,14 @@ public:
     virtual void process(ContextGraphLock& g, ContextRenderLock& r, const float* source, float* dest, size_t framesToProcess) override;
     virtual void reset() override { m_biquad.reset(); }
 
+    // Brings the coefficients up to date for this quantum, as process() does, without filtering anything.
+    void updateCoefficients(ContextGraphLock& g, ContextRenderLock& r) { updateCoefficientsIfNecessary(g, r, true, false); }
+    const Biquad& biquad() const { return m_biquad; }
+
+    // Takes coefficients computed elsewhere, as the processor's a-rate path does, so that the next k-rate
+    // quantum carries on from them.
+    void setCoefficients(const Biquad& biquad) { m_biquad.setCoefficients(biquad); }
+
     // Get the magnitude and phase response of the filter at the given
     // set of frequencies (in Hz). The phase response is in radians.
     void getFrequencyResponse(ContextGraphLock& g, ContextRenderLock& r,
@@ -56,6 +56,10 @@ public:
     std::shared_ptr<AudioParam> gain() { return biquadProcessor()->parameter3(); }
     std::shared_ptr<AudioParam> detune() { return biquadProcessor()->parameter4(); }
 
+    // Frames between coefficient updates while a parameter is automated at a-rate; see BiquadProcessor.
+    unsigned coefficientInterval() { return biquadProcessor()->coefficientInterval(); }
+    void setCoefficientInterval(unsigned frames) { biquadProcessor()->setCoefficientInterval(frames); }
+
     // Get the magnitude and phase response of the filter at the given
     // set of frequencies (in Hz). The phase response is in radians.
     void getFrequencyResponse(ContextGraphLock& g, ContextRenderLock&,
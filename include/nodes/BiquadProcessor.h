@@ -28,6 +28,7 @@
 #include "AudioNode.h"
 #include "AudioParam.h"
 #include "Biquad.h"
+#include "BiquadBank.h"
 #include "AudioDSPKernel.h"
 #include "AudioDSPKernelProcessor.h"
 
@@ -53,7 +54,11 @@ public:
     virtual ~BiquadProcessor();
     
     virtual AudioDSPKernel* createKernel();
-        
+
+    virtual void initialize() override;
+    virtual void uninitialize() override;
+    virtual void reset() override;
+
     virtual void process(ContextGraphLock& g, ContextRenderLock&, const AudioBus* source, AudioBus* destination, size_t framesToProcess);
 
     // Get the magnitude and phase response of the filter at the given
@@ -64,7 +69,7 @@ public:
                               float* magResponse,
                               float* phaseResponse);
 
-    void checkForDirtyCoefficients(std::shared_ptr<AudioContext>);
+    void checkForDirtyCoefficients(ContextRenderLock&);
     
     bool filterCoefficientsDirty() const { return m_filterCoefficientsDirty; }
     bool hasSampleAccurateValues() const { return m_hasSampleAccurateValues; }
@@ -77,7 +82,18 @@ public:
     FilterType type() const { return m_type; }
     void setType(FilterType);
 
+    // Configures a biquad as this processor's type of filter, for the given parameter values.
+    void configureBiquad(Biquad&, double frequency, double Q, double gain, double detune) const;
+
+    // While any parameter is a-rate, the coefficients are computed every coefficientInterval frames
+    // and ramped in between, rather than once per render quantum. A shorter interval follows fast
+    // modulation more closely, for the cost of computing coefficients more often.
+    unsigned coefficientInterval() const { return m_coefficientInterval; }
+    void setCoefficientInterval(unsigned);
+
 private:
+    void processSubBlocks(ContextGraphLock& g, ContextRenderLock&, const AudioBus* source, AudioBus* destination, size_t framesToProcess);
+
     FilterType m_type;
 
     std::shared_ptr<AudioParam> m_parameter1;
@@ -90,6 +106,19 @@ private:
 
     // Set to true if any of the filter parameters are sample-accurate.
     bool m_hasSampleAccurateValues;
+
+    // Filters all the channels at once. The kernels only compute the coefficients, and respond to getFrequencyResponse.
+    std::unique_ptr<BiquadBank> m_bank;
+    std::vector<const float*> m_sources;
+    std::vector<float*> m_destinations;
+
+    // The a-rate parameter values for a quantum, and the coefficients at the end of each interval.
+    unsigned m_coefficientInterval;
+    AudioFloatArray m_frequencyValues;
+    AudioFloatArray m_qValues;
+    AudioFloatArray m_gainValues;
+    AudioFloatArray m_detuneValues;
+    Biquad m_intervalBiquad;
 };
 
 } // namespace WebCore
@@ -28,11 +28,13 @@
 #include "AudioNode.h"
 #include "WTF/RefPtr.h"
 #include "WTF/Threading.h"
+#include <atomic>
 
 namespace WebCore {
 
 class AudioBuffer;
 class Reverb;
+class UniformConvolver;
     
 class ConvolverNode : public AudioNode {
 public:
@@ -52,20 +54,42 @@ public:
     bool normalize() const { return m_normalize; }
     void setNormalize(bool normalize) { m_normalize = normalize; }
 
+    // Convolve by uniformly partitioned convolution, rather than with a Reverb. This is cheaper for long and for
+    // true-stereo responses, and does all its work on the audio thread. Like normalize, it applies to buffers set after it.
+    bool uniformPartitioning() const { return m_uniformPartitioning; }
+    void setUniformPartitioning(bool uniformPartitioning) { m_uniformPartitioning = uniformPartitioning; }
+
 private:
     virtual double tailTime() const OVERRIDE;
     virtual double latencyTime() const OVERRIDE;
 
+    // A reverb prepared on the main thread, waiting for the audio thread to swap it in. The audio thread hands
+    // the node back, holding the reverb it replaced, to the context's reclaimer, which destroys it off the
+    // audio thread. The node owns itself through self so that doing so never allocates or frees.
+    // It holds one of the two engines, or neither.
+    struct PreparedReverb {
+        std::unique_ptr<Reverb> reverb;
+        std::unique_ptr<UniformConvolver> uniformConvolver;
+        std::shared_ptr<PreparedReverb> self;
+    };
+
+    // Publishes a reverb to be swapped in on the next render quantum, replacing any not yet taken.
+    void publishReverb(std::unique_ptr<Reverb>, std::unique_ptr<UniformConvolver>);
+
+    // Only accessed by the audio thread, or once it is no longer rendering this node.
     std::unique_ptr<Reverb> m_reverb;
-    std::shared_ptr<AudioBuffer> m_buffer;
+    std::unique_ptr<UniformConvolver> m_uniformConvolver;
 
-    // lock free swap on update
-    bool m_swapOnRender;
-    std::unique_ptr<Reverb> m_newReverb;
-    std::shared_ptr<AudioBuffer> m_newBuffer;
+    // Lock free swap on update.
+    std::atomic<PreparedReverb*> m_pendingReverb;
+
+    // The impulse response most recently set, as returned by buffer(). Only accessed by the main thread.
+    std::shared_ptr<AudioBuffer> m_buffer;
 
     // Normalize the impulse response or not. Must default to true.
     bool m_normalize;
+
+    bool m_uniformPartitioning;
 };
 
 } // namespace WebCore
@@ -42,6 +42,8 @@ public:
     virtual void initialize();
     virtual void uninitialize();
     virtual void startRendering();
+
+    size_t xrunCount() const { return m_destination ? m_destination->xrunCount() : 0; }
     
 private:
     std::unique_ptr<AudioDestination> m_destination;
@@ -27,6 +27,7 @@
 
 #include "AudioArray.h"
 #include "AudioDSPKernel.h"
+#include "DelayLine.h"
 #include "DelayProcessor.h"
 
 namespace WebCore {
@@ -50,9 +51,8 @@ public:
     virtual double latencyTime() const OVERRIDE;
 
 private:
-    AudioFloatArray m_buffer;
+    DelayLine m_delayLine;
     double m_maxDelayTime;
-    int m_writeIndex;
     double m_currentDelayTime;
     double m_smoothingRate;
     bool m_firstTime;
@@ -61,7 +61,6 @@ private:
     AudioFloatArray m_delayTimes;
 
     DelayProcessor* delayProcessor() { return static_cast<DelayProcessor*>(processor()); }
-    size_t bufferLengthForDelay(double delayTime, double sampleRate) const;
 };
 
 } // namespace WebCore
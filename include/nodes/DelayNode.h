@@ -46,6 +46,9 @@ public:
     DelayNode(float sampleRate, double maxDelayTime, ExceptionCode&);
     std::shared_ptr<AudioParam> delayTime();
 
+    DelayLine::Interpolation interpolation() { return delayProcessor()->interpolation(); }
+    void setInterpolation(DelayLine::Interpolation interpolation) { delayProcessor()->setInterpolation(interpolation); }
+
 private:
     DelayProcessor* delayProcessor() { return static_cast<DelayProcessor*>(processor()); }
 };
@@ -27,6 +27,7 @@
 
 #include "AudioDSPKernelProcessor.h"
 #include "AudioParam.h"
+#include "DelayLine.h"
 
 namespace WebCore {
 
@@ -43,9 +44,14 @@ public:
 
     double maxDelayTime() { return m_maxDelayTime; }
 
+    // How the kernels read between frames at fractional delays.
+    DelayLine::Interpolation interpolation() const { return m_interpolation; }
+    void setInterpolation(DelayLine::Interpolation interpolation) { m_interpolation = interpolation; }
+
 private:
     std::shared_ptr<AudioParam> m_delayTime;
     double m_maxDelayTime;
+    DelayLine::Interpolation m_interpolation;
 };
 
 } // namespace WebCore
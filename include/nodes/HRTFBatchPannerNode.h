@@ -0,0 +1,90 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef HRTFBatchPannerNode_h
+#define HRTFBatchPannerNode_h
+
+#include "AudioNode.h"
+#include "Cone.h"
+#include "Distance.h"
+#include "ExceptionCodes.h"
+#include "util/graphics/FloatPoint3D.h"
+#include <memory>
+#include <vector>
+
+namespace WebCore {
+    class AudioBus;
+    class HRTFBatchPanner;
+}
+
+namespace LabSound {
+
+    // HRTFBatchPannerNode positions many mono sources around the listener at once, one source per input,
+    // and mixes them to a single stereo output. Each source sounds as it would through an HRTF PannerNode
+    // of its own, but the sources share their inverse FFTs, so that a crowd of sounds costs far less.
+    //
+    // Stereo inputs are mixed down to mono. The distance and cone models are shared by all the sources.
+
+    class HRTFBatchPannerNode : public WebCore::AudioNode {
+    public:
+        HRTFBatchPannerNode(float sampleRate, unsigned numberOfSources);
+        virtual ~HRTFBatchPannerNode();
+
+        // AudioNode
+        virtual void process(ContextGraphLock& g, ContextRenderLock&, size_t framesToProcess) override;
+        virtual void reset(std::shared_ptr<WebCore::AudioContext>) override;
+
+        unsigned numberOfSources() const { return static_cast<unsigned>(m_sources.size()); }
+
+        // Position and orientation of each source, as for PannerNode.
+        FloatPoint3D position(unsigned source) const;
+        void setPosition(unsigned source, float x, float y, float z);
+        FloatPoint3D orientation(unsigned source) const;
+        void setOrientation(unsigned source, float x, float y, float z);
+
+        // Distance parameters
+        unsigned short distanceModel() { return m_distanceEffect.model(); }
+        void setDistanceModel(unsigned short, ExceptionCode&);
+
+        float refDistance() { return static_cast<float>(m_distanceEffect.refDistance()); }
+        void setRefDistance(float refDistance) { m_distanceEffect.setRefDistance(refDistance); }
+
+        float maxDistance() { return static_cast<float>(m_distanceEffect.maxDistance()); }
+        void setMaxDistance(float maxDistance) { m_distanceEffect.setMaxDistance(maxDistance); }
+
+        float rolloffFactor() { return static_cast<float>(m_distanceEffect.rolloffFactor()); }
+        void setRolloffFactor(float rolloffFactor) { m_distanceEffect.setRolloffFactor(rolloffFactor); }
+
+        // Sound cones - angles in degrees
+        float coneInnerAngle() const { return static_cast<float>(m_coneEffect.innerAngle()); }
+        void setConeInnerAngle(float angle) { m_coneEffect.setInnerAngle(angle); }
+
+        float coneOuterAngle() const { return static_cast<float>(m_coneEffect.outerAngle()); }
+        void setConeOuterAngle(float angle) { m_coneEffect.setOuterAngle(angle); }
+
+        float coneOuterGain() const { return static_cast<float>(m_coneEffect.outerGain()); }
+        void setConeOuterGain(float angle) { m_coneEffect.setOuterGain(angle); }
+
+        virtual double tailTime() const override;
+        virtual double latencyTime() const override;
+
+    private:
+        struct Source {
+            FloatPoint3D position;
+            FloatPoint3D orientation;
+        };
+
+        std::vector<Source> m_sources;
+        std::unique_ptr<WebCore::HRTFBatchPanner> m_panner;
+
+        WebCore::DistanceEffect m_distanceEffect;
+        WebCore::ConeEffect m_coneEffect;
+
+        // Mono mixes of stereo inputs, and each source's channel for the panner.
+        std::vector<std::unique_ptr<WebCore::AudioBus>> m_monoBuses;
+        std::vector<const float*> m_channels;
+    };
+
+}
+
+#endif // HRTFBatchPannerNode_h
@@ -114,6 +114,10 @@ public:
     void setConeOuterGain(float angle) { m_coneEffect.setOuterGain(angle); }
 
     void getAzimuthElevation(ContextRenderLock& r, double* outAzimuth, double* outElevation);
+
+    // The azimuth and elevation of any position as heard by the listener.
+    static void azimuthElevation(const FloatPoint3D& position, AudioListener*, double* outAzimuth, double* outElevation);
+
     float dopplerRate(ContextRenderLock& r);
 
     // Accessors for dynamically calculated gain values.
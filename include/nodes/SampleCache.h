@@ -0,0 +1,73 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef SampleCache_h
+#define SampleCache_h
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace WebCore {
+    class AudioBuffer;
+}
+
+namespace LabSound {
+
+    // SampleCache decodes each sound file once per process, however many instruments or contexts play it.
+    //
+    // Decoded samples are written to a cache file as planar floats, and handed out as read-only AudioBuffers
+    // backed by a mapping of that file, so only the pages being played need stay resident. A later run maps
+    // the cache file rather than decoding again, unless the source file's size or modification time has changed.
+    //
+    // The cache holds on to buffers up to a memory budget, evicting the least recently used first.
+    // An evicted buffer remains valid for as long as anything else holds it.
+
+    class SampleCache {
+    public:
+        static SampleCache& shared();
+
+        // Returns null if the file can't be decoded. Pass 0 for sampleRate to keep the file's sample-rate.
+        std::shared_ptr<WebCore::AudioBuffer> load(const char* path, float sampleRate, bool mixToMono);
+
+        // Where cache files are written; the system's temporary directory by default.
+        // An empty path keeps decoded samples in memory.
+        void setCacheDirectory(const std::string&);
+        std::string cacheDirectory() const;
+
+        // In bytes of decoded samples.
+        void setMemoryBudget(size_t);
+        size_t memoryBudget() const;
+        size_t memoryUsage() const;
+
+        // Drops the cache's references to all the buffers it holds.
+        void purge();
+
+    private:
+        SampleCache();
+
+        struct Entry {
+            std::shared_ptr<WebCore::AudioBuffer> buffer;
+            size_t bytes;
+            std::list<std::string>::iterator recent;
+        };
+
+        // Evicts until the budget is met, sparing the most recent entry. Called with m_mutex held.
+        void evict();
+
+        mutable std::mutex m_mutex;
+        std::string m_cacheDirectory;
+        size_t m_memoryBudget;
+        size_t m_memoryUsage;
+
+        std::map<std::string, Entry> m_entries;
+
+        // Keys, most recently used first.
+        std::list<std::string> m_recent;
+    };
+
+}
+
+#endif // SampleCache_h
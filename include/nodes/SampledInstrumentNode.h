@@ -1,176 +1,162 @@
-#pragma once
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
 
-#include "AudioContext.h"
-#include "AudioContextLock.h"
+#ifndef SampledInstrumentNode_h
+#define SampledInstrumentNode_h
+
+#include "AudioArray.h"
+#include "AudioBuffer.h"
 #include "AudioNode.h"
 #include "AudioParam.h"
-#include "AudioBufferSourceNode.h"
-#include "ADSRNode.h"
-#include "ExceptionCodes.h"
-#include "SoundBuffer.h"
-
-#include <iostream> 
+#include "VoiceScheduler.h"
 #include <array>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
 #include <string>
-#include <algorithm>
+#include <vector>
 
 namespace LabSound {
 
-	using namespace WebCore;
-
-	struct SamplerSound {
-
-		SamplerSound(
-            std::shared_ptr<GainNode> destination,
-			std::string path, 
-			std::string baseMidiNote, 
-			std::string midiNoteLow, 
-			std::string midiNoteHigh,
-            float sampleRate) {
-
-			audioBuffer = new SoundBuffer(path.c_str(), sampleRate);
-
-			this->baseMidiNote = getMIDIFromNoteString(baseMidiNote);
-			this->midiNoteLow = getMIDIFromNoteString(midiNoteLow);
-			this->midiNoteHigh = getMIDIFromNoteString(midiNoteHigh);
-
-			this->destinationNode = destination;
-
-		}
-
-		bool appliesToNote(uint8_t note) {
-
-			//std::cout << "Note: " << int(note) << std::endl;
-			//std::cout << "Base: " << int(baseMidiNote) << std::endl;
-			//std::cout << "Low: " << int(midiNoteLow) << std::endl;
-			//std::cout << "High: " << int(midiNoteHigh) << std::endl;
-			//std::cout << std::endl << std::endl;
-
-			if (baseMidiNote == note) {
-				return true; 
-			} else if (note >= midiNoteLow && note <= midiNoteHigh) {
-				return true; 
-			}
-
-			else return false; 
-
-		}
-
-		std::shared_ptr<AudioBufferSourceNode> startNote(ContextGraphLock& g, ContextRenderLock& r,
-                                                         uint8_t midiNoteNumber, float amplitude = 1.0) {
-
-			// var semitoneRatio = Math.pow(2, 1/12);
-			double pitchRatio = pow(2.0, (midiNoteNumber - baseMidiNote) / 12.0);
-
-			std::shared_ptr<AudioBufferSourceNode> theSample(audioBuffer->create(g, r, g.context()->sampleRate()));
-
-			theSample->playbackRate()->setValue(pitchRatio); 
-			theSample->gain()->setValue(amplitude); 
-
-			// Connect the source node to the parsed audio data for playback
-			theSample->setBuffer(g, r, audioBuffer->audioBuffer);
-
-			// Bus the sound to the output destination .
-			ExceptionCode ec;
-			theSample->connect(g, r, destinationNode.get(), 0, 0, ec);
-			theSample->start(0.0);
-
-			return theSample;
-
-		}
-
-		// Ex: F#6. Assumes uppercase note names, hash symbol, and octave. 
-		uint8_t getMIDIFromNoteString(std::string noteName) {
-
-			std::array<std::string, 12> midiTranslationArray = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
-
-			// Ocatve is always last character, as an integer 
-			std::string octaveString = noteName.substr(noteName.length() - 1, 1);
-			int octave = std::stoi(octaveString);
-
-			std::string noteString = noteName.erase(noteName.length() - 1, 1); 
-
-			// Uppercase the incoming note 
-			std::transform(noteString.begin(), noteString.end(), noteString.begin(), ::toupper);
-
-			// IF we don't use # notation, convert S to #
-			std::replace(noteString.begin(), noteString.end(), 'S', '#'); // replace all 'x' to 'y'
-
-			// Note name is now the first or second character 
-			int notePos = -1;
-			for (int i = 0; i < 12; ++i) {
-				if (noteString == midiTranslationArray[i]) {
-					notePos = i;
-					break;
-				}
-			}
-
-			return uint8_t((octave * 12.0) + notePos);
-
-		}
-
-		std::string getNoteStringFromMIDI(uint8_t note) {
-
-			std::array<std::string, 12> midiTranslationArray = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
-
-			int octave = int(note / 12) - 1;
-			int positionInOctave = note % 12;
-
-			std::string originalNote = midiTranslationArray[positionInOctave];
-
-			std::replace(originalNote.begin(), originalNote.end(), '#', 'S'); // replace all 'x' to 'y'
-
-			return  originalNote + std::to_string(octave);
-
-		}
-
-		void stopNote(); 
-
-        std::shared_ptr<GainNode> destinationNode;
-
-		SoundBuffer *audioBuffer;
-
-		uint8_t baseMidiNote;
-		uint8_t midiNoteLow;
-		uint8_t midiNoteHigh; 
-
-	};
-
-	class SampledInstrumentNode {
-
-	public:
-        SampledInstrumentNode(float sampleRate);
-        virtual ~SampledInstrumentNode() {}
-        
-		void loadInstrumentConfiguration(std::string path);
-
-		void noteOn(ContextGraphLock& g, ContextRenderLock& r, float frequency, float amplitude);
-		float noteOff(ContextRenderLock& r, float amplitude);
-
-		void stopAll(); 
-
-        std::shared_ptr<GainNode> gainNode;
-
-	private:
-
-		// void startVoice(SamplerVoice const &voice, SamplerSound const &sound, const uint8_t midiNoteNumber, const float velocity);
-		// void stopVoice(SamplerVoice const &voice);
-
-		// Sample Map => Audio Buffers
-
-		// Loop? 
-		// Filter? 
-
-		// Blech
-        std::vector<std::shared_ptr<SamplerSound>> samples;
-
-		// Satisfy the AudioNode interface
-		//virtual void process(ContextGraphLock& g, ContextRenderLock&, size_t) override {}
-		//virtual void reset() override {}
-		//virtual double tailTime() const OVERRIDE { return 0; }
-		//virtual double latencyTime() const OVERRIDE { return 0; }
-		//virtual bool propagatesSilence(double now) const OVERRIDE { return true; }
-
-	};
+    // SampledInstrumentNode plays MIDI notes from a map of recorded samples, each resampled to the pitch of
+    // its note, through an ADSR envelope.
+    //
+    // An instrument is a set of zones, each a sample recorded at a base note which plays for a range of keys
+    // and velocities. Zones which overlap play together, so velocity layers are zones over the same keys with
+    // different velocity ranges. The zones of each of the 128 keys are found when the instrument is loaded, so a
+    // note finds its samples without searching.
+    //
+    // The node holds a fixed number of voices. A note started when all of them are sounding takes the voice
+    // of the quietest released note, or failing that of the oldest note. Notes are started and released from
+    // any thread through a lock-free queue, and each applies at the frame of its time on the context's timeline,
+    // so that a sequence may be scheduled ahead.
+
+    class SampledInstrumentNode : public WebCore::AudioNode {
+    public:
+        // maxEvents bounds the notes which may wait for the render thread at once.
+        SampledInstrumentNode(float sampleRate, unsigned maxVoices = 64, unsigned maxEvents = 4096);
+        virtual ~SampledInstrumentNode();
+
+        // AudioNode
+        virtual void process(ContextGraphLock& g, ContextRenderLock&, size_t framesToProcess) override;
+        virtual void reset(std::shared_ptr<WebCore::AudioContext>) override;
+
+        // Reads a JSON description of the zones, as in examples/data/cello_pluck.json, and loads the samples
+        // on the calling thread. Sample paths are relative to the description. A zone may give lowVelocity and
+        // highVelocity, from 1 to 127; otherwise it plays at every velocity. The instrument replaces the
+        // current one at the start of the next quantum, silencing any notes it was playing.
+        void loadInstrumentConfiguration(std::string path);
+
+        unsigned maxVoices() const { return m_envelopes.maxVoices(); }
+
+        // Starts a note at a time in seconds on the context's timeline; a time already past starts it at once.
+        // A velocity of 0 releases the note, as in MIDI. Returns false if too many notes are waiting.
+        bool noteOn(double when, uint8_t midiNoteNumber, uint8_t velocity);
+
+        // Releases every sounding note of a key, which sound until their release time has passed, or their
+        // sample ends.
+        void noteOff(double when, uint8_t midiNoteNumber);
+        void allNotesOff(double when);
+
+        // Scales the whole instrument, read once per quantum.
+        std::shared_ptr<WebCore::AudioParam> gain() const { return m_gain; }
+
+        // The envelope, as ADSRNode's. Attack, decay and sustain are read as each note starts, and release as
+        // it is released. By default a note plays its sample as recorded until it is released.
+        std::shared_ptr<WebCore::AudioParam> attackTime() const { return m_attackTime; }
+        std::shared_ptr<WebCore::AudioParam> attackLevel() const { return m_attackLevel; }
+        std::shared_ptr<WebCore::AudioParam> decayTime() const { return m_decayTime; }
+        std::shared_ptr<WebCore::AudioParam> sustainLevel() const { return m_sustainLevel; }
+        std::shared_ptr<WebCore::AudioParam> releaseTime() const { return m_releaseTime; }
+
+        // The voices sounding at the end of the last quantum, and the notes that have had to steal a voice.
+        unsigned activeVoiceCount() const { return m_activeVoiceCount.load(std::memory_order_relaxed); }
+        uint64_t stolenVoiceCount() const { return m_envelopes.stolenVoiceCount(); }
+
+        virtual bool propagatesSilence(double now) const override;
+
+    private:
+        virtual double tailTime() const override { return 0; }
+        virtual double latencyTime() const override { return 0; }
+
+        struct Zone {
+            std::shared_ptr<WebCore::AudioBuffer> sample;
+            uint8_t baseNote;
+            uint8_t lowNote;
+            uint8_t highNote;
+            uint8_t lowVelocity;
+            uint8_t highVelocity;
+        };
+
+        struct Instrument {
+            std::vector<Zone> zones;
+
+            // For each key, a range of keyZones, which index zones.
+            std::array<uint32_t, 128> firstKeyZone;
+            std::array<uint32_t, 128> keyZoneCount;
+            std::vector<uint32_t> keyZones;
+
+            // Held until the audio thread takes the instrument, then retired through the context.
+            std::shared_ptr<Instrument> self;
+        };
+
+        enum EventType { NoteOnEvent, NoteOffEvent, AllNotesOffEvent };
+
+        struct Event {
+            double when;
+            uint64_t frame; // when is due, set by the render thread
+            uint32_t sequence; // orders events due at the same frame as they were made
+            uint8_t type;
+            uint8_t key;
+            uint8_t velocity;
+        };
+
+        // The sample a voice plays. Its envelope is kept by m_envelopes.
+        struct Voice {
+            const Zone* zone;
+            const float* sampleData;
+            double position; // in frames of the sample
+            double rate;
+            float gain;
+            uint8_t key;
+        };
+
+        bool pushEvent(EventType, double when, uint8_t key, uint8_t velocity);
+        void applyEvent(ContextRenderLock&, const Event&, uint64_t frame);
+
+        void startNote(ContextRenderLock&, const Zone&, uint8_t key, uint8_t velocity, uint64_t frame);
+
+        void freeVoice(unsigned activeIndex);
+        void releaseVoice(ContextRenderLock&, unsigned voice);
+
+        // Renders every sounding voice, adding it to the output.
+        void renderVoices(float* destination, size_t framesToProcess, float gain);
+
+        // Returns the frames of the voice's sample, resampled, written to m_voiceBuffer. Fewer than asked
+        // for means the sample has ended.
+        size_t renderSample(Voice&, size_t framesToProcess);
+
+        std::shared_ptr<WebCore::AudioParam> m_gain;
+        std::shared_ptr<WebCore::AudioParam> m_attackTime;
+        std::shared_ptr<WebCore::AudioParam> m_attackLevel;
+        std::shared_ptr<WebCore::AudioParam> m_decayTime;
+        std::shared_ptr<WebCore::AudioParam> m_sustainLevel;
+        std::shared_ptr<WebCore::AudioParam> m_releaseTime;
+
+        // Owned by the render thread once taken from m_pendingInstrument.
+        std::shared_ptr<Instrument> m_instrument;
+        std::atomic<Instrument*> m_pendingInstrument;
 
-} // LabSound
+        VoiceEventQueue<Event> m_events;
+
+        std::vector<Voice> m_voices;
+        VoiceEnvelopes m_envelopes;
+
+        WebCore::AudioFloatArray m_voiceBuffer;
+
+        std::atomic<unsigned> m_activeVoiceCount;
+    };
+
+}
+
+#endif // SampledInstrumentNode_h
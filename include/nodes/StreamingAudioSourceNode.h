@@ -0,0 +1,167 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef StreamingAudioSourceNode_h
+#define StreamingAudioSourceNode_h
+
+#include "AudioArray.h"
+#include "AudioParam.h"
+#include "AudioScheduledSourceNode.h"
+#include <WTF/Threading.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace WebCore {
+    class AudioBus;
+    class AudioFileStream;
+}
+
+namespace LabSound {
+
+    // StreamingAudioSourceNode plays a file from disk without holding it in memory. A background thread
+    // decodes the file a block at a time into a ring buffer which the render thread reads without locking,
+    // so memory is bounded by the read-ahead window however long the file is.
+    //
+    // If the decoder falls behind, the node renders silence and counts the frames it missed.
+
+    class StreamingAudioSourceNode : public WebCore::AudioScheduledSourceNode {
+    public:
+        // readAheadTime is how far, in seconds, the decoder may run ahead of playback. It is rounded up
+        // so that the ring buffer is a power of two frames long.
+        StreamingAudioSourceNode(float sampleRate, double readAheadTime = 2.0);
+        virtual ~StreamingAudioSourceNode();
+
+        // AudioNode
+        virtual void process(ContextGraphLock& g, ContextRenderLock&, size_t framesToProcess) override;
+        virtual void reset(std::shared_ptr<WebCore::AudioContext>) override;
+
+        // Opens the file and begins decoding it from the start. Returns false if the file can't be opened.
+        // Rendering carries on while the file is opened; the render thread switches to it at its next quantum.
+        bool setFile(const char* filePath);
+
+        // The length of the file, in seconds.
+        double duration() const { return m_duration; }
+
+        unsigned numberOfChannels() const { return m_numberOfChannels; }
+
+        // Play-state. As AudioBufferSourceNode; a duration of 0 plays to the end of the file.
+        void startGrain(double when, double grainOffset);
+        void startGrain(double when, double grainOffset, double grainDuration);
+
+        // Moves playback to a time in seconds into the file. Frames already decoded are discarded,
+        // so playback is silent until the decoder has caught up.
+        void seek(double time);
+
+        // Loop times in seconds. A loopEnd of 0 loops the whole file. Changes apply to frames not yet decoded.
+        bool loop() const;
+        void setLoop(bool);
+        double loopStart() const;
+        double loopEnd() const;
+        void setLoopStart(double);
+        void setLoopEnd(double);
+
+        std::shared_ptr<WebCore::AudioParam> gain() { return m_gain; }
+
+        // Frames of silence rendered because the decoder fell behind, since the file was set. Waiting for the
+        // first block after the file is set or a seek doesn't count.
+        uint64_t underrunFrames() const { return m_underrunFrames.load(std::memory_order_relaxed); }
+
+        virtual bool propagatesSilence(double now) const override;
+
+    private:
+        virtual double tailTime() const override { return 0; }
+        virtual double latencyTime() const override { return 0; }
+
+        // Where the decoder should start, and the frame it should stop before, in frames into the file.
+        struct Request {
+            uint64_t offset;
+            uint64_t end;
+        };
+
+        // A file and the ring buffer it is decoded into. The decoder writes to the source set last, and the render
+        // thread reads from the one it last took, so that a file is opened without holding up rendering.
+        struct Source {
+            std::unique_ptr<WebCore::AudioFileStream> stream;
+            unsigned numberOfChannels;
+
+            // Frames are counted from when the file was set, and masked to index the channels.
+            std::vector<std::unique_ptr<WebCore::AudioFloatArray>> ring;
+            size_t ringMask;
+
+            // Written by the decoder: the end of the decoded frames; the frame from which they belong to the latest
+            // request, so that the render thread skips any before it; where the stream ends, if it has been reached;
+            // and the request they belong to.
+            std::atomic<uint64_t> writeFrame;
+            std::atomic<uint64_t> discardUntil;
+            std::atomic<uint64_t> streamEnd;
+            std::atomic<unsigned> decodedGeneration;
+
+            // Written by the render thread.
+            std::atomic<uint64_t> readFrame;
+
+            // Keeps a source alive from when it is set until the render thread takes it.
+            std::shared_ptr<Source> self;
+        };
+
+        // Asks the decoder thread to restart from a new position.
+        void requestPosition(double offset, double duration);
+
+        void startDecoder();
+        void stopDecoder();
+
+        static void decoderEntry(void* threadData);
+        void decoderLoop();
+
+        // Decodes a block into the ring buffer. Returns false if there is no more to decode, or no room.
+        bool decode(Source&, bool isLooping, uint64_t loopStartFrame, uint64_t loopEndFrame);
+
+        // Reads from the ring buffer into the output, zeroing what isn't available.
+        void render(ContextRenderLock&, WebCore::AudioBus*, size_t destinationFrameOffset, size_t numberOfFrames);
+
+        unsigned m_numberOfChannels;
+        double m_duration;
+        double m_readAheadTime;
+
+        // The source set last, which the decoder reads into; the one the render thread plays from; and one set
+        // but not yet taken by the render thread.
+        std::shared_ptr<Source> m_decoderSource;
+        std::shared_ptr<Source> m_source;
+        std::atomic<Source*> m_pendingSource;
+
+        // Written by the render thread.
+        std::atomic<uint64_t> m_underrunFrames;
+
+        // The render thread reads only frames decoded for the latest request.
+        std::atomic<unsigned> m_requestedGeneration;
+
+        // Guarded by m_requestMutex, and shared by the main and decoder threads only.
+        mutable std::mutex m_requestMutex;
+        std::condition_variable m_wake;
+        Request m_request;
+        bool m_isLooping;
+        double m_loopStart;
+        double m_loopEnd;
+        bool m_shouldExit;
+
+        // Owned by the decoder thread.
+        ThreadIdentifier m_decoderThread;
+        std::unique_ptr<WebCore::AudioBus> m_decodeBus;
+        unsigned m_generation;
+        uint64_t m_decodeFrame;
+        uint64_t m_decodeEnd;
+        bool m_decodeFinished;
+
+        std::shared_ptr<WebCore::AudioParam> m_gain;
+        float m_lastGain;
+
+        // Set by startGrain() after m_requestWhen, and taken by the render thread.
+        std::atomic<bool> m_startRequested;
+        double m_requestWhen;
+    };
+
+}
+
+#endif // StreamingAudioSourceNode_h
@@ -0,0 +1,156 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#ifndef VoicePoolNode_h
+#define VoicePoolNode_h
+
+#include "AudioArray.h"
+#include "AudioNode.h"
+#include "AudioParam.h"
+#include "ExceptionCodes.h"
+#include "OscillatorNode.h"
+#include "VoiceScheduler.h"
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace WebCore {
+    class WaveTable;
+}
+
+namespace LabSound {
+
+    // VoicePoolNode plays many notes of a band-limited oscillator with an ADSR envelope, mixed to a stereo
+    // output. The voices are rendered by the node itself rather than by an OscillatorNode and ADSRNode each,
+    // so a note costs no graph nodes, buses or connections. The voices' phases, envelopes and gains are kept
+    // a field to an array, and a voice's frames are rendered a register at a time.
+    //
+    // The pool holds a fixed number of voices. A note started when all of them are sounding takes the voice
+    // of the quietest released note, or failing that of the oldest note. Its envelope starts from the stolen
+    // voice's level, so that the change doesn't click.
+    //
+    // Notes are started, changed and released from any thread through a lock-free queue, and each change
+    // applies at the frame of its time on the context's timeline.
+
+    class VoicePoolNode : public WebCore::AudioNode {
+    public:
+        // Identifies a note to the calls that change it. Zero is never a note.
+        typedef uint32_t Note;
+
+        // maxEvents bounds the changes that may wait for the render thread at once.
+        VoicePoolNode(float sampleRate, unsigned maxVoices, unsigned short type = WebCore::OscillatorNode::SAWTOOTH, unsigned maxEvents = 4096);
+        virtual ~VoicePoolNode();
+
+        // AudioNode
+        virtual void process(ContextGraphLock& g, ContextRenderLock&, size_t framesToProcess) override;
+        virtual void reset(std::shared_ptr<WebCore::AudioContext>) override;
+
+        unsigned maxVoices() const { return m_envelopes.maxVoices(); }
+
+        // The waveform of every voice, one of OscillatorNode's standard types. Sounding notes change too.
+        unsigned short type() const { return m_type; }
+        void setType(ContextRenderLock&, unsigned short type, ExceptionCode&);
+
+        // Starts a note at a time in seconds on the context's timeline; a time already past starts it at once.
+        // pan runs from -1, left, to 1, right, with equal power. Returns 0 if too many changes are waiting.
+        Note noteOn(double when, float frequency, float gain = 1, float pan = 0);
+
+        // Releases a note, which sounds until its release time has passed.
+        void noteOff(Note, double when);
+        void allNotesOff(double when);
+
+        // Changes a sounding note. Frequency changes keep the phase, so they don't click; gain and pan change
+        // at the frame given, so a glide should be made of several changes.
+        void setFrequency(Note, float frequency, double when);
+        void setGain(Note, float gain, double when);
+        void setPan(Note, float pan, double when);
+
+        // The envelope. Attack, decay and sustain are read as each note starts, and release as it is released.
+        std::shared_ptr<WebCore::AudioParam> attackTime() const { return m_attackTime; }
+        std::shared_ptr<WebCore::AudioParam> attackLevel() const { return m_attackLevel; }
+        std::shared_ptr<WebCore::AudioParam> decayTime() const { return m_decayTime; }
+        std::shared_ptr<WebCore::AudioParam> sustainLevel() const { return m_sustainLevel; }
+        std::shared_ptr<WebCore::AudioParam> releaseTime() const { return m_releaseTime; }
+
+        // The voices sounding at the end of the last quantum, and the notes that have had to steal a voice.
+        unsigned activeVoiceCount() const { return m_activeVoiceCount.load(std::memory_order_relaxed); }
+        uint64_t stolenVoiceCount() const { return m_envelopes.stolenVoiceCount(); }
+
+        virtual bool propagatesSilence(double now) const override;
+
+    private:
+        virtual double tailTime() const override { return 0; }
+        virtual double latencyTime() const override { return 0; }
+
+        enum EventType { NoteOnEvent, NoteOffEvent, AllNotesOffEvent, FrequencyEvent, GainEvent, PanEvent };
+
+        struct Event {
+            double when;
+            uint64_t frame; // when is due, set by the render thread
+            uint32_t sequence; // orders events due at the same frame as they were made
+            Note note;
+            uint8_t type;
+            float frequency;
+            float gain;
+            float pan;
+        };
+
+        bool pushEvent(EventType, Note, double when, float frequency, float gain, float pan);
+        void applyEvent(ContextRenderLock&, const Event&, uint64_t frame);
+
+        // Takes a free voice, or steals one, and makes it sounding.
+        unsigned allocateVoice(uint64_t frame);
+        void freeVoice(unsigned activeIndex);
+
+        void setVoiceFrequency(unsigned voice, float frequency);
+        void setVoiceGains(unsigned voice);
+
+        void startEnvelope(ContextRenderLock&, unsigned voice);
+        void releaseVoice(ContextRenderLock&, unsigned voice);
+
+        // Renders every sounding voice, adding it to the output.
+        void renderVoices(float* left, float* right, size_t framesToProcess);
+
+        // Note to voice, open addressed with linear probing.
+        unsigned findVoice(Note) const;
+        void insertNote(Note, unsigned voice);
+        void eraseNote(Note);
+
+        unsigned short m_type;
+        std::shared_ptr<WebCore::WaveTable> m_waveTable;
+
+        std::shared_ptr<WebCore::AudioParam> m_attackTime;
+        std::shared_ptr<WebCore::AudioParam> m_attackLevel;
+        std::shared_ptr<WebCore::AudioParam> m_decayTime;
+        std::shared_ptr<WebCore::AudioParam> m_sustainLevel;
+        std::shared_ptr<WebCore::AudioParam> m_releaseTime;
+
+        VoiceEventQueue<Event> m_events;
+        std::atomic<uint32_t> m_nextNote;
+
+        // The voices, a field to an array, but for their envelopes.
+        VoiceEnvelopes m_envelopes;
+        std::vector<Note> m_noteIds;
+        std::vector<uint32_t> m_phases;
+        std::vector<uint32_t> m_phaseIncrements;
+        std::vector<const float*> m_higherWaveData;
+        std::vector<const float*> m_lowerWaveData;
+        std::vector<float> m_tableInterpolationFactors;
+        std::vector<float> m_frequencies;
+        std::vector<float> m_gains;
+        std::vector<float> m_pans;
+        std::vector<float> m_leftGains;
+        std::vector<float> m_rightGains;
+
+        std::vector<Note> m_noteTableKeys;
+        std::vector<unsigned> m_noteTableVoices;
+
+        WebCore::AudioFloatArray m_voiceBuffer;
+
+        std::atomic<unsigned> m_activeVoiceCount;
+    };
+
+}
+
+#endif // VoicePoolNode_h
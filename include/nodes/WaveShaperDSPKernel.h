@@ -25,8 +25,11 @@
 #ifndef WaveShaperDSPKernel_h
 #define WaveShaperDSPKernel_h
 
+#include "AudioArray.h"
 #include "AudioDSPKernel.h"
+#include "HalfBandResampler.h"
 #include "WaveShaperProcessor.h"
+#include <memory>
 
 namespace WebCore {
 
@@ -36,19 +39,35 @@ class WaveShaperProcessor;
 
 class WaveShaperDSPKernel : public AudioDSPKernel {
 public:  
-    explicit WaveShaperDSPKernel(WaveShaperProcessor* processor)
-    : AudioDSPKernel(processor)
-    {
-    }
+    explicit WaveShaperDSPKernel(WaveShaperProcessor*);
     
     // AudioDSPKernel
     virtual void process(ContextGraphLock& g, ContextRenderLock&, const float* source, float* dest, size_t framesToProcess);
-    virtual void reset() override { }
+    virtual void reset() override;
     virtual double tailTime() const OVERRIDE { return 0; }
-    virtual double latencyTime() const OVERRIDE { return 0; }
-    
+    virtual double latencyTime() const OVERRIDE;
+
+    // Oversampling requires more resources, so let's only allocate them if needed.
+    void lazyInitializeOversampling();
+
 protected:
+    // Apply the shaping curve.
+    void processCurve(const float* source, float* dest, size_t framesToProcess);
+
+    // Use up-sampling, process at the higher sample-rate, then down-sample.
+    void processCurve2x(const float* source, float* dest, size_t framesToProcess);
+    void processCurve4x(const float* source, float* dest, size_t framesToProcess);
+
     WaveShaperProcessor* waveShaperProcessor() { return static_cast<WaveShaperProcessor*>(processor()); }
+    const WaveShaperProcessor* waveShaperProcessor() const { return static_cast<const WaveShaperProcessor*>(processor()); }
+
+    // Oversampling.
+    std::unique_ptr<AudioFloatArray> m_tempBuffer;
+    std::unique_ptr<AudioFloatArray> m_tempBuffer2;
+    std::unique_ptr<UpSampler> m_upSampler;
+    std::unique_ptr<DownSampler> m_downSampler;
+    std::unique_ptr<UpSampler> m_upSampler2;
+    std::unique_ptr<DownSampler> m_downSampler2;
 };
 
 } // namespace WebCore
@@ -38,6 +38,9 @@ public:
     void setCurve(ContextRenderLock&, std::shared_ptr<std::vector<float>>);
     std::shared_ptr<std::vector<float>> curve();
 
+    void setOversample(ContextRenderLock&, WaveShaperProcessor::OverSampleType);
+    WaveShaperProcessor::OverSampleType oversample();
+
 private:    
 
     WaveShaperProcessor* waveShaperProcessor() { return static_cast<WaveShaperProcessor*>(processor()); }
@@ -37,6 +37,12 @@ namespace WebCore {
 
 class WaveShaperProcessor : public AudioDSPKernelProcessor {
 public:
+    enum OverSampleType {
+        OverSampleNone,
+        OverSample2x,
+        OverSample4x
+    };
+
     WaveShaperProcessor(float sampleRate, size_t numberOfChannels);
 
     virtual ~WaveShaperProcessor();
@@ -48,9 +54,16 @@ public:
     void setCurve(ContextRenderLock&, std::shared_ptr<std::vector<float>>);
     std::shared_ptr<std::vector<float>> curve() { return m_curve; }
 
+    // Shaping at two or four times the sample rate keeps the harmonics the curve adds from aliasing,
+    // for the cost of the resampling filters and of shaping more frames.
+    void setOversample(ContextRenderLock&, OverSampleType);
+    OverSampleType oversample() const { return m_oversample; }
+
 private:
     // m_curve represents the non-linear shaping curve.
     std::shared_ptr<std::vector<float>> m_curve;
+
+    OverSampleType m_oversample;
 };
 
 } // namespace WebCore
@@ -30,6 +30,8 @@
 #define WaveTable_h
 
 #include "AudioArray.h"
+#include <memory>
+#include <stdint.h>
 #include <vector>
 
 namespace WebCore {
@@ -46,6 +48,10 @@ public:
     // Creates an arbitrary wavetable given the frequency components (Fourier coefficients).
     static std::unique_ptr<WaveTable> create(float sampleRate, std::vector<float>& real, std::vector<float>& imag);
 
+    // Returns the wavetable for one of OscillatorNode's standard types, created the first time it is asked for
+    // and shared by every oscillator of any context at that sample-rate. Returns null for CUSTOM and unknown types.
+    static std::shared_ptr<WaveTable> sharedWaveTable(unsigned short type, float sampleRate);
+
     // Returns pointers to the lower and higher wavetable data for the pitch range containing
     // the given fundamental frequency. These two tables are in adjacent "pitch" ranges
     // where the higher table will have the maximum number of partials which won't alias when played back
@@ -57,9 +63,43 @@ public:
     // Returns the scalar multiplier to the oscillator frequency to calculate wave table phase increment.
     float rateScale() const { return m_rateScale; }
 
+    // Below this fundamental frequency no partial of the waveform is culled, so the lower and higher wave data
+    // hold the same waveform and needn't be interpolated. It's as high as ~17.5KHz @ 44.1KHz for a sine.
+    float unculledFrequencyLimit() const { return m_unculledFrequencyLimit; }
+
     unsigned waveTableSize() const { return m_waveTableSize; }
     float sampleRate() const { return m_sampleRate; }
 
+    // A read position is fixed point: the table index is in the bits above phaseFractionBits(), so the phase
+    // wraps around the table by itself as it advances.
+    unsigned phaseFractionBits() const { return m_phaseFractionBits; }
+
+    // Converts a read index or phase increment, in table entries and possibly negative, to a fixed point phase.
+    uint32_t fixedPointPhase(double readIndex) const;
+
+    // Reads the wave data chosen by waveDataForFundamentalFrequency() at a phase, interpolating towards the
+    // lower data by tableInterpolationFactor unless lowerWaveData is null.
+    float readWaveData(const float* higherWaveData, const float* lowerWaveData, float tableInterpolationFactor, uint32_t phase) const
+    {
+        uint32_t index = phase >> m_phaseFractionBits;
+        uint32_t next = (index + 1) & (m_waveTableSize - 1);
+        float fraction = (phase & ((1u << m_phaseFractionBits) - 1)) * m_phaseFractionScale;
+
+        float sample1 = higherWaveData[index];
+        float sample2 = higherWaveData[next];
+
+        if (lowerWaveData) {
+            sample1 += tableInterpolationFactor * (lowerWaveData[index] - sample1);
+            sample2 += tableInterpolationFactor * (lowerWaveData[next] - sample2);
+        }
+
+        return sample1 + fraction * (sample2 - sample1);
+    }
+
+    // Renders framesToProcess frames as readWaveData() reads them, starting at phase and advancing it by phaseIncrement a frame.
+    void renderWaveData(const float* higherWaveData, const float* lowerWaveData, float tableInterpolationFactor,
+                        uint32_t& phase, uint32_t phaseIncrement, float* destP, size_t framesToProcess) const;
+
 private:
     explicit WaveTable(float sampleRate);
 
@@ -76,6 +116,10 @@ private:
     float m_lowestFundamentalFrequency;
 
     float m_rateScale;
+    float m_unculledFrequencyLimit;
+
+    unsigned m_phaseFractionBits;
+    float m_phaseFractionScale;
 
     unsigned numberOfRanges() const { return m_numberOfRanges; }
 
@@ -51,8 +51,6 @@ namespace LabSound {
             if (!numChannels)
                 return;
             
-            std::shared_ptr<AudioContext> c = r.contextPtr();
-
             if (m_noteOnTime >= 0) {
                 if (m_currentGain > 0) {
                     m_zeroSteps = 16;
@@ -61,15 +59,15 @@ namespace LabSound {
                 else
                     m_zeroSteps = 0;
                 
-                m_attackTimeTarget = m_noteOnTime + m_attackTime->value(c);
+                m_attackTimeTarget = m_noteOnTime + m_attackTime->value(r);
                 
-                m_attackSteps = m_attackTime->value(c) * sampleRate();
-                m_attackStepSize = m_attackLevel->value(c) / m_attackSteps;
+                m_attackSteps = m_attackTime->value(r) * sampleRate();
+                m_attackStepSize = m_attackLevel->value(r) / m_attackSteps;
                 
-                m_decayTimeTarget = m_attackTimeTarget + m_decayTime->value(c);
+                m_decayTimeTarget = m_attackTimeTarget + m_decayTime->value(r);
                 
-                m_decaySteps = m_decayTime->value(c) * sampleRate();
-                m_decayStepSize = (m_sustainLevel->value(c) - m_attackLevel->value(c)) / m_decaySteps;
+                m_decaySteps = m_decayTime->value(r) * sampleRate();
+                m_decayStepSize = (m_sustainLevel->value(r) - m_attackLevel->value(r)) / m_decaySteps;
                 
                 m_releaseSteps = 0;
                 
@@ -85,7 +83,7 @@ namespace LabSound {
             if (gainValues.size() < framesToProcess)
                 gainValues.resize(framesToProcess);
 
-            float s = m_sustainLevel->value(c);
+            float s = m_sustainLevel->value(r);
 
             for (size_t i = 0; i < framesToProcess; ++i) {
                 if (m_zeroSteps > 0) {
@@ -140,13 +138,11 @@ namespace LabSound {
             // note off at any time except while a note is on, has no effect
             m_noteOnTime = -1.;
             
-            std::shared_ptr<AudioContext> c = r.contextPtr();
-            
             if (m_noteOffTime == DBL_MAX) {
-                m_noteOffTime = now + m_releaseTime->value(c);
+                m_noteOffTime = now + m_releaseTime->value(r);
 
-                m_releaseSteps = m_releaseTime->value(c) * sampleRate();
-                m_releaseStepSize = -m_sustainLevel->value(c) / m_releaseSteps;
+                m_releaseSteps = m_releaseTime->value(r) * sampleRate();
+                m_releaseStepSize = -m_sustainLevel->value(r) / m_releaseSteps;
             }
         }
 
@@ -217,13 +213,17 @@ namespace LabSound {
         addInput(std::unique_ptr<AudioNodeInput>(new WebCore::AudioNodeInput(this)));
         addOutput(std::unique_ptr<AudioNodeOutput>(new WebCore::AudioNodeOutput(this, 2))); // 2 stereo
 
+        addParam(data->m_attackTime);
+        addParam(data->m_attackLevel);
+        addParam(data->m_decayTime);
+        addParam(data->m_sustainLevel);
+        addParam(data->m_releaseTime);
+
         initialize();
     }
 
     ADSRNode::~ADSRNode() {
-        data->numChannels = 0;
-        delete data;
-        data = 0;
+        // data is the processor, which m_processor owns.
         uninitialize();
     }
 
@@ -0,0 +1,99 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "AllocationCounter.h"
+
+#if LABSOUND_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    std::atomic<size_t> allocations(0);
+
+    void* countedAllocate(size_t size)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return malloc(size ? size : 1);
+    }
+
+}
+
+void* operator new(size_t size)
+{
+    if (void* p = countedAllocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (void* p = countedAllocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw()
+{
+    return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw()
+{
+    return countedAllocate(size);
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) throw()
+{
+    free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) throw()
+{
+    free(p);
+}
+
+namespace LabSound {
+
+    bool allocationCountingEnabled()
+    {
+        return true;
+    }
+
+    size_t allocationCount()
+    {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+}
+
+#else
+
+namespace LabSound {
+
+    bool allocationCountingEnabled()
+    {
+        return false;
+    }
+
+    size_t allocationCount()
+    {
+        return 0;
+    }
+
+}
+
+#endif
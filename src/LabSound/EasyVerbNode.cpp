@@ -37,7 +37,7 @@ namespace LabSound {
 		// Processes the source to destination bus.  The number of channels must match in source and destination.
 		void process(ContextGraphLock& g, ContextRenderLock& r, const WebCore::AudioBus* sourceBus, WebCore::AudioBus* destinationBus, size_t framesToProcess) {
 
-			perryVerb.setT60(m_delayTime->value(r.contextPtr()));
+			perryVerb.setT60(m_delayTime->value(r));
 
 			const float *source = sourceBus->channel(0)->data();
 
@@ -83,6 +83,7 @@ namespace LabSound {
 		addInput(std::unique_ptr<AudioNodeInput>(new WebCore::AudioNodeInput(this)));
 		addOutput(std::unique_ptr<AudioNodeOutput>(new WebCore::AudioNodeOutput(this, 1))); // 2 stereo
 
+		addParam(data->m_delayTime);
 
 		initialize(); 
 
@@ -0,0 +1,141 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "LabSound.h"
+#include "HRTFBatchPannerNode.h"
+
+#include "AudioBus.h"
+#include "AudioContext.h"
+#include "AudioContextLock.h"
+#include "AudioListener.h"
+#include "AudioNodeInput.h"
+#include "AudioNodeOutput.h"
+#include "HRTFBatchPanner.h"
+#include "PannerNode.h"
+
+using namespace std;
+using namespace WebCore;
+
+namespace LabSound {
+
+    HRTFBatchPannerNode::HRTFBatchPannerNode(float sampleRate, unsigned numberOfSources)
+    : AudioNode(sampleRate)
+    , m_sources(numberOfSources)
+    , m_panner(new HRTFBatchPanner(sampleRate, numberOfSources))
+    , m_channels(numberOfSources)
+    {
+        setNodeType((AudioNode::NodeType) LabSound::NodeTypeHRTFBatchPanner);
+
+        for (unsigned i = 0; i < numberOfSources; ++i) {
+            addInput(unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
+            m_sources[i].position = FloatPoint3D(0, 0, 0);
+            m_sources[i].orientation = FloatPoint3D(1, 0, 0);
+            m_monoBuses.emplace_back(new AudioBus(1, AudioNode::ProcessingSizeInFrames));
+        }
+
+        addOutput(unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 2)));
+
+        initialize();
+    }
+
+    HRTFBatchPannerNode::~HRTFBatchPannerNode()
+    {
+        uninitialize();
+    }
+
+    void HRTFBatchPannerNode::process(ContextGraphLock&, ContextRenderLock& r, size_t framesToProcess)
+    {
+        AudioBus* destination = output(0)->bus();
+        AudioListener* listener = r.context() ? r.context()->listener() : 0;
+
+        if (!isInitialized() || !listener) {
+            destination->zero();
+            return;
+        }
+
+        FloatPoint3D listenerPosition = listener->position();
+
+        for (unsigned i = 0; i < m_sources.size(); ++i) {
+            const Source& source = m_sources[i];
+            auto input = this->input(i);
+
+            // Silent sources aren't transformed, once their tails have died away.
+            AudioBus* bus = input->isConnected() ? input->bus() : 0;
+            if (!bus || bus->isSilent() || bus->length() < framesToProcess) {
+                m_channels[i] = 0;
+                continue;
+            }
+
+            if (bus->numberOfChannels() == 1)
+                m_channels[i] = bus->channel(0)->data();
+            else {
+                AudioBus* mono = m_monoBuses[i].get();
+                mono->copyFrom(*bus);
+                m_channels[i] = mono->channel(0)->data();
+            }
+
+            double azimuth;
+            double elevation;
+            PannerNode::azimuthElevation(source.position, listener, &azimuth, &elevation);
+
+            double distanceGain = m_distanceEffect.gain(source.position.distanceTo(listenerPosition));
+            double coneGain = m_coneEffect.gain(source.position, source.orientation, listenerPosition);
+            m_panner->setSource(i, azimuth, elevation, static_cast<float>(distanceGain * coneGain));
+        }
+
+        m_panner->pan(m_channels.data(), destination, framesToProcess);
+    }
+
+    void HRTFBatchPannerNode::reset(std::shared_ptr<AudioContext>)
+    {
+        m_panner->reset();
+    }
+
+    FloatPoint3D HRTFBatchPannerNode::position(unsigned source) const
+    {
+        return source < m_sources.size() ? m_sources[source].position : FloatPoint3D();
+    }
+
+    void HRTFBatchPannerNode::setPosition(unsigned source, float x, float y, float z)
+    {
+        if (source < m_sources.size())
+            m_sources[source].position = FloatPoint3D(x, y, z);
+    }
+
+    FloatPoint3D HRTFBatchPannerNode::orientation(unsigned source) const
+    {
+        return source < m_sources.size() ? m_sources[source].orientation : FloatPoint3D();
+    }
+
+    void HRTFBatchPannerNode::setOrientation(unsigned source, float x, float y, float z)
+    {
+        if (source < m_sources.size())
+            m_sources[source].orientation = FloatPoint3D(x, y, z);
+    }
+
+    void HRTFBatchPannerNode::setDistanceModel(unsigned short model, ExceptionCode& ec)
+    {
+        switch (model) {
+        case DistanceEffect::ModelLinear:
+        case DistanceEffect::ModelInverse:
+        case DistanceEffect::ModelExponential:
+            m_distanceEffect.setModel(static_cast<DistanceEffect::ModelType>(model), true);
+            break;
+        default:
+            ec = NOT_SUPPORTED_ERR;
+            break;
+        }
+    }
+
+    double HRTFBatchPannerNode::tailTime() const
+    {
+        return m_panner->tailTime();
+    }
+
+    double HRTFBatchPannerNode::latencyTime() const
+    {
+        return m_panner->latencyTime();
+    }
+
+} // namespace LabSound
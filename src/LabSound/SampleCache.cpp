@@ -0,0 +1,258 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "SampleCache.h"
+
+#include "AudioBuffer.h"
+#include "AudioBus.h"
+#include "AudioFileReader.h"
+#include "MappedFile.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+
+using namespace std;
+using namespace WebCore;
+
+namespace LabSound {
+
+    const size_t DefaultMemoryBudget = 512 * 1024 * 1024;
+
+    // The header is followed by each channel's frames in turn, as native floats.
+    // It is 64 bytes long so that the channels are as well aligned as the mapping.
+    struct CacheFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t numberOfChannels;
+        float sampleRate;
+        uint64_t length;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint8_t padding[24];
+    };
+
+    static_assert(sizeof(CacheFileHeader) == 64, "cache file header should be 64 bytes");
+
+    const char CacheFileMagic[4] = { 'L', 'S', 'S', 'C' };
+    const uint32_t CacheFileVersion = 1;
+
+    static std::once_flag s_sharedOnce;
+    static SampleCache* s_shared = 0;
+
+    static string defaultCacheDirectory()
+    {
+#if OS(WINDOWS)
+        const char* directory = getenv("TEMP");
+        return directory ? directory : ".";
+#else
+        const char* directory = getenv("TMPDIR");
+        return directory ? directory : "/tmp";
+#endif
+    }
+
+    static string cacheKey(const char* path, float sampleRate, bool mixToMono)
+    {
+        return string(path) + "|" + to_string(sampleRate) + (mixToMono ? "|mono" : "");
+    }
+
+    // The key's 64 bit FNV-1a hash names the cache file.
+    static string cacheFileName(const string& key)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < key.size(); ++i) {
+            hash ^= static_cast<unsigned char>(key[i]);
+            hash *= 1099511628211ULL;
+        }
+
+        static const char digits[] = "0123456789abcdef";
+        string name = "labsound-";
+        for (int shift = 60; shift >= 0; shift -= 4)
+            name += digits[(hash >> shift) & 15];
+        return name + ".samples";
+    }
+
+    static shared_ptr<AudioBuffer> mapCacheFile(const string& cachePath, const struct stat& source)
+    {
+        shared_ptr<MappedFile> file = MappedFile::open(cachePath.c_str());
+        if (!file || file->size() < sizeof(CacheFileHeader))
+            return nullptr;
+
+        const CacheFileHeader* header = static_cast<const CacheFileHeader*>(file->data());
+        if (memcmp(header->magic, CacheFileMagic, sizeof(CacheFileMagic)) || header->version != CacheFileVersion)
+            return nullptr;
+
+        // A stale or truncated cache file is decoded again, and replaced.
+        if (header->sourceSize != static_cast<uint64_t>(source.st_size) || header->sourceModified != static_cast<int64_t>(source.st_mtime))
+            return nullptr;
+
+        uint64_t samples = header->numberOfChannels * header->length;
+        if (!header->numberOfChannels || file->size() != sizeof(CacheFileHeader) + samples * sizeof(float))
+            return nullptr;
+
+        const float* channels = reinterpret_cast<const float*>(header + 1);
+        vector<const float*> channelData;
+        for (uint32_t i = 0; i < header->numberOfChannels; ++i)
+            channelData.push_back(channels + i * header->length);
+
+        file->prefetch();
+        return make_shared<AudioBuffer>(file, channelData, static_cast<size_t>(header->length), header->sampleRate);
+    }
+
+    static bool writeCacheFile(const string& cachePath, AudioBus* bus, const struct stat& source)
+    {
+        CacheFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CacheFileMagic, sizeof(CacheFileMagic));
+        header.version = CacheFileVersion;
+        header.numberOfChannels = bus->numberOfChannels();
+        header.sampleRate = bus->sampleRate();
+        header.length = bus->length();
+        header.sourceSize = source.st_size;
+        header.sourceModified = source.st_mtime;
+
+        // Written aside and moved into place, so that a cache file is never seen half written, even while
+        // other processes are writing the same one.
+        string temporaryPath = temporaryPathFor(cachePath);
+        FILE* f = fopen(temporaryPath.c_str(), "wb");
+        if (!f)
+            return false;
+
+        bool written = fwrite(&header, sizeof(header), 1, f) == 1;
+        for (unsigned i = 0; written && i < bus->numberOfChannels(); ++i)
+            written = fwrite(bus->channel(i)->data(), sizeof(float), bus->length(), f) == bus->length();
+        written = !fclose(f) && written;
+
+        if (!written || !replaceFile(temporaryPath, cachePath)) {
+            remove(temporaryPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    SampleCache& SampleCache::shared()
+    {
+        std::call_once(s_sharedOnce, []() { s_shared = new SampleCache(); });
+        return *s_shared;
+    }
+
+    SampleCache::SampleCache()
+    : m_cacheDirectory(defaultCacheDirectory())
+    , m_memoryBudget(DefaultMemoryBudget)
+    , m_memoryUsage(0)
+    {
+    }
+
+    shared_ptr<AudioBuffer> SampleCache::load(const char* path, float sampleRate, bool mixToMono)
+    {
+        string key = cacheKey(path, sampleRate, mixToMono);
+        string directory;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_entries.find(key);
+            if (found != m_entries.end()) {
+                m_recent.splice(m_recent.begin(), m_recent, found->second.recent);
+                return found->second.buffer;
+            }
+            directory = m_cacheDirectory;
+        }
+
+        // Decode without the lock, so that different files may be loaded at once.
+        struct stat source;
+        if (stat(path, &source))
+            return nullptr;
+
+        string cachePath;
+        shared_ptr<AudioBuffer> buffer;
+        if (!directory.empty()) {
+            cachePath = directory + "/" + cacheFileName(key);
+            buffer = mapCacheFile(cachePath, source);
+        }
+
+        if (!buffer) {
+            std::unique_ptr<AudioBus> bus = createBusFromAudioFile(path, mixToMono, sampleRate);
+            if (!bus)
+                return nullptr;
+
+            if (!cachePath.empty() && writeCacheFile(cachePath, bus.get(), source))
+                buffer = mapCacheFile(cachePath, source);
+
+            // Keep the samples in memory if they couldn't be cached on disk.
+            if (!buffer)
+                buffer = make_shared<AudioBuffer>(bus.get());
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Another thread may have loaded the same file meanwhile; hand out one buffer to both.
+        auto found = m_entries.find(key);
+        if (found != m_entries.end()) {
+            m_recent.splice(m_recent.begin(), m_recent, found->second.recent);
+            return found->second.buffer;
+        }
+
+        m_recent.push_front(key);
+        Entry& entry = m_entries[key];
+        entry.buffer = buffer;
+        entry.bytes = buffer->numberOfChannels() * buffer->length() * sizeof(float);
+        entry.recent = m_recent.begin();
+        m_memoryUsage += entry.bytes;
+
+        evict();
+        return buffer;
+    }
+
+    void SampleCache::evict()
+    {
+        while (m_memoryUsage > m_memoryBudget && m_recent.size() > 1) {
+            auto found = m_entries.find(m_recent.back());
+            m_memoryUsage -= found->second.bytes;
+            m_entries.erase(found);
+            m_recent.pop_back();
+        }
+    }
+
+    void SampleCache::setCacheDirectory(const string& directory)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cacheDirectory = directory;
+    }
+
+    string SampleCache::cacheDirectory() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cacheDirectory;
+    }
+
+    void SampleCache::setMemoryBudget(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_memoryBudget = bytes;
+        evict();
+    }
+
+    size_t SampleCache::memoryBudget() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memoryBudget;
+    }
+
+    size_t SampleCache::memoryUsage() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memoryUsage;
+    }
+
+    void SampleCache::purge()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+        m_recent.clear();
+        m_memoryUsage = 0;
+    }
+
+} // namespace LabSound
@@ -1,93 +1,338 @@
-#include "SampledInstrumentNode.h"
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
 #include "LabSound.h"
+#include "SampledInstrumentNode.h"
+
+#include "AudioBus.h"
+#include "AudioContext.h"
+#include "AudioContextLock.h"
+#include "AudioNodeOutput.h"
+#include "SampleCache.h"
 #include "json11/json11.hpp"
-#include <string>
+#include <WTF/Assertions.h>
+#include <algorithm>
+#include <ctype.h>
 #include <fstream>
+#include <math.h>
 #include <streambuf>
-#include <WTF/Assertions.h>
 
-#if OS(WINDOWS)
-#include <direct.h>
-#define getcwd _getcwd
-#endif
-#if OS(DARWIN)
-#include <limits.h>
-#include <unistd.h>
-#define MAX_PATH PATH_MAX
-#endif
-
-//
+using namespace std;
+using namespace WebCore;
+using namespace json11;
 
 namespace LabSound {
 
-	using namespace json11;
+    // Ex: F#6, or FS6. The octave is the last character, and counts from C0, which is note 0.
+    static int noteNumberFromName(std::string noteName)
+    {
+        static const char* noteNames[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
 
-    SampledInstrumentNode::SampledInstrumentNode(float sampleRate) {
+        if (noteName.length() < 2 || !isdigit(noteName[noteName.length() - 1]))
+            return -1;
 
-		// All samples bus their output to this node... 
-        gainNode = std::make_shared<GainNode>(sampleRate);
-		gainNode->gain()->setValue(4.0);
-	}
+        int octave = noteName[noteName.length() - 1] - '0';
+        std::string noteString = noteName.substr(0, noteName.length() - 1);
+        std::transform(noteString.begin(), noteString.end(), noteString.begin(), ::toupper);
+        std::replace(noteString.begin(), noteString.end(), 'S', '#');
 
-	// Definitely have ADSR... 
-	void SampledInstrumentNode::noteOn(ContextGraphLock& g, ContextRenderLock& r, float midiNoteNumber, float amplitude) {
-	
-		for (auto &sample : samples) {
+        for (int i = 0; i < 12; ++i) {
+            if (noteString == noteNames[i])
+                return octave * 12 + i;
+        }
+        return -1;
+    }
 
-			// Find note in sample map
-			if (sample->appliesToNote(midiNoteNumber)) {
-				sample->startNote(g, r, midiNoteNumber, amplitude);
-			}
+    SampledInstrumentNode::SampledInstrumentNode(float sampleRate, unsigned maxVoices, unsigned maxEvents)
+    : AudioNode(sampleRate)
+    , m_pendingInstrument(nullptr)
+    , m_events(maxEvents)
+    , m_envelopes(maxVoices)
+    , m_voiceBuffer(AudioNode::ProcessingSizeInFrames)
+    , m_activeVoiceCount(0)
+    {
+        setNodeType((AudioNode::NodeType) LabSound::NodeTypeSampledInstrument);
 
-		}
+        m_gain = std::make_shared<AudioParam>("gain", 1.0, 0, 100);
+        m_attackTime = std::make_shared<AudioParam>("attackTime", 0, 0, 120);
+        m_attackLevel = std::make_shared<AudioParam>("attackLevel", 1.0, 0, 10);
+        m_decayTime = std::make_shared<AudioParam>("decayTime", 0, 0, 120);
+        m_sustainLevel = std::make_shared<AudioParam>("sustain", 1.0, 0, 10);
+        m_releaseTime = std::make_shared<AudioParam>("release", 0.0625, 0, 120);
+        addParam(m_gain);
+        addParam(m_attackTime);
+        addParam(m_attackLevel);
+        addParam(m_decayTime);
+        addParam(m_sustainLevel);
+        addParam(m_releaseTime);
 
-	}
+        Voice idle = {};
+        m_voices.resize(m_envelopes.maxVoices(), idle);
 
-	void SampledInstrumentNode::loadInstrumentConfiguration(std::string path) {
+        addOutput(unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 1)));
 
-		char cwd[MAX_PATH];
-		getcwd(cwd, MAX_PATH);
+        initialize();
+    }
 
-		std::string swdString(cwd);
+    SampledInstrumentNode::~SampledInstrumentNode()
+    {
+        // Drop any instrument which was never taken.
+        if (Instrument* loaded = m_pendingInstrument.exchange(nullptr)) {
+            std::shared_ptr<Instrument> release = std::move(loaded->self);
+        }
+
+        uninitialize();
+    }
 
-		std::ifstream fileStream(path);
-		std::string jsonString;
-        
-        if ( !fileStream.is_open() ) {
-            LOG_ERROR("Instrument JSON failed to open with path %s: ", path.c_str());
+    void SampledInstrumentNode::loadInstrumentConfiguration(std::string path)
+    {
+        std::ifstream fileStream(path);
+        if (!fileStream.is_open()) {
+            LOG_ERROR("Instrument JSON failed to open with path %s", path.c_str());
             return;
         }
-        
-		fileStream.seekg(0, std::ios::end);
-		jsonString.reserve(fileStream.tellg());
-		fileStream.seekg(0, std::ios::beg);
-
-		jsonString.assign((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
-
-		std::string err;
-		auto jsonConfig = Json::parse(jsonString, err);
-
-		if (err.empty()) {
-
-			for (auto &samp : jsonConfig["samples"].array_items()) {
-				// std::cout << "Loading Sample: " << samp.dump() << "\n";
-				// std::cout << "Sample Name: " << samp["sample"].string_value() << std::endl;
-                samples.emplace_back(std::make_shared<SamplerSound>(
-					gainNode,
-					samp["sample"].string_value(),
-					samp["baseNote"].string_value(),
-					samp["lowNote"].string_value(),
-					samp["highNote"].string_value(),
-                    44100
-					));
-			}
-
-		}
-		
-		else {
-			LOG_ERROR("JSON Parse Error: %s", err.c_str());
-		}
-
-	}
-
-}
+
+        std::string jsonString((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+
+        std::string err;
+        Json jsonConfig = Json::parse(jsonString, err);
+        if (!err.empty()) {
+            LOG_ERROR("JSON Parse Error: %s", err.c_str());
+            return;
+        }
+
+        size_t separator = path.find_last_of("/\\");
+        std::string directory = separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+
+        std::shared_ptr<Instrument> instrument = std::make_shared<Instrument>();
+
+        for (auto& samp : jsonConfig["samples"].array_items()) {
+            std::string samplePath = samp["sample"].string_value();
+            int baseNote = noteNumberFromName(samp["baseNote"].string_value());
+            int lowNote = noteNumberFromName(samp["lowNote"].string_value());
+            int highNote = noteNumberFromName(samp["highNote"].string_value());
+            if (baseNote < 0 || lowNote < 0 || highNote < 0) {
+                LOG_ERROR("Instrument zone for %s has an unreadable note", samplePath.c_str());
+                continue;
+            }
+
+            bool isAbsolute = !samplePath.empty() && (samplePath[0] == '/' || samplePath[0] == '\\' || samplePath.find(':') != std::string::npos);
+            Zone zone;
+            zone.sample = SampleCache::shared().load((isAbsolute ? samplePath : directory + samplePath).c_str(), sampleRate(), true);
+            if (!zone.sample || zone.sample->length() < 2) {
+                LOG_ERROR("Could not load %s", samplePath.c_str());
+                continue;
+            }
+
+            zone.baseNote = static_cast<uint8_t>(baseNote);
+            zone.lowNote = static_cast<uint8_t>(lowNote);
+            zone.highNote = static_cast<uint8_t>(highNote);
+            zone.lowVelocity = static_cast<uint8_t>(samp["lowVelocity"].is_number() ? min(max(samp["lowVelocity"].int_value(), 1), 127) : 1);
+            zone.highVelocity = static_cast<uint8_t>(samp["highVelocity"].is_number() ? min(max(samp["highVelocity"].int_value(), 1), 127) : 127);
+            instrument->zones.push_back(zone);
+        }
+
+        // A zone plays for its base note, and for the keys from its low note to its high note.
+        for (uint32_t key = 0; key < 128; ++key) {
+            instrument->firstKeyZone[key] = static_cast<uint32_t>(instrument->keyZones.size());
+            for (uint32_t i = 0; i < instrument->zones.size(); ++i) {
+                const Zone& zone = instrument->zones[i];
+                if (zone.baseNote == key || (key >= zone.lowNote && key <= zone.highNote))
+                    instrument->keyZones.push_back(i);
+            }
+            instrument->keyZoneCount[key] = static_cast<uint32_t>(instrument->keyZones.size()) - instrument->firstKeyZone[key];
+        }
+
+        instrument->self = instrument;
+
+        // An instrument the audio thread hasn't taken yet is replaced, and so was never seen by the audio thread.
+        if (Instrument* replaced = m_pendingInstrument.exchange(instrument.get(), std::memory_order_acq_rel)) {
+            std::shared_ptr<Instrument> release = std::move(replaced->self);
+        }
+    }
+
+    bool SampledInstrumentNode::noteOn(double when, uint8_t midiNoteNumber, uint8_t velocity)
+    {
+        if (midiNoteNumber > 127)
+            return false;
+
+        return pushEvent(velocity ? NoteOnEvent : NoteOffEvent, when, midiNoteNumber, min<uint8_t>(velocity, 127));
+    }
+
+    void SampledInstrumentNode::noteOff(double when, uint8_t midiNoteNumber)
+    {
+        pushEvent(NoteOffEvent, when, midiNoteNumber, 0);
+    }
+
+    void SampledInstrumentNode::allNotesOff(double when)
+    {
+        pushEvent(AllNotesOffEvent, when, 0, 0);
+    }
+
+    bool SampledInstrumentNode::pushEvent(EventType type, double when, uint8_t key, uint8_t velocity)
+    {
+        Event event;
+        event.when = when;
+        event.type = static_cast<uint8_t>(type);
+        event.key = key;
+        event.velocity = velocity;
+        return m_events.push(event);
+    }
+
+    void SampledInstrumentNode::process(ContextGraphLock&, ContextRenderLock& r, size_t framesToProcess)
+    {
+        // Take a newly loaded instrument. The voices play from the one it replaces, which is retired rather than
+        // destroyed here.
+        if (Instrument* loaded = m_pendingInstrument.exchange(nullptr, std::memory_order_acquire)) {
+            while (!m_envelopes.activeVoices().empty())
+                freeVoice(static_cast<unsigned>(m_envelopes.activeVoices().size() - 1));
+
+            std::shared_ptr<void> retired = std::move(m_instrument);
+            m_instrument = std::move(loaded->self);
+            if (retired && r.context())
+                r.context()->retire(r, std::move(retired));
+        }
+
+        AudioBus* outputBus = output(0)->bus();
+        outputBus->zero();
+
+        if (!isInitialized() || !r.context() || framesToProcess > m_voiceBuffer.size())
+            return;
+
+        float* destination = outputBus->channel(0)->mutableData();
+        float gain = m_gain->value(r);
+        bool hasRendered = false;
+
+        // Render up to each event due in this quantum, then apply it.
+        m_events.process(r.context()->currentSampleFrame(), framesToProcess, sampleRate(),
+                         [&](const Event& event, uint64_t frame) { applyEvent(r, event, frame); },
+                         [&](size_t offset, size_t frames) {
+                             if (!m_envelopes.activeVoices().empty()) {
+                                 renderVoices(destination + offset, frames, gain);
+                                 hasRendered = true;
+                             }
+                         });
+
+        m_activeVoiceCount.store(static_cast<unsigned>(m_envelopes.activeVoices().size()), std::memory_order_relaxed);
+
+        if (hasRendered)
+            outputBus->clearSilentFlag();
+    }
+
+    void SampledInstrumentNode::reset(std::shared_ptr<AudioContext>)
+    {
+    }
+
+    bool SampledInstrumentNode::propagatesSilence(double now) const
+    {
+        return m_envelopes.activeVoices().empty() && m_events.empty();
+    }
+
+    void SampledInstrumentNode::applyEvent(ContextRenderLock& r, const Event& event, uint64_t frame)
+    {
+        const std::vector<unsigned>& activeVoices = m_envelopes.activeVoices();
+        switch (event.type) {
+        case NoteOnEvent:
+            if (m_instrument) {
+                const Instrument& instrument = *m_instrument;
+                uint32_t first = instrument.firstKeyZone[event.key];
+                for (uint32_t i = first; i < first + instrument.keyZoneCount[event.key]; ++i) {
+                    const Zone& zone = instrument.zones[instrument.keyZones[i]];
+                    if (event.velocity >= zone.lowVelocity && event.velocity <= zone.highVelocity)
+                        startNote(r, zone, event.key, event.velocity, frame);
+                }
+            }
+            break;
+        case NoteOffEvent:
+            for (size_t i = 0; i < activeVoices.size(); ++i) {
+                if (m_voices[activeVoices[i]].key == event.key)
+                    releaseVoice(r, activeVoices[i]);
+            }
+            break;
+        case AllNotesOffEvent:
+            for (size_t i = 0; i < activeVoices.size(); ++i)
+                releaseVoice(r, activeVoices[i]);
+            break;
+        }
+    }
+
+    void SampledInstrumentNode::startNote(ContextRenderLock& r, const Zone& zone, uint8_t key, uint8_t velocity, uint64_t frame)
+    {
+        unsigned index = m_envelopes.allocateVoice(frame);
+        Voice& voice = m_voices[index];
+        voice.zone = &zone;
+        voice.sampleData = zone.sample->channelData(0);
+        voice.position = 0;
+        voice.rate = pow(2.0, (static_cast<int>(key) - zone.baseNote) / 12.0) * zone.sample->sampleRate() / sampleRate();
+        voice.gain = velocity / 127.0f;
+        voice.key = key;
+
+        float sampleRate = this->sampleRate();
+        uint32_t attackFrames = static_cast<uint32_t>(max(m_attackTime->value(r), 0.0f) * sampleRate);
+        uint32_t decayFrames = static_cast<uint32_t>(max(m_decayTime->value(r), 0.0f) * sampleRate);
+        m_envelopes.startEnvelope(index, attackFrames, m_attackLevel->value(r), decayFrames, m_sustainLevel->value(r));
+    }
+
+    void SampledInstrumentNode::freeVoice(unsigned activeIndex)
+    {
+        unsigned voice = m_envelopes.freeVoice(activeIndex);
+        m_voices[voice].zone = 0;
+        m_voices[voice].sampleData = 0;
+    }
+
+    void SampledInstrumentNode::releaseVoice(ContextRenderLock& r, unsigned index)
+    {
+        uint32_t releaseFrames = static_cast<uint32_t>(max(m_releaseTime->value(r), 0.0f) * sampleRate());
+        m_envelopes.releaseVoice(index, releaseFrames);
+    }
+
+    size_t SampledInstrumentNode::renderSample(Voice& voice, size_t framesToProcess)
+    {
+        // Frames are interpolated between two of the sample's, so the last one read is the next to last.
+        size_t length = voice.zone->sample->length();
+        double lastPosition = static_cast<double>(length - 1);
+        if (voice.position >= lastPosition)
+            return 0;
+
+        size_t frames = min(framesToProcess, static_cast<size_t>(ceil((lastPosition - voice.position) / voice.rate)));
+        while (frames && voice.position + (frames - 1) * voice.rate >= lastPosition)
+            --frames;
+
+        const float* sampleP = voice.sampleData;
+        float* destP = m_voiceBuffer.data();
+        double position = voice.position;
+        double rate = voice.rate;
+
+        for (size_t i = 0; i < frames; ++i) {
+            size_t index = static_cast<size_t>(position);
+            float fraction = static_cast<float>(position - index);
+            destP[i] = sampleP[index] + fraction * (sampleP[index + 1] - sampleP[index]);
+            position += rate;
+        }
+
+        voice.position = position;
+        return frames;
+    }
+
+    void SampledInstrumentNode::renderVoices(float* destination, size_t framesToProcess, float gain)
+    {
+        const float* voiceP = m_voiceBuffer.data();
+        const std::vector<unsigned>& activeVoices = m_envelopes.activeVoices();
+
+        for (size_t i = 0; i < activeVoices.size(); ) {
+            unsigned index = activeVoices[i];
+            Voice& voice = m_voices[index];
+            size_t sampleFrames = renderSample(voice, framesToProcess);
+
+            // A voice ends with its sample, or its release.
+            float scale = voice.gain * gain;
+            bool hasEnded = !m_envelopes.mix(index, voiceP, sampleFrames, &destination, &scale, 1) || sampleFrames < framesToProcess;
+            if (hasEnded)
+                freeVoice(static_cast<unsigned>(i));
+            else
+                ++i;
+        }
+    }
+
+} // namespace LabSound
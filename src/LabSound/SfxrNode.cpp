@@ -618,6 +618,17 @@ namespace LabSound {
 		_hpFilterCutoff = make_shared<AudioParam>("hpFiterCutoff", 0, 0, 1);
 		_hpFilterCutoffSweep = make_shared<AudioParam>("hpFilterCutoffSweep", 0, -1, 1);
 
+        std::shared_ptr<AudioParam> params[] = {
+            _waveType, _attack, _sustainTime, _sustainPunch,
+            _startFrequency, _minFrequency, _decayTime, _slide,
+            _deltaSlide, _vibratoDepth, _vibratoSpeed, _changeAmount,
+            _changeSpeed, _squareDuty, _dutySweep, _repeatSpeed,
+            _phaserOffset, _phaserSweep, _lpFilterCutoff, _lpFilterCutoffSweep,
+            _lpFiterResonance, _hpFilterCutoff, _hpFilterCutoffSweep
+        };
+        for (auto& param : params)
+            addParam(param);
+
         sfxr->ResetParams();
         sfxr->ResetSample(true);
         sfxr->PlaySample();
@@ -661,7 +672,7 @@ namespace LabSound {
         int n = nonSilentFramesToProcess;
 
 #define UPDATE(typ, cur, val) \
-{ typ v = val->value(r.contextPtr()); if (sfxr->cur != v) { needUpdate = true; sfxr->cur = v;} }
+{ typ v = val->value(r); if (sfxr->cur != v) { needUpdate = true; sfxr->cur = v;} }
 
         bool needUpdate = false;
         UPDATE(int, wave_type, _waveType)
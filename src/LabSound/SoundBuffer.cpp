@@ -4,6 +4,7 @@
 #include "SoundBuffer.h"
 #include "AudioContextLock.h"
 #include "AudioDestinationNode.h"
+#include "SampleCache.h"
 #include <stdio.h>
 #include <iostream>
 
@@ -13,24 +14,12 @@ namespace LabSound {
     
     SoundBuffer::SoundBuffer(const char* path, float sampleRate)
     {
-        FILE* f = fopen(path, "rb");
-        if (f) {
-            fseek(f, 0, SEEK_END);
-            int l = ftell(f);
-            fseek(f, 0, SEEK_SET);
-            uint8_t* data = new uint8_t[l];
-            fread(data, 1, l, f);
-            fclose(f);
-            
-            bool mixToMono = true;
-            
-            // create an audio buffer from the file data. The file data will be
-            // parsed, and does not need to be retained.
-            audioBuffer = AudioBuffer::createFromAudioFileData(data, l, mixToMono, sampleRate);
-            delete [] data;
-        }
-        else
-            std::cerr << "File not found " << path << std::endl;
+        bool mixToMono = true;
+
+        // Sounds are decoded once, and shared by every SoundBuffer which loads the same file.
+        audioBuffer = SampleCache::shared().load(path, sampleRate, mixToMono);
+        if (!audioBuffer)
+            std::cerr << "Could not load " << path << std::endl;
     }
     
     SoundBuffer::~SoundBuffer()
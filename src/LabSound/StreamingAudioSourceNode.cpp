@@ -0,0 +1,460 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "LabSound.h"
+#include "StreamingAudioSourceNode.h"
+
+#include "AudioBus.h"
+#include "AudioContext.h"
+#include "AudioContextLock.h"
+#include "AudioFileReader.h"
+#include "AudioNodeOutput.h"
+#include "AudioUtilities.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string.h>
+
+using namespace std;
+using namespace WebCore;
+
+namespace LabSound {
+
+    // Frames decoded at a time. The ring buffer holds at least a few blocks, however short the read-ahead.
+    const size_t DecodeFrames = 4096;
+    const size_t MinimumRingFrames = 4 * DecodeFrames;
+
+    // How long the decoder sleeps when the ring buffer is full or the stream has ended, unless woken by a request.
+    const int DecoderPollMilliseconds = 5;
+
+    const uint64_t NoStreamEnd = numeric_limits<uint64_t>::max();
+
+    static size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    StreamingAudioSourceNode::StreamingAudioSourceNode(float sampleRate, double readAheadTime)
+    : AudioScheduledSourceNode(sampleRate)
+    , m_numberOfChannels(0)
+    , m_duration(0)
+    , m_readAheadTime(readAheadTime)
+    , m_pendingSource(nullptr)
+    , m_underrunFrames(0)
+    , m_requestedGeneration(0)
+    , m_isLooping(false)
+    , m_loopStart(0)
+    , m_loopEnd(0)
+    , m_shouldExit(false)
+    , m_decoderThread(0)
+    , m_generation(0)
+    , m_decodeFrame(0)
+    , m_decodeEnd(0)
+    , m_decodeFinished(true)
+    , m_lastGain(1.0)
+    , m_startRequested(false)
+    , m_requestWhen(0)
+    {
+        setNodeType((AudioNode::NodeType) LabSound::NodeTypeStreamingAudioSource);
+
+        m_request.offset = 0;
+        m_request.end = 0;
+
+        m_gain = make_shared<AudioParam>("gain", 1.0, 0.0, 1.0);
+        addParam(m_gain);
+
+        // Default to mono. A call to setFile() will set the number of output channels to that of the file.
+        addOutput(std::unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 1)));
+
+        initialize();
+    }
+
+    StreamingAudioSourceNode::~StreamingAudioSourceNode()
+    {
+        stopDecoder();
+
+        // Drop any source which was never taken.
+        if (Source* pending = m_pendingSource.exchange(nullptr)) {
+            std::shared_ptr<Source> release = std::move(pending->self);
+        }
+
+        uninitialize();
+    }
+
+    bool StreamingAudioSourceNode::setFile(const char* filePath)
+    {
+        std::shared_ptr<Source> source = make_shared<Source>();
+        source->stream = createAudioFileStream(filePath, sampleRate());
+        if (!source->stream)
+            return false;
+
+        // The render thread plays on from the source it holds while the decoder is replaced.
+        stopDecoder();
+
+        AudioFileStream* stream = source->stream.get();
+        source->numberOfChannels = stream->numberOfChannels();
+
+        size_t readAheadFrames = static_cast<size_t>(m_readAheadTime * stream->sampleRate());
+        size_t ringFrames = roundUpToPowerOfTwo(max(MinimumRingFrames, readAheadFrames));
+        for (unsigned i = 0; i < source->numberOfChannels; ++i)
+            source->ring.emplace_back(new AudioFloatArray(ringFrames));
+        source->ringMask = ringFrames - 1;
+
+        source->writeFrame.store(0);
+        source->discardUntil.store(0);
+        source->streamEnd.store(NoStreamEnd);
+        source->readFrame.store(0);
+
+        m_numberOfChannels = source->numberOfChannels;
+        m_duration = stream->length() / static_cast<double>(stream->sampleRate());
+        m_decodeBus.reset(new AudioBus(m_numberOfChannels, DecodeFrames));
+        m_decoderSource = source;
+        m_underrunFrames.store(0);
+
+        // Ask for the whole file. Nothing decoded so far belongs to it, and the source the render thread is
+        // playing falls silent until it takes this one.
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            m_generation = m_requestedGeneration.load(std::memory_order_relaxed);
+            source->decodedGeneration.store(m_generation);
+            m_request.offset = 0;
+            m_request.end = stream->length();
+            m_requestedGeneration.fetch_add(1, std::memory_order_release);
+        }
+
+        startDecoder();
+
+        // A source the render thread hasn't taken yet is replaced, and so was never seen by the render thread.
+        source->self = source;
+        if (Source* replaced = m_pendingSource.exchange(source.get(), std::memory_order_acq_rel)) {
+            std::shared_ptr<Source> release = std::move(replaced->self);
+        }
+        return true;
+    }
+
+    void StreamingAudioSourceNode::startGrain(double when, double grainOffset)
+    {
+        // Duration of 0 has special value, meaning play to the end of the file.
+        startGrain(when, grainOffset, 0);
+    }
+
+    void StreamingAudioSourceNode::startGrain(double when, double grainOffset, double grainDuration)
+    {
+        if (!m_decoderSource)
+            return;
+
+        requestPosition(grainOffset, grainDuration);
+
+        m_requestWhen = when;
+        m_playbackState = SCHEDULED_STATE;
+        m_startRequested.store(true, std::memory_order_release);
+    }
+
+    void StreamingAudioSourceNode::seek(double time)
+    {
+        if (!m_decoderSource)
+            return;
+
+        requestPosition(time, 0);
+    }
+
+    void StreamingAudioSourceNode::requestPosition(double offset, double duration)
+    {
+        double streamSampleRate = m_decoderSource->stream->sampleRate();
+        uint64_t length = m_decoderSource->stream->length();
+
+        uint64_t offsetFrame = min<uint64_t>(length, AudioUtilities::timeToSampleFrame(max(0.0, offset), streamSampleRate));
+        uint64_t endFrame = length;
+        if (duration > 0)
+            endFrame = min<uint64_t>(length, offsetFrame + AudioUtilities::timeToSampleFrame(duration, streamSampleRate));
+
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+
+        // Before playback first starts, the ring buffer still holds what setFile() asked for; keep it if it is what's wanted.
+        if (m_playbackState == UNSCHEDULED_STATE && m_request.offset == offsetFrame && m_request.end == endFrame)
+            return;
+
+        m_request.offset = offsetFrame;
+        m_request.end = endFrame;
+        m_requestedGeneration.fetch_add(1, std::memory_order_release);
+        m_wake.notify_one();
+    }
+
+    bool StreamingAudioSourceNode::loop() const
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        return m_isLooping;
+    }
+
+    void StreamingAudioSourceNode::setLoop(bool looping)
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_isLooping = looping;
+        m_wake.notify_one();
+    }
+
+    double StreamingAudioSourceNode::loopStart() const
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        return m_loopStart;
+    }
+
+    double StreamingAudioSourceNode::loopEnd() const
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        return m_loopEnd;
+    }
+
+    void StreamingAudioSourceNode::setLoopStart(double loopStart)
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_loopStart = loopStart;
+    }
+
+    void StreamingAudioSourceNode::setLoopEnd(double loopEnd)
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_loopEnd = loopEnd;
+    }
+
+    void StreamingAudioSourceNode::startDecoder()
+    {
+        ASSERT(!m_decoderThread);
+        m_decoderThread = createThread(StreamingAudioSourceNode::decoderEntry, this, "Streaming Audio Decoder");
+    }
+
+    void StreamingAudioSourceNode::stopDecoder()
+    {
+        if (!m_decoderThread)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            m_shouldExit = true;
+            m_wake.notify_all();
+        }
+
+        waitForThreadCompletion(m_decoderThread);
+        m_decoderThread = 0;
+        m_shouldExit = false;
+    }
+
+    void StreamingAudioSourceNode::decoderEntry(void* threadData)
+    {
+        StreamingAudioSourceNode* node = reinterpret_cast<StreamingAudioSourceNode*>(threadData);
+        ASSERT(node);
+        node->decoderLoop();
+    }
+
+    void StreamingAudioSourceNode::decoderLoop()
+    {
+        Source& source = *m_decoderSource;
+        const double streamSampleRate = source.stream->sampleRate();
+        const uint64_t length = source.stream->length();
+
+        for (;;) {
+            unsigned generation;
+            Request request;
+            bool isLooping;
+            double loopStart;
+            double loopEnd;
+            {
+                std::lock_guard<std::mutex> lock(m_requestMutex);
+                if (m_shouldExit)
+                    return;
+
+                generation = m_requestedGeneration.load(std::memory_order_relaxed);
+                request = m_request;
+                isLooping = m_isLooping;
+                loopStart = m_loopStart;
+                loopEnd = m_loopEnd;
+            }
+
+            if (generation != m_generation) {
+                m_generation = generation;
+                m_decodeFrame = request.offset;
+                m_decodeEnd = request.end;
+                m_decodeFinished = !source.stream->seek(m_decodeFrame);
+
+                // Frames decoded for the previous request are skipped by the render thread. The stream end and discard
+                // position are published by the release of the generation.
+                uint64_t writeFrame = source.writeFrame.load(std::memory_order_relaxed);
+                source.streamEnd.store(m_decodeFinished ? writeFrame : NoStreamEnd, std::memory_order_relaxed);
+                source.discardUntil.store(writeFrame, std::memory_order_relaxed);
+                source.decodedGeneration.store(generation, std::memory_order_release);
+            }
+
+            // As AudioBufferSourceNode, loop points of 0 and 0, or which are out of order, loop the whole file.
+            uint64_t loopStartFrame = 0;
+            uint64_t loopEndFrame = length;
+            if ((loopStart || loopEnd) && loopStart >= 0 && loopEnd > 0 && loopStart < loopEnd) {
+                loopStartFrame = min<uint64_t>(length, AudioUtilities::timeToSampleFrame(loopStart, streamSampleRate));
+                loopEndFrame = min<uint64_t>(length, AudioUtilities::timeToSampleFrame(loopEnd, streamSampleRate));
+            }
+
+            if (decode(source, isLooping, loopStartFrame, loopEndFrame))
+                continue;
+
+            std::unique_lock<std::mutex> lock(m_requestMutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(DecoderPollMilliseconds), [this, generation]() {
+                return m_shouldExit || m_requestedGeneration.load(std::memory_order_relaxed) != generation;
+            });
+        }
+    }
+
+    bool StreamingAudioSourceNode::decode(Source& source, bool isLooping, uint64_t loopStartFrame, uint64_t loopEndFrame)
+    {
+        if (m_decodeFinished)
+            return false;
+
+        const size_t ringFrames = source.ringMask + 1;
+        uint64_t writeFrame = source.writeFrame.load(std::memory_order_relaxed);
+        uint64_t readFrame = source.readFrame.load(std::memory_order_acquire);
+        if (ringFrames - (writeFrame - readFrame) < DecodeFrames)
+            return false;
+
+        bool canLoop = isLooping && loopStartFrame < loopEndFrame;
+        uint64_t endFrame = canLoop ? loopEndFrame : m_decodeEnd;
+
+        if (m_decodeFrame >= endFrame && canLoop && source.stream->seek(loopStartFrame))
+            m_decodeFrame = loopStartFrame;
+
+        size_t framesToDecode = m_decodeFrame < endFrame ? static_cast<size_t>(min<uint64_t>(DecodeFrames, endFrame - m_decodeFrame)) : 0;
+        size_t framesDecoded = framesToDecode ? source.stream->read(m_decodeBus.get(), framesToDecode) : 0;
+
+        if (!framesDecoded) {
+            // The file may end before the length it reported; loop from there if we can.
+            if (framesToDecode && canLoop && m_decodeFrame > loopStartFrame) {
+                m_decodeFrame = endFrame;
+                return true;
+            }
+
+            m_decodeFinished = true;
+            source.streamEnd.store(writeFrame, std::memory_order_release);
+            return false;
+        }
+
+        size_t index = static_cast<size_t>(writeFrame & source.ringMask);
+        size_t firstFrames = min(framesDecoded, ringFrames - index);
+        for (unsigned i = 0; i < source.numberOfChannels; ++i) {
+            const float* decoded = m_decodeBus->channel(i)->data();
+            float* ring = source.ring[i]->data();
+            memcpy(ring + index, decoded, sizeof(float) * firstFrames);
+            memcpy(ring, decoded + firstFrames, sizeof(float) * (framesDecoded - firstFrames));
+        }
+
+        m_decodeFrame += framesDecoded;
+        source.writeFrame.store(writeFrame + framesDecoded, std::memory_order_release);
+        return true;
+    }
+
+    void StreamingAudioSourceNode::process(ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess)
+    {
+        // Take a newly set file. The source it replaces is retired rather than destroyed here.
+        if (Source* pending = m_pendingSource.exchange(nullptr, std::memory_order_acquire)) {
+            std::shared_ptr<void> retired = std::move(m_source);
+            m_source = std::move(pending->self);
+            output(0)->setNumberOfChannels(r, m_source->numberOfChannels);
+            if (retired && r.context())
+                r.context()->retire(r, std::move(retired));
+        }
+
+        AudioBus* outputBus = output(0)->bus();
+
+        if (!m_source || !isInitialized() || outputBus->numberOfChannels() != m_source->numberOfChannels) {
+            outputBus->zero();
+            return;
+        }
+
+        // Hand the space of frames discarded by a seek back to the decoder, even before playback starts.
+        if (m_source->decodedGeneration.load(std::memory_order_acquire) == m_requestedGeneration.load(std::memory_order_relaxed)) {
+            uint64_t discardUntil = m_source->discardUntil.load(std::memory_order_relaxed);
+            if (m_source->readFrame.load(std::memory_order_relaxed) < discardUntil)
+                m_source->readFrame.store(discardUntil, std::memory_order_release);
+        }
+
+        if (m_startRequested.exchange(false, std::memory_order_acquire))
+            m_startTime = m_requestWhen;
+
+        size_t quantumFrameOffset;
+        size_t nonSilentFramesToProcess;
+
+        updateSchedulingInfo(r, framesToProcess, outputBus, quantumFrameOffset, nonSilentFramesToProcess);
+
+        if (!nonSilentFramesToProcess) {
+            outputBus->zero();
+            return;
+        }
+
+        render(r, outputBus, quantumFrameOffset, nonSilentFramesToProcess);
+
+        // Apply the gain (in-place) to the output bus.
+        float totalGain = gain()->value(r);
+        outputBus->copyWithGainFrom(*outputBus, &m_lastGain, totalGain);
+        outputBus->clearSilentFlag();
+    }
+
+    void StreamingAudioSourceNode::render(ContextRenderLock& r, AudioBus* bus, size_t destinationFrameOffset, size_t numberOfFrames)
+    {
+        Source& source = *m_source;
+        size_t framesRead = 0;
+        bool hasEnded = false;
+        bool isStarved = false;
+
+        // Until the decoder has caught up with the latest request, nothing in the ring buffer is to be played.
+        unsigned generation = m_requestedGeneration.load(std::memory_order_acquire);
+        if (source.decodedGeneration.load(std::memory_order_acquire) == generation) {
+            uint64_t discardUntil = source.discardUntil.load(std::memory_order_relaxed);
+            uint64_t readFrame = max(source.readFrame.load(std::memory_order_relaxed), discardUntil);
+            uint64_t writeFrame = source.writeFrame.load(std::memory_order_acquire);
+            uint64_t streamEnd = source.streamEnd.load(std::memory_order_acquire);
+            uint64_t availableEnd = min(writeFrame, streamEnd);
+
+            // Silence before the first block of a request is decoded is the latency of a seek, not starvation.
+            isStarved = writeFrame > discardUntil;
+
+            if (availableEnd > readFrame)
+                framesRead = static_cast<size_t>(min<uint64_t>(numberOfFrames, availableEnd - readFrame));
+
+            const size_t ringFrames = source.ringMask + 1;
+            size_t index = static_cast<size_t>(readFrame & source.ringMask);
+            size_t firstFrames = min(framesRead, ringFrames - index);
+            for (unsigned i = 0; i < source.numberOfChannels; ++i) {
+                const float* ring = source.ring[i]->data();
+                float* destination = bus->channel(i)->mutableData() + destinationFrameOffset;
+                memcpy(destination, ring + index, sizeof(float) * firstFrames);
+                memcpy(destination + firstFrames, ring, sizeof(float) * (framesRead - firstFrames));
+            }
+
+            readFrame += framesRead;
+            source.readFrame.store(readFrame, std::memory_order_release);
+            hasEnded = readFrame >= streamEnd;
+        }
+
+        if (framesRead == numberOfFrames)
+            return;
+
+        for (unsigned i = 0; i < source.numberOfChannels; ++i)
+            memset(bus->channel(i)->mutableData() + destinationFrameOffset + framesRead, 0, sizeof(float) * (numberOfFrames - framesRead));
+
+        if (hasEnded)
+            finish(r);
+        else if (isStarved)
+            m_underrunFrames.fetch_add(numberOfFrames - framesRead, std::memory_order_relaxed);
+    }
+
+    void StreamingAudioSourceNode::reset(std::shared_ptr<AudioContext> c)
+    {
+        m_lastGain = gain()->value(c);
+    }
+
+    bool StreamingAudioSourceNode::propagatesSilence(double now) const
+    {
+        return !isPlayingOrScheduled() || hasFinished();
+    }
+
+} // namespace LabSound
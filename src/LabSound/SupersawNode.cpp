@@ -38,8 +38,7 @@ namespace LabSound {
 
         void update(ContextGraphLock& g, ContextRenderLock& r, bool okayToReallocate) {
             int currentN = saws.size();
-            std::shared_ptr<AudioContext> c = r.contextPtr();
-            int n = int(sawCount->value(c) + 0.5f);
+            int n = int(sawCount->value(r) + 0.5f);
             if (okayToReallocate && (n != currentN)) {
                 ExceptionCode ec;
 
@@ -62,16 +61,16 @@ namespace LabSound {
                 cachedDetune = FLT_MAX;
             }
 
-            if (cachedFrequency != frequency->value(c)) {
-                cachedFrequency = frequency->value(c);
+            if (cachedFrequency != frequency->value(r)) {
+                cachedFrequency = frequency->value(r);
                 for (auto i : saws) {
                     i->frequency()->setValue(cachedFrequency);
                     i->frequency()->resetSmoothedValue();
                 }
             }
 
-            if (cachedDetune != detune->value(c)) {
-                cachedDetune = detune->value(c);
+            if (cachedDetune != detune->value(r)) {
+                cachedDetune = detune->value(r);
                 float n = cachedDetune / ((float) saws.size() - 1.0f);
                 for (size_t i = 0; i < saws.size(); ++i) {
                     saws[i]->detune()->setValue(-cachedDetune + float(i) * 2 * n);
@@ -100,6 +99,10 @@ namespace LabSound {
 
         setNodeType((AudioNode::NodeType) LabSound::NodeTypeSupersaw);
 
+        addParam(_data->sawCount);
+        addParam(_data->detune);
+        addParam(_data->frequency);
+
         initialize();
         LabSound::connect(g, r, _data->gainNode.get(), this);
     }
@@ -0,0 +1,355 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "LabSound.h"
+#include "VoicePoolNode.h"
+
+#include "AudioBus.h"
+#include "AudioContext.h"
+#include "AudioContextLock.h"
+#include "AudioNodeOutput.h"
+#include "WaveTable.h"
+#include <algorithm>
+#include <math.h>
+#include <wtf/MathExtras.h>
+
+using namespace std;
+using namespace WebCore;
+
+namespace LabSound {
+
+    static const unsigned NoVoice = ~0u;
+
+    static inline unsigned noteHash(VoicePoolNode::Note note, size_t mask)
+    {
+        return static_cast<unsigned>((note * 2654435761u) & mask);
+    }
+
+    VoicePoolNode::VoicePoolNode(float sampleRate, unsigned maxVoices, unsigned short type, unsigned maxEvents)
+    : AudioNode(sampleRate)
+    , m_type(type)
+    , m_waveTable(WaveTable::sharedWaveTable(type, sampleRate))
+    , m_events(maxEvents)
+    , m_nextNote(1)
+    , m_envelopes(maxVoices)
+    , m_voiceBuffer(AudioNode::ProcessingSizeInFrames)
+    , m_activeVoiceCount(0)
+    {
+        setNodeType((AudioNode::NodeType) LabSound::NodeTypeVoicePool);
+
+        if (!m_waveTable) {
+            m_type = OscillatorNode::SAWTOOTH;
+            m_waveTable = WaveTable::sharedWaveTable(m_type, sampleRate);
+        }
+
+        m_attackTime = std::make_shared<AudioParam>("attackTime", 0.005, 0, 120);
+        m_attackLevel = std::make_shared<AudioParam>("attackLevel", 1.0, 0, 10);
+        m_decayTime = std::make_shared<AudioParam>("decayTime", 0.05, 0, 120);
+        m_sustainLevel = std::make_shared<AudioParam>("sustain", 0.75, 0, 10);
+        m_releaseTime = std::make_shared<AudioParam>("release", 0.0625, 0, 120);
+        addParam(m_attackTime);
+        addParam(m_attackLevel);
+        addParam(m_decayTime);
+        addParam(m_sustainLevel);
+        addParam(m_releaseTime);
+
+        maxVoices = max(maxVoices, 1u);
+        m_noteIds.resize(maxVoices, 0);
+        m_phases.resize(maxVoices, 0);
+        m_phaseIncrements.resize(maxVoices, 0);
+        m_higherWaveData.resize(maxVoices, 0);
+        m_lowerWaveData.resize(maxVoices, 0);
+        m_tableInterpolationFactors.resize(maxVoices, 0);
+        m_frequencies.resize(maxVoices, 0);
+        m_gains.resize(maxVoices, 0);
+        m_pans.resize(maxVoices, 0);
+        m_leftGains.resize(maxVoices, 0);
+        m_rightGains.resize(maxVoices, 0);
+
+        // At most half full, so that probes stay short.
+        size_t noteTableSize = 2;
+        while (noteTableSize < 2 * maxVoices)
+            noteTableSize <<= 1;
+        m_noteTableKeys.resize(noteTableSize, 0);
+        m_noteTableVoices.resize(noteTableSize, NoVoice);
+
+        addOutput(unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 2)));
+
+        initialize();
+    }
+
+    VoicePoolNode::~VoicePoolNode()
+    {
+        uninitialize();
+    }
+
+    void VoicePoolNode::setType(ContextRenderLock& r, unsigned short type, ExceptionCode& ec)
+    {
+        std::shared_ptr<WaveTable> waveTable = WaveTable::sharedWaveTable(type, sampleRate());
+        if (!waveTable) {
+            ec = NOT_SUPPORTED_ERR;
+            return;
+        }
+
+        m_waveTable = waveTable;
+        m_type = type;
+
+        // Choose the sounding voices' tables from the new waveform.
+        const std::vector<unsigned>& activeVoices = m_envelopes.activeVoices();
+        for (size_t i = 0; i < activeVoices.size(); ++i)
+            setVoiceFrequency(activeVoices[i], m_frequencies[activeVoices[i]]);
+    }
+
+    VoicePoolNode::Note VoicePoolNode::noteOn(double when, float frequency, float gain, float pan)
+    {
+        Note note = m_nextNote.fetch_add(1, std::memory_order_relaxed);
+        if (!note)
+            note = m_nextNote.fetch_add(1, std::memory_order_relaxed);
+
+        return pushEvent(NoteOnEvent, note, when, frequency, gain, pan) ? note : 0;
+    }
+
+    void VoicePoolNode::noteOff(Note note, double when)
+    {
+        pushEvent(NoteOffEvent, note, when, 0, 0, 0);
+    }
+
+    void VoicePoolNode::allNotesOff(double when)
+    {
+        pushEvent(AllNotesOffEvent, 0, when, 0, 0, 0);
+    }
+
+    void VoicePoolNode::setFrequency(Note note, float frequency, double when)
+    {
+        pushEvent(FrequencyEvent, note, when, frequency, 0, 0);
+    }
+
+    void VoicePoolNode::setGain(Note note, float gain, double when)
+    {
+        pushEvent(GainEvent, note, when, 0, gain, 0);
+    }
+
+    void VoicePoolNode::setPan(Note note, float pan, double when)
+    {
+        pushEvent(PanEvent, note, when, 0, 0, pan);
+    }
+
+    bool VoicePoolNode::pushEvent(EventType type, Note note, double when, float frequency, float gain, float pan)
+    {
+        Event event;
+        event.when = when;
+        event.note = note;
+        event.type = static_cast<uint8_t>(type);
+        event.frequency = frequency;
+        event.gain = gain;
+        event.pan = pan;
+        return m_events.push(event);
+    }
+
+    void VoicePoolNode::process(ContextGraphLock&, ContextRenderLock& r, size_t framesToProcess)
+    {
+        AudioBus* outputBus = output(0)->bus();
+        outputBus->zero();
+
+        if (!isInitialized() || !r.context() || !m_waveTable || framesToProcess > m_voiceBuffer.size())
+            return;
+
+        float* left = outputBus->channel(0)->mutableData();
+        float* right = outputBus->channel(1)->mutableData();
+        bool hasRendered = false;
+
+        // Render up to each event due in this quantum, then apply it.
+        m_events.process(r.context()->currentSampleFrame(), framesToProcess, sampleRate(),
+                         [&](const Event& event, uint64_t frame) { applyEvent(r, event, frame); },
+                         [&](size_t offset, size_t frames) {
+                             if (!m_envelopes.activeVoices().empty()) {
+                                 renderVoices(left + offset, right + offset, frames);
+                                 hasRendered = true;
+                             }
+                         });
+
+        m_activeVoiceCount.store(static_cast<unsigned>(m_envelopes.activeVoices().size()), std::memory_order_relaxed);
+
+        if (hasRendered)
+            outputBus->clearSilentFlag();
+    }
+
+    void VoicePoolNode::reset(std::shared_ptr<AudioContext>)
+    {
+        std::fill(m_phases.begin(), m_phases.end(), 0);
+    }
+
+    bool VoicePoolNode::propagatesSilence(double now) const
+    {
+        return m_envelopes.activeVoices().empty() && m_events.empty();
+    }
+
+    void VoicePoolNode::applyEvent(ContextRenderLock& r, const Event& event, uint64_t frame)
+    {
+        if (event.type == NoteOnEvent) {
+            unsigned voice = allocateVoice(frame);
+            m_noteIds[voice] = event.note;
+            insertNote(event.note, voice);
+            m_gains[voice] = event.gain;
+            m_pans[voice] = event.pan;
+            setVoiceGains(voice);
+            setVoiceFrequency(voice, event.frequency);
+            startEnvelope(r, voice);
+            return;
+        }
+
+        if (event.type == AllNotesOffEvent) {
+            const std::vector<unsigned>& activeVoices = m_envelopes.activeVoices();
+            for (size_t i = 0; i < activeVoices.size(); ++i)
+                releaseVoice(r, activeVoices[i]);
+            return;
+        }
+
+        // The note may have ended, or had its voice stolen, since the event was made.
+        unsigned voice = findVoice(event.note);
+        if (voice == NoVoice)
+            return;
+
+        switch (event.type) {
+        case NoteOffEvent:
+            releaseVoice(r, voice);
+            break;
+        case FrequencyEvent:
+            setVoiceFrequency(voice, event.frequency);
+            break;
+        case GainEvent:
+            m_gains[voice] = event.gain;
+            setVoiceGains(voice);
+            break;
+        case PanEvent:
+            m_pans[voice] = event.pan;
+            setVoiceGains(voice);
+            break;
+        }
+    }
+
+    unsigned VoicePoolNode::allocateVoice(uint64_t frame)
+    {
+        // A stolen voice's note no longer finds it. Its phase carries on, so that the change doesn't click.
+        unsigned voice = m_envelopes.allocateVoice(frame);
+        eraseNote(m_noteIds[voice]);
+        return voice;
+    }
+
+    void VoicePoolNode::freeVoice(unsigned activeIndex)
+    {
+        unsigned voice = m_envelopes.freeVoice(activeIndex);
+        eraseNote(m_noteIds[voice]);
+        m_noteIds[voice] = 0;
+        m_phases[voice] = 0;
+    }
+
+    void VoicePoolNode::setVoiceFrequency(unsigned voice, float frequency)
+    {
+        float* lowerWaveData;
+        float* higherWaveData;
+        float tableInterpolationFactor;
+        m_waveTable->waveDataForFundamentalFrequency(frequency, lowerWaveData, higherWaveData, tableInterpolationFactor);
+
+        m_frequencies[voice] = frequency;
+        m_higherWaveData[voice] = higherWaveData;
+        m_lowerWaveData[voice] = fabsf(frequency) < m_waveTable->unculledFrequencyLimit() ? 0 : lowerWaveData;
+        m_tableInterpolationFactors[voice] = tableInterpolationFactor;
+        m_phaseIncrements[voice] = m_waveTable->fixedPointPhase(frequency * m_waveTable->rateScale());
+    }
+
+    void VoicePoolNode::setVoiceGains(unsigned voice)
+    {
+        // Equal power, as StereoPannerNode pans a mono source.
+        float x = (min(max(m_pans[voice], -1.0f), 1.0f) + 1) * 0.5f;
+        m_leftGains[voice] = m_gains[voice] * cosf(x * piOverTwoFloat);
+        m_rightGains[voice] = m_gains[voice] * sinf(x * piOverTwoFloat);
+    }
+
+    void VoicePoolNode::startEnvelope(ContextRenderLock& r, unsigned voice)
+    {
+        float sampleRate = this->sampleRate();
+        uint32_t attackFrames = static_cast<uint32_t>(max(m_attackTime->value(r), 0.0f) * sampleRate);
+        uint32_t decayFrames = static_cast<uint32_t>(max(m_decayTime->value(r), 0.0f) * sampleRate);
+        m_envelopes.startEnvelope(voice, attackFrames, m_attackLevel->value(r), decayFrames, m_sustainLevel->value(r));
+    }
+
+    void VoicePoolNode::releaseVoice(ContextRenderLock& r, unsigned voice)
+    {
+        uint32_t releaseFrames = static_cast<uint32_t>(max(m_releaseTime->value(r), 0.0f) * sampleRate());
+        m_envelopes.releaseVoice(voice, releaseFrames);
+    }
+
+    void VoicePoolNode::renderVoices(float* left, float* right, size_t framesToProcess)
+    {
+        float* voiceP = m_voiceBuffer.data();
+        float* destinations[2] = { left, right };
+        const std::vector<unsigned>& activeVoices = m_envelopes.activeVoices();
+
+        for (size_t i = 0; i < activeVoices.size(); ) {
+            unsigned voice = activeVoices[i];
+            m_waveTable->renderWaveData(m_higherWaveData[voice], m_lowerWaveData[voice], m_tableInterpolationFactors[voice],
+                                        m_phases[voice], m_phaseIncrements[voice], voiceP, framesToProcess);
+
+            float gains[2] = { m_leftGains[voice], m_rightGains[voice] };
+            if (m_envelopes.mix(voice, voiceP, framesToProcess, destinations, gains, 2))
+                ++i;
+            else
+                freeVoice(static_cast<unsigned>(i));
+        }
+    }
+
+    unsigned VoicePoolNode::findVoice(Note note) const
+    {
+        if (!note)
+            return NoVoice;
+
+        size_t mask = m_noteTableKeys.size() - 1;
+        for (size_t i = noteHash(note, mask); m_noteTableKeys[i]; i = (i + 1) & mask) {
+            if (m_noteTableKeys[i] == note)
+                return m_noteTableVoices[i];
+        }
+        return NoVoice;
+    }
+
+    void VoicePoolNode::insertNote(Note note, unsigned voice)
+    {
+        size_t mask = m_noteTableKeys.size() - 1;
+        size_t i = noteHash(note, mask);
+        while (m_noteTableKeys[i])
+            i = (i + 1) & mask;
+
+        m_noteTableKeys[i] = note;
+        m_noteTableVoices[i] = voice;
+    }
+
+    void VoicePoolNode::eraseNote(Note note)
+    {
+        if (!note)
+            return;
+
+        size_t mask = m_noteTableKeys.size() - 1;
+        size_t i = noteHash(note, mask);
+        while (m_noteTableKeys[i] != note) {
+            if (!m_noteTableKeys[i])
+                return;
+            i = (i + 1) & mask;
+        }
+
+        // Move back any later entry of the run which the hole would hide from its probe.
+        for (size_t j = (i + 1) & mask; m_noteTableKeys[j]; j = (j + 1) & mask) {
+            size_t home = noteHash(m_noteTableKeys[j], mask);
+            bool isBetween = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+            if (!isBetween) {
+                m_noteTableKeys[i] = m_noteTableKeys[j];
+                m_noteTableVoices[i] = m_noteTableVoices[j];
+                i = j;
+            }
+        }
+
+        m_noteTableKeys[i] = 0;
+        m_noteTableVoices[i] = NoVoice;
+    }
+
+} // namespace LabSound
@@ -0,0 +1,153 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "VoiceScheduler.h"
+
+#include "VectorMath.h"
+
+using namespace std;
+using namespace WebCore::VectorMath;
+
+namespace LabSound {
+
+    static const unsigned NoVoice = ~0u;
+
+    VoiceEnvelopes::VoiceEnvelopes(unsigned maxVoices)
+    : m_stolenVoiceCount(0)
+    {
+        maxVoices = max(maxVoices, 1u);
+        m_levels.resize(maxVoices, 0);
+        m_levelSteps.resize(maxVoices, 0);
+        m_stageFrames.resize(maxVoices, 0);
+        m_stages.resize(maxVoices, Release);
+        m_peakLevels.resize(maxVoices, 0);
+        m_decayFrames.resize(maxVoices, 0);
+        m_sustainLevels.resize(maxVoices, 0);
+        m_startFrames.resize(maxVoices, 0);
+
+        m_activeVoices.reserve(maxVoices);
+        m_freeVoices.reserve(maxVoices);
+        for (unsigned i = maxVoices; i > 0; --i)
+            m_freeVoices.push_back(i - 1);
+    }
+
+    unsigned VoiceEnvelopes::allocateVoice(uint64_t startFrame)
+    {
+        if (!m_freeVoices.empty()) {
+            unsigned voice = m_freeVoices.back();
+            m_freeVoices.pop_back();
+            m_activeVoices.push_back(voice);
+            m_levels[voice] = 0;
+            m_startFrames[voice] = startFrame;
+            return voice;
+        }
+
+        unsigned quietest = NoVoice;
+        unsigned oldest = NoVoice;
+        for (size_t i = 0; i < m_activeVoices.size(); ++i) {
+            unsigned voice = m_activeVoices[i];
+            if (m_stages[voice] == Release && (quietest == NoVoice || m_levels[voice] < m_levels[quietest]))
+                quietest = voice;
+            if (oldest == NoVoice || m_startFrames[voice] < m_startFrames[oldest])
+                oldest = voice;
+        }
+
+        unsigned voice = quietest != NoVoice ? quietest : oldest;
+        m_startFrames[voice] = startFrame;
+        m_stolenVoiceCount.fetch_add(1, std::memory_order_relaxed);
+        return voice;
+    }
+
+    unsigned VoiceEnvelopes::freeVoice(unsigned activeIndex)
+    {
+        unsigned voice = m_activeVoices[activeIndex];
+        m_levels[voice] = 0;
+        m_stages[voice] = Release;
+
+        m_activeVoices[activeIndex] = m_activeVoices.back();
+        m_activeVoices.pop_back();
+        m_freeVoices.push_back(voice);
+        return voice;
+    }
+
+    void VoiceEnvelopes::startEnvelope(unsigned voice, uint32_t attackFrames, float peakLevel, uint32_t decayFrames, float sustainLevel)
+    {
+        m_peakLevels[voice] = peakLevel;
+        m_decayFrames[voice] = decayFrames;
+        m_sustainLevels[voice] = sustainLevel;
+
+        m_stages[voice] = Attack;
+        m_stageFrames[voice] = attackFrames;
+        if (attackFrames)
+            m_levelSteps[voice] = (peakLevel - m_levels[voice]) / attackFrames;
+        else
+            advanceStage(voice);
+    }
+
+    void VoiceEnvelopes::releaseVoice(unsigned voice, uint32_t releaseFrames)
+    {
+        if (m_stages[voice] == Release)
+            return;
+
+        m_stages[voice] = Release;
+        m_stageFrames[voice] = releaseFrames;
+        m_levelSteps[voice] = releaseFrames ? -m_levels[voice] / releaseFrames : 0;
+    }
+
+    bool VoiceEnvelopes::advanceStage(unsigned voice)
+    {
+        switch (m_stages[voice]) {
+        case Attack:
+            m_levels[voice] = m_peakLevels[voice];
+            m_stages[voice] = Decay;
+            m_stageFrames[voice] = m_decayFrames[voice];
+            if (m_decayFrames[voice]) {
+                m_levelSteps[voice] = (m_sustainLevels[voice] - m_peakLevels[voice]) / m_decayFrames[voice];
+                return true;
+            }
+            // There's no decay, so go straight on to the sustain.
+            return advanceStage(voice);
+        case Decay:
+            m_levels[voice] = m_sustainLevels[voice];
+            m_levelSteps[voice] = 0;
+            m_stages[voice] = Sustain;
+            return true;
+        case Sustain:
+            return true;
+        default:
+            m_levels[voice] = 0;
+            return false;
+        }
+    }
+
+    bool VoiceEnvelopes::mix(unsigned voice, const float* source, size_t frames, float* const* destinations, const float* gains, unsigned numberOfDestinations)
+    {
+        // Each stage of the envelope is a ramp, scaled by the destination's gain as it is added.
+        size_t framesProcessed = 0;
+        while (framesProcessed < frames) {
+            bool isSustaining = m_stages[voice] == Sustain;
+            size_t stageFrames = frames - framesProcessed;
+            if (!isSustaining)
+                stageFrames = min<size_t>(stageFrames, m_stageFrames[voice]);
+
+            if (stageFrames) {
+                for (unsigned i = 0; i < numberOfDestinations; ++i) {
+                    float level = m_levels[voice] * gains[i];
+                    float step = m_levelSteps[voice] * gains[i];
+                    vrampmuladd(source + framesProcessed, 1, &level, &step, destinations[i] + framesProcessed, 1, stageFrames);
+                }
+
+                m_levels[voice] += m_levelSteps[voice] * stageFrames;
+                framesProcessed += stageFrames;
+                if (!isSustaining)
+                    m_stageFrames[voice] -= static_cast<uint32_t>(stageFrames);
+            }
+
+            if (!isSustaining && !m_stageFrames[voice] && !advanceStage(voice))
+                return false;
+        }
+        return true;
+    }
+
+} // namespace LabSound
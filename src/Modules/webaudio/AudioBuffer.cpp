@@ -37,7 +37,7 @@ namespace WebCore {
 
 std::shared_ptr<AudioBuffer> AudioBuffer::create(unsigned numberOfChannels, size_t numberOfFrames, float sampleRate)
 {
-    if (sampleRate < 22050 || sampleRate > 96000 || numberOfChannels > AudioContext::maxNumberOfChannels() || !numberOfFrames)
+    if (sampleRate < 8000 || sampleRate > 192000 || numberOfChannels > AudioContext::maxNumberOfChannels() || !numberOfFrames)
         return 0;
     
     return std::make_shared<AudioBuffer>(numberOfChannels, numberOfFrames, sampleRate);
@@ -85,9 +85,21 @@ AudioBuffer::AudioBuffer(AudioBus* bus)
     }
 }
 
+AudioBuffer::AudioBuffer(std::shared_ptr<const void> storage, const std::vector<const float*>& channels, size_t numberOfFrames, float sampleRate)
+    : m_gain(1.0)
+    , m_sampleRate(sampleRate)
+    , m_length(numberOfFrames)
+    , m_storage(storage)
+    , m_storageChannels(channels)
+{
+    ASSERT(m_storage);
+}
+
 void AudioBuffer::releaseMemory()
 {
     m_channels.clear();
+    m_storageChannels.clear();
+    m_storage.reset();
 }
 
 std::shared_ptr<std::vector<float>> AudioBuffer::getChannelData(unsigned channelIndex, ExceptionCode& ec)
@@ -108,6 +120,22 @@ std::shared_ptr<std::vector<float>> AudioBuffer::getChannelData(unsigned channel
     return m_channels[channelIndex];
 }
 
+const float* AudioBuffer::channelData(unsigned channelIndex) const
+{
+    if (m_storage)
+        return channelIndex < m_storageChannels.size() ? m_storageChannels[channelIndex] : 0;
+
+    return channelIndex < m_channels.size() ? m_channels[channelIndex]->data() : 0;
+}
+
+float* AudioBuffer::mutableChannelData(unsigned channelIndex)
+{
+    if (m_storage || channelIndex >= m_channels.size())
+        return 0;
+
+    return m_channels[channelIndex]->data();
+}
+
 void AudioBuffer::zero()
 {
     for (unsigned i = 0; i < m_channels.size(); ++i) {
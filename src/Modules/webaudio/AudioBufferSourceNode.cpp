@@ -65,6 +65,8 @@ AudioBufferSourceNode::AudioBufferSourceNode(float sampleRate)
 
     m_gain = make_shared<AudioParam>("gain", 1.0, 0.0, 1.0);
     m_playbackRate = make_shared<AudioParam>("playbackRate", 1.0, 0.0, MaxRate);
+    addParam(m_gain);
+    addParam(m_playbackRate);
 
     // Default to mono.  A call to setBuffer() will set the number of output channels to that of the buffer.
     addOutput(std::unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 1)));
@@ -146,7 +148,7 @@ void AudioBufferSourceNode::process(ContextGraphLock& g, ContextRenderLock& r, s
     }
 
     // Apply the gain (in-place) to the output bus.
-    float totalGain = gain()->value(r.contextPtr()) * m_buffer->gain();
+    float totalGain = gain()->value(r) * m_buffer->gain();
     outputBus->copyWithGainFrom(*outputBus, &m_lastGain, totalGain);
     outputBus->clearSilentFlag();
 }
@@ -363,7 +365,7 @@ bool AudioBufferSourceNode::setBuffer(ContextGraphLock& g, ContextRenderLock& r,
         m_destinationChannels = std::unique_ptr<float*[]>(new float*[numberOfChannels]);
 
         for (unsigned i = 0; i < numberOfChannels; ++i) 
-            m_sourceChannels[i] = buffer->getChannelData(i)->data();
+            m_sourceChannels[i] = buffer->channelData(i);
     }
 
     m_virtualReadIndex = 0;
@@ -407,7 +409,7 @@ double AudioBufferSourceNode::totalPitchRate(ContextRenderLock& r)
     if (buffer())
         sampleRateFactor = buffer()->sampleRate() / sampleRate();
     
-    double basePitchRate = playbackRate()->value(r.contextPtr());
+    double basePitchRate = playbackRate()->value(r);
 
     double totalRate = dopplerRate * sampleRateFactor * basePitchRate;
 
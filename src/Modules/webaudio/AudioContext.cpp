@@ -35,6 +35,9 @@
 #include "AudioListener.h"
 #include "AudioNodeInput.h"
 #include "AudioNodeOutput.h"
+#include "AudioReclaimer.h"
+#include "AudioRenderPlan.h"
+#include "AudioRenderThreadPool.h"
 #include "BiquadFilterNode.h"
 #include "ChannelMergerNode.h"
 #include "ChannelSplitterNode.h"
@@ -63,6 +66,8 @@
 #include <wtf/Atomics.h>
 #include <wtf/MainThread.h>
 
+#include <thread>
+
 using namespace std;
 
 namespace WebCore {
@@ -71,9 +76,8 @@ namespace {
     
 bool isSampleRateRangeGood(float sampleRate)
 {
-    // FIXME: It would be nice if the minimum sample-rate could be less than 44.1KHz,
-    // but that will require some fixes in HRTFPanner::fftSizeForSampleRate(), and some testing there.
-    return sampleRate >= 44100 && sampleRate <= 96000;
+    // The range HRTFPanner::fftSizeForSampleRate() covers.
+    return sampleRate >= 8000 && sampleRate <= 192000;
 }
 
 }
@@ -92,10 +96,8 @@ std::unique_ptr<AudioContext> AudioContext::create(ExceptionCode&)
 
 std::unique_ptr<AudioContext> AudioContext::createOfflineContext(unsigned numberOfChannels, size_t numberOfFrames, float sampleRate, ExceptionCode& ec)
 {
-    // FIXME: offline contexts have limitations on supported sample-rates.
-    // Currently all AudioContexts must have the same sample-rate.
-    auto loader = HRTFDatabaseLoader::loader();
-    if (numberOfChannels > 10 || !isSampleRateRangeGood(sampleRate) || (loader && loader->databaseSampleRate() != sampleRate)) {
+    // Contexts at different sample-rates each share the HRTF database loaded for their own rate.
+    if (numberOfChannels > 10 || !isSampleRateRangeGood(sampleRate)) {
         ec = SYNTAX_ERR;
         return 0;
     }
@@ -109,8 +111,12 @@ AudioContext::AudioContext()
     , m_isInitialized(false)
     , m_isAudioThreadFinished(false)
     , m_destinationNode(0)
-    , m_isDeletionScheduled(false)
+    , m_finishedNodes(0)
     , m_automaticPullNodesNeedUpdating(false)
+    , m_renderPlanEnabled(true)
+    , m_renderPlanMaxNodes(1024)
+    , m_renderPlanMaxConnections(4096)
+    , m_unscheduledParamCount(0)
     , m_connectionCount(0)
     , m_isOfflineContext(false)
     , m_activeSourceCount(0)
@@ -124,14 +130,18 @@ AudioContext::AudioContext(unsigned numberOfChannels, size_t numberOfFrames, flo
     , m_isInitialized(false)
     , m_isAudioThreadFinished(false)
     , m_destinationNode(0)
+    , m_finishedNodes(0)
     , m_automaticPullNodesNeedUpdating(false)
+    , m_renderPlanEnabled(true)
+    , m_renderPlanMaxNodes(1024)
+    , m_renderPlanMaxConnections(4096)
+    , m_unscheduledParamCount(0)
     , m_connectionCount(0)
     , m_isOfflineContext(true)
     , m_activeSourceCount(0)
 {
     constructCommon();
 
-    // FIXME: the passed in sampleRate MUST match the hardware sample-rate since HRTFDatabaseLoader is a singleton.
     m_hrtfDatabaseLoader = HRTFDatabaseLoader::createAndLoadAsynchronouslyIfNecessary(sampleRate);
 
     // Create a new destination for offline rendering.
@@ -153,6 +163,9 @@ void AudioContext::constructCommon()
     FFTFrame::initialize();
     
     m_listener = std::make_shared<AudioListener>();
+    m_renderPlan = std::unique_ptr<AudioRenderPlan>(new AudioRenderPlan());
+    m_renderPlan->reserve(m_renderPlanMaxNodes, m_renderPlanMaxConnections, 1);
+    m_reclaimer = std::unique_ptr<AudioReclaimer>(new AudioReclaimer());
 }
 
 AudioContext::~AudioContext()
@@ -163,9 +176,8 @@ AudioContext::~AudioContext()
     
     ASSERT(!m_isInitialized);
     ASSERT(m_isStopScheduled);
-    ASSERT(!m_nodesToDelete.size());
     ASSERT(!m_referencedNodes.size());
-    ASSERT(!m_finishedNodes.size());
+    ASSERT(!m_finishedNodes.load());
     ASSERT(!m_automaticPullNodes.size());
     ASSERT(!m_renderingAutomaticPullNodes.size());
 }
@@ -196,12 +208,8 @@ void AudioContext::lazyInitialize()
 
 void AudioContext::clear()
 {
-    // Audio thread is dead. Nobody will schedule node deletion action. Let's do it ourselves.
-    do {
-        deleteMarkedNodes();
-        m_nodesToDelete.insert(m_nodesToDelete.end(), m_nodesMarkedForDeletion.begin(), m_nodesMarkedForDeletion.end());
-        m_nodesMarkedForDeletion.clear();
-    } while (m_nodesToDelete.size());
+    // Audio thread is dead. Nothing retired is referenced by the rendering state any more, so release it all now.
+    deleteMarkedNodes();
 }
 
 void AudioContext::uninitialize(ContextGraphLock& g, ContextRenderLock& r)
@@ -297,69 +305,117 @@ void AudioContext::notifyNodeFinishedProcessing(ContextRenderLock& r, AudioNode*
 {
     ASSERT(r.context());
 
-    for (auto i : m_referencedNodes) {
-        if (i.get() == node) {
-            m_finishedNodes.push_back(i);
-            return;
-        }
-    }
-    ASSERT(0 == "node to finish not referenced");
+    // A node the context doesn't hold isn't the context's to release, and might not outlive the quantum.
+    // A held node stays alive until derefFinishedSourceNodes(), which finds it by the indices it carries.
+    if (node->m_referencedNodeIndex == AudioNode::NotHeldByContext && node->m_automaticSourceIndex == AudioNode::NotHeldByContext)
+        return;
+
+    pushFinishedNode(node);
+}
+
+void AudioContext::pushFinishedNode(AudioNode* node)
+{
+    AudioNode* head = m_finishedNodes.load(std::memory_order_relaxed);
+    do {
+        node->m_nextFinishedNode = head;
+    } while (!m_finishedNodes.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
 }
 
 void AudioContext::derefFinishedSourceNodes(ContextGraphLock& g, ContextRenderLock& r)
 {
     ASSERT(g.context() && r.context());
-    for (unsigned i = 0; i < m_finishedNodes.size(); i++)
-        derefNode(g, r, m_finishedNodes[i]);
 
-    m_finishedNodes.clear();
+    AudioNode* node = m_finishedNodes.exchange(0, std::memory_order_acquire);
+    while (node) {
+        AudioNode* next = node->m_nextFinishedNode;
+        node->m_nextFinishedNode = 0;
+
+        if (node->m_referencedNodeIndex != AudioNode::NotHeldByContext)
+            derefNode(g, r, node);
+        if (node->m_automaticSourceIndex != AudioNode::NotHeldByContext)
+            releaseAutomaticSource(g, r, node);
+
+        node = next;
+    }
 }
 
 void AudioContext::refNode(ContextGraphLock& g, std::shared_ptr<AudioNode> node)
 {
     ASSERT(g.context());
+    ASSERT(node->m_referencedNodeIndex == AudioNode::NotHeldByContext);
     node->ref(g.contextPtr(), AudioNode::RefTypeConnection);
+    node->m_referencedNodeIndex = static_cast<unsigned>(m_referencedNodes.size());
     m_referencedNodes.push_back(node);
 }
 
-void AudioContext::derefNode(ContextGraphLock& g, ContextRenderLock& r, std::shared_ptr<AudioNode> node)
+void AudioContext::derefNode(ContextGraphLock& g, ContextRenderLock& r, AudioNode* node)
 {
     ASSERT(g.context());
-    
+    ASSERT(node->m_referencedNodeIndex < m_referencedNodes.size());
+
     node->deref(g, r, AudioNode::RefTypeConnection);
 
-    for (std::vector<std::shared_ptr<AudioNode>>::iterator i = m_referencedNodes.begin(); i != m_referencedNodes.end(); ++i) {
-        if (node == *i) {
-            m_referencedNodes.erase(i);
-            break;
-        }
+    // Swap the last reference into the hole, and retire ours rather than possibly destroying the node here.
+    unsigned index = node->m_referencedNodeIndex;
+    std::shared_ptr<AudioNode> retired = std::move(m_referencedNodes[index]);
+    if (index + 1 < m_referencedNodes.size()) {
+        m_referencedNodes[index] = std::move(m_referencedNodes.back());
+        m_referencedNodes[index]->m_referencedNodeIndex = index;
     }
+    m_referencedNodes.pop_back();
+
+    node->m_referencedNodeIndex = AudioNode::NotHeldByContext;
+    m_reclaimer->retire(std::move(retired));
 }
 
 void AudioContext::derefUnfinishedSourceNodes(ContextGraphLock& g, ContextRenderLock& r)
 {
     ASSERT(g.context());
-    for (unsigned i = 0; i < m_referencedNodes.size(); ++i)
+    for (unsigned i = 0; i < m_referencedNodes.size(); ++i) {
         m_referencedNodes[i]->deref(g, r, AudioNode::RefTypeConnection);
+        m_referencedNodes[i]->m_referencedNodeIndex = AudioNode::NotHeldByContext;
+    }
 
     m_referencedNodes.clear();
 }
 
-    
-void AudioContext::holdSourceNodeUntilFinished(std::shared_ptr<AudioScheduledSourceNode> sn) {
-    lock_guard<mutex> lock(automaticSourcesMutex);
-    automaticSources.push_back(sn);
+void AudioContext::holdSourceNodeUntilFinished(std::shared_ptr<AudioScheduledSourceNode> sn)
+{
+    if (!sn)
+        return;
+
+    // The list belongs to the audio thread, which adds the source before the next render quantum.
+    enqueueGraphCommand([this, sn](ContextGraphLock& g, ContextRenderLock& r) {
+        if (sn->m_automaticSourceIndex != AudioNode::NotHeldByContext)
+            return;
+
+        sn->m_automaticSourceIndex = static_cast<unsigned>(m_automaticSources.size());
+        m_automaticSources.push_back(sn);
+
+        // If it finished before it could be held, nothing will notify the context again.
+        if (sn->hasFinished())
+            releaseAutomaticSource(g, r, sn.get());
+    });
 }
-    
-void AudioContext::handleAutomaticSources() {
-    lock_guard<mutex> lock(automaticSourcesMutex);
-    for (auto i = automaticSources.begin(); i != automaticSources.end(); ++i) {
-        if ((*i)->hasFinished()) {
-            i = automaticSources.erase(i);
-            if (i == automaticSources.end())
-                break;
-        }
+
+void AudioContext::releaseAutomaticSource(ContextGraphLock& g, ContextRenderLock& r, AudioNode* node)
+{
+    ASSERT(node->m_automaticSourceIndex < m_automaticSources.size());
+
+    // A finished source only renders silence. Disconnect it so that nothing pulls it once it is released.
+    for (unsigned i = 0; i < node->numberOfOutputs(); ++i)
+        AudioNodeOutput::disconnectAll(g, r, node->output(i));
+
+    unsigned index = node->m_automaticSourceIndex;
+    std::shared_ptr<AudioScheduledSourceNode> retired = std::move(m_automaticSources[index]);
+    if (index + 1 < m_automaticSources.size()) {
+        m_automaticSources[index] = std::move(m_automaticSources.back());
+        m_automaticSources[index]->m_automaticSourceIndex = index;
     }
+    m_automaticSources.pop_back();
+
+    node->m_automaticSourceIndex = AudioNode::NotHeldByContext;
+    m_reclaimer->retire(std::move(retired));
 }
 
 void AudioContext::addDeferredFinishDeref(ContextGraphLock& g, AudioNode* node)
@@ -372,6 +428,9 @@ void AudioContext::handlePreRenderTasks(ContextGraphLock& g, ContextRenderLock&
 {
     ASSERT(r.context());
  
+    // Apply graph edits queued by other threads first, so that they take effect in this quantum.
+    handlePendingGraphCommands(g, r);
+
     // At the beginning of every render quantum, try to update the internal rendering graph state (from main thread changes).
     handleDirtyAudioSummingJunctions(g, r);
     updateAutomaticPullNodes(r);
@@ -384,18 +443,16 @@ void AudioContext::handlePostRenderTasks(ContextGraphLock& g, ContextRenderLock&
     // Take care of finishing any derefs where the tryLock() failed previously.
     handleDeferredFinishDerefs(g, r);
 
-    // Dynamically clean up nodes which are no longer needed.
+    // Dynamically clean up nodes which are no longer needed. Their last references go to the reclaimer.
     derefFinishedSourceNodes(g, r);
 
-    // Don't delete in the real-time thread. Let the main thread do it because the clean up may take time
-    scheduleNodeDeletion(g);
-
     // Fixup the state of any dirty AudioSummingJunctions and AudioNodeOutputs.
     handleDirtyAudioSummingJunctions(g, r);
 
     updateAutomaticPullNodes(r);
-    
-    handleAutomaticSources();
+
+    // The rendering state no longer refers to anything retired before this point.
+    m_reclaimer->advanceEpoch();
 }
 
 void AudioContext::handleDeferredFinishDerefs(ContextGraphLock& g, ContextRenderLock& r)
@@ -409,72 +466,111 @@ void AudioContext::handleDeferredFinishDerefs(ContextGraphLock& g, ContextRender
     m_deferredFinishDerefList.clear();
 }
 
-void AudioContext::markForDeletion(ContextRenderLock& r, AudioNode* node)
+void AudioContext::deleteMarkedNodes()
+{
+    m_reclaimer->reclaimAll();
+}
+
+void AudioContext::retire(ContextRenderLock& r, std::shared_ptr<void> object)
 {
     ASSERT(r.context());
-    for (auto i : m_referencedNodes) {
-        if (i.get() == node) {
-            m_nodesMarkedForDeletion.push_back(i);
-            return;
-        }
+    m_reclaimer->retire(std::move(object));
+}
+
+void AudioContext::markSummingJunctionDirty(std::shared_ptr<AudioSummingJunction> summingJunction)
+{
+    if (summingJunction)
+        m_dirtySummingJunctions.push(summingJunction);
+}
+
+void AudioContext::handleDirtyAudioSummingJunctions(ContextGraphLock& g, ContextRenderLock& r)
+{
+    ASSERT(r.context());
+
+    std::shared_ptr<AudioSummingJunction> asj;
+    while (m_dirtySummingJunctions.try_pop(asj)) {
+        asj->updateRenderingState(g, r);
+
+        // The rendering connections changed, so the render plan's node order may be stale.
+        m_renderPlan->invalidate();
     }
-    
-    ASSERT(0 == "Attempting to delete unreferenced node");
 }
 
-void AudioContext::scheduleNodeDeletion(ContextGraphLock& g)
+void AudioContext::enqueueGraphCommand(GraphCommand command)
 {
-    // &&& all this deletion stuff should be handled by a concurrent queue - simply have only a m_nodesToDelete concurrent queue and ditch the marked vector
-    
-    bool isGood = m_isInitialized && g.context();
-    ASSERT(isGood);
-    if (!isGood)
-        return;
+    // The queue is bounded so that the audio thread never allocates. If the audio thread has fallen behind
+    // by a whole queue's worth of edits, wait for it to catch up rather than drop an edit.
+    std::shared_ptr<GraphCommand> pending = std::make_shared<GraphCommand>(std::move(command));
+    while (!m_pendingGraphCommands.push(pending))
+        std::this_thread::yield();
+}
 
-    // Make sure to call deleteMarkedNodes() on main thread.    
-    if (m_nodesMarkedForDeletion.size() && !m_isDeletionScheduled) {
-        m_nodesToDelete.insert(m_nodesToDelete.end(), m_nodesMarkedForDeletion.begin(), m_nodesMarkedForDeletion.end());
-        m_nodesMarkedForDeletion.clear();
+void AudioContext::handlePendingGraphCommands(ContextGraphLock& g, ContextRenderLock& r)
+{
+    ASSERT(g.context() && r.context());
 
-        m_isDeletionScheduled = true;
+    std::shared_ptr<GraphCommand> command;
+    while (m_pendingGraphCommands.try_pop(command)) {
+        (*command)(g, r);
 
-        // Don't let ourself get deleted before the callback.
-        // See matching deref() in deleteMarkedNodesDispatch().
-        callOnMainThread(deleteMarkedNodesDispatch, this);
+        // The command may hold the last references to the nodes it captured.
+        m_reclaimer->retire(std::move(command));
     }
 }
 
-void AudioContext::deleteMarkedNodesDispatch(void* userData)
+void AudioContext::connect(std::shared_ptr<AudioNode> source, std::shared_ptr<AudioNode> destination, unsigned outputIndex, unsigned inputIndex)
 {
-    AudioContext* context = reinterpret_cast<AudioContext*>(userData);
-    ASSERT(context);
-    if (!context)
+    if (!source || !destination)
         return;
 
-    context->deleteMarkedNodes();
+    enqueueGraphCommand([source, destination, outputIndex, inputIndex](ContextGraphLock& g, ContextRenderLock& r) {
+        ExceptionCode ec = NO_ERR;
+        source->connect(g, r, destination.get(), outputIndex, inputIndex, ec);
+    });
 }
 
-void AudioContext::deleteMarkedNodes()
+void AudioContext::disconnect(std::shared_ptr<AudioNode> source, unsigned outputIndex)
 {
-    m_nodesToDelete.clear();
-    m_isDeletionScheduled = false;
+    if (!source)
+        return;
+
+    enqueueGraphCommand([source, outputIndex](ContextGraphLock& g, ContextRenderLock& r) {
+        ExceptionCode ec = NO_ERR;
+        source->disconnect(g, r, outputIndex, ec);
+    });
 }
 
-void AudioContext::markSummingJunctionDirty(std::shared_ptr<AudioSummingJunction> summingJunction)
+void AudioContext::connectParam(std::shared_ptr<AudioParam> param, std::shared_ptr<AudioNode> driver, unsigned outputIndex)
 {
-    if (summingJunction)
-        m_dirtySummingJunctions.push(summingJunction);
+    if (!param || !driver)
+        return;
+
+    enqueueGraphCommand([param, driver, outputIndex](ContextGraphLock& g, ContextRenderLock&) {
+        ExceptionCode ec = NO_ERR;
+        driver->connect(g, param, outputIndex, ec);
+    });
 }
 
-void AudioContext::handleDirtyAudioSummingJunctions(ContextGraphLock& g, ContextRenderLock& r)
+void AudioContext::disconnectParam(std::shared_ptr<AudioParam> param, std::shared_ptr<AudioNode> driver, unsigned outputIndex)
 {
-    ASSERT(r.context());
+    if (!param || !driver)
+        return;
 
-    std::shared_ptr<AudioSummingJunction> asj;
-    while (m_dirtySummingJunctions.try_pop(asj))
-        asj->updateRenderingState(g, r);
+    enqueueGraphCommand([param, driver, outputIndex](ContextGraphLock& g, ContextRenderLock&) {
+        if (outputIndex < driver->numberOfOutputs())
+            AudioParam::disconnect(g, param, driver->output(outputIndex));
+    });
 }
 
+void AudioContext::setSourceBuffer(std::shared_ptr<AudioBufferSourceNode> source, std::shared_ptr<AudioBuffer> buffer)
+{
+    if (!source)
+        return;
+
+    enqueueGraphCommand([source, buffer](ContextGraphLock& g, ContextRenderLock& r) {
+        source->setBuffer(g, r, buffer);
+    });
+}
 
 void AudioContext::addAutomaticPullNode(ContextRenderLock& r, std::shared_ptr<AudioNode> node)
 {
@@ -511,6 +607,7 @@ void AudioContext::updateAutomaticPullNodes(ContextRenderLock& r)
         }
 
         m_automaticPullNodesNeedUpdating = false;
+        m_renderPlan->invalidate();
     }
 }
 
@@ -522,6 +619,65 @@ void AudioContext::processAutomaticPullNodes(ContextGraphLock& g, ContextRenderL
         m_renderingAutomaticPullNodes[i]->processIfNecessary(g, r, framesToProcess);
 }
 
+void AudioContext::processRenderPlan(ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess)
+{
+    ASSERT(r.context());
+
+    if (!m_renderPlanEnabled)
+        return;
+
+    if (m_renderPlan->isDirty())
+        m_renderPlan->compile(r, m_destinationNode.get(), m_renderingAutomaticPullNodes);
+
+    if (m_renderThreadPool && !m_unscheduledParamCount)
+        m_renderPlan->execute(g, r, framesToProcess, *m_renderThreadPool);
+    else
+        m_renderPlan->execute(g, r, framesToProcess);
+}
+
+void AudioContext::setRenderThreadCount(ContextRenderLock& r, unsigned count)
+{
+    ASSERT(r.context());
+
+    if (count == renderThreadCount())
+        return;
+
+    m_renderThreadPool.reset();
+    if (count > 1)
+        m_renderThreadPool = std::unique_ptr<AudioRenderThreadPool>(new AudioRenderThreadPool(count));
+
+    m_renderPlan->reserve(m_renderPlanMaxNodes, m_renderPlanMaxConnections, renderThreadCount());
+}
+
+void AudioContext::setRenderPlanCapacity(ContextRenderLock& r, size_t maxNodes, size_t maxConnections)
+{
+    ASSERT(r.context());
+
+    m_renderPlanMaxNodes = maxNodes;
+    m_renderPlanMaxConnections = maxConnections;
+    m_renderPlan->reserve(maxNodes, maxConnections, renderThreadCount());
+}
+
+bool AudioContext::renderPlanExceedsCapacity() const
+{
+    return m_renderPlan->exceedsCapacity();
+}
+
+void AudioContext::updateUnscheduledParamCount(ContextRenderLock& r, bool added)
+{
+    ASSERT(r.context());
+
+    if (added)
+        ++m_unscheduledParamCount;
+    else
+        --m_unscheduledParamCount;
+}
+
+unsigned AudioContext::renderThreadCount() const
+{
+    return m_renderThreadPool ? m_renderThreadPool->numberOfThreads() : 1;
+}
+
 void AudioContext::startRendering()
 {
     destination()->startRendering();
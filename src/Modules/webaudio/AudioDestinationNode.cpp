@@ -37,6 +37,7 @@ namespace WebCore {
 AudioDestinationNode::AudioDestinationNode(std::shared_ptr<AudioContext> c, float sampleRate)
     : AudioNode(sampleRate)
     , m_currentSampleFrame(0)
+    , m_droppedQuantumCount(0)
     , m_context(c)
 {
     addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
@@ -60,8 +61,12 @@ void AudioDestinationNode::render(AudioBus* sourceBus, AudioBus* destinationBus,
     DenormalDisabler denormalDisabler;
     
     ContextRenderLock renderLock(m_context, "AudioDestinationNode::render");
-    if (!renderLock.context())
-        return;                     // return if couldn't acquire lock
+    if (!renderLock.context()) {
+        // Another thread holds the render lock; this quantum is lost.
+        ++m_droppedQuantumCount;
+        destinationBus->zero();
+        return;
+    }
     
     if (!m_context->isRunnable()) {
         destinationBus->zero();
@@ -71,6 +76,7 @@ void AudioDestinationNode::render(AudioBus* sourceBus, AudioBus* destinationBus,
     ContextGraphLock graphLock(m_context, "AudioDestinationNode::render");
     
     if (!graphLock.context()) {
+        ++m_droppedQuantumCount;
         destinationBus->zero();
         return;
     }
@@ -82,8 +88,11 @@ void AudioDestinationNode::render(AudioBus* sourceBus, AudioBus* destinationBus,
     if (sourceBus)
         m_localAudioInputProvider.set(sourceBus);
 
+    // Process the graph in dependency order, leaving each node's audio in its output bus.
+    m_context->processRenderPlan(graphLock, renderLock, numberOfFrames);
+
     // This will cause the node(s) connected to this destination node to process, which in turn will pull on their input(s),
-    // all the way backwards through the rendering graph.
+    // all the way backwards through the rendering graph. If the render plan ran, the pull finds everything already rendered.
     AudioBus* renderedBus = input(0)->pull(graphLock, renderLock, destinationBus, numberOfFrames);
     
     if (!renderedBus)
@@ -49,6 +49,11 @@ AudioNode::AudioNode(float sampleRate)
     , m_connectionRefCount(0)
     , m_isMarkedForDeletion(false)
     , m_isDisabled(false)
+    , m_renderPlanGeneration(0)
+    , m_renderPlanIndex(0)
+    , m_referencedNodeIndex(NotHeldByContext)
+    , m_automaticSourceIndex(NotHeldByContext)
+    , m_nextFinishedNode(0)
 {
 #if DEBUG_AUDIONODE_REFERENCES
     if (!s_isNodeCountInitialized) {
@@ -61,7 +66,8 @@ AudioNode::AudioNode(float sampleRate)
 AudioNode::~AudioNode()
 {
 #if DEBUG_AUDIONODE_REFERENCES
-    --s_nodeCount[nodeType()];
+    if (nodeType() < NodeTypeEnd)
+        --s_nodeCount[nodeType()];
     fprintf(stderr, "%p: %d: AudioNode::~AudioNode() %d %d\n", this, nodeType(), m_normalRefCount, m_connectionRefCount);
 #endif
 }
@@ -81,7 +87,9 @@ void AudioNode::setNodeType(NodeType type)
     m_nodeType = type;
 
 #if DEBUG_AUDIONODE_REFERENCES
-    ++s_nodeCount[type];
+    // LabSound's own node types are numbered after NodeTypeEnd, and aren't counted.
+    if (type < NodeTypeEnd)
+        ++s_nodeCount[type];
 #endif
 }
 
@@ -101,6 +109,12 @@ void AudioNode::addOutput(std::shared_ptr<AudioNodeOutput> output)
     m_outputs.emplace_back(output);
 }
 
+void AudioNode::addParam(std::shared_ptr<AudioParam> param)
+{
+    param->m_isRegistered = true;
+    m_params.emplace_back(param);
+}
+
 std::shared_ptr<AudioNodeInput> AudioNode::input(unsigned i)
 {
     if (i < m_inputs.size())
@@ -115,6 +129,13 @@ std::shared_ptr<AudioNodeOutput> AudioNode::output(unsigned i)
     return 0;
 }
 
+std::shared_ptr<AudioParam> AudioNode::param(unsigned i)
+{
+    if (i < m_params.size())
+        return m_params[i];
+    return 0;
+}
+
 void AudioNode::connect(ContextGraphLock& g, ContextRenderLock &r,
                         AudioNode* destination, unsigned outputIndex, unsigned inputIndex, ExceptionCode& ec)
 {
@@ -335,10 +356,6 @@ void AudioNode::finishDeref(ContextGraphLock& g, ContextRenderLock& r, RefType r
                 for (unsigned i = 0; i < m_outputs.size(); ++i)
                     AudioNodeOutput::disconnectAll(g, r, output(i)); // This will deref() nodes we're connected to.
 
-                // Mark for deletion at end of each render quantum or when context shuts down.
-//                if (!shuttingDown)
-//                    ac->markForDeletion(this);
-                
                 m_isMarkedForDeletion = true;
             }
         }
@@ -107,6 +107,11 @@ AudioBus* AudioNodeOutput::pull(ContextGraphLock& g, ContextRenderLock& r, Audio
     ASSERT(m_renderingFanOutCount > 0 || m_renderingParamFanOutCount > 0);
     
     updateNumberOfChannels(g, r);
+
+    // If the render plan already processed our node this quantum, the audio is waiting in our bus.
+    // Redirecting m_actualDestinationBus to inPlaceBus now would hand back a bus that was never rendered.
+    if (node()->isProcessedForTime(r.context()->currentTime()))
+        return m_actualDestinationBus;
     
     // Causes our AudioNode to process if it hasn't already for this render quantum.
     // We try to do in-place processing (using inPlaceBus) if at all possible,
@@ -123,6 +128,14 @@ AudioBus* AudioNodeOutput::pull(ContextGraphLock& g, ContextRenderLock& r, Audio
     return m_actualDestinationBus;
 }
 
+void AudioNodeOutput::prepareForScheduledProcessing(ContextGraphLock& g, ContextRenderLock& r)
+{
+    ASSERT(r.context());
+
+    updateNumberOfChannels(g, r);
+    m_actualDestinationBus = m_internalBus.get();
+}
+
 AudioBus* AudioNodeOutput::bus() const
 {
     ASSERT(m_actualDestinationBus);
@@ -31,6 +31,8 @@
 #include "AudioNodeOutput.h"
 #include "AudioUtilities.h"
 #include "FloatConversion.h"
+#include "VectorMath.h"
+#include <algorithm>
 #include <wtf/MathExtras.h>
 
 namespace WebCore {
@@ -38,6 +40,20 @@ namespace WebCore {
 const double AudioParam::DefaultSmoothingConstant = 0.05;
 const double AudioParam::SnapThreshold = 0.001;
 
+float AudioParam::value(ContextRenderLock& r)
+{
+    // Update value for timeline.
+    if (r.context()) {
+        bool hasValue;
+        float timelineValue = m_timeline.valueForContextTime(r, narrowPrecisionToFloat(m_value), hasValue);
+
+        if (hasValue)
+            m_value = timelineValue;
+    }
+
+    return narrowPrecisionToFloat(m_value);
+}
+
 float AudioParam::value(std::shared_ptr<AudioContext> c)
 {
     // Update value for timeline.
@@ -65,13 +81,13 @@ float AudioParam::smoothedValue()
     return narrowPrecisionToFloat(m_smoothedValue);
 }
 
-bool AudioParam::smooth(std::shared_ptr<AudioContext> c)
+bool AudioParam::smooth(ContextRenderLock& r)
 {
     // If values have been explicitly scheduled on the timeline, then use the exact value.
     // Smoothing effectively is performed by the timeline.
     bool useTimelineValue = false;
-    if (c) {
-        m_value = m_timeline.valueForContextTime(c, narrowPrecisionToFloat(m_value), useTimelineValue);
+    if (r.context()) {
+        m_value = m_timeline.valueForContextTime(r, narrowPrecisionToFloat(m_value), useTimelineValue);
     }
     
     if (m_smoothedValue == m_value) {
@@ -124,7 +140,7 @@ void AudioParam::calculateFinalValues(ContextGraphLock& g, ContextRenderLock& r,
     else {
         // Calculate control-rate (k-rate) intrinsic value.
         bool hasValue;
-        float timelineValue = m_timeline.valueForContextTime(r.contextPtr(), narrowPrecisionToFloat(m_value), hasValue);
+        float timelineValue = m_timeline.valueForContextTime(r, narrowPrecisionToFloat(m_value), hasValue);
 
         if (hasValue)
             m_value = timelineValue;
@@ -133,24 +149,53 @@ void AudioParam::calculateFinalValues(ContextGraphLock& g, ContextRenderLock& r,
     }
 
     // Now sum all of the audio-rate connections together (unity-gain summing junction).
-    // Note that connections would normally be mono, but we mix down to mono if necessary.
-    AudioBus summingBus(1, numberOfValues, false);
-    summingBus.setChannelMemory(0, values, numberOfValues);
+    unsigned numberOfConnections = numberOfRenderingConnections();
+    if (!numberOfConnections)
+        return;
+
+    // Connections are summed straight into values, in one pass, from their outputs' channels.
+    // The list of channels keeps its capacity, so that nothing is allocated once the connections are settled.
+    m_summingSources.clear();
+    m_summingSources.push_back(values);
 
-    for (unsigned i = 0; i < numberOfRenderingConnections(); ++i) {
+    for (unsigned i = 0; i < numberOfConnections; ++i) {
         AudioNodeOutput* output = renderingOutput(i);
         ASSERT(output);
 
         // Render audio from this output.
         AudioBus* connectionBus = output->pull(g, r, 0, AudioNode::ProcessingSizeInFrames);
-
-        // Sum, with unity-gain.
-        summingBus.sumFrom(*connectionBus);
+        if (!connectionBus || connectionBus->isSilent())
+            continue;
+
+        // Connections would normally be mono; others are mixed down to mono as AudioBus::sumFrom does.
+        switch (connectionBus->numberOfChannels()) {
+        case 2: {
+            float scale = 0.5f;
+            VectorMath::vsma(connectionBus->channel(0)->data(), 1, &scale, values, 1, numberOfValues);
+            VectorMath::vsma(connectionBus->channel(1)->data(), 1, &scale, values, 1, numberOfValues);
+            break;
+        }
+        case 6:
+            m_summingSources.push_back(connectionBus->channel(2)->data());
+            break;
+        default:
+            m_summingSources.push_back(connectionBus->channel(0)->data());
+            break;
+        }
     }
+
+    if (m_summingSources.size() > 1)
+        VectorMath::vsum(m_summingSources.data(), static_cast<unsigned>(m_summingSources.size()), values, numberOfValues);
 }
 
 void AudioParam::calculateTimelineValues(ContextRenderLock& r, float* values, unsigned numberOfValues)
 {
+    // Without automation the param holds its value, so there is nothing to generate.
+    if (!m_timeline.hasValues()) {
+        std::fill(values, values + numberOfValues, narrowPrecisionToFloat(m_value));
+        return;
+    }
+
     // Calculate values for this render quantum.
     // Normally numberOfValues will equal AudioNode::ProcessingSizeInFrames (the render quantum size).
     double sampleRate = r.context()->sampleRate();
@@ -162,6 +207,17 @@ void AudioParam::calculateTimelineValues(ContextRenderLock& r, float* values, un
     m_value = m_timeline.valuesForTimeRange(startTime, endTime, narrowPrecisionToFloat(m_value), values, numberOfValues, sampleRate, sampleRate);
 }
 
+void AudioParam::didUpdate(ContextGraphLock&, ContextRenderLock& r)
+{
+    // The drivers of a param which no node registered are pulled from within its node's process(), out of
+    // the render plan's sight. The context renders on one thread while there are any.
+    bool isUnscheduledDriven = !m_isRegistered && numberOfRenderingConnections() > 0;
+    if (isUnscheduledDriven != m_isUnscheduledDriven) {
+        m_isUnscheduledDriven = isUnscheduledDriven;
+        r.context()->updateUnscheduledParamCount(r, isUnscheduledDriven);
+    }
+}
+
 void AudioParam::connect(ContextGraphLock& g, std::shared_ptr<AudioParam> param, std::shared_ptr<AudioNodeOutput> output)
 {
     if (!output)
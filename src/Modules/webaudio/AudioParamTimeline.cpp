@@ -27,8 +27,10 @@
 #include "AudioNode.h"
 #include "AudioParamTimeline.h"
 
+#include "AudioContextLock.h"
 #include "AudioUtilities.h"
 #include "FloatConversion.h"
+#include "VectorMath.h"
 #include <algorithm>
 #include <wtf/MathExtras.h>
 
@@ -36,6 +38,33 @@ using namespace std;
 
 namespace WebCore {
 
+AudioParamTimeline::AudioParamTimeline()
+    : m_latest(0)
+    , m_pending(0)
+    , m_retired(0)
+    , m_eventCount(0)
+    , m_renderTime(0)
+    , m_isRendering(false)
+    , m_current(0)
+    , m_cursor(0)
+    , m_cursorTime(0)
+{
+}
+
+AudioParamTimeline::~AudioParamTimeline()
+{
+    // m_latest is either m_pending or m_current.
+    delete m_pending.exchange(0);
+    delete m_current;
+
+    EventList* retired = m_retired.exchange(0);
+    while (retired) {
+        EventList* next = retired->nextRetired;
+        delete retired;
+        retired = next;
+    }
+}
+
 void AudioParamTimeline::setValueAtTime(float value, float time)
 {
     insertEvent(ParamEvent(ParamEvent::SetValue, value, time, 0, 0, 0));
@@ -66,6 +95,48 @@ static bool isValidNumber(float x)
     return !isnan(x) && !isinf(x);
 }
 
+size_t AudioParamTimeline::firstEventToRender(const std::vector<ParamEvent>& events, double time)
+{
+    // Rendering passes over an event once the one after it has started.
+    if (events.size() < 2)
+        return 0;
+
+    auto next = lower_bound(events.begin() + 1, events.end(), time, [](const ParamEvent& event, double value) {
+        return event.time() < value;
+    });
+    return (next - events.begin()) - 1;
+}
+
+AudioParamTimeline::EventList* AudioParamTimeline::beginEdit()
+{
+    // Free the lists rendering has finished with.
+    EventList* retired = m_retired.exchange(0, std::memory_order_acquire);
+    while (retired) {
+        EventList* next = retired->nextRetired;
+        delete retired;
+        retired = next;
+    }
+
+    // A list which hasn't been picked up yet can still be changed, so that a burst of edits costs one copy.
+    EventList* list = m_pending.exchange(0, std::memory_order_acquire);
+    if (!list)
+        list = m_latest ? new EventList(*m_latest) : new EventList();
+
+    // Drop the events which have already played out.
+    size_t expired = firstEventToRender(list->events, m_renderTime.load(std::memory_order_relaxed));
+    if (expired)
+        list->events.erase(list->events.begin(), list->events.begin() + expired);
+
+    return list;
+}
+
+void AudioParamTimeline::publish(EventList* list)
+{
+    m_latest = list;
+    m_eventCount.store(list->events.size(), std::memory_order_relaxed);
+    m_pending.store(list, std::memory_order_release);
+}
+
 void AudioParamTimeline::insertEvent(const ParamEvent& event)
 {
     // Sanity check the event. Be super careful we're not getting infected with NaN or Inf.
@@ -81,55 +152,124 @@ void AudioParamTimeline::insertEvent(const ParamEvent& event)
         return;
         
     std::lock_guard<std::mutex> locker(m_eventsLock);
-    
-    unsigned i = 0;
+
+    EventList* list = beginEdit();
+    std::vector<ParamEvent>& events = list->events;
+
     float insertTime = event.time();
-    for (i = 0; i < m_events.size(); ++i) {
-        // Overwrite same event type and time.
-        if (m_events[i].time() == insertTime && m_events[i].type() == event.type()) {
-            m_events[i] = event;
+    auto insertAt = upper_bound(events.begin(), events.end(), insertTime, [](float time, const ParamEvent& event) {
+        return time < event.time();
+    });
+
+    // Overwrite same event type and time.
+    auto i = insertAt;
+    while (i != events.begin() && (i - 1)->time() == insertTime) {
+        --i;
+        if (i->type() == event.type()) {
+            *i = event;
+            publish(list);
             return;
         }
-
-        if (m_events[i].time() > insertTime)
-            break;
     }
 
-    m_events.insert(m_events.begin() + i, event);
+    events.insert(insertAt, event);
+    publish(list);
 }
 
 void AudioParamTimeline::cancelScheduledValues(float startTime)
 {
     std::lock_guard<std::mutex> locker(m_eventsLock);
 
+    EventList* list = beginEdit();
+    std::vector<ParamEvent>& events = list->events;
+
     // Remove all events starting at startTime.
-    for (unsigned i = 0; i < m_events.size(); ++i) {
-        if (m_events[i].time() >= startTime) {
-            m_events.erase(m_events.begin() + i, m_events.end());
-            break;
+    auto i = lower_bound(events.begin(), events.end(), startTime, [](const ParamEvent& event, float time) {
+        return event.time() < time;
+    });
+    events.erase(i, events.end());
+
+    publish(list);
+}
+
+bool AudioParamTimeline::beginRendering(double startTime)
+{
+    // Only one thread at a time reads through the cursor; any other returns at once rather than waiting.
+    if (m_isRendering.exchange(true, std::memory_order_acquire))
+        return false;
+
+    if (EventList* list = m_pending.exchange(0, std::memory_order_acquire)) {
+        // Hand the old list back to be freed by the next edit, so that rendering never frees memory.
+        if (EventList* retired = m_current) {
+            retired->nextRetired = m_retired.load(std::memory_order_relaxed);
+            while (!m_retired.compare_exchange_weak(retired->nextRetired, retired, std::memory_order_release, std::memory_order_relaxed)) { }
         }
+
+        m_current = list;
+        m_cursor = firstEventToRender(list->events, startTime);
     }
+    else if (m_current && startTime < m_cursorTime)
+        m_cursor = firstEventToRender(m_current->events, startTime);
+
+    m_cursorTime = startTime;
+    m_renderTime.store(startTime, std::memory_order_relaxed);
+    return true;
 }
 
-float AudioParamTimeline::valueForContextTime(std::shared_ptr<AudioContext> context, float defaultValue, bool& hasValue)
+void AudioParamTimeline::endRendering()
+{
+    m_isRendering.store(false, std::memory_order_release);
+}
+
+float AudioParamTimeline::valueForContextTime(ContextRenderLock& r, float defaultValue, bool& hasValue)
 {
+    AudioContext* context = r.context();
     ASSERT(context);
 
-    if (!m_eventsLock.try_lock() || !context || !m_events.size() || context->currentTime() < m_events[0].time()) {
-        hasValue = false;
+    hasValue = false;
+    if (!context || !hasValues())
         return defaultValue;
-    }
 
     // Ask for just a single value.
+    float value = defaultValue;
     double sampleRate = context->sampleRate();
     double startTime = context->currentTime();
     double endTime = startTime + 1.1 / sampleRate; // time just beyond one sample-frame
     double controlRate = sampleRate / AudioNode::ProcessingSizeInFrames; // one parameter change per render quantum
-    float value = valuesForTimeRange(startTime, endTime, defaultValue, &value, 1, sampleRate, controlRate);
 
-    m_eventsLock.unlock();
+    if (beginRendering(startTime)) {
+        if (m_current && m_current->events.size() && startTime >= m_current->events[0].time()) {
+            value = valuesForTimeRangeImpl(m_current->events, m_cursor, startTime, endTime, defaultValue, &value, 1, sampleRate, controlRate);
+            hasValue = true;
+        }
+        endRendering();
+    }
+
+    return value;
+}
+
+float AudioParamTimeline::valueForContextTime(std::shared_ptr<AudioContext> context, float defaultValue, bool& hasValue)
+{
+    ASSERT(context);
+
+    hasValue = false;
+    if (!context || !hasValues())
+        return defaultValue;
+
+    float value = defaultValue;
+    double sampleRate = context->sampleRate();
+    double startTime = context->currentTime();
+    double endTime = startTime + 1.1 / sampleRate;
+    double controlRate = sampleRate / AudioNode::ProcessingSizeInFrames;
+
+    // Edits are the only other holders of the lock, so a control thread may wait on it.
+    std::lock_guard<std::mutex> locker(m_eventsLock);
+    if (m_latest && m_latest->events.size() && startTime >= m_latest->events[0].time()) {
+        size_t cursor = firstEventToRender(m_latest->events, startTime);
+        value = valuesForTimeRangeImpl(m_latest->events, cursor, startTime, endTime, defaultValue, &value, 1, sampleRate, controlRate);
+        hasValue = true;
+    }
 
-    hasValue = true;
     return value;
 }
 
@@ -142,22 +282,26 @@ float AudioParamTimeline::valuesForTimeRange(
     double sampleRate,
     double controlRate)
 {
-    // We can't contend the lock in the realtime audio thread.
-    if (!m_eventsLock.try_lock()) {
-        if (values) {
-            for (unsigned i = 0; i < numberOfValues; ++i)
-                values[i] = defaultValue;
+    // We can't wait in the realtime audio thread; if another thread is reading the timeline, the value holds.
+    if (beginRendering(startTime)) {
+        if (m_current) {
+            float value = valuesForTimeRangeImpl(m_current->events, m_cursor, startTime, endTime, defaultValue, values, numberOfValues, sampleRate, controlRate);
+            endRendering();
+            return value;
         }
-        return defaultValue;
+        endRendering();
     }
 
-    float value = valuesForTimeRangeImpl(startTime, endTime, defaultValue, values, numberOfValues, sampleRate, controlRate);
-    m_eventsLock.unlock();
-
-    return value;
+    if (values) {
+        for (unsigned i = 0; i < numberOfValues; ++i)
+            values[i] = defaultValue;
+    }
+    return defaultValue;
 }
 
 float AudioParamTimeline::valuesForTimeRangeImpl(
+    const std::vector<ParamEvent>& events,
+    size_t& cursor,
     double startTime,
     double endTime,
     float defaultValue,
@@ -170,19 +314,32 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
         return defaultValue;
 
     // Return default value if there are no events matching the desired time range.
-    if (!m_events.size() || endTime <= m_events[0].time()) {
+    if (!events.size() || endTime <= events[0].time()) {
         for (unsigned i = 0; i < numberOfValues; ++i)
             values[i] = defaultValue;
         return defaultValue;
     }
 
+    // Once the last event has started, a param without a curve or target to follow holds its value.
+    size_t n = events.size();
+    const ParamEvent& lastEvent = events[n - 1];
+    if (cursor >= n - 1 && lastEvent.time() <= startTime) {
+        unsigned lastType = lastEvent.type();
+        if (lastType == ParamEvent::SetValue || lastType == ParamEvent::LinearRampToValue || lastType == ParamEvent::ExponentialRampToValue) {
+            cursor = n - 1;
+            float value = lastEvent.value();
+            std::fill(values, values + numberOfValues, value);
+            return value;
+        }
+    }
+
     // Maintain a running time and index for writing the values buffer.
     double currentTime = startTime;
     unsigned writeIndex = 0;
 
     // If first event is after startTime then fill initial part of values buffer with defaultValue
     // until we reach the first event time.
-    double firstEventTime = m_events[0].time();
+    double firstEventTime = events[0].time();
     if (firstEventTime > startTime) {
         double fillToTime = min(endTime, firstEventTime);
         unsigned fillToFrame = AudioUtilities::timeToSampleFrame(fillToTime - startTime, sampleRate);
@@ -197,17 +354,19 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
 
     // Go through each event and render the value buffer where the times overlap,
     // stopping when we've rendered all the requested values.
-    // FIXME: could try to optimize by avoiding having to iterate starting from the very first event
-    // and keeping track of a "current" event index.
-    int n = m_events.size();
-    for (int i = 0; i < n && writeIndex < numberOfValues; ++i) {
-        ParamEvent& event = m_events[i];
-        ParamEvent* nextEvent = i < n - 1 ? &(m_events[i + 1]) : 0;
+    // Events before the cursor ended before an earlier startTime, so they can't overlap this range.
+    size_t firstRendered = n;
+    for (size_t i = min(cursor, n - 1); i < n && writeIndex < numberOfValues; ++i) {
+        const ParamEvent& event = events[i];
+        const ParamEvent* nextEvent = i < n - 1 ? &(events[i + 1]) : 0;
 
         // Wait until we get a more recent event.
         if (nextEvent && nextEvent->time() < currentTime)
             continue;
 
+        if (firstRendered == n)
+            firstRendered = i;
+
         float value1 = event.value();
         double time1 = event.time();
         float value2 = nextEvent ? nextEvent->value() : value1;
@@ -225,11 +384,15 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
 
         // First handle linear and exponential ramps which require looking ahead to the next event.
         if (nextEventType == ParamEvent::LinearRampToValue) {
-            for (; writeIndex < fillToFrame; ++writeIndex) {
-                float x = (currentTime - time1) * k;
-                value = (1 - x) * value1 + x * value2;
-                values[writeIndex] = value;
-                currentTime += sampleFrameTimeIncr;
+            // Each value of the ramp is found from its frame, so the stretch is generated in one go.
+            if (writeIndex < fillToFrame) {
+                unsigned count = fillToFrame - writeIndex;
+                float rampStart = value1 + (value2 - value1) * static_cast<float>((currentTime - time1) * k);
+                float rampStep = (value2 - value1) * static_cast<float>(k * sampleFrameTimeIncr);
+                VectorMath::vramp(&rampStart, &rampStep, values + writeIndex, 1, count);
+                writeIndex = fillToFrame;
+                value = values[writeIndex - 1];
+                currentTime += count * sampleFrameTimeIncr;
             }
         } else if (nextEventType == ParamEvent::ExponentialRampToValue) {
             if (value1 <= 0 || value2 <= 0) {
@@ -248,10 +411,12 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
                 value = value1 * powf(value2 / value1,
                                       AudioUtilities::timeToSampleFrame(currentTime - time1, sampleRate) / numSampleFrames);
 
-                for (; writeIndex < fillToFrame; ++writeIndex) {
-                    values[writeIndex] = value;
-                    value *= multiplier;
-                    currentTime += sampleFrameTimeIncr;
+                if (writeIndex < fillToFrame) {
+                    unsigned count = fillToFrame - writeIndex;
+                    const float noOffset = 0;
+                    VectorMath::vexpramp(&value, &multiplier, &noOffset, values + writeIndex, 1, count);
+                    writeIndex = fillToFrame;
+                    currentTime += count * sampleFrameTimeIncr;
                 }
             }
         } else {
@@ -280,9 +445,13 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
                     float timeConstant = event.timeConstant();
                     float discreteTimeConstant = static_cast<float>(AudioUtilities::discreteTimeConstantForSampleRate(timeConstant, controlRate));
 
-                    for (; writeIndex < fillToFrame; ++writeIndex) {
-                        values[writeIndex] = value;
-                        value += (target - value) * discreteTimeConstant;
+                    // Stepping value += (target - value) * discreteTimeConstant each frame is a geometric approach to the target.
+                    if (writeIndex < fillToFrame) {
+                        float distance = value - target;
+                        float ratio = 1 - discreteTimeConstant;
+                        VectorMath::vexpramp(&distance, &ratio, &target, values + writeIndex, 1, fillToFrame - writeIndex);
+                        writeIndex = fillToFrame;
+                        value = target + distance;
                     }
 
                     break;
@@ -355,6 +524,9 @@ float AudioParamTimeline::valuesForTimeRangeImpl(
         }
     }
 
+    if (firstRendered < n)
+        cursor = firstRendered;
+
     // If there's any time left after processing the last event then just propagate the last value
     // to the end of the values buffer.
     for (; writeIndex < numberOfValues; ++writeIndex)
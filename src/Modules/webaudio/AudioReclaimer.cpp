@@ -0,0 +1,126 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "AudioReclaimer.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace WebCore {
+
+// How many objects the audio thread can retire between two passes of the reclaimer before spilling into m_overflow.
+const size_t RetiredQueueCapacity = 4096;
+
+// How often the reclaimer thread looks for objects to release.
+const int ReclaimIntervalMilliseconds = 10;
+
+AudioReclaimer::AudioReclaimer()
+: m_retired(RetiredQueueCapacity)
+, m_epoch(0)
+, m_overflowCount(0)
+, m_shouldExit(false)
+, m_thread(0)
+{
+    m_thread = createThread(AudioReclaimer::reclaimerEntry, this, "audio reclaimer");
+}
+
+AudioReclaimer::~AudioReclaimer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_shouldExit = true;
+        m_wake.notify_all();
+    }
+
+    if (m_thread)
+        waitForThreadCompletion(m_thread);
+
+    reclaimAll();
+}
+
+void AudioReclaimer::retire(std::shared_ptr<void> object)
+{
+    if (!object)
+        return;
+
+    Retired retired = { std::move(object), m_epoch.load(std::memory_order_relaxed) };
+    if (!m_overflowCount.load(std::memory_order_acquire) && m_retired.push(retired))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_overflowMutex);
+    m_overflow.push_back(std::move(retired));
+    m_overflowCount.store(m_overflow.size(), std::memory_order_release);
+}
+
+void AudioReclaimer::advanceEpoch()
+{
+    if (m_overflowCount.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(m_overflowMutex);
+        size_t pushed = 0;
+        while (pushed < m_overflow.size() && m_retired.push(m_overflow[pushed]))
+            ++pushed;
+        m_overflow.erase(m_overflow.begin(), m_overflow.begin() + pushed);
+        m_overflowCount.store(m_overflow.size(), std::memory_order_release);
+    }
+
+    m_epoch.fetch_add(1, std::memory_order_release);
+}
+
+void AudioReclaimer::reclaimAll()
+{
+    std::lock_guard<std::mutex> lock(m_reclaimMutex);
+
+    {
+        std::lock_guard<std::mutex> overflowLock(m_overflowMutex);
+        for (auto& retired : m_overflow)
+            m_pending.push_back(std::move(retired));
+        m_overflow.clear();
+        m_overflowCount.store(0, std::memory_order_release);
+    }
+
+    reclaim(~uint64_t(0));
+}
+
+void AudioReclaimer::reclaimerEntry(void* threadData)
+{
+    AudioReclaimer* reclaimer = reinterpret_cast<AudioReclaimer*>(threadData);
+    ASSERT(reclaimer);
+    reclaimer->reclaimerLoop();
+}
+
+void AudioReclaimer::reclaimerLoop()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(ReclaimIntervalMilliseconds), [this]() { return m_shouldExit; });
+            if (m_shouldExit)
+                return;
+        }
+
+        // Objects retired during the current or the previous epoch may still be referenced by the rendering state.
+        uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+        if (epoch < 2)
+            continue;
+
+        std::lock_guard<std::mutex> lock(m_reclaimMutex);
+        reclaim(epoch - 2);
+    }
+}
+
+void AudioReclaimer::reclaim(uint64_t safeEpoch)
+{
+    Retired retired;
+    while (m_retired.try_pop(retired))
+        m_pending.push_back(std::move(retired));
+
+    for (auto& pending : m_pending) {
+        if (pending.epoch <= safeEpoch)
+            pending.object.reset();
+    }
+
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [](const Retired& r) { return !r.object; }), m_pending.end());
+}
+
+} // namespace WebCore
@@ -0,0 +1,445 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "AudioRenderPlan.h"
+
+#include "AudioContextLock.h"
+#include "AudioNode.h"
+#include "AudioNodeInput.h"
+#include "AudioNodeOutput.h"
+#include "AudioParam.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace WebCore {
+
+// m_renderPlanIndex of a node which has been reached by the walk but not scheduled yet.
+// Finding one upstream of a node means the graph has a feedback loop.
+const unsigned NotScheduled = ~0u;
+
+// Appends to storage reserved by AudioRenderPlan::reserve(). Returns false rather than growing the vector,
+// which would allocate on the audio thread.
+template<typename T>
+static bool append(std::vector<T>& v, const T& value)
+{
+    if (v.size() == v.capacity())
+        return false;
+    v.push_back(value);
+    return true;
+}
+
+// Replaces the vector's storage with room for capacity elements; reserve() alone never shrinks it.
+template<typename T>
+static void reserveExactly(std::vector<T>& v, size_t capacity)
+{
+    std::vector<T> storage;
+    storage.reserve(capacity);
+    v.swap(storage);
+}
+
+// Chase-Lev work stealing deque of task indices. The owning thread pushes and pops at the bottom,
+// other threads steal from the top. Every task is pushed at most once per quantum and the deque
+// is reset before each quantum, so the array never wraps and a slot is never overwritten while
+// a thief may be reading it.
+struct AudioRenderPlan::TaskQueue {
+    std::vector<unsigned> tasks;
+    char pad0[64];
+    std::atomic<int> top;
+    char pad1[64];
+    std::atomic<int> bottom;
+    char pad2[64];
+
+    TaskQueue() : top(0), bottom(0) {}
+
+    void reset()
+    {
+        top.store(0, std::memory_order_relaxed);
+        bottom.store(0, std::memory_order_relaxed);
+    }
+
+    void push(unsigned task)
+    {
+        int b = bottom.load(std::memory_order_relaxed);
+        tasks[b] = task;
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    bool pop(unsigned& task)
+    {
+        int b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        task = tasks[b];
+        if (t < b)
+            return true;
+
+        // Last task in the deque; race the thieves for it.
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    bool steal(unsigned& task)
+    {
+        int t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+            return false;
+
+        task = tasks[t];
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+class AudioRenderPlan::ParallelJob : public AudioRenderThreadPool::Job {
+public:
+    ParallelJob(AudioRenderPlan& plan, ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess)
+    : m_plan(plan), m_g(g), m_r(r), m_framesToProcess(framesToProcess) {}
+
+    virtual void run(unsigned participant) override
+    {
+        AudioRenderPlan& plan = m_plan;
+        TaskQueue& queue = *plan.m_queues[participant];
+        const unsigned numberOfQueues = static_cast<unsigned>(plan.m_queues.size());
+        const unsigned numberOfTasks = static_cast<unsigned>(plan.m_tasks.size());
+
+        while (plan.m_completedTasks.load(std::memory_order_acquire) < numberOfTasks) {
+            unsigned t;
+            bool found = queue.pop(t);
+            for (unsigned i = 1; !found && i < numberOfQueues; ++i)
+                found = plan.m_queues[(participant + i) % numberOfQueues]->steal(t);
+
+            if (!found) {
+                // Everything ready is being worked on; wait for a running task to release its dependents.
+                std::this_thread::yield();
+                continue;
+            }
+
+            const Task& task = plan.m_tasks[t];
+            for (unsigned i = 0; i < task.numberOfSteps; ++i)
+                plan.runStep(plan.m_steps[plan.m_taskSteps[task.firstStep + i]], m_g, m_r, m_framesToProcess);
+
+            // The last dependency to finish makes the dependent ready, and keeps it on this thread,
+            // which most likely still has the audio it needs in cache.
+            for (unsigned i = 0; i < task.numberOfDependents; ++i) {
+                unsigned dependent = plan.m_dependents[task.firstDependent + i];
+                if (plan.m_pendingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    queue.push(dependent);
+            }
+
+            plan.m_completedTasks.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+
+private:
+    AudioRenderPlan& m_plan;
+    ContextGraphLock& m_g;
+    ContextRenderLock& m_r;
+    size_t m_framesToProcess;
+};
+
+AudioRenderPlan::AudioRenderPlan()
+: m_completedTasks(0)
+, m_generation(0)
+, m_isDirty(true)
+, m_hasFeedback(false)
+, m_exceedsCapacity(false)
+{
+}
+
+AudioRenderPlan::~AudioRenderPlan()
+{
+}
+
+void AudioRenderPlan::reserve(size_t maxNodes, size_t maxConnections, unsigned numberOfThreads)
+{
+    // The destination is a step until the walk is done.
+    const size_t maxSteps = maxNodes + 1;
+
+    reserveExactly(m_steps, maxSteps);
+    reserveExactly(m_stack, maxSteps);
+    reserveExactly(m_outputs, maxSteps + maxConnections);
+    reserveExactly(m_producers, maxConnections);
+
+    reserveExactly(m_tasks, maxSteps);
+    reserveExactly(m_taskSteps, maxSteps);
+    reserveExactly(m_stepTask, maxSteps);
+    reserveExactly(m_stepConsumers, maxSteps);
+    reserveExactly(m_edges, maxConnections);
+    reserveExactly(m_dependents, maxConnections);
+    m_pendingDependencies.reset(new std::atomic<unsigned>[maxSteps]);
+
+    m_queues.clear();
+    if (numberOfThreads > 1) {
+        for (unsigned i = 0; i < numberOfThreads; ++i) {
+            m_queues.emplace_back(new TaskQueue());
+            m_queues.back()->tasks.resize(maxSteps);
+        }
+    }
+
+    m_isDirty = true;
+}
+
+void AudioRenderPlan::compile(ContextRenderLock& r, AudioNode* destination, const std::vector<std::shared_ptr<AudioNode>>& pullNodes)
+{
+    ASSERT(r.context());
+
+    m_steps.clear();
+    m_outputs.clear();
+    m_producers.clear();
+    m_stack.clear();
+    m_tasks.clear();
+    m_hasFeedback = false;
+    m_exceedsCapacity = false;
+    m_isDirty = false;
+
+    // A new generation invalidates every node's visited mark from the previous compile.
+    ++m_generation;
+
+    bool fits = true;
+    if (destination) {
+        // The destination is pulled by the hardware, so it isn't a step itself, only a root.
+        destination->m_renderPlanGeneration = m_generation;
+        destination->m_renderPlanIndex = NotScheduled;
+        fits = append(m_stack, Visit{ destination, 0, 0 }) && visit(0);
+        if (fits) {
+            m_producers.resize(m_steps.back().firstProducer);
+            m_steps.pop_back();
+        }
+    }
+
+    for (size_t i = 0; fits && i < pullNodes.size(); ++i)
+        fits = visit(pullNodes[i].get());
+
+    if (!fits || !buildTasks()) {
+        // The graph has outgrown the storage reserved for it. The destination's pull renders it instead,
+        // until the graph shrinks or more is reserved.
+        m_steps.clear();
+        m_tasks.clear();
+        m_exceedsCapacity = true;
+    }
+}
+
+// A node's summing junctions are its inputs followed by its params.
+static AudioSummingJunction* summingJunction(AudioNode* node, unsigned i)
+{
+    if (i < node->numberOfInputs())
+        return node->input(i).get();
+    return node->param(i - node->numberOfInputs()).get();
+}
+
+bool AudioRenderPlan::visit(AudioNode* root)
+{
+    if (root) {
+        if (root->m_renderPlanGeneration == m_generation)
+            return true;
+        root->m_renderPlanGeneration = m_generation;
+        root->m_renderPlanIndex = NotScheduled;
+        if (!append(m_stack, Visit{ root, 0, 0 }))
+            return false;
+    }
+
+    // Iterative post-order walk, so that a long chain of nodes can't exhaust the audio thread's stack.
+    // Nodes already marked are either done, or are still on the stack because of a feedback loop;
+    // either way they are not visited again.
+    while (m_stack.size()) {
+        Visit& v = m_stack.back();
+        AudioNode* upstream = 0;
+        unsigned numberOfJunctions = v.node->numberOfInputs() + v.node->numberOfParams();
+
+        while (!upstream && v.input < numberOfJunctions) {
+            AudioSummingJunction* junction = summingJunction(v.node, v.input);
+            if (v.connection < junction->numberOfRenderingConnections()) {
+                AudioNode* candidate = junction->renderingOutput(v.connection++)->node();
+                if (candidate->m_renderPlanGeneration != m_generation)
+                    upstream = candidate;
+            }
+            else {
+                ++v.input;
+                v.connection = 0;
+            }
+        }
+
+        if (upstream) {
+            upstream->m_renderPlanGeneration = m_generation;
+            upstream->m_renderPlanIndex = NotScheduled;
+            if (!append(m_stack, Visit{ upstream, 0, 0 }))
+                return false;
+            continue;
+        }
+
+        // Every node feeding this one has been scheduled.
+        AudioNode* node = v.node;
+        m_stack.pop_back();
+
+        Step step = { node, static_cast<unsigned>(m_outputs.size()), node->numberOfOutputs(), static_cast<unsigned>(m_producers.size()), 0 };
+        for (unsigned i = 0; i < step.numberOfOutputs; ++i) {
+            if (!append(m_outputs, node->output(i).get()))
+                return false;
+        }
+        if (!append(m_steps, step))
+            return false;
+
+        for (unsigned i = 0; i < numberOfJunctions; ++i) {
+            AudioSummingJunction* junction = summingJunction(node, i);
+            for (unsigned j = 0; j < junction->numberOfRenderingConnections(); ++j) {
+                if (!addProducer(junction->renderingOutput(j)->node()))
+                    return false;
+            }
+        }
+
+        node->m_renderPlanIndex = static_cast<unsigned>(m_steps.size() - 1);
+    }
+
+    return true;
+}
+
+bool AudioRenderPlan::addProducer(AudioNode* upstream)
+{
+    if (upstream->m_renderPlanIndex == NotScheduled) {
+        m_hasFeedback = true;
+        return true;
+    }
+
+    Step& step = m_steps.back();
+    for (unsigned i = 0; i < step.numberOfProducers; ++i) {
+        if (m_producers[step.firstProducer + i] == upstream->m_renderPlanIndex)
+            return true;
+    }
+
+    if (!append(m_producers, upstream->m_renderPlanIndex))
+        return false;
+    ++step.numberOfProducers;
+    return true;
+}
+
+bool AudioRenderPlan::buildTasks()
+{
+    const unsigned numberOfSteps = static_cast<unsigned>(m_steps.size());
+
+    // Every per-step array was reserved for as many steps as m_steps, and m_edges for as many as m_producers.
+    m_tasks.clear();
+    m_edges.clear();
+    m_stepTask.resize(numberOfSteps);
+    m_stepConsumers.assign(numberOfSteps, 0);
+
+    for (const Step& step : m_steps) {
+        for (unsigned i = 0; i < step.numberOfProducers; ++i)
+            ++m_stepConsumers[m_producers[step.firstProducer + i]];
+    }
+
+    // Steps are already in dependency order. A step continues its producer's task if it has only the one
+    // producer, and is that producer's only consumer; anything else, a join or a fork, starts a new task.
+    for (unsigned s = 0; s < numberOfSteps; ++s) {
+        const Step& step = m_steps[s];
+        if (step.numberOfProducers == 1 && m_stepConsumers[m_producers[step.firstProducer]] == 1) {
+            m_stepTask[s] = m_stepTask[m_producers[step.firstProducer]];
+            ++m_tasks[m_stepTask[s]].numberOfSteps;
+        }
+        else {
+            m_stepTask[s] = static_cast<unsigned>(m_tasks.size());
+            m_tasks.push_back({ 0, 1, 0, 0, 0 });
+        }
+    }
+
+    // Lay each task's steps out contiguously, keeping their order.
+    unsigned first = 0;
+    for (Task& task : m_tasks) {
+        task.firstStep = first;
+        first += task.numberOfSteps;
+        task.numberOfSteps = 0;
+    }
+
+    m_taskSteps.resize(numberOfSteps);
+    for (unsigned s = 0; s < numberOfSteps; ++s) {
+        Task& task = m_tasks[m_stepTask[s]];
+        m_taskSteps[task.firstStep + task.numberOfSteps++] = s;
+    }
+
+    // Dependencies between tasks, from the producers of each task's steps.
+    for (unsigned s = 0; s < numberOfSteps; ++s) {
+        const Step& step = m_steps[s];
+        for (unsigned i = 0; i < step.numberOfProducers; ++i) {
+            unsigned producerTask = m_stepTask[m_producers[step.firstProducer + i]];
+            if (producerTask != m_stepTask[s] && !append(m_edges, std::make_pair(producerTask, m_stepTask[s])))
+                return false;
+        }
+    }
+
+    std::sort(m_edges.begin(), m_edges.end());
+    m_edges.erase(std::unique(m_edges.begin(), m_edges.end()), m_edges.end());
+
+    m_dependents.resize(m_edges.size());
+    for (unsigned i = 0; i < m_edges.size(); ++i) {
+        Task& producer = m_tasks[m_edges[i].first];
+        if (!producer.numberOfDependents)
+            producer.firstDependent = i;
+        ++producer.numberOfDependents;
+        ++m_tasks[m_edges[i].second].numberOfDependencies;
+        m_dependents[i] = m_edges[i].second;
+    }
+
+    return true;
+}
+
+void AudioRenderPlan::runStep(const Step& step, ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess)
+{
+    AudioNodeOutput** outputs = m_outputs.data() + step.firstOutput;
+    for (unsigned i = 0; i < step.numberOfOutputs; ++i)
+        outputs[i]->prepareForScheduledProcessing(g, r);
+
+    step.node->processIfNecessary(g, r, framesToProcess);
+}
+
+void AudioRenderPlan::execute(ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess)
+{
+    ASSERT(r.context() && !m_isDirty);
+
+    for (const Step& step : m_steps)
+        runStep(step, g, r, framesToProcess);
+}
+
+void AudioRenderPlan::execute(ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess, AudioRenderThreadPool& pool)
+{
+    ASSERT(r.context() && !m_isDirty);
+
+    const unsigned numberOfThreads = pool.numberOfThreads();
+
+    // In a feedback loop a node is pulled on demand by the node it feeds, from whichever thread that is,
+    // so the loop can't be split across threads. Queues for the pool are made by reserve(), not here.
+    if (numberOfThreads < 2 || m_tasks.size() < 2 || m_hasFeedback || m_queues.size() != numberOfThreads) {
+        execute(g, r, framesToProcess);
+        return;
+    }
+
+    for (auto& queue : m_queues)
+        queue->reset();
+
+    // Deal the tasks which are ready from the start out to all of the threads.
+    unsigned next = 0;
+    for (unsigned t = 0; t < m_tasks.size(); ++t) {
+        m_pendingDependencies[t].store(m_tasks[t].numberOfDependencies, std::memory_order_relaxed);
+        if (!m_tasks[t].numberOfDependencies) {
+            m_queues[next]->push(t);
+            next = (next + 1) % numberOfThreads;
+        }
+    }
+
+    m_completedTasks.store(0, std::memory_order_relaxed);
+
+    ParallelJob job(*this, g, r, framesToProcess);
+    pool.run(job);
+}
+
+} // namespace WebCore
@@ -0,0 +1,151 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "AudioRenderThreadPool.h"
+
+#include <chrono>
+#include <thread>
+
+#if OS(DARWIN)
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#elif OS(WINDOWS)
+#include <windows.h>
+#elif OS(LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace WebCore {
+
+// How long a worker waits for the next job before going to sleep. Offline rendering, which starts the next
+// quantum at once, finds the workers awake; an audio device's next quantum is milliseconds away, and the
+// workers sleep through the wait rather than spin.
+const std::chrono::microseconds WorkerSpinTime(50);
+
+static void pinCurrentThread(unsigned core)
+{
+    unsigned cores = std::thread::hardware_concurrency();
+    if (cores < 2)
+        return;
+    core %= cores;
+
+#if OS(DARWIN)
+    // Mac OS X doesn't allow binding a thread to a core; distinct affinity tags ask the scheduler to spread the workers out.
+    thread_affinity_policy_data_t policy = { static_cast<integer_t>(core + 1) };
+    thread_policy_set(mach_thread_self(), THREAD_AFFINITY_POLICY, (thread_policy_t) &policy, THREAD_AFFINITY_POLICY_COUNT);
+#elif OS(WINDOWS)
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+#elif OS(LINUX)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+AudioRenderThreadPool::AudioRenderThreadPool(unsigned numberOfThreads)
+: m_job(0)
+, m_epoch(0)
+, m_running(0)
+, m_sleeping(0)
+, m_shouldExit(false)
+{
+    if (numberOfThreads < 1)
+        numberOfThreads = 1;
+
+    // The workers keep pointers into m_workers, so it must not be resized once they are started.
+    m_workers.resize(numberOfThreads - 1);
+    for (unsigned i = 0; i < m_workers.size(); ++i) {
+        m_workers[i].pool = this;
+        m_workers[i].participant = i + 1;
+        m_workers[i].thread = 0;
+    }
+
+    for (auto& worker : m_workers)
+        worker.thread = createThread(AudioRenderThreadPool::workerEntry, &worker, "audio render worker");
+}
+
+AudioRenderThreadPool::~AudioRenderThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_shouldExit = true;
+        m_wake.notify_all();
+    }
+
+    for (auto& worker : m_workers) {
+        if (worker.thread)
+            waitForThreadCompletion(worker.thread);
+    }
+}
+
+void AudioRenderThreadPool::run(Job& job)
+{
+    if (m_workers.empty()) {
+        job.run(0);
+        return;
+    }
+
+    m_job = &job;
+    m_running.store(static_cast<unsigned>(m_workers.size()), std::memory_order_relaxed);
+
+    // Publishes m_job to the workers. Only take the mutex if one of them has gone to sleep;
+    // a sleeping worker increments m_sleeping before it checks the epoch, so it can't miss the wake up.
+    m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake.notify_all();
+    }
+
+    job.run(0);
+
+    // The job is finished, but workers may still be on their way out of it.
+    while (m_running.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    m_job = 0;
+}
+
+void AudioRenderThreadPool::workerEntry(void* threadData)
+{
+    Worker* worker = reinterpret_cast<Worker*>(threadData);
+    ASSERT(worker);
+    worker->pool->workerLoop(worker->participant);
+}
+
+void AudioRenderThreadPool::workerLoop(unsigned participant)
+{
+    pinCurrentThread(participant);
+
+    // The epoch the pool was constructed with, rather than the current one; run() may already have been called
+    // by the time this thread gets going, and that first job must not be missed.
+    unsigned epoch = 0;
+
+    for (;;) {
+        auto spinEnd = std::chrono::steady_clock::now() + WorkerSpinTime;
+        while (m_epoch.load(std::memory_order_acquire) == epoch && std::chrono::steady_clock::now() < spinEnd) {
+            if (m_shouldExit.load(std::memory_order_relaxed))
+                return;
+            std::this_thread::yield();
+        }
+
+        if (m_epoch.load(std::memory_order_acquire) == epoch) {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+            while (m_epoch.load(std::memory_order_seq_cst) == epoch && !m_shouldExit)
+                m_wake.wait(lock);
+            m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        if (m_shouldExit)
+            return;
+
+        epoch = m_epoch.load(std::memory_order_acquire);
+        m_job->run(participant);
+        m_running.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+} // namespace WebCore
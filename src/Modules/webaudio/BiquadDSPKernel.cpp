@@ -57,54 +57,13 @@ void BiquadDSPKernel::updateCoefficientsIfNecessary(ContextGraphLock& g, Context
             gain = biquadProcessor()->parameter3()->smoothedValue();
             detune = biquadProcessor()->parameter4()->smoothedValue();
         } else {
-            value1 = biquadProcessor()->parameter1()->value(r.contextPtr());
-            value2 = biquadProcessor()->parameter2()->value(r.contextPtr());
-            gain = biquadProcessor()->parameter3()->value(r.contextPtr());
-            detune = biquadProcessor()->parameter4()->value(r.contextPtr());
+            value1 = biquadProcessor()->parameter1()->value(r);
+            value2 = biquadProcessor()->parameter2()->value(r);
+            gain = biquadProcessor()->parameter3()->value(r);
+            detune = biquadProcessor()->parameter4()->value(r);
         }
 
-        // Convert from Hertz to normalized frequency 0 -> 1.
-        double nyquist = this->nyquist();
-        double normalizedFrequency = value1 / nyquist;
-
-        // Offset frequency by detune.
-        if (detune)
-            normalizedFrequency *= pow(2, detune / 1200);
-
-        // Configure the biquad with the new filter parameters for the appropriate type of filter.
-        switch (biquadProcessor()->type()) {
-        case BiquadProcessor::LowPass:
-            m_biquad.setLowpassParams(normalizedFrequency, value2);
-            break;
-
-        case BiquadProcessor::HighPass:
-            m_biquad.setHighpassParams(normalizedFrequency, value2);
-            break;
-
-        case BiquadProcessor::BandPass:
-            m_biquad.setBandpassParams(normalizedFrequency, value2);
-            break;
-
-        case BiquadProcessor::LowShelf:
-            m_biquad.setLowShelfParams(normalizedFrequency, gain);
-            break;
-
-        case BiquadProcessor::HighShelf:
-            m_biquad.setHighShelfParams(normalizedFrequency, gain);
-            break;
-
-        case BiquadProcessor::Peaking:
-            m_biquad.setPeakingParams(normalizedFrequency, value2, gain);
-            break;
-
-        case BiquadProcessor::Notch:
-            m_biquad.setNotchParams(normalizedFrequency, value2);
-            break;
-
-        case BiquadProcessor::Allpass:
-            m_biquad.setAllpassParams(normalizedFrequency, value2);
-            break;
-        }
+        biquadProcessor()->configureBiquad(m_biquad, value1, value2, gain, detune);
     }
 }
 
@@ -32,6 +32,12 @@ BiquadFilterNode::BiquadFilterNode(float sampleRate)
 {
     // Initially setup as lowpass filter.
     m_processor = std::move(std::unique_ptr<WebCore::AudioProcessor>(new BiquadProcessor(sampleRate, 1, false)));
+
+    addParam(frequency());
+    addParam(q());
+    addParam(gain());
+    addParam(detune());
+
     setNodeType(NodeTypeBiquadFilter);
 }
 
@@ -26,14 +26,20 @@
 #include "BiquadProcessor.h"
 
 #include "BiquadDSPKernel.h"
+#include <algorithm>
+#include <cmath>
 
 namespace WebCore {
-    
+
+// Frames between a-rate coefficient updates, short enough that sweeps sound smooth.
+const unsigned DefaultCoefficientInterval = 16;
+
 BiquadProcessor::BiquadProcessor(float sampleRate, size_t numberOfChannels, bool autoInitialize)
     : AudioDSPKernelProcessor(sampleRate, numberOfChannels)
     , m_type(LowPass)
     , m_filterCoefficientsDirty(true)
     , m_hasSampleAccurateValues(false)
+    , m_coefficientInterval(DefaultCoefficientInterval)
 {
     double nyquist = 0.5 * this->sampleRate();
 
@@ -58,7 +64,41 @@ AudioDSPKernel* BiquadProcessor::createKernel()
     return new BiquadDSPKernel(this);
 }
 
-void BiquadProcessor::checkForDirtyCoefficients(std::shared_ptr<AudioContext> c)
+void BiquadProcessor::initialize()
+{
+    if (isInitialized())
+        return;
+
+    AudioDSPKernelProcessor::initialize();
+
+    m_bank.reset(new BiquadBank(numberOfChannels()));
+    m_sources.resize(numberOfChannels());
+    m_destinations.resize(numberOfChannels());
+
+    m_frequencyValues.allocate(AudioNode::ProcessingSizeInFrames);
+    m_qValues.allocate(AudioNode::ProcessingSizeInFrames);
+    m_gainValues.allocate(AudioNode::ProcessingSizeInFrames);
+    m_detuneValues.allocate(AudioNode::ProcessingSizeInFrames);
+}
+
+void BiquadProcessor::uninitialize()
+{
+    if (!isInitialized())
+        return;
+
+    AudioDSPKernelProcessor::uninitialize();
+    m_bank.reset();
+}
+
+void BiquadProcessor::reset()
+{
+    AudioDSPKernelProcessor::reset();
+
+    if (m_bank)
+        m_bank->reset();
+}
+
+void BiquadProcessor::checkForDirtyCoefficients(ContextRenderLock& r)
 {
     // Deal with smoothing / de-zippering. Start out assuming filter parameters are not changing.
 
@@ -80,10 +120,10 @@ void BiquadProcessor::checkForDirtyCoefficients(std::shared_ptr<AudioContext> c)
             m_hasJustReset = false;
         } else {
             // Smooth all of the filter parameters. If they haven't yet converged to their target value then mark coefficients as dirty.
-            bool isStable1 = m_parameter1->smooth(c);
-            bool isStable2 = m_parameter2->smooth(c);
-            bool isStable3 = m_parameter3->smooth(c);
-            bool isStable4 = m_parameter4->smooth(c);
+            bool isStable1 = m_parameter1->smooth(r);
+            bool isStable2 = m_parameter2->smooth(r);
+            bool isStable3 = m_parameter3->smooth(r);
+            bool isStable4 = m_parameter4->smooth(r);
             if (!(isStable1 && isStable2 && isStable3 && isStable4))
                 m_filterCoefficientsDirty = true;
         }
@@ -97,11 +137,108 @@ void BiquadProcessor::process(ContextGraphLock& g, ContextRenderLock& r, const A
         return;
     }
         
-    checkForDirtyCoefficients(r.contextPtr());
-            
-    // For each channel of our input, process using the corresponding BiquadDSPKernel into the output channel.
-    for (unsigned i = 0; i < m_kernels.size(); ++i)
-        m_kernels[i]->process(g, r, source->channel(i)->data(), destination->channel(i)->mutableData(), framesToProcess);
+    bool channelCountMatches = source->numberOfChannels() == destination->numberOfChannels() && source->numberOfChannels() == m_bank->numberOfLanes();
+    ASSERT(channelCountMatches);
+    if (!channelCountMatches)
+        return;
+
+    checkForDirtyCoefficients(r);
+
+    if (m_hasSampleAccurateValues && m_coefficientInterval < framesToProcess && framesToProcess <= m_frequencyValues.size()) {
+        processSubBlocks(g, r, source, destination, framesToProcess);
+        return;
+    }
+
+    // Every channel is filtered with the same coefficients, so only the first kernel computes them.
+    BiquadDSPKernel* kernel = static_cast<BiquadDSPKernel*>(m_kernels[0].get());
+    kernel->updateCoefficients(g, r);
+
+    // Then all of the channels are filtered together, a channel in each lane of the bank.
+    for (unsigned i = 0; i < m_bank->numberOfLanes(); ++i) {
+        m_bank->setCoefficients(i, 0, kernel->biquad());
+        m_sources[i] = source->channel(i)->data();
+        m_destinations[i] = destination->channel(i)->mutableData();
+    }
+
+    m_bank->process(m_sources.data(), m_destinations.data(), framesToProcess);
+}
+
+void BiquadProcessor::processSubBlocks(ContextGraphLock& g, ContextRenderLock& r, const AudioBus* source, AudioBus* destination, size_t framesToProcess)
+{
+    unsigned numberOfValues = static_cast<unsigned>(framesToProcess);
+    m_parameter1->calculateSampleAccurateValues(g, r, m_frequencyValues.data(), numberOfValues);
+    m_parameter2->calculateSampleAccurateValues(g, r, m_qValues.data(), numberOfValues);
+    m_parameter3->calculateSampleAccurateValues(g, r, m_gainValues.data(), numberOfValues);
+    m_parameter4->calculateSampleAccurateValues(g, r, m_detuneValues.data(), numberOfValues);
+
+    // The coefficients are computed for the last frame of each interval, and the bank ramps to them across it.
+    for (size_t offset = 0; offset < framesToProcess; offset += m_coefficientInterval) {
+        size_t frames = std::min(static_cast<size_t>(m_coefficientInterval), framesToProcess - offset);
+        size_t last = offset + frames - 1;
+        configureBiquad(m_intervalBiquad, m_frequencyValues[last], m_qValues[last], m_gainValues[last], m_detuneValues[last]);
+
+        for (unsigned i = 0; i < m_bank->numberOfLanes(); ++i) {
+            m_bank->rampCoefficients(i, 0, m_intervalBiquad, frames);
+            m_sources[i] = source->channel(i)->data() + offset;
+            m_destinations[i] = destination->channel(i)->mutableData() + offset;
+        }
+
+        m_bank->process(m_sources.data(), m_destinations.data(), frames);
+    }
+
+    // The kernel's coefficients are the ones the bank's next k-rate quantum starts from.
+    static_cast<BiquadDSPKernel*>(m_kernels[0].get())->setCoefficients(m_intervalBiquad);
+}
+
+void BiquadProcessor::configureBiquad(Biquad& biquad, double frequency, double Q, double gain, double detune) const
+{
+    // Convert from Hertz to normalized frequency 0 -> 1.
+    double nyquist = 0.5 * sampleRate();
+    double normalizedFrequency = frequency / nyquist;
+
+    // Offset frequency by detune.
+    if (detune)
+        normalizedFrequency *= pow(2, detune / 1200);
+
+    // Configure the biquad with the new filter parameters for the appropriate type of filter.
+    switch (m_type) {
+    case LowPass:
+        biquad.setLowpassParams(normalizedFrequency, Q);
+        break;
+
+    case HighPass:
+        biquad.setHighpassParams(normalizedFrequency, Q);
+        break;
+
+    case BandPass:
+        biquad.setBandpassParams(normalizedFrequency, Q);
+        break;
+
+    case LowShelf:
+        biquad.setLowShelfParams(normalizedFrequency, gain);
+        break;
+
+    case HighShelf:
+        biquad.setHighShelfParams(normalizedFrequency, gain);
+        break;
+
+    case Peaking:
+        biquad.setPeakingParams(normalizedFrequency, Q, gain);
+        break;
+
+    case Notch:
+        biquad.setNotchParams(normalizedFrequency, Q);
+        break;
+
+    case Allpass:
+        biquad.setAllpassParams(normalizedFrequency, Q);
+        break;
+    }
+}
+
+void BiquadProcessor::setCoefficientInterval(unsigned frames)
+{
+    m_coefficientInterval = std::max(frames, 1u);
 }
 
 void BiquadProcessor::setType(FilterType type)
@@ -31,6 +31,7 @@
 #include "AudioNodeInput.h"
 #include "AudioNodeOutput.h"
 #include "Reverb.h"
+#include "UniformConvolver.h"
 #include <wtf/MainThread.h>
 
 using namespace std;
@@ -47,8 +48,9 @@ namespace WebCore {
 
 ConvolverNode::ConvolverNode(float sampleRate)
     : AudioNode(sampleRate)
-    , m_swapOnRender(false)
+    , m_pendingReverb(nullptr)
     , m_normalize(true)
+    , m_uniformPartitioning(false)
 {
     addInput(unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
     addOutput(unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 2)));
@@ -65,16 +67,18 @@ ConvolverNode::~ConvolverNode()
 
 void ConvolverNode::process(ContextGraphLock& g, ContextRenderLock& r, size_t framesToProcess)
 {
-    if (m_swapOnRender) {
-        m_reverb = std::move(m_newReverb);
-        m_buffer = m_newBuffer;
-        m_newBuffer.reset();
-        m_swapOnRender = false;
+    // Take the prepared reverb, and give the one it replaces to the reclaimer, so that nothing is destroyed here.
+    if (PreparedReverb* prepared = m_pendingReverb.exchange(nullptr, std::memory_order_acquire)) {
+        std::swap(m_reverb, prepared->reverb);
+        std::swap(m_uniformConvolver, prepared->uniformConvolver);
+        std::shared_ptr<void> retired = std::move(prepared->self);
+        if (r.context())
+            r.context()->retire(r, std::move(retired));
     }
     
     AudioBus* outputBus = output(0)->bus();
     
-    if (!isInitialized() || !m_reverb) {
+    if (!isInitialized() || (!m_reverb && !m_uniformConvolver)) {
         if (outputBus)
             outputBus->zero();
         return;
@@ -84,13 +88,15 @@ void ConvolverNode::process(ContextGraphLock& g, ContextRenderLock& r, size_t fr
     // Note that we can handle the case where nothing is connected to the input, in which case we'll just feed silence into the convolver.
     // FIXME:  If we wanted to get fancy we could try to factor in the 'tail time' and stop processing once the tail dies down if
     // we keep getting fed silence.
-    m_reverb->process(g, r, input(0)->bus(), outputBus, framesToProcess);
+    if (m_uniformConvolver)
+        m_uniformConvolver->process(input(0)->bus(), outputBus, framesToProcess);
+    else
+        m_reverb->process(g, r, input(0)->bus(), outputBus, framesToProcess);
 }
 
 void ConvolverNode::reset(std::shared_ptr<AudioContext>)
 {
-    m_newReverb.reset();
-    m_swapOnRender = true;
+    publishReverb(nullptr, nullptr);
 }
 
 void ConvolverNode::initialize()
@@ -106,7 +112,13 @@ void ConvolverNode::uninitialize()
     if (!isInitialized())
         return;
 
+    // Drop any reverb which was never swapped in.
+    if (PreparedReverb* prepared = m_pendingReverb.exchange(nullptr)) {
+        std::shared_ptr<PreparedReverb> release = std::move(prepared->self);
+    }
+
     m_reverb.reset();
+    m_uniformConvolver.reset();
     AudioNode::uninitialize();
 }
 
@@ -128,33 +140,56 @@ void ConvolverNode::setBuffer(std::shared_ptr<AudioBuffer> buffer)
     // This memory is simply used in the Reverb constructor and no reference to it is kept for later use in that class.
     AudioBus bufferBus(numberOfChannels, bufferLength, false);
     for (unsigned i = 0; i < numberOfChannels; ++i)
-        bufferBus.setChannelMemory(i, buffer->getChannelData(i)->data(), bufferLength);
+        bufferBus.setChannelMemory(i, const_cast<float*>(buffer->channelData(i)), bufferLength);
 
     bufferBus.setSampleRate(buffer->sampleRate());
 
-    // Create the reverb with the given impulse response.
-    const bool nonRealtimeForLargeBuffers = false;
-    m_newReverb = std::unique_ptr<Reverb>(new Reverb(&bufferBus, AudioNode::ProcessingSizeInFrames, MaxFFTSize, 2,
-                                                  nonRealtimeForLargeBuffers, m_normalize));
-    m_newBuffer = buffer;
-    m_swapOnRender = true;
+    // Create the reverb with the given impulse response. This is the expensive part, and it happens here on the
+    // main thread.
+    if (m_uniformPartitioning) {
+        // The channels of the response are paths between a stereo input and the stereo output, as for Reverb.
+        float scale = m_normalize ? Reverb::calculateNormalizationScale(&bufferBus) : 1;
+        publishReverb(nullptr, std::unique_ptr<UniformConvolver>(new UniformConvolver(&bufferBus, UniformConvolver::stereoPaths(numberOfChannels), 2, 2,
+                                                                                      UniformConvolver::DefaultPartitionSize, scale)));
+    } else {
+        // The stages far into the impulse response are processed by the reverb's background threads,
+        // leaving the audio thread only the early part of the response to convolve in each render quantum.
+        const bool useBackgroundThreads = true;
+        publishReverb(std::unique_ptr<Reverb>(new Reverb(&bufferBus, AudioNode::ProcessingSizeInFrames, MaxFFTSize, 2,
+                                                         useBackgroundThreads, m_normalize)), nullptr);
+    }
+    m_buffer = buffer;
 }
 
 std::shared_ptr<AudioBuffer> ConvolverNode::buffer()
 {
-    if (m_swapOnRender) {
-        return m_newBuffer;
-    }
     return m_buffer;
 }
 
+void ConvolverNode::publishReverb(std::unique_ptr<Reverb> reverb, std::unique_ptr<UniformConvolver> uniformConvolver)
+{
+    std::shared_ptr<PreparedReverb> prepared = std::make_shared<PreparedReverb>();
+    prepared->reverb = std::move(reverb);
+    prepared->uniformConvolver = std::move(uniformConvolver);
+    prepared->self = prepared;
+
+    // A reverb the audio thread hasn't taken yet is replaced, and so was never seen by the audio thread.
+    if (PreparedReverb* replaced = m_pendingReverb.exchange(prepared.get(), std::memory_order_acq_rel)) {
+        std::shared_ptr<PreparedReverb> release = std::move(replaced->self);
+    }
+}
+
 double ConvolverNode::tailTime() const
 {
+    if (m_uniformConvolver)
+        return m_uniformConvolver->impulseResponseLength() / static_cast<double>(sampleRate());
     return m_reverb ? m_reverb->impulseResponseLength() / static_cast<double>(sampleRate()) : 0;
 }
 
 double ConvolverNode::latencyTime() const
 {
+    if (m_uniformConvolver)
+        return m_uniformConvolver->latencyFrames() / static_cast<double>(sampleRate());
     return m_reverb ? m_reverb->latencyFrames() / static_cast<double>(sampleRate()) : 0;
 }
 
@@ -27,7 +27,9 @@
 
 #include "AudioNode.h"
 #include "AudioUtilities.h"
+#include "VectorMath.h"
 #include <algorithm>
+#include <cmath>
 
 using namespace std;
 
@@ -35,129 +37,111 @@ namespace WebCore {
 
 const float SmoothingTimeConstant = 0.020f; // 20ms
 
+// Once the smoothed delay is this close to the desired delay, in frames, it is taken as arrived, and the
+// delay line is read with a constant delay.
+const double SettledDelayFrames = 1e-4;
+
+// Compute the length of the buffer needed to handle a max delay of |maxDelayTime|. One is
+// added to handle the case where the actual delay equals the maximum delay.
+static size_t framesForMaxDelay(double maxDelayTime, double sampleRate)
+{
+    return maxDelayTime > 0 ? 1 + AudioUtilities::timeToSampleFrame(maxDelayTime, sampleRate) : 0;
+}
+
 DelayDSPKernel::DelayDSPKernel(DelayProcessor* processor)
     : AudioDSPKernel(processor)
-    , m_writeIndex(0)
+    , m_delayLine(processor ? framesForMaxDelay(processor->maxDelayTime(), processor->sampleRate()) : 0)
+    , m_maxDelayTime(processor ? processor->maxDelayTime() : 0)
+    , m_currentDelayTime(0)
+    , m_smoothingRate(0)
     , m_firstTime(true)
+    , m_desiredDelayFrames(0)
     , m_delayTimes(AudioNode::ProcessingSizeInFrames)
 {
     ASSERT(processor && processor->sampleRate() > 0);
     if (!(processor && processor->sampleRate() > 0))
         return;
 
-    m_maxDelayTime = processor->maxDelayTime();
     ASSERT(m_maxDelayTime >= 0);
-    if (m_maxDelayTime < 0)
-        return;
-
-    m_buffer.allocate(bufferLengthForDelay(m_maxDelayTime, processor->sampleRate()));
-    m_buffer.zero();
-
     m_smoothingRate = AudioUtilities::discreteTimeConstantForSampleRate(SmoothingTimeConstant, processor->sampleRate());
 }
 
 DelayDSPKernel::DelayDSPKernel(double maxDelayTime, float sampleRate)
     : AudioDSPKernel(sampleRate)
+    , m_delayLine(framesForMaxDelay(maxDelayTime, sampleRate))
     , m_maxDelayTime(maxDelayTime)
-    , m_writeIndex(0)
+    , m_currentDelayTime(0)
+    , m_smoothingRate(0)
     , m_firstTime(true)
+    , m_desiredDelayFrames(0)
+    , m_delayTimes(AudioNode::ProcessingSizeInFrames)
 {
     ASSERT(maxDelayTime > 0.0);
-    if (maxDelayTime <= 0.0)
-        return;
-
-    size_t bufferLength = bufferLengthForDelay(maxDelayTime, sampleRate);
-    ASSERT(bufferLength);
-    if (!bufferLength)
-        return;
-
-    m_buffer.allocate(bufferLength);
-    m_buffer.zero();
-
     m_smoothingRate = AudioUtilities::discreteTimeConstantForSampleRate(SmoothingTimeConstant, sampleRate);
 }
 
-size_t DelayDSPKernel::bufferLengthForDelay(double maxDelayTime, double sampleRate) const
-{
-    // Compute the length of the buffer needed to handle a max delay of |maxDelayTime|. One is
-    // added to handle the case where the actual delay equals the maximum delay.
-    return 1 + AudioUtilities::timeToSampleFrame(maxDelayTime, sampleRate);
-}
-
 void DelayDSPKernel::process(ContextGraphLock& g, ContextRenderLock& r, const float* source, float* destination, size_t framesToProcess)
 {
-    size_t bufferLength = m_buffer.size();
-    float* buffer = m_buffer.data();
-
-    ASSERT(bufferLength);
-    if (!bufferLength)
+    ASSERT(m_delayLine.maxDelayFrames());
+    if (!m_delayLine.maxDelayFrames())
         return;
 
     ASSERT(source && destination);
     if (!source || !destination)
         return;
 
+    ASSERT(framesToProcess <= m_delayTimes.size());
+    if (framesToProcess > m_delayTimes.size())
+        return;
+
     float sampleRate = this->sampleRate();
-    double delayTime = 0;
-    float* delayTimes = m_delayTimes.data();
+    float* delayFrames = m_delayTimes.data();
     double maxTime = maxDelayTime();
 
-    bool sampleAccurate = delayProcessor() && delayProcessor()->delayTime()->hasSampleAccurateValues();
-
-    if (sampleAccurate)
-        delayProcessor()->delayTime()->calculateSampleAccurateValues(g, r, delayTimes, framesToProcess);
-    else {
-        delayTime = delayProcessor() ? delayProcessor()->delayTime()->finalValue(g, r) : m_desiredDelayFrames / sampleRate;
+    if (delayProcessor())
+        m_delayLine.setInterpolation(delayProcessor()->interpolation());
 
-        // Make sure the delay time is in a valid range.
-        delayTime = min(maxTime, delayTime);
-        delayTime = max(0.0, delayTime);
+    bool sampleAccurate = delayProcessor() && delayProcessor()->delayTime()->hasSampleAccurateValues();
 
-        if (m_firstTime) {
-            m_currentDelayTime = delayTime;
-            m_firstTime = false;
-        }
+    if (sampleAccurate) {
+        // The delay line clamps the delays to the range it holds.
+        delayProcessor()->delayTime()->calculateSampleAccurateValues(g, r, delayFrames, framesToProcess);
+        VectorMath::vsmul(delayFrames, 1, &sampleRate, delayFrames, 1, framesToProcess);
+        m_currentDelayTime = min(maxTime, max(0.0, static_cast<double>(delayFrames[framesToProcess - 1]) / sampleRate));
+        m_delayLine.process(source, destination, framesToProcess, delayFrames);
+        return;
     }
 
-    for (unsigned i = 0; i < framesToProcess; ++i) {
-        if (sampleAccurate) {
-            delayTime = delayTimes[i];
-            delayTime = std::min(maxTime, delayTime);
-            delayTime = std::max(0.0, delayTime);
-            m_currentDelayTime = delayTime;
-        } else {
-            // Approach desired delay time.
-            m_currentDelayTime += (delayTime - m_currentDelayTime) * m_smoothingRate;
-        }
+    double delayTime = delayProcessor() ? delayProcessor()->delayTime()->finalValue(g, r) : m_desiredDelayFrames / sampleRate;
 
-        double desiredDelayFrames = m_currentDelayTime * sampleRate;
+    // Make sure the delay time is in a valid range.
+    delayTime = min(maxTime, delayTime);
+    delayTime = max(0.0, delayTime);
 
-        double readPosition = m_writeIndex + bufferLength - desiredDelayFrames;
-        if (readPosition >= bufferLength)
-            readPosition -= bufferLength;
-
-        // Linearly interpolate in-between delay times.
-        int readIndex1 = static_cast<int>(readPosition);
-        int readIndex2 = (readIndex1 + 1) % bufferLength;
-        double interpolationFactor = readPosition - readIndex1;
-
-        double input = static_cast<float>(*source++);
-        buffer[m_writeIndex] = static_cast<float>(input);
-        m_writeIndex = (m_writeIndex + 1) % bufferLength;
-
-        double sample1 = buffer[readIndex1];
-        double sample2 = buffer[readIndex2];
+    if (m_firstTime) {
+        m_currentDelayTime = delayTime;
+        m_firstTime = false;
+    }
 
-        double output = (1.0 - interpolationFactor) * sample1 + interpolationFactor * sample2;
+    if (fabs(delayTime - m_currentDelayTime) * sampleRate < SettledDelayFrames) {
+        m_currentDelayTime = delayTime;
+        m_delayLine.process(source, destination, framesToProcess, delayTime * sampleRate);
+        return;
+    }
 
-        *destination++ = static_cast<float>(output);
+    // Approach desired delay time.
+    for (size_t i = 0; i < framesToProcess; ++i) {
+        m_currentDelayTime += (delayTime - m_currentDelayTime) * m_smoothingRate;
+        delayFrames[i] = static_cast<float>(m_currentDelayTime * sampleRate);
     }
+
+    m_delayLine.process(source, destination, framesToProcess, delayFrames);
 }
 
 void DelayDSPKernel::reset()
 {
     m_firstTime = true;
-    m_buffer.zero();
+    m_delayLine.reset();
 }
 
 double DelayDSPKernel::tailTime() const
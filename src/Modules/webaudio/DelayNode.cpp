@@ -38,6 +38,7 @@ DelayNode::DelayNode(float sampleRate, double maxDelayTime, ExceptionCode& ec)
         return;
     }
     m_processor = std::move(std::unique_ptr<WebCore::AudioProcessor>(new DelayProcessor(sampleRate, 1, maxDelayTime)));
+    addParam(delayProcessor()->delayTime());
     setNodeType(NodeTypeDelay);
 }
 
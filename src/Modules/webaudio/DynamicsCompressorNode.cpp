@@ -52,6 +52,12 @@ DynamicsCompressorNode::DynamicsCompressorNode(float sampleRate)
     m_reduction = make_shared<AudioParam>("reduction", 0, -20, 0);
     m_attack = make_shared<AudioParam>("attack", 0.003, 0, 1);
     m_release = make_shared<AudioParam>("release", 0.250, 0, 1);
+    addParam(m_threshold);
+    addParam(m_knee);
+    addParam(m_ratio);
+    addParam(m_reduction);
+    addParam(m_attack);
+    addParam(m_release);
 
     initialize();
 }
@@ -66,11 +72,11 @@ void DynamicsCompressorNode::process(ContextGraphLock& g, ContextRenderLock& r,
     AudioBus* outputBus = output(0)->bus();
     ASSERT(outputBus);
 
-    float threshold = m_threshold->value(r.contextPtr());
-    float knee = m_knee->value(r.contextPtr());
-    float ratio = m_ratio->value(r.contextPtr());
-    float attack = m_attack->value(r.contextPtr());
-    float release = m_release->value(r.contextPtr());
+    float threshold = m_threshold->value(r);
+    float knee = m_knee->value(r);
+    float ratio = m_ratio->value(r);
+    float attack = m_attack->value(r);
+    float release = m_release->value(r);
 
     m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamThreshold, threshold);
     m_dynamicsCompressor->setParameterValue(DynamicsCompressor::ParamKnee, knee);
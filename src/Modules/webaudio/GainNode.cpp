@@ -38,6 +38,7 @@ GainNode::GainNode(float sampleRate)
     , m_sampleAccurateGainValues(AudioNode::ProcessingSizeInFrames) // FIXME: can probably share temp buffer in context
 {
     m_gain = std::make_shared<AudioParam>("gain", 1.0, 0.0, 1.0);
+    addParam(m_gain);
 
     addInput(std::unique_ptr<AudioNodeInput>(new AudioNodeInput(this)));
     addOutput(std::unique_ptr<AudioNodeOutput>(new AudioNodeOutput(this, 1)));
@@ -71,7 +72,7 @@ void GainNode::process(ContextGraphLock& g, ContextRenderLock& r, size_t framesT
             }
         } else {
             // Apply the gain with de-zippering into the output bus.
-            outputBus->copyWithGainFrom(*inputBus, &m_lastGain, gain()->value(r.contextPtr()));
+            outputBus->copyWithGainFrom(*inputBus, &m_lastGain, gain()->value(r));
         }
     }
 }
@@ -110,7 +110,7 @@ void OfflineAudioDestinationNode::offlineRender()
         
     // Synchronize with HRTFDatabaseLoader.
     // The database must be loaded before we can proceed.
-    auto loader = HRTFDatabaseLoader::loader();
+    auto loader = HRTFDatabaseLoader::loader(sampleRate());
     ASSERT(loader);
     if (!loader)
         return;
@@ -131,7 +131,7 @@ void OfflineAudioDestinationNode::offlineRender()
         
         for (unsigned channelIndex = 0; channelIndex < numberOfChannels; ++channelIndex) {
             const float* source = m_renderBus->channel(channelIndex)->data();
-            float* destination = m_renderTarget->getChannelData(channelIndex)->data();
+            float* destination = m_renderTarget->mutableChannelData(channelIndex);
             memcpy(destination + n, source, sizeof(float) * framesAvailableToCopy);
         }
         
@@ -32,6 +32,7 @@
 #include "VectorMath.h"
 #include "WaveTable.h"
 #include <algorithm>
+#include <stdint.h>
 #include <wtf/MathExtras.h>
 
 using namespace std;
@@ -40,11 +41,6 @@ namespace WebCore {
 
 using namespace VectorMath;
 
-std::shared_ptr<WaveTable> OscillatorNode::s_waveTableSine = 0;
-std::shared_ptr<WaveTable> OscillatorNode::s_waveTableSquare = 0;
-std::shared_ptr<WaveTable> OscillatorNode::s_waveTableSawtooth = 0;
-std::shared_ptr<WaveTable> OscillatorNode::s_waveTableTriangle = 0;
-
 OscillatorNode::OscillatorNode(ContextRenderLock& r, float sampleRate)
     : AudioScheduledSourceNode(sampleRate)
     , m_type(SINE)
@@ -60,6 +56,9 @@ OscillatorNode::OscillatorNode(ContextRenderLock& r, float sampleRate)
     // Default to no detuning.
     m_detune = std::make_shared<AudioParam>("detune", 0, -4800, 4800);
 
+    addParam(m_frequency);
+    addParam(m_detune);
+
     // Sets up default wavetable.
     ExceptionCode ec;
     setType(r, m_type, ec);
@@ -77,32 +76,8 @@ OscillatorNode::~OscillatorNode()
 
 void OscillatorNode::setType(ContextRenderLock& r, unsigned short type, ExceptionCode& ec)
 {
-    std::shared_ptr<WaveTable> waveTable;
-    float sampleRate = this->sampleRate();
-
-    switch (type) {
-    case SINE:
-        if (!s_waveTableSine)
-            s_waveTableSine = WaveTable::createSine(sampleRate);
-        waveTable = s_waveTableSine;
-        break;
-    case SQUARE:
-        if (!s_waveTableSquare)
-            s_waveTableSquare = WaveTable::createSquare(sampleRate);
-        waveTable = s_waveTableSquare;
-        break;
-    case SAWTOOTH:
-        if (!s_waveTableSawtooth)
-            s_waveTableSawtooth = WaveTable::createSawtooth(sampleRate);
-        waveTable = s_waveTableSawtooth;
-        break;
-    case TRIANGLE:
-        if (!s_waveTableTriangle)
-            s_waveTableTriangle = WaveTable::createTriangle(sampleRate);
-        waveTable = s_waveTableTriangle;
-        break;
-    case CUSTOM:
-    default:
+    std::shared_ptr<WaveTable> waveTable = WaveTable::sharedWaveTable(type, sampleRate());
+    if (!waveTable) {
         // Throw exception for invalid types, including CUSTOM since setWaveTable() method must be
         // called explicitly.
         ec = NOT_SUPPORTED_ERR;
@@ -132,8 +107,6 @@ bool OscillatorNode::calculateSampleAccuratePhaseIncrements(ContextGraphLock& g,
 
     float finalScale = m_waveTable->rateScale();
     
-    std::shared_ptr<AudioContext> c = r.contextPtr();
-
     if (m_frequency->hasSampleAccurateValues()) {
         hasSampleAccurateValues = true;
         hasFrequencyChanges = true;
@@ -143,7 +116,7 @@ bool OscillatorNode::calculateSampleAccuratePhaseIncrements(ContextGraphLock& g,
         m_frequency->calculateSampleAccurateValues(g, r, phaseIncrements, framesToProcess);
     } else {
         // Handle ordinary parameter smoothing/de-zippering if there are no scheduled changes.
-        m_frequency->smooth(c);
+        m_frequency->smooth(r);
         float frequency = m_frequency->smoothedValue();
         finalScale *= frequency;
     }
@@ -167,7 +140,7 @@ bool OscillatorNode::calculateSampleAccuratePhaseIncrements(ContextGraphLock& g,
         }
     } else {
         // Handle ordinary parameter smoothing/de-zippering if there are no scheduled changes.
-        m_detune->smooth(c);
+        m_detune->smooth(r);
         float detune = m_detune->smoothedValue();
         float detuneScale = powf(2, detune / 1200);
         finalScale *= detuneScale;
@@ -234,7 +207,14 @@ void OscillatorNode::process(ContextGraphLock& g, ContextRenderLock& r, size_t f
     float frequency = 0;
     float* higherWaveData = 0;
     float* lowerWaveData = 0;
-    float tableInterpolationFactor;
+    float tableInterpolationFactor = 0;
+
+    float* phaseIncrements = m_phaseIncrements.data();
+    size_t n = nonSilentFramesToProcess;
+
+    // Below the limit, all the tables the frequencies could select hold the same waveform, so one is read
+    // without interpolating, and it needn't be chosen again as the frequency changes. A sine is always below it.
+    bool usesSingleTable;
 
     if (!hasSampleAccurateValues) {
         frequency = m_frequency->smoothedValue();
@@ -242,52 +222,60 @@ void OscillatorNode::process(ContextGraphLock& g, ContextRenderLock& r, size_t f
         float detuneScale = powf(2, detune / 1200);
         frequency *= detuneScale;
         m_waveTable->waveDataForFundamentalFrequency(frequency, lowerWaveData, higherWaveData, tableInterpolationFactor);
+        usesSingleTable = fabsf(frequency) < m_waveTable->unculledFrequencyLimit();
+    } else {
+        float maxIncrement;
+        vmaxmgv(phaseIncrements, 1, &maxIncrement, n);
+        usesSingleTable = invRateScale * maxIncrement < m_waveTable->unculledFrequencyLimit();
+        if (usesSingleTable)
+            m_waveTable->waveDataForFundamentalFrequency(0, lowerWaveData, higherWaveData, tableInterpolationFactor);
     }
 
-    float incr = frequency * rateScale;
-    float* phaseIncrements = m_phaseIncrements.data();
+    if (usesSingleTable)
+        lowerWaveData = 0;
 
-    unsigned readIndexMask = waveTableSize - 1;
+    float incr = frequency * rateScale;
 
     // Start rendering at the correct offset.
     destP += quantumFrameOffset;
-    int n = nonSilentFramesToProcess;
 
-    while (n--) {
-        unsigned readIndex = static_cast<unsigned>(virtualReadIndex);
-        unsigned readIndex2 = readIndex + 1;
-
-        // Contain within valid range.
-        readIndex = readIndex & readIndexMask;
-        readIndex2 = readIndex2 & readIndexMask;
+    // Render runs of frames with the same phase increment, choosing the tables again only when the frequency changes.
+    bool hasWaveData = !hasSampleAccurateValues;
+    uint32_t phase = m_waveTable->fixedPointPhase(virtualReadIndex);
+    uint32_t phaseIncrement = m_waveTable->fixedPointPhase(incr);
+    for (size_t i = 0; i < n; ) {
+        size_t run = n - i;
 
         if (hasSampleAccurateValues) {
-            incr = *phaseIncrements++;
-
-            frequency = invRateScale * incr;
-            m_waveTable->waveDataForFundamentalFrequency(frequency, lowerWaveData, higherWaveData, tableInterpolationFactor);
+            if (!hasWaveData || phaseIncrements[i] != incr) {
+                incr = phaseIncrements[i];
+                if (!usesSingleTable) {
+                    frequency = invRateScale * incr;
+                    m_waveTable->waveDataForFundamentalFrequency(frequency, lowerWaveData, higherWaveData, tableInterpolationFactor);
+                }
+                phaseIncrement = m_waveTable->fixedPointPhase(incr);
+                hasWaveData = true;
+            }
+
+            run = 1;
+            while (i + run < n && phaseIncrements[i + run] == incr)
+                ++run;
         }
 
-        float sample1Lower = lowerWaveData[readIndex];
-        float sample2Lower = lowerWaveData[readIndex2];
-        float sample1Higher = higherWaveData[readIndex];
-        float sample2Higher = higherWaveData[readIndex2];
+        // A frequency changing every frame, as it does along a ramp, is read a frame at a time.
+        if (run == 1) {
+            destP[i] = m_waveTable->readWaveData(higherWaveData, lowerWaveData, tableInterpolationFactor, phase);
+            phase += phaseIncrement;
+        } else
+            m_waveTable->renderWaveData(higherWaveData, lowerWaveData, tableInterpolationFactor, phase, phaseIncrement, destP + i, run);
 
-        // Linearly interpolate within each table (lower and higher).
-        float interpolationFactor = static_cast<float>(virtualReadIndex) - readIndex;
-        float sampleHigher = (1 - interpolationFactor) * sample1Higher + interpolationFactor * sample2Higher;
-        float sampleLower = (1 - interpolationFactor) * sample1Lower + interpolationFactor * sample2Lower;
-
-        // Then interpolate between the two tables.
-        float sample = (1 - tableInterpolationFactor) * sampleHigher + tableInterpolationFactor * sampleLower;
-
-        *destP++ = sample;
-
-        // Increment virtual read index and wrap virtualReadIndex into the range 0 -> waveTableSize.
-        virtualReadIndex += incr;
-        virtualReadIndex -= floor(virtualReadIndex * invWaveTableSize) * waveTableSize;
+        virtualReadIndex += static_cast<double>(incr) * run;
+        i += run;
     }
 
+    // Wrap virtualReadIndex into the range 0 -> waveTableSize.
+    virtualReadIndex -= floor(virtualReadIndex * invWaveTableSize) * waveTableSize;
+
     m_virtualReadIndex = virtualReadIndex;
 
     outputBus->clearSilentFlag();
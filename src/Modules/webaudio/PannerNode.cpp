@@ -54,6 +54,8 @@ PannerNode::PannerNode(float sampleRate)
     
     m_distanceGain = std::make_shared<AudioParam>("distanceGain", 1.0, 0.0, 1.0);
     m_coneGain = std::make_shared<AudioParam>("coneGain", 1.0, 0.0, 1.0);
+    addParam(m_distanceGain);
+    addParam(m_coneGain);
 
     m_position = FloatPoint3D(0, 0, 0);
     m_orientation = FloatPoint3D(1, 0, 0);
@@ -191,12 +193,16 @@ void PannerNode::setDistanceModel(unsigned short model, ExceptionCode& ec)
 void PannerNode::getAzimuthElevation(ContextRenderLock& r, double* outAzimuth, double* outElevation)
 {
     // FIXME: we should cache azimuth and elevation (if possible), so we only re-calculate if a change has been made.
+    azimuthElevation(m_position, listener(r), outAzimuth, outElevation);
+}
 
+void PannerNode::azimuthElevation(const FloatPoint3D& position, AudioListener* listener, double* outAzimuth, double* outElevation)
+{
     double azimuth = 0.0;
 
     // Calculate the source-listener vector
-    FloatPoint3D listenerPosition = listener(r)->position();
-    FloatPoint3D sourceListener = m_position - listenerPosition;
+    FloatPoint3D listenerPosition = listener->position();
+    FloatPoint3D sourceListener = position - listenerPosition;
 
     if (sourceListener.isZero()) {
         // degenerate case if source and listener are at the same point
@@ -208,8 +214,8 @@ void PannerNode::getAzimuthElevation(ContextRenderLock& r, double* outAzimuth, d
     sourceListener.normalize();
 
     // Align axes
-    FloatPoint3D listenerFront = listener(r)->orientation();
-    FloatPoint3D listenerUp = listener(r)->upVector();
+    FloatPoint3D listenerFront = listener->orientation();
+    FloatPoint3D listenerUp = listener->upVector();
     FloatPoint3D listenerRight = listenerFront.cross(listenerUp);
     listenerRight.normalize();
 
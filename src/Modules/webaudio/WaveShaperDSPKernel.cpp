@@ -25,47 +25,172 @@
 #include "LabSoundConfig.h"
 #include "WaveShaperDSPKernel.h"
 
+#include "AudioNode.h"
 #include "WaveShaperProcessor.h"
 #include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
 namespace WebCore {
 
+WaveShaperDSPKernel::WaveShaperDSPKernel(WaveShaperProcessor* processor)
+    : AudioDSPKernel(processor)
+{
+    if (processor->oversample() != WaveShaperProcessor::OverSampleNone)
+        lazyInitializeOversampling();
+}
+
+void WaveShaperDSPKernel::lazyInitializeOversampling()
+{
+    if (!m_tempBuffer) {
+        m_tempBuffer.reset(new AudioFloatArray(AudioNode::ProcessingSizeInFrames * 2));
+        m_tempBuffer2.reset(new AudioFloatArray(AudioNode::ProcessingSizeInFrames * 4));
+        m_upSampler.reset(new UpSampler(AudioNode::ProcessingSizeInFrames));
+        m_downSampler.reset(new DownSampler(AudioNode::ProcessingSizeInFrames * 2));
+        m_upSampler2.reset(new UpSampler(AudioNode::ProcessingSizeInFrames * 2));
+        m_downSampler2.reset(new DownSampler(AudioNode::ProcessingSizeInFrames * 4));
+    }
+}
+
 void WaveShaperDSPKernel::process(ContextGraphLock& g, ContextRenderLock&, const float* source, float* destination, size_t framesToProcess)
 {
     ASSERT(source && destination && waveShaperProcessor());
 
+    // Oversampled blocks must fit the resamplers; anything longer is shaped at the normal rate.
+    bool canOversample = m_tempBuffer && framesToProcess <= AudioNode::ProcessingSizeInFrames;
+
+    switch (canOversample ? waveShaperProcessor()->oversample() : WaveShaperProcessor::OverSampleNone) {
+    case WaveShaperProcessor::OverSampleNone:
+        processCurve(source, destination, framesToProcess);
+        break;
+    case WaveShaperProcessor::OverSample2x:
+        processCurve2x(source, destination, framesToProcess);
+        break;
+    case WaveShaperProcessor::OverSample4x:
+        processCurve4x(source, destination, framesToProcess);
+        break;
+    }
+}
+
+void WaveShaperDSPKernel::processCurve(const float* source, float* destination, size_t framesToProcess)
+{
     std::shared_ptr<std::vector<float>> curve = waveShaperProcessor()->curve();
-    if (!curve) {
+    if (!curve || curve->empty()) {
         // Act as "straight wire" pass-through if no curve is set.
-        memcpy(destination, source, sizeof(float) * framesToProcess);
+        if (source != destination)
+            memcpy(destination, source, sizeof(float) * framesToProcess);
         return;
     }
 
-    float* curveData = &(*curve)[0];
-    int curveLength = (*curve).size();
+    const float* curveData = curve->data();
+    int curveLength = static_cast<int>(curve->size());
+    int lastIndex = curveLength - 1;
 
-    ASSERT(curveData);
+    // Map the input range -1 -> +1 onto the curve from end to end, and interpolate linearly between its points.
+    // Input outside of the nominal range takes the curve's end values. NaN takes its first.
+    const float scale = 0.5f * lastIndex;
+    const float maxIndex = static_cast<float>(lastIndex);
+    size_t i = 0;
 
-    if (!curveData || !curveLength) {
-        memcpy(destination, source, sizeof(float) * framesToProcess);
-        return;
+#ifdef __SSE2__
+    {
+        const __m128 one = _mm_set1_ps(1);
+        const __m128 scales = _mm_set1_ps(scale);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 maxIndices = _mm_set1_ps(maxIndex);
+
+        for (; i + 4 <= framesToProcess; i += 4) {
+            __m128 virtualIndex = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(source + i), one), scales);
+            virtualIndex = _mm_min_ps(_mm_max_ps(virtualIndex, zero), maxIndices);
+            __m128i index = _mm_cvttps_epi32(virtualIndex);
+            __m128 interpolation = _mm_sub_ps(virtualIndex, _mm_cvtepi32_ps(index));
+
+            int32_t indices[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), index);
+            __m128 value1 = _mm_setr_ps(curveData[indices[0]], curveData[indices[1]], curveData[indices[2]], curveData[indices[3]]);
+            __m128 value2 = _mm_setr_ps(curveData[indices[0] + (indices[0] < lastIndex)], curveData[indices[1] + (indices[1] < lastIndex)],
+                                        curveData[indices[2] + (indices[2] < lastIndex)], curveData[indices[3] + (indices[3] < lastIndex)]);
+            _mm_storeu_ps(destination + i, _mm_add_ps(value1, _mm_mul_ps(interpolation, _mm_sub_ps(value2, value1))));
+        }
+    }
+#endif
+
+    for (; i < framesToProcess; ++i) {
+        float virtualIndex = min(maxIndex, max(0.0f, (source[i] + 1) * scale));
+        int index1 = static_cast<int>(virtualIndex);
+        int index2 = index1 + (index1 < lastIndex);
+        float interpolation = virtualIndex - index1;
+        destination[i] = curveData[index1] + interpolation * (curveData[index2] - curveData[index1]);
     }
+}
+
+void WaveShaperDSPKernel::processCurve2x(const float* source, float* destination, size_t framesToProcess)
+{
+    float* tempP = m_tempBuffer->data();
+
+    m_upSampler->process(source, tempP, framesToProcess);
+
+    // Process at 2x up-sampled rate.
+    processCurve(tempP, tempP, framesToProcess * 2);
+
+    m_downSampler->process(tempP, destination, framesToProcess * 2);
+}
+
+void WaveShaperDSPKernel::processCurve4x(const float* source, float* destination, size_t framesToProcess)
+{
+    float* tempP = m_tempBuffer->data();
+    float* tempP2 = m_tempBuffer2->data();
 
-    // Apply waveshaping curve.
-    for (unsigned i = 0; i < framesToProcess; ++i) {
-        const float input = source[i];
+    m_upSampler->process(source, tempP, framesToProcess);
+    m_upSampler2->process(tempP, tempP2, framesToProcess * 2);
 
-        // Calculate an index based on input -1 -> +1 with 0 being at the center of the curve data.
-        int index = (curveLength * (input + 1)) / 2;
+    // Process at 4x up-sampled rate.
+    processCurve(tempP2, tempP2, framesToProcess * 4);
 
-        // Clip index to the input range of the curve.
-        // This takes care of input outside of nominal range -1 -> +1
-        index = max(index, 0);
-        index = min(index, curveLength - 1);
-        destination[i] = curveData[index];
+    m_downSampler2->process(tempP2, tempP, framesToProcess * 4);
+    m_downSampler->process(tempP, destination, framesToProcess * 2);
+}
+
+void WaveShaperDSPKernel::reset()
+{
+    if (m_upSampler) {
+        m_upSampler->reset();
+        m_downSampler->reset();
+        m_upSampler2->reset();
+        m_downSampler2->reset();
     }
 }
 
+double WaveShaperDSPKernel::latencyTime() const
+{
+    // In frames at the normal rate, the delay of each resampler in the chain.
+    double latencyFrames = 0;
+    if (!m_upSampler)
+        return 0;
+
+    switch (waveShaperProcessor()->oversample()) {
+    case WaveShaperProcessor::OverSampleNone:
+        break;
+    case WaveShaperProcessor::OverSample2x:
+        latencyFrames += m_upSampler->latencyFrames();
+        latencyFrames += m_downSampler->latencyFrames();
+        break;
+    case WaveShaperProcessor::OverSample4x:
+        // Account for the delays of the second stage, at twice the normal rate.
+        latencyFrames += m_upSampler->latencyFrames();
+        latencyFrames += m_upSampler2->latencyFrames() / 2.0;
+        latencyFrames += m_downSampler2->latencyFrames() / 2.0;
+        latencyFrames += m_downSampler->latencyFrames();
+        break;
+    }
+
+    return latencyFrames / sampleRate();
+}
+
 } // namespace WebCore
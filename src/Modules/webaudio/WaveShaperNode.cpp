@@ -45,4 +45,14 @@ std::shared_ptr<std::vector<float>> WaveShaperNode::curve()
     return waveShaperProcessor()->curve();
 }
 
+void WaveShaperNode::setOversample(ContextRenderLock& r, WaveShaperProcessor::OverSampleType oversample)
+{
+    waveShaperProcessor()->setOversample(r, oversample);
+}
+
+WaveShaperProcessor::OverSampleType WaveShaperNode::oversample()
+{
+    return waveShaperProcessor()->oversample();
+}
+
 } // namespace WebCore
@@ -31,6 +31,7 @@ namespace WebCore {
     
 WaveShaperProcessor::WaveShaperProcessor(float sampleRate, size_t numberOfChannels)
     : AudioDSPKernelProcessor(sampleRate, numberOfChannels)
+    , m_oversample(OverSampleNone)
 {
 }
 
@@ -52,6 +53,20 @@ void WaveShaperProcessor::setCurve(ContextRenderLock& r, std::shared_ptr<std::ve
     m_curve = curve;
 }
 
+void WaveShaperProcessor::setOversample(ContextRenderLock& r, OverSampleType oversample)
+{
+    // can't change the resamplers whilst rendering
+    ASSERT(r.context());
+    m_oversample = oversample;
+
+    if (oversample != OverSampleNone) {
+        for (unsigned i = 0; i < m_kernels.size(); ++i) {
+            WaveShaperDSPKernel* kernel = static_cast<WaveShaperDSPKernel*>(m_kernels[i].get());
+            kernel->lazyInitializeOversampling();
+        }
+    }
+}
+
 void WaveShaperProcessor::process(ContextGraphLock& g, ContextRenderLock& r, const AudioBus* source, AudioBus* destination, size_t framesToProcess)
 {
     if (!isInitialized()) {
@@ -34,6 +34,17 @@
 #include "VectorMath.h"
 #include <algorithm>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if HAVE(ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
 
 const unsigned WaveTableSize = 4096; // This must be a power of two.
 const unsigned NumberOfRanges = 36; // There should be 3 * log2(WaveTableSize) 1/3 octave ranges.
@@ -83,6 +94,37 @@ std::unique_ptr<WaveTable> WaveTable::createTriangle(float sampleRate)
     return waveTable;
 }
 
+// The wavetables for the standard types, by type and sample-rate.
+static std::mutex s_sharedWaveTablesLock;
+static std::map<std::pair<unsigned short, float>, std::shared_ptr<WaveTable> > s_sharedWaveTables;
+
+std::shared_ptr<WaveTable> WaveTable::sharedWaveTable(unsigned short type, float sampleRate)
+{
+    std::unique_ptr<WaveTable> (*createWaveTable)(float) = 0;
+    switch (type) {
+    case OscillatorNode::SINE:
+        createWaveTable = createSine;
+        break;
+    case OscillatorNode::SQUARE:
+        createWaveTable = createSquare;
+        break;
+    case OscillatorNode::SAWTOOTH:
+        createWaveTable = createSawtooth;
+        break;
+    case OscillatorNode::TRIANGLE:
+        createWaveTable = createTriangle;
+        break;
+    default:
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(s_sharedWaveTablesLock);
+    std::shared_ptr<WaveTable>& shared = s_sharedWaveTables[std::make_pair(type, sampleRate)];
+    if (!shared)
+        shared = createWaveTable(sampleRate);
+    return shared;
+}
+
 WaveTable::WaveTable(float sampleRate)
     : m_sampleRate(sampleRate)
     , m_waveTableSize(WaveTableSize)
@@ -93,8 +135,21 @@ WaveTable::WaveTable(float sampleRate)
     float nyquist = 0.5 * m_sampleRate;
     m_lowestFundamentalFrequency = nyquist / maxNumberOfPartials();
     m_rateScale = m_waveTableSize / m_sampleRate;
+    m_unculledFrequencyLimit = 0;
+
+    m_phaseFractionBits = 32;
+    while ((1u << (32 - m_phaseFractionBits)) < m_waveTableSize)
+        --m_phaseFractionBits;
+    m_phaseFractionScale = 1.0f / (1u << m_phaseFractionBits);
 }
 
+uint32_t WaveTable::fixedPointPhase(double readIndex) const
+{
+    // Through a signed integer, so that negative values wrap around the table as the phase does.
+    return static_cast<uint32_t>(static_cast<int64_t>(floor(readIndex * (1u << m_phaseFractionBits) + 0.5)));
+}
+
+
 void WaveTable::waveDataForFundamentalFrequency(float fundamentalFrequency, float* &lowerWaveData, float* &higherWaveData, float& tableInterpolationFactor)
 {
     // Negative frequencies are allowed, in which case we alias to the positive frequency.
@@ -156,6 +211,23 @@ void WaveTable::createBandLimitedTables(const float* realData, const float* imag
     
     numberOfComponents = std::min(numberOfComponents, halfSize);
 
+    // Find the highest partial present. Every range keeping at least that many partials has the same table.
+    unsigned highestPartial = 0;
+    for (i = 1; i < numberOfComponents; ++i) {
+        if (realData[i] || imagData[i])
+            highestPartial = i;
+    }
+
+    unsigned highestUnculledRange = 0;
+    while (highestUnculledRange + 1 < m_numberOfRanges && numberOfPartialsForRange(highestUnculledRange + 1) >= highestPartial)
+        ++highestUnculledRange;
+
+    // waveDataForFundamentalFrequency() interpolates towards the next range up, so the limit is a range below the last unculled one.
+    if (highestUnculledRange + 1 == m_numberOfRanges)
+        m_unculledFrequencyLimit = std::numeric_limits<float>::infinity();
+    else if (highestUnculledRange)
+        m_unculledFrequencyLimit = m_lowestFundamentalFrequency * powf(2, (highestUnculledRange - 1) * m_centsPerRange / 1200);
+
 	//std::cout << "Created wavetable of size " << numberOfComponents << std::endl;
 
     m_bandLimitedTables.reserve(m_numberOfRanges);
@@ -229,6 +301,93 @@ void WaveTable::createBandLimitedTables(const float* realData, const float* imag
     }
 }
 
+void WaveTable::renderWaveData(const float* higherWaveData, const float* lowerWaveData, float tableInterpolationFactor,
+                               uint32_t& phase, uint32_t phaseIncrement, float* destP, size_t framesToProcess) const
+{
+    const unsigned fractionBits = m_phaseFractionBits;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // The four frames' entries are gathered one at a time, but the phases are split, and the entries
+    // interpolated, a register at a time.
+    if (framesToProcess >= 4) {
+        const uint32_t indexMask = m_waveTableSize - 1;
+        const float fractionScale = m_phaseFractionScale;
+        __m128i phases = _mm_setr_epi32(phase, phase + phaseIncrement, phase + 2 * phaseIncrement, phase + 3 * phaseIncrement);
+        const __m128i phaseStep = _mm_set1_epi32(4 * phaseIncrement);
+        const __m128i shift = _mm_cvtsi32_si128(fractionBits);
+        const __m128i fractionMasks = _mm_set1_epi32((1u << fractionBits) - 1);
+        const __m128 fractionScales = _mm_set1_ps(fractionScale);
+        const __m128 tableFactors = _mm_set1_ps(tableInterpolationFactor);
+
+        for (; i + 4 <= framesToProcess; i += 4) {
+            uint32_t index[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(index), _mm_srl_epi32(phases, shift));
+            __m128 fractions = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phases, fractionMasks)), fractionScales);
+
+            uint32_t next0 = (index[0] + 1) & indexMask;
+            uint32_t next1 = (index[1] + 1) & indexMask;
+            uint32_t next2 = (index[2] + 1) & indexMask;
+            uint32_t next3 = (index[3] + 1) & indexMask;
+
+            __m128 sample1 = _mm_setr_ps(higherWaveData[index[0]], higherWaveData[index[1]], higherWaveData[index[2]], higherWaveData[index[3]]);
+            __m128 sample2 = _mm_setr_ps(higherWaveData[next0], higherWaveData[next1], higherWaveData[next2], higherWaveData[next3]);
+
+            if (lowerWaveData) {
+                __m128 lower1 = _mm_setr_ps(lowerWaveData[index[0]], lowerWaveData[index[1]], lowerWaveData[index[2]], lowerWaveData[index[3]]);
+                __m128 lower2 = _mm_setr_ps(lowerWaveData[next0], lowerWaveData[next1], lowerWaveData[next2], lowerWaveData[next3]);
+                sample1 = _mm_add_ps(sample1, _mm_mul_ps(tableFactors, _mm_sub_ps(lower1, sample1)));
+                sample2 = _mm_add_ps(sample2, _mm_mul_ps(tableFactors, _mm_sub_ps(lower2, sample2)));
+            }
+
+            _mm_storeu_ps(destP + i, _mm_add_ps(sample1, _mm_mul_ps(fractions, _mm_sub_ps(sample2, sample1))));
+            phases = _mm_add_epi32(phases, phaseStep);
+        }
+
+        phase += static_cast<uint32_t>(i) * phaseIncrement;
+    }
+#elif HAVE(ARM_NEON_INTRINSICS)
+    if (framesToProcess >= 4) {
+        const uint32_t indexMask = m_waveTableSize - 1;
+        const float fractionScale = m_phaseFractionScale;
+        uint32_t initialPhases[4] = { phase, phase + phaseIncrement, phase + 2 * phaseIncrement, phase + 3 * phaseIncrement };
+        uint32x4_t phases = vld1q_u32(initialPhases);
+        const uint32x4_t phaseStep = vdupq_n_u32(4 * phaseIncrement);
+        const int32x4_t shift = vdupq_n_s32(-static_cast<int32_t>(fractionBits));
+        const uint32x4_t fractionMasks = vdupq_n_u32((1u << fractionBits) - 1);
+
+        for (; i + 4 <= framesToProcess; i += 4) {
+            uint32_t index[4];
+            vst1q_u32(index, vshlq_u32(phases, shift));
+            float32x4_t fractions = vmulq_n_f32(vcvtq_f32_u32(vandq_u32(phases, fractionMasks)), fractionScale);
+
+            uint32_t next[4] = { (index[0] + 1) & indexMask, (index[1] + 1) & indexMask, (index[2] + 1) & indexMask, (index[3] + 1) & indexMask };
+            float entries1[4] = { higherWaveData[index[0]], higherWaveData[index[1]], higherWaveData[index[2]], higherWaveData[index[3]] };
+            float entries2[4] = { higherWaveData[next[0]], higherWaveData[next[1]], higherWaveData[next[2]], higherWaveData[next[3]] };
+            float32x4_t sample1 = vld1q_f32(entries1);
+            float32x4_t sample2 = vld1q_f32(entries2);
+
+            if (lowerWaveData) {
+                float lowerEntries1[4] = { lowerWaveData[index[0]], lowerWaveData[index[1]], lowerWaveData[index[2]], lowerWaveData[index[3]] };
+                float lowerEntries2[4] = { lowerWaveData[next[0]], lowerWaveData[next[1]], lowerWaveData[next[2]], lowerWaveData[next[3]] };
+                sample1 = vmlaq_n_f32(sample1, vsubq_f32(vld1q_f32(lowerEntries1), sample1), tableInterpolationFactor);
+                sample2 = vmlaq_n_f32(sample2, vsubq_f32(vld1q_f32(lowerEntries2), sample2), tableInterpolationFactor);
+            }
+
+            vst1q_f32(destP + i, vmlaq_f32(sample1, fractions, vsubq_f32(sample2, sample1)));
+            phases = vaddq_u32(phases, phaseStep);
+        }
+
+        phase += static_cast<uint32_t>(i) * phaseIncrement;
+    }
+#endif
+
+    for (; i < framesToProcess; ++i) {
+        destP[i] = readWaveData(higherWaveData, lowerWaveData, tableInterpolationFactor, phase);
+        phase += phaseIncrement;
+    }
+}
+
 void WaveTable::generateBasicWaveform(int shape)
 {
     unsigned fftSize = waveTableSize();
@@ -0,0 +1,1329 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "AudioFileDecoder.h"
+
+#include "AudioBus.h"
+#include "AudioFileReader.h"
+#include "AudioSourceProvider.h"
+#include "SincResampler.h"
+#include "VectorMath.h"
+#include <WTF/Assertions.h>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if HAVE(ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
+
+#if COMPILER(MSVC)
+#include <intrin.h>
+#endif
+
+namespace WebCore {
+
+using namespace std;
+
+// Files are read this many bytes at a time.
+const size_t ReadBlockBytes = 256 * 1024;
+
+// Frames decoded at a time when mixing down or converting the sample-rate, and read at a time into a bus.
+const size_t DecodeBlockFrames = 8192;
+
+// As many channels as an AudioBus may have.
+const unsigned MaxChannels = 32;
+
+namespace {
+
+class ByteSource {
+public:
+    virtual ~ByteSource() { }
+
+    // Returns the number of bytes read, which is less only at the end of the source.
+    virtual size_t read(void* destination, size_t bytes) = 0;
+    virtual bool seek(uint64_t offset) = 0;
+    virtual uint64_t size() const = 0;
+};
+
+class FileByteSource : public ByteSource {
+public:
+    static unique_ptr<ByteSource> open(const char* filePath)
+    {
+        FILE* file = fopen(filePath, "rb");
+        if (!file)
+            return nullptr;
+
+        // Reads are already made in large blocks.
+        setvbuf(file, 0, _IONBF, 0);
+
+        unique_ptr<FileByteSource> source(new FileByteSource(file));
+        if (!source->seekFile(0, SEEK_END))
+            return nullptr;
+#if OS(WINDOWS)
+        source->m_size = _ftelli64(file);
+#else
+        source->m_size = ftello(file);
+#endif
+        if (!source->seekFile(0, SEEK_SET))
+            return nullptr;
+        return source;
+    }
+
+    virtual ~FileByteSource()
+    {
+        fclose(m_file);
+    }
+
+    virtual size_t read(void* destination, size_t bytes) override
+    {
+        return fread(destination, 1, bytes, m_file);
+    }
+
+    virtual bool seek(uint64_t offset) override
+    {
+        return offset <= m_size && seekFile(offset, SEEK_SET);
+    }
+
+    virtual uint64_t size() const override { return m_size; }
+
+private:
+    explicit FileByteSource(FILE* file)
+        : m_file(file)
+        , m_size(0)
+    {
+    }
+
+    bool seekFile(uint64_t offset, int origin)
+    {
+#if OS(WINDOWS)
+        return !_fseeki64(m_file, static_cast<__int64>(offset), origin);
+#else
+        return !fseeko(m_file, static_cast<off_t>(offset), origin);
+#endif
+    }
+
+    FILE* m_file;
+    uint64_t m_size;
+};
+
+class MemoryByteSource : public ByteSource {
+public:
+    MemoryByteSource(const void* data, size_t dataSize)
+        : m_data(static_cast<const uint8_t*>(data))
+        , m_size(dataSize)
+        , m_position(0)
+    {
+    }
+
+    virtual size_t read(void* destination, size_t bytes) override
+    {
+        bytes = min(bytes, m_size - m_position);
+        memcpy(destination, m_data + m_position, bytes);
+        m_position += bytes;
+        return bytes;
+    }
+
+    virtual bool seek(uint64_t offset) override
+    {
+        if (offset > m_size)
+            return false;
+        m_position = static_cast<size_t>(offset);
+        return true;
+    }
+
+    virtual uint64_t size() const override { return m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_position;
+};
+
+inline uint16_t readLE16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+inline uint32_t readLE32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+inline uint64_t readLE64(const uint8_t* p) { return readLE32(p) | (static_cast<uint64_t>(readLE32(p + 4)) << 32); }
+inline uint16_t readBE16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+inline uint32_t readBE32(const uint8_t* p) { return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+inline uint64_t readBE64(const uint8_t* p) { return (static_cast<uint64_t>(readBE32(p)) << 32) | readBE32(p + 4); }
+
+// The 80 bit extended precision number AIFF gives its sample-rate as.
+double readExtended(const uint8_t* p)
+{
+    int exponent = ((p[0] & 0x7F) << 8) | p[1];
+    double value = ldexp(static_cast<double>(readBE64(p + 2)), exponent - 16383 - 63);
+    return (p[0] & 0x80) ? -value : value;
+}
+
+inline unsigned countLeadingZeros(uint64_t value)
+{
+    ASSERT(value);
+#if COMPILER(MSVC)
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+        return 31 - index;
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return 63 - index;
+#else
+    return __builtin_clzll(value);
+#endif
+}
+
+// Samples are as wide as their container; narrower samples are left justified within it, so need no special handling.
+enum SampleFormat {
+    SampleFormatUnsigned8,
+    SampleFormatSigned8,
+    SampleFormatSigned16,
+    SampleFormatSigned24,
+    SampleFormatSigned32,
+    SampleFormatFloat32,
+    SampleFormatFloat64
+};
+
+bool sampleFormatFor(bool isFloat, unsigned containerBytes, bool isSigned8, SampleFormat& format)
+{
+    if (isFloat) {
+        if (containerBytes != 4 && containerBytes != 8)
+            return false;
+        format = containerBytes == 4 ? SampleFormatFloat32 : SampleFormatFloat64;
+        return true;
+    }
+
+    switch (containerBytes) {
+    case 1: format = isSigned8 ? SampleFormatSigned8 : SampleFormatUnsigned8; return true;
+    case 2: format = SampleFormatSigned16; return true;
+    case 3: format = SampleFormatSigned24; return true;
+    case 4: format = SampleFormatSigned32; return true;
+    }
+    return false;
+}
+
+unsigned bytesPerSample(SampleFormat format)
+{
+    switch (format) {
+    case SampleFormatUnsigned8:
+    case SampleFormatSigned8: return 1;
+    case SampleFormatSigned16: return 2;
+    case SampleFormatSigned24: return 3;
+    case SampleFormatSigned32:
+    case SampleFormatFloat32: return 4;
+    case SampleFormatFloat64: return 8;
+    }
+    return 0;
+}
+
+// Converts interleaved samples to floats. Integers are left unscaled; the scale which brings them to [-1, 1)
+// is returned, to be applied as they are deinterleaved.
+float convertSamples(const uint8_t* source, SampleFormat format, bool isBigEndian, float* destination, size_t numberOfSamples)
+{
+    size_t i = 0;
+    switch (format) {
+    case SampleFormatUnsigned8:
+        for (; i < numberOfSamples; ++i)
+            destination[i] = static_cast<float>(source[i] - 128);
+        return 1.0f / 128;
+
+    case SampleFormatSigned8:
+        for (; i < numberOfSamples; ++i)
+            destination[i] = static_cast<int8_t>(source[i]);
+        return 1.0f / 128;
+
+    case SampleFormatSigned16:
+#ifdef __SSE2__
+        for (; i + 8 <= numberOfSamples; i += 8) {
+            __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * i));
+            if (isBigEndian)
+                samples = _mm_or_si128(_mm_slli_epi16(samples, 8), _mm_srli_epi16(samples, 8));
+
+            // Each sample goes to the top of a 32 bit lane, and is shifted back down with its sign.
+            __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+            __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+            _mm_storeu_ps(destination + i, _mm_cvtepi32_ps(low));
+            _mm_storeu_ps(destination + i + 4, _mm_cvtepi32_ps(high));
+        }
+#elif HAVE(ARM_NEON_INTRINSICS)
+        for (; i + 8 <= numberOfSamples; i += 8) {
+            int16x8_t samples = vld1q_s16(reinterpret_cast<const int16_t*>(source + 2 * i));
+            if (isBigEndian)
+                samples = vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_s16(samples)));
+            vst1q_f32(destination + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))));
+            vst1q_f32(destination + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))));
+        }
+#endif
+        for (; i < numberOfSamples; ++i) {
+            const uint8_t* p = source + 2 * i;
+            destination[i] = static_cast<int16_t>(isBigEndian ? readBE16(p) : readLE16(p));
+        }
+        return 1.0f / 32768;
+
+    case SampleFormatSigned24:
+        // Read into the top of 32 bits, so as to keep the sign.
+        for (; i < numberOfSamples; ++i) {
+            const uint8_t* p = source + 3 * i;
+            uint32_t sample = isBigEndian ?
+                (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) :
+                (static_cast<uint32_t>(p[2]) << 24) | (p[1] << 16) | (p[0] << 8);
+            destination[i] = static_cast<float>(static_cast<int32_t>(sample));
+        }
+        return 1.0f / 2147483648.0f;
+
+    case SampleFormatSigned32:
+        for (; i < numberOfSamples; ++i) {
+            const uint8_t* p = source + 4 * i;
+            destination[i] = static_cast<float>(static_cast<int32_t>(isBigEndian ? readBE32(p) : readLE32(p)));
+        }
+        return 1.0f / 2147483648.0f;
+
+    case SampleFormatFloat32:
+        for (; i < numberOfSamples; ++i) {
+            const uint8_t* p = source + 4 * i;
+            uint32_t bits = isBigEndian ? readBE32(p) : readLE32(p);
+            memcpy(destination + i, &bits, sizeof(float));
+        }
+        return 1;
+
+    case SampleFormatFloat64:
+        for (; i < numberOfSamples; ++i) {
+            const uint8_t* p = source + 8 * i;
+            uint64_t bits = isBigEndian ? readBE64(p) : readLE64(p);
+            double sample;
+            memcpy(&sample, &bits, sizeof(double));
+            destination[i] = static_cast<float>(sample);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+void convertIntegers(const int32_t* source, float scale, float* destination, size_t numberOfSamples)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128 k = _mm_set1_ps(scale);
+    for (; i + 4 <= numberOfSamples; i += 4) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), k));
+    }
+#elif HAVE(ARM_NEON_INTRINSICS)
+    for (; i + 4 <= numberOfSamples; i += 4)
+        vst1q_f32(destination + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(source + i)), scale));
+#endif
+    for (; i < numberOfSamples; ++i)
+        destination[i] = source[i] * scale;
+}
+
+// Uncompressed WAV and AIFF.
+class PCMDecoder : public AudioFileDecoder {
+public:
+    PCMDecoder(unique_ptr<ByteSource> source, unsigned numberOfChannels, float sampleRate, SampleFormat format, bool isBigEndian, uint64_t dataOffset, uint64_t dataSize)
+        : m_source(move(source))
+        , m_format(format)
+        , m_isBigEndian(isBigEndian)
+        , m_frameBytes(numberOfChannels * bytesPerSample(format))
+        , m_dataOffset(dataOffset)
+        , m_position(0)
+        , m_destinations(numberOfChannels)
+    {
+        m_numberOfChannels = numberOfChannels;
+        m_sampleRate = sampleRate;
+        m_length = dataSize / m_frameBytes;
+
+        // Short files, such as impulse responses, are read in one go without a full sized block.
+        m_blockFrames = static_cast<size_t>(min<uint64_t>(max<size_t>(1, ReadBlockBytes / m_frameBytes), max<uint64_t>(1, m_length)));
+        m_bytes.resize(m_blockFrames * m_frameBytes);
+        m_samples.resize(m_blockFrames * numberOfChannels);
+        m_source->seek(m_dataOffset);
+    }
+
+    virtual bool seek(uint64_t frame) override
+    {
+        if (frame > m_length || !m_source->seek(m_dataOffset + frame * m_frameBytes))
+            return false;
+        m_position = frame;
+        return true;
+    }
+
+    virtual size_t read(float* const* channels, size_t framesToRead) override
+    {
+        framesToRead = static_cast<size_t>(min<uint64_t>(framesToRead, m_length - m_position));
+
+        size_t framesRead = 0;
+        while (framesRead < framesToRead) {
+            size_t frames = min(m_blockFrames, framesToRead - framesRead);
+            frames = m_source->read(m_bytes.data(), frames * m_frameBytes) / m_frameBytes;
+            if (!frames)
+                break;
+
+            float scale = convertSamples(m_bytes.data(), m_format, m_isBigEndian, m_samples.data(), frames * m_numberOfChannels);
+            for (unsigned i = 0; i < m_numberOfChannels; ++i)
+                m_destinations[i] = channels[i] + framesRead;
+            VectorMath::vdeinterleave(m_samples.data(), m_numberOfChannels, &scale, m_destinations.data(), frames);
+
+            framesRead += frames;
+            m_position += frames;
+        }
+        return framesRead;
+    }
+
+private:
+    unique_ptr<ByteSource> m_source;
+    SampleFormat m_format;
+    bool m_isBigEndian;
+    size_t m_frameBytes;
+    size_t m_blockFrames;
+    uint64_t m_dataOffset;
+    uint64_t m_position;
+
+    vector<uint8_t> m_bytes;
+    vector<float> m_samples;
+    vector<float*> m_destinations;
+};
+
+unique_ptr<AudioFileDecoder> openWAV(unique_ptr<ByteSource> source)
+{
+    uint64_t offset = 12;
+    bool hasFormat = false;
+    unsigned numberOfChannels = 0;
+    float sampleRate = 0;
+    SampleFormat format = SampleFormatSigned16;
+
+    uint8_t chunk[8];
+    while (source->seek(offset) && source->read(chunk, sizeof(chunk)) == sizeof(chunk)) {
+        uint32_t chunkSize = readLE32(chunk + 4);
+        offset += sizeof(chunk);
+
+        if (!memcmp(chunk, "fmt ", 4)) {
+            uint8_t fmt[40];
+            size_t fmtBytes = min<size_t>(chunkSize, sizeof(fmt));
+            if (fmtBytes < 16 || source->read(fmt, fmtBytes) != fmtBytes)
+                return nullptr;
+
+            unsigned formatTag = readLE16(fmt);
+            numberOfChannels = readLE16(fmt + 2);
+            sampleRate = static_cast<float>(readLE32(fmt + 4));
+            unsigned blockAlign = readLE16(fmt + 12);
+
+            // WAVE_FORMAT_EXTENSIBLE gives the format in the first two bytes of its sub-format GUID.
+            if (formatTag == 0xFFFE && fmtBytes >= 26)
+                formatTag = readLE16(fmt + 24);
+
+            const unsigned FormatPCM = 1;
+            const unsigned FormatFloat = 3;
+            if ((formatTag != FormatPCM && formatTag != FormatFloat) || !numberOfChannels || numberOfChannels > MaxChannels || !sampleRate || blockAlign % numberOfChannels)
+                return nullptr;
+            if (!sampleFormatFor(formatTag == FormatFloat, blockAlign / numberOfChannels, false, format))
+                return nullptr;
+            hasFormat = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (!hasFormat)
+                return nullptr;
+
+            // Writers which couldn't go back to fill in the size leave it unset; take the rest of the file.
+            uint64_t dataSize = chunkSize;
+            if (!dataSize || offset + dataSize > source->size())
+                dataSize = source->size() - offset;
+            return unique_ptr<AudioFileDecoder>(new PCMDecoder(move(source), numberOfChannels, sampleRate, format, false, offset, dataSize));
+        }
+
+        offset += chunkSize + (chunkSize & 1);
+    }
+    return nullptr;
+}
+
+unique_ptr<AudioFileDecoder> openAIFF(unique_ptr<ByteSource> source, bool isCompressed)
+{
+    uint64_t offset = 12;
+    bool hasFormat = false;
+    unsigned numberOfChannels = 0;
+    uint64_t numberOfFrames = 0;
+    float sampleRate = 0;
+    SampleFormat format = SampleFormatSigned16;
+    bool isBigEndian = true;
+    uint64_t dataOffset = 0;
+    uint64_t dataSize = 0;
+
+    // The sound data may come before the format.
+    uint8_t chunk[8];
+    while (source->seek(offset) && source->read(chunk, sizeof(chunk)) == sizeof(chunk)) {
+        uint32_t chunkSize = readBE32(chunk + 4);
+        offset += sizeof(chunk);
+
+        if (!memcmp(chunk, "COMM", 4)) {
+            uint8_t comm[22];
+            size_t commBytes = min<size_t>(chunkSize, sizeof(comm));
+            if (commBytes < 18 || source->read(comm, commBytes) != commBytes)
+                return nullptr;
+
+            numberOfChannels = readBE16(comm);
+            numberOfFrames = readBE32(comm + 2);
+            unsigned bitsPerSample = readBE16(comm + 6);
+            sampleRate = static_cast<float>(readExtended(comm + 8));
+
+            bool isFloat = false;
+            if (isCompressed) {
+                if (commBytes < 22)
+                    return nullptr;
+                const char* compression = reinterpret_cast<const char*>(comm + 18);
+                if (!memcmp(compression, "sowt", 4))
+                    isBigEndian = false;
+                else if (!memcmp(compression, "fl32", 4) || !memcmp(compression, "FL32", 4)) {
+                    isFloat = true;
+                    bitsPerSample = 32;
+                } else if (!memcmp(compression, "fl64", 4) || !memcmp(compression, "FL64", 4)) {
+                    isFloat = true;
+                    bitsPerSample = 64;
+                } else if (memcmp(compression, "NONE", 4) && memcmp(compression, "twos", 4))
+                    return nullptr;
+            }
+
+            if (!numberOfChannels || numberOfChannels > MaxChannels || !(sampleRate > 0))
+                return nullptr;
+            if (!sampleFormatFor(isFloat, (bitsPerSample + 7) / 8, true, format))
+                return nullptr;
+            hasFormat = true;
+        } else if (!memcmp(chunk, "SSND", 4)) {
+            uint8_t ssnd[8];
+            if (chunkSize < sizeof(ssnd) || source->read(ssnd, sizeof(ssnd)) != sizeof(ssnd))
+                return nullptr;
+            uint32_t soundOffset = readBE32(ssnd);
+            dataOffset = offset + sizeof(ssnd) + soundOffset;
+            dataSize = chunkSize - min<uint64_t>(chunkSize, sizeof(ssnd) + soundOffset);
+        }
+
+        offset += chunkSize + (chunkSize & 1);
+    }
+
+    if (!hasFormat || !dataOffset || dataOffset > source->size())
+        return nullptr;
+
+    uint64_t frameBytes = numberOfChannels * bytesPerSample(format);
+    dataSize = min(dataSize, source->size() - dataOffset);
+    dataSize = min(dataSize, numberOfFrames * frameBytes);
+    return unique_ptr<AudioFileDecoder>(new PCMDecoder(move(source), numberOfChannels, sampleRate, format, isBigEndian, dataOffset, dataSize));
+}
+
+// Reads a most significant bit first stream, through a buffer filled a block at a time.
+class BitReader {
+public:
+    explicit BitReader(ByteSource& source)
+        : m_source(source)
+        , m_buffer(static_cast<size_t>(min<uint64_t>(ReadBlockBytes, source.size())))
+        , m_position(0)
+        , m_end(0)
+        , m_cache(0)
+        , m_bits(0)
+        , m_isExhausted(false)
+    {
+    }
+
+    // Discards what has been buffered, once the source has been seeked.
+    void reset()
+    {
+        m_position = 0;
+        m_end = 0;
+        m_cache = 0;
+        m_bits = 0;
+        m_isExhausted = false;
+    }
+
+    // Set once a read has run past the end of the source; reads then return zero.
+    bool isExhausted() const { return m_isExhausted; }
+
+    // Up to 32 bits.
+    uint32_t read(unsigned bits)
+    {
+        ASSERT(bits <= 32);
+        if (m_bits < bits) {
+            fill();
+            if (m_bits < bits) {
+                m_isExhausted = true;
+                m_cache = 0;
+                m_bits = 0;
+                return 0;
+            }
+        }
+        if (!bits)
+            return 0;
+
+        uint32_t value = static_cast<uint32_t>(m_cache >> (64 - bits));
+        m_cache <<= bits;
+        m_bits -= bits;
+        return value;
+    }
+
+    int32_t readSigned(unsigned bits)
+    {
+        if (!bits)
+            return 0;
+        unsigned shift = 32 - bits;
+        return static_cast<int32_t>(read(bits) << shift) >> shift;
+    }
+
+    // Counts the zeros before the next one, which is consumed as well.
+    uint32_t readUnary()
+    {
+        uint32_t count = 0;
+        for (;;) {
+            if (!m_bits) {
+                fill();
+                if (!m_bits) {
+                    m_isExhausted = true;
+                    return count;
+                }
+            }
+
+            // The cache is zero beyond its valid bits, so any one found is within them.
+            if (m_cache) {
+                unsigned zeros = countLeadingZeros(m_cache);
+                count += zeros;
+                m_cache = zeros < 63 ? m_cache << (zeros + 1) : 0;
+                m_bits -= zeros + 1;
+                return count;
+            }
+
+            count += m_bits;
+            m_bits = 0;
+        }
+    }
+
+    // Rice coded values with zig-zag signs, as FLAC's residuals are. Most are found within the cache without refilling.
+    void readRice(int32_t* values, size_t count, unsigned parameter)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            if (m_bits < 32)
+                fill();
+
+            uint32_t value;
+            unsigned zeros = m_cache ? countLeadingZeros(m_cache) : 64;
+            if (zeros + 1 + parameter <= m_bits) {
+                uint64_t rest = m_cache << zeros << 1;
+                value = (zeros << parameter) | (parameter ? static_cast<uint32_t>(rest >> (64 - parameter)) : 0);
+                m_cache = rest << parameter;
+                m_bits -= zeros + 1 + parameter;
+            } else {
+                value = readUnary() << parameter;
+                value |= read(parameter);
+            }
+            values[i] = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+    }
+
+    void alignToByte()
+    {
+        read(m_bits % 8);
+    }
+
+private:
+    void fill()
+    {
+        // Whole bytes at once, while the buffer has eight to spare.
+        if (m_end - m_position >= 8) {
+            unsigned bytes = (64 - m_bits) / 8;
+            if (bytes) {
+                uint64_t next = readBE64(&m_buffer[m_position]) >> (64 - 8 * bytes);
+                m_cache |= next << (64 - 8 * bytes - m_bits);
+                m_position += bytes;
+                m_bits += 8 * bytes;
+            }
+            return;
+        }
+
+        while (m_bits <= 56) {
+            if (m_position == m_end) {
+                m_end = m_source.read(m_buffer.data(), m_buffer.size());
+                m_position = 0;
+                if (!m_end)
+                    return;
+            }
+            m_cache |= static_cast<uint64_t>(m_buffer[m_position++]) << (56 - m_bits);
+            m_bits += 8;
+        }
+    }
+
+    ByteSource& m_source;
+    vector<uint8_t> m_buffer;
+    size_t m_position;
+    size_t m_end;
+
+    // The next bits of the stream, most significant first.
+    uint64_t m_cache;
+    unsigned m_bits;
+
+    bool m_isExhausted;
+};
+
+class FLACDecoder : public AudioFileDecoder {
+public:
+    static unique_ptr<AudioFileDecoder> open(unique_ptr<ByteSource>);
+
+    virtual bool seek(uint64_t frame) override;
+    virtual size_t read(float* const* channels, size_t framesToRead) override;
+
+private:
+    explicit FLACDecoder(unique_ptr<ByteSource>);
+
+    // Decodes the next block into m_samples. Returns false at the end of the stream, or if the frame is damaged.
+    bool decodeFrame();
+    bool decodeSubframe(int32_t* samples, size_t blockSize, unsigned bitsPerSample);
+    bool decodeResidual(int32_t* residual, size_t blockSize, unsigned order);
+
+    struct SeekPoint {
+        uint64_t frame;
+        uint64_t offset;
+    };
+
+    unique_ptr<ByteSource> m_source;
+    BitReader m_reader;
+    unsigned m_bitsPerSample;
+    size_t m_maxBlockSize;
+    float m_scale;
+    uint64_t m_firstFrameOffset;
+
+    // Offsets from the first frame, in order.
+    vector<SeekPoint> m_seekTable;
+
+    // The decoded block, a channel at a time, and how much of it has been read.
+    vector<vector<int32_t>> m_samples;
+    uint64_t m_blockStart;
+    size_t m_blockSize;
+    size_t m_blockPosition;
+};
+
+FLACDecoder::FLACDecoder(unique_ptr<ByteSource> source)
+    : m_source(move(source))
+    , m_reader(*m_source)
+    , m_bitsPerSample(0)
+    , m_maxBlockSize(0)
+    , m_scale(0)
+    , m_firstFrameOffset(0)
+    , m_blockStart(0)
+    , m_blockSize(0)
+    , m_blockPosition(0)
+{
+}
+
+unique_ptr<AudioFileDecoder> FLACDecoder::open(unique_ptr<ByteSource> source)
+{
+    uint8_t header[10];
+    uint64_t offset = 0;
+    if (!source->seek(0) || source->read(header, sizeof(header)) != sizeof(header))
+        return nullptr;
+
+    // An ID3v2 tag may come first; its size is given seven bits to the byte.
+    if (!memcmp(header, "ID3", 3)) {
+        offset = 10 + ((header[6] & 0x7F) << 21 | (header[7] & 0x7F) << 14 | (header[8] & 0x7F) << 7 | (header[9] & 0x7F));
+        if (!source->seek(offset) || source->read(header, 4) != 4)
+            return nullptr;
+    }
+    if (memcmp(header, "fLaC", 4))
+        return nullptr;
+    offset += 4;
+
+    unique_ptr<FLACDecoder> decoder(new FLACDecoder(move(source)));
+    ByteSource* byteSource = decoder->m_source.get();
+
+    bool hasStreamInfo = false;
+    bool isLast = false;
+    while (!isLast) {
+        uint8_t blockHeader[4];
+        if (!byteSource->seek(offset) || byteSource->read(blockHeader, sizeof(blockHeader)) != sizeof(blockHeader))
+            return nullptr;
+
+        isLast = (blockHeader[0] & 0x80) != 0;
+        unsigned type = blockHeader[0] & 0x7F;
+        uint32_t length = (blockHeader[1] << 16) | (blockHeader[2] << 8) | blockHeader[3];
+        offset += sizeof(blockHeader);
+
+        const unsigned StreamInfo = 0;
+        const unsigned SeekTable = 3;
+        if (type == StreamInfo) {
+            uint8_t info[34];
+            if (length < sizeof(info) || byteSource->read(info, sizeof(info)) != sizeof(info))
+                return nullptr;
+
+            decoder->m_maxBlockSize = readBE16(info + 2);
+            decoder->m_sampleRate = static_cast<float>((info[10] << 12) | (info[11] << 4) | (info[12] >> 4));
+            decoder->m_numberOfChannels = ((info[12] >> 1) & 7) + 1;
+            decoder->m_bitsPerSample = (((info[12] & 1) << 4) | (info[13] >> 4)) + 1;
+            decoder->m_length = (static_cast<uint64_t>(info[13] & 0xF) << 32) | readBE32(info + 14);
+            hasStreamInfo = true;
+        } else if (type == SeekTable) {
+            vector<uint8_t> table(length);
+            if (byteSource->read(table.data(), length) != length)
+                return nullptr;
+
+            const uint64_t Placeholder = ~0ULL;
+            for (uint32_t i = 0; i + 18 <= length; i += 18) {
+                SeekPoint point = { readBE64(&table[i]), readBE64(&table[i + 8]) };
+                if (point.frame != Placeholder)
+                    decoder->m_seekTable.push_back(point);
+            }
+        }
+
+        offset += length;
+    }
+
+    // Streams of unknown length, and those too wide for the decoder's 32 bit arithmetic, aren't read.
+    if (!hasStreamInfo || !decoder->m_sampleRate || !decoder->m_length || decoder->m_maxBlockSize < 16 || decoder->m_bitsPerSample < 4 || decoder->m_bitsPerSample > 24)
+        return nullptr;
+
+    decoder->m_scale = static_cast<float>(ldexp(1.0, 1 - static_cast<int>(decoder->m_bitsPerSample)));
+    decoder->m_firstFrameOffset = offset;
+    decoder->m_samples.resize(decoder->m_numberOfChannels);
+    for (unsigned i = 0; i < decoder->m_numberOfChannels; ++i)
+        decoder->m_samples[i].resize(decoder->m_maxBlockSize);
+
+    if (!decoder->seek(0))
+        return nullptr;
+    return decoder;
+}
+
+bool FLACDecoder::seek(uint64_t frame)
+{
+    if (frame > m_length)
+        return false;
+
+    // Start from the nearest seek point before the frame, and decode forward to it.
+    SeekPoint start = { 0, 0 };
+    for (size_t i = 0; i < m_seekTable.size() && m_seekTable[i].frame <= frame; ++i)
+        start = m_seekTable[i];
+
+    if (!m_source->seek(m_firstFrameOffset + start.offset))
+        return false;
+    m_reader.reset();
+    m_blockStart = start.frame;
+    m_blockSize = 0;
+    m_blockPosition = 0;
+
+    while (frame >= m_blockStart + m_blockSize) {
+        if (m_blockStart + m_blockSize >= m_length) {
+            m_blockPosition = m_blockSize;
+            return frame == m_length;
+        }
+        if (!decodeFrame())
+            return false;
+    }
+
+    m_blockPosition = static_cast<size_t>(frame - m_blockStart);
+    return true;
+}
+
+size_t FLACDecoder::read(float* const* channels, size_t framesToRead)
+{
+    size_t framesRead = 0;
+    while (framesRead < framesToRead) {
+        if (m_blockPosition == m_blockSize) {
+            if (m_blockStart + m_blockSize >= m_length || !decodeFrame())
+                break;
+        }
+
+        size_t frames = min(framesToRead - framesRead, m_blockSize - m_blockPosition);
+        for (unsigned i = 0; i < m_numberOfChannels; ++i)
+            convertIntegers(m_samples[i].data() + m_blockPosition, m_scale, channels[i] + framesRead, frames);
+
+        m_blockPosition += frames;
+        framesRead += frames;
+    }
+    return framesRead;
+}
+
+bool FLACDecoder::decodeFrame()
+{
+    BitReader& reader = m_reader;
+
+    const uint32_t FixedBlockSync = 0xFFF8;
+    const uint32_t VariableBlockSync = 0xFFF9;
+    uint32_t sync = reader.read(16);
+    if (sync != FixedBlockSync && sync != VariableBlockSync)
+        return false;
+
+    unsigned blockSizeCode = reader.read(4);
+    unsigned sampleRateCode = reader.read(4);
+    unsigned channelAssignment = reader.read(4);
+    unsigned sampleSizeCode = reader.read(3);
+    reader.read(1);
+
+    // The frame or sample number, UTF-8 coded; only its length matters here.
+    uint32_t leadByte = reader.read(8);
+    unsigned leadingOnes = 0;
+    while (leadingOnes < 8 && (leadByte & (0x80 >> leadingOnes)))
+        ++leadingOnes;
+    if (leadingOnes == 1 || leadingOnes > 7)
+        return false;
+    for (unsigned i = 1; i < leadingOnes; ++i)
+        reader.read(8);
+
+    size_t blockSize;
+    if (blockSizeCode == 1)
+        blockSize = 192;
+    else if (blockSizeCode >= 2 && blockSizeCode <= 5)
+        blockSize = 576 << (blockSizeCode - 2);
+    else if (blockSizeCode == 6)
+        blockSize = reader.read(8) + 1;
+    else if (blockSizeCode == 7)
+        blockSize = reader.read(16) + 1;
+    else if (blockSizeCode >= 8)
+        blockSize = 256 << (blockSizeCode - 8);
+    else
+        return false;
+
+    // The stream's sample-rate holds throughout; a frame may restate it.
+    if (sampleRateCode == 12)
+        reader.read(8);
+    else if (sampleRateCode == 13 || sampleRateCode == 14)
+        reader.read(16);
+    else if (sampleRateCode == 15)
+        return false;
+
+    static const unsigned sampleSizes[8] = { 0, 8, 12, 0, 16, 20, 24, 0 };
+    unsigned bitsPerSample = sampleSizeCode ? sampleSizes[sampleSizeCode] : m_bitsPerSample;
+    if (!bitsPerSample || bitsPerSample > m_bitsPerSample)
+        return false;
+
+    // The header's CRC-8. Damage is found as the frame fails to decode, rather than by checksum.
+    reader.read(8);
+
+    const unsigned LeftSide = 8;
+    const unsigned SideRight = 9;
+    const unsigned MidSide = 10;
+    unsigned numberOfChannels = channelAssignment < LeftSide ? channelAssignment + 1 : 2;
+    if (channelAssignment > MidSide || numberOfChannels != m_numberOfChannels || blockSize > m_maxBlockSize)
+        return false;
+
+    for (unsigned i = 0; i < numberOfChannels; ++i) {
+        // The side channel has a bit more to it.
+        bool isSide = (i == 1 && (channelAssignment == LeftSide || channelAssignment == MidSide)) || (i == 0 && channelAssignment == SideRight);
+        if (!decodeSubframe(m_samples[i].data(), blockSize, bitsPerSample + (isSide ? 1 : 0)))
+            return false;
+    }
+
+    // Padding to the byte, then the frame's CRC-16.
+    reader.alignToByte();
+    reader.read(16);
+    if (reader.isExhausted())
+        return false;
+
+    if (channelAssignment >= LeftSide) {
+        int32_t* left = m_samples[0].data();
+        int32_t* right = m_samples[1].data();
+        if (channelAssignment == LeftSide) {
+            for (size_t i = 0; i < blockSize; ++i)
+                right[i] = left[i] - right[i];
+        } else if (channelAssignment == SideRight) {
+            for (size_t i = 0; i < blockSize; ++i)
+                left[i] += right[i];
+        } else {
+            for (size_t i = 0; i < blockSize; ++i) {
+                int32_t side = right[i];
+                int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(left[i]) << 1) | (side & 1);
+                left[i] = (mid + side) >> 1;
+                right[i] = (mid - side) >> 1;
+            }
+        }
+    }
+
+    m_blockStart += m_blockSize;
+    m_blockSize = blockSize;
+    m_blockPosition = 0;
+    return true;
+}
+
+bool FLACDecoder::decodeSubframe(int32_t* samples, size_t blockSize, unsigned bitsPerSample)
+{
+    BitReader& reader = m_reader;
+    if (reader.read(1))
+        return false;
+
+    unsigned type = reader.read(6);
+    unsigned wastedBits = reader.read(1) ? reader.readUnary() + 1 : 0;
+    if (wastedBits >= bitsPerSample)
+        return false;
+    bitsPerSample -= wastedBits;
+
+    const unsigned Constant = 0;
+    const unsigned Verbatim = 1;
+    const unsigned FixedFirst = 8;
+    const unsigned FixedLast = 12;
+    const unsigned LPCFirst = 32;
+
+    if (type == Constant) {
+        int32_t value = reader.readSigned(bitsPerSample);
+        for (size_t i = 0; i < blockSize; ++i)
+            samples[i] = value;
+    } else if (type == Verbatim) {
+        for (size_t i = 0; i < blockSize; ++i)
+            samples[i] = reader.readSigned(bitsPerSample);
+    } else if (type >= FixedFirst && type <= FixedLast) {
+        unsigned order = type - FixedFirst;
+        if (order > blockSize)
+            return false;
+        for (unsigned i = 0; i < order; ++i)
+            samples[i] = reader.readSigned(bitsPerSample);
+        if (!decodeResidual(samples + order, blockSize, order))
+            return false;
+
+        // The residual is added to a polynomial through the samples before it.
+        switch (order) {
+        case 1:
+            for (size_t i = 1; i < blockSize; ++i)
+                samples[i] += samples[i - 1];
+            break;
+        case 2:
+            for (size_t i = 2; i < blockSize; ++i)
+                samples[i] += 2 * samples[i - 1] - samples[i - 2];
+            break;
+        case 3:
+            for (size_t i = 3; i < blockSize; ++i)
+                samples[i] += 3 * (samples[i - 1] - samples[i - 2]) + samples[i - 3];
+            break;
+        case 4:
+            for (size_t i = 4; i < blockSize; ++i)
+                samples[i] += 4 * (samples[i - 1] + samples[i - 3]) - 6 * samples[i - 2] - samples[i - 4];
+            break;
+        }
+    } else if (type >= LPCFirst) {
+        unsigned order = (type & 31) + 1;
+        if (order > blockSize)
+            return false;
+        for (unsigned i = 0; i < order; ++i)
+            samples[i] = reader.readSigned(bitsPerSample);
+
+        unsigned precision = reader.read(4) + 1;
+        int shift = reader.readSigned(5);
+        if (precision > 15 || shift < 0)
+            return false;
+
+        int32_t coefficients[32];
+        for (unsigned i = 0; i < order; ++i)
+            coefficients[i] = reader.readSigned(precision);
+
+        if (!decodeResidual(samples + order, blockSize, order))
+            return false;
+
+        for (size_t i = order; i < blockSize; ++i) {
+            int64_t prediction = 0;
+            const int32_t* history = samples + i - 1;
+            for (unsigned j = 0; j < order; ++j)
+                prediction += static_cast<int64_t>(coefficients[j]) * history[-static_cast<int>(j)];
+            samples[i] += static_cast<int32_t>(prediction >> shift);
+        }
+    } else
+        return false;
+
+    if (wastedBits) {
+        for (size_t i = 0; i < blockSize; ++i)
+            samples[i] = static_cast<int32_t>(static_cast<uint32_t>(samples[i]) << wastedBits);
+    }
+    return !reader.isExhausted();
+}
+
+bool FLACDecoder::decodeResidual(int32_t* residual, size_t blockSize, unsigned order)
+{
+    BitReader& reader = m_reader;
+
+    // Rice coding, with a four or five bit parameter to each partition.
+    unsigned method = reader.read(2);
+    if (method > 1)
+        return false;
+    unsigned parameterBits = method ? 5 : 4;
+    unsigned escapeParameter = method ? 31 : 15;
+
+    unsigned partitionOrder = reader.read(4);
+    size_t partitionSize = blockSize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blockSize || partitionSize < order)
+        return false;
+
+    size_t partitions = size_t(1) << partitionOrder;
+    for (size_t partition = 0; partition < partitions; ++partition) {
+        size_t count = partition ? partitionSize : partitionSize - order;
+        unsigned parameter = reader.read(parameterBits);
+
+        if (parameter == escapeParameter) {
+            // Unencoded, at a given width.
+            unsigned bits = reader.read(5);
+            for (size_t i = 0; i < count; ++i)
+                residual[i] = reader.readSigned(bits);
+        } else
+            reader.readRice(residual, count, parameter);
+
+        residual += count;
+        if (reader.isExhausted())
+            return false;
+    }
+    return true;
+}
+
+unique_ptr<AudioFileDecoder> openSource(unique_ptr<ByteSource> source)
+{
+    uint8_t header[12];
+    if (!source || source->read(header, sizeof(header)) != sizeof(header))
+        return nullptr;
+
+    if (!memcmp(header, "RIFF", 4) && !memcmp(header + 8, "WAVE", 4))
+        return openWAV(move(source));
+    if (!memcmp(header, "FORM", 4) && !memcmp(header + 8, "AIFF", 4))
+        return openAIFF(move(source), false);
+    if (!memcmp(header, "FORM", 4) && !memcmp(header + 8, "AIFC", 4))
+        return openAIFF(move(source), true);
+    if (!memcmp(header, "fLaC", 4) || !memcmp(header, "ID3", 3))
+        return FLACDecoder::open(move(source));
+    return nullptr;
+}
+
+// Presents a decoder as an AudioFileStream, mixing down and converting the sample-rate as it's read.
+//
+// When converting, each channel has its own resampler, which pulls decoded frames through a queue. The channels
+// are converted in turn for the same span, so the queues stay within a block or so of each other.
+class DecodedAudioFileStream : public AudioFileStream {
+public:
+    DecodedAudioFileStream(unique_ptr<AudioFileDecoder> decoder, float sampleRate, bool mixToMono)
+        : m_decoder(move(decoder))
+        , m_sampleRate(sampleRate ? sampleRate : m_decoder->sampleRate())
+        , m_scaleFactor(static_cast<double>(m_decoder->sampleRate()) / m_sampleRate)
+        , m_numberOfChannels(mixToMono ? 1 : m_decoder->numberOfChannels())
+        , m_length(static_cast<uint64_t>(m_decoder->length() / m_scaleFactor))
+        , m_position(0)
+        , m_blockFrames(static_cast<size_t>(min<uint64_t>(DecodeBlockFrames, max<uint64_t>(1, m_decoder->length()))))
+        , m_isMixing(mixToMono && m_decoder->numberOfChannels() > 1)
+    {
+        if (m_isMixing)
+            allocateChannels(m_mixChannels, m_mixStorage, m_decoder->numberOfChannels());
+
+        if (m_decoder->sampleRate() != m_sampleRate) {
+            allocateChannels(m_blockChannels, m_blockStorage, m_numberOfChannels);
+            m_queues.resize(m_numberOfChannels);
+            m_queueStarts.resize(m_numberOfChannels);
+            for (unsigned i = 0; i < m_numberOfChannels; ++i)
+                m_providers.push_back(unique_ptr<ChannelProvider>(new ChannelProvider(*this, i)));
+            resetResamplers();
+        }
+    }
+
+    virtual unsigned numberOfChannels() const override { return m_numberOfChannels; }
+    virtual float sampleRate() const override { return m_sampleRate; }
+    virtual uint64_t length() const override { return m_length; }
+
+    virtual bool seek(uint64_t frame) override
+    {
+        uint64_t decoderFrame = min(m_decoder->length(), static_cast<uint64_t>(frame * m_scaleFactor));
+        if (frame > m_length || !m_decoder->seek(decoderFrame))
+            return false;
+
+        m_position = frame;
+        if (!m_resamplers.empty())
+            resetResamplers();
+        return true;
+    }
+
+    virtual size_t read(AudioBus* bus, size_t framesToRead) override
+    {
+        ASSERT(bus->numberOfChannels() >= m_numberOfChannels && bus->length() >= framesToRead);
+        framesToRead = static_cast<size_t>(min<uint64_t>(framesToRead, m_length - m_position));
+
+        size_t framesRead = framesToRead;
+        if (m_resamplers.empty()) {
+            float* channels[MaxChannels];
+            for (unsigned i = 0; i < m_numberOfChannels; ++i)
+                channels[i] = bus->channel(i)->mutableData();
+            framesRead = decode(channels, framesToRead);
+        } else {
+            // Past the end of the file, the resamplers are given silence.
+            for (unsigned i = 0; i < m_numberOfChannels; ++i)
+                m_resamplers[i]->process(m_providers[i].get(), bus->channel(i)->mutableData(), framesToRead);
+        }
+
+        m_position += framesRead;
+        return framesRead;
+    }
+
+private:
+    class ChannelProvider : public AudioSourceProvider {
+    public:
+        ChannelProvider(DecodedAudioFileStream& stream, unsigned channel)
+            : m_stream(stream)
+            , m_channel(channel)
+        {
+        }
+
+        virtual void provideInput(AudioBus* bus, size_t framesToProcess) override
+        {
+            m_stream.provide(m_channel, bus->channel(0)->mutableData(), framesToProcess);
+        }
+
+    private:
+        DecodedAudioFileStream& m_stream;
+        unsigned m_channel;
+    };
+
+    void allocateChannels(vector<float*>& channels, vector<float>& storage, unsigned numberOfChannels)
+    {
+        storage.resize(numberOfChannels * m_blockFrames);
+        for (unsigned i = 0; i < numberOfChannels; ++i)
+            channels.push_back(storage.data() + i * m_blockFrames);
+    }
+
+    void resetResamplers()
+    {
+        m_resamplers.clear();
+        for (unsigned i = 0; i < m_numberOfChannels; ++i) {
+            m_resamplers.push_back(unique_ptr<SincResampler>(new SincResampler(m_scaleFactor)));
+            m_queues[i].clear();
+            m_queueStarts[i] = 0;
+        }
+    }
+
+    // Decodes at the file's sample-rate into the stream's channels, mixing down if need be.
+    size_t decode(float* const* channels, size_t framesToDecode)
+    {
+        if (!m_isMixing)
+            return m_decoder->read(channels, framesToDecode);
+
+        unsigned numberOfChannels = m_decoder->numberOfChannels();
+        const float scale = 1.0f / numberOfChannels;
+
+        size_t framesDecoded = 0;
+        while (framesDecoded < framesToDecode) {
+            size_t frames = m_decoder->read(m_mixChannels.data(), min(m_blockFrames, framesToDecode - framesDecoded));
+            if (!frames)
+                break;
+
+            float* destination = channels[0] + framesDecoded;
+            VectorMath::vsmul(m_mixChannels[0], 1, &scale, destination, 1, frames);
+            for (unsigned i = 1; i < numberOfChannels; ++i)
+                VectorMath::vsma(m_mixChannels[i], 1, &scale, destination, 1, frames);
+            framesDecoded += frames;
+        }
+        return framesDecoded;
+    }
+
+    void provide(unsigned channel, float* destination, size_t framesToProvide)
+    {
+        vector<float>& queue = m_queues[channel];
+        size_t& start = m_queueStarts[channel];
+
+        while (framesToProvide) {
+            if (start == queue.size() && !decodeIntoQueues()) {
+                memset(destination, 0, sizeof(float) * framesToProvide);
+                return;
+            }
+
+            size_t frames = min(framesToProvide, queue.size() - start);
+            memcpy(destination, queue.data() + start, sizeof(float) * frames);
+            start += frames;
+            destination += frames;
+            framesToProvide -= frames;
+        }
+    }
+
+    // Appends a block to every channel's queue, dropping what each has already used. Returns false at the end of the file.
+    bool decodeIntoQueues()
+    {
+        size_t frames = decode(m_blockChannels.data(), m_blockFrames);
+        if (!frames)
+            return false;
+
+        for (unsigned i = 0; i < m_numberOfChannels; ++i) {
+            vector<float>& queue = m_queues[i];
+            queue.erase(queue.begin(), queue.begin() + m_queueStarts[i]);
+            queue.insert(queue.end(), m_blockChannels[i], m_blockChannels[i] + frames);
+            m_queueStarts[i] = 0;
+        }
+        return true;
+    }
+
+    unique_ptr<AudioFileDecoder> m_decoder;
+    float m_sampleRate;
+    double m_scaleFactor;
+    unsigned m_numberOfChannels;
+    uint64_t m_length;
+    uint64_t m_position;
+    size_t m_blockFrames;
+
+    // The file's channels, before they're mixed down.
+    bool m_isMixing;
+    vector<float> m_mixStorage;
+    vector<float*> m_mixChannels;
+
+    // Blocks decoded for the resamplers, and queued for each.
+    vector<float> m_blockStorage;
+    vector<float*> m_blockChannels;
+    vector<vector<float>> m_queues;
+    vector<size_t> m_queueStarts;
+
+    vector<unique_ptr<SincResampler>> m_resamplers;
+    vector<unique_ptr<ChannelProvider>> m_providers;
+};
+
+} // namespace
+
+unique_ptr<AudioFileDecoder> AudioFileDecoder::open(const char* filePath)
+{
+    return openSource(FileByteSource::open(filePath));
+}
+
+unique_ptr<AudioFileDecoder> AudioFileDecoder::open(const void* data, size_t dataSize)
+{
+    return openSource(unique_ptr<ByteSource>(new MemoryByteSource(data, dataSize)));
+}
+
+unique_ptr<AudioFileStream> createAudioFileStream(unique_ptr<AudioFileDecoder> decoder, float sampleRate, bool mixToMono)
+{
+    if (!decoder)
+        return nullptr;
+    return unique_ptr<AudioFileStream>(new DecodedAudioFileStream(move(decoder), sampleRate, mixToMono));
+}
+
+unique_ptr<AudioBus> createBusFromAudioFileStream(AudioFileStream& stream)
+{
+    size_t length = static_cast<size_t>(stream.length());
+    unsigned numberOfChannels = stream.numberOfChannels();
+    unique_ptr<AudioBus> bus(new AudioBus(numberOfChannels, length));
+    bus->setSampleRate(stream.sampleRate());
+
+    // Each block is read straight into place, through a bus borrowing the channels' memory.
+    AudioBus block(numberOfChannels, DecodeBlockFrames, false);
+    size_t framesRead = 0;
+    while (framesRead < length) {
+        size_t frames = min(DecodeBlockFrames, length - framesRead);
+        for (unsigned i = 0; i < numberOfChannels; ++i)
+            block.setChannelMemory(i, bus->channel(i)->mutableData() + framesRead, frames);
+
+        // A damaged file leaves the rest of the bus silent.
+        size_t framesThisTime = stream.read(&block, frames);
+        if (!framesThisTime)
+            break;
+        framesRead += framesThisTime;
+    }
+    return bus;
+}
+
+// Darwin reads through ExtAudioFile in AudioFileReaderMac.cpp, and falls back to the decoders above.
+#if !OS(DARWIN)
+
+unique_ptr<AudioBus> createBusFromInMemoryAudioFile(const void* data, size_t dataSize, bool mixToMono, float sampleRate)
+{
+    unique_ptr<AudioFileStream> stream = createAudioFileStream(AudioFileDecoder::open(data, dataSize), sampleRate, mixToMono);
+    return stream ? createBusFromAudioFileStream(*stream) : nullptr;
+}
+
+unique_ptr<AudioBus> createBusFromAudioFile(const char* filePath, bool mixToMono, float sampleRate)
+{
+    unique_ptr<AudioFileStream> stream = createAudioFileStream(AudioFileDecoder::open(filePath), sampleRate, mixToMono);
+    return stream ? createBusFromAudioFileStream(*stream) : nullptr;
+}
+
+unique_ptr<AudioFileStream> createAudioFileStream(const char* filePath, float sampleRate)
+{
+    return createAudioFileStream(AudioFileDecoder::open(filePath), sampleRate, false);
+}
+
+#endif
+
+} // namespace WebCore
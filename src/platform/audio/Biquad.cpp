@@ -62,6 +62,15 @@ Biquad::~Biquad()
 {
 }
 
+void Biquad::setCoefficients(const Biquad& biquad)
+{
+    m_b0 = biquad.m_b0;
+    m_b1 = biquad.m_b1;
+    m_b2 = biquad.m_b2;
+    m_a1 = biquad.m_a1;
+    m_a2 = biquad.m_a2;
+}
+
 void Biquad::process(const float* sourceP, float* destP, size_t framesToProcess)
 {
 #if OS(DARWIN)
@@ -0,0 +1,364 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "BiquadBank.h"
+
+#include "Biquad.h"
+#include "DenormalDisabler.h"
+#include <algorithm>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if HAVE(ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
+
+namespace WebCore {
+
+// Frames interleaved and filtered at a time, small enough for the slice to stay in the L1 cache.
+const size_t SliceFrames = 256;
+
+BiquadBank::BiquadBank(unsigned numberOfLanes, unsigned numberOfSections, Precision precision)
+    : m_numberOfLanes(numberOfLanes)
+    , m_numberOfSections(std::max(numberOfSections, 1u))
+    , m_numberOfGroups((numberOfLanes + LaneWidth - 1) / LaneWidth)
+    , m_precision(precision)
+    , m_isRamping(false)
+    , m_interleaved(SliceFrames * LaneWidth)
+{
+    size_t coefficients = m_numberOfGroups * m_numberOfSections * NumberOfCoefficients * LaneWidth;
+    size_t state = m_numberOfGroups * m_numberOfSections * 2 * LaneWidth;
+
+    if (precision == DoublePrecision) {
+        m_doubleCoefficients.allocate(coefficients);
+        m_doubleState.allocate(state);
+        m_doubleIncrements.allocate(coefficients);
+    } else {
+        m_coefficients.allocate(coefficients);
+        m_state.allocate(state);
+        m_increments.allocate(coefficients);
+    }
+    m_targets.allocate(coefficients);
+
+    // Initialize as pass-thru, including the lanes which only pad out the last group.
+    for (unsigned lane = 0; lane < m_numberOfGroups * LaneWidth; ++lane) {
+        for (unsigned section = 0; section < m_numberOfSections; ++section)
+            setCoefficients(lane, section, 1, 0, 0, 0, 0);
+    }
+}
+
+size_t BiquadBank::coefficientIndex(unsigned lane, unsigned section, Coefficient coefficient) const
+{
+    unsigned group = lane / LaneWidth;
+    return ((group * m_numberOfSections + section) * NumberOfCoefficients + coefficient) * LaneWidth + lane % LaneWidth;
+}
+
+void BiquadBank::setCoefficients(unsigned lane, unsigned section, double b0, double b1, double b2, double a1, double a2)
+{
+    ASSERT(lane < m_numberOfGroups * LaneWidth && section < m_numberOfSections);
+
+    const double values[NumberOfCoefficients] = { b0, b1, b2, a1, a2 };
+    for (int i = 0; i < NumberOfCoefficients; ++i) {
+        size_t index = coefficientIndex(lane, section, static_cast<Coefficient>(i));
+        m_targets[index] = values[i];
+        if (m_precision == DoublePrecision) {
+            m_doubleCoefficients[index] = values[i];
+            m_doubleIncrements[index] = 0;
+        } else {
+            m_coefficients[index] = static_cast<float>(values[i]);
+            m_increments[index] = 0;
+        }
+    }
+}
+
+void BiquadBank::rampCoefficients(unsigned lane, unsigned section, const Biquad& biquad, size_t framesToRamp)
+{
+    ASSERT(lane < m_numberOfGroups * LaneWidth && section < m_numberOfSections);
+
+    if (!framesToRamp) {
+        setCoefficients(lane, section, biquad);
+        return;
+    }
+
+    const double values[NumberOfCoefficients] = { biquad.b0(), biquad.b1(), biquad.b2(), biquad.a1(), biquad.a2() };
+    for (int i = 0; i < NumberOfCoefficients; ++i) {
+        size_t index = coefficientIndex(lane, section, static_cast<Coefficient>(i));
+        double step = (values[i] - m_targets[index]) / framesToRamp;
+        m_targets[index] = values[i];
+        if (m_precision == DoublePrecision)
+            m_doubleIncrements[index] = step;
+        else
+            m_increments[index] = static_cast<float>(step);
+    }
+
+    m_isRamping = true;
+}
+
+void BiquadBank::setCoefficients(unsigned lane, unsigned section, const Biquad& biquad)
+{
+    setCoefficients(lane, section, biquad.b0(), biquad.b1(), biquad.b2(), biquad.a1(), biquad.a2());
+}
+
+void BiquadBank::reset()
+{
+    if (m_precision == DoublePrecision)
+        m_doubleState.zero();
+    else
+        m_state.zero();
+}
+
+void BiquadBank::process(const float* const* sourcesP, float* const* destsP, size_t framesToProcess)
+{
+    float* interleaved = m_interleaved.data();
+
+    for (unsigned group = 0; group < m_numberOfGroups; ++group) {
+        unsigned firstLane = group * LaneWidth;
+        unsigned lanes = m_numberOfLanes - firstLane;
+        if (lanes > LaneWidth)
+            lanes = LaneWidth;
+
+        for (size_t offset = 0; offset < framesToProcess; offset += SliceFrames) {
+            size_t frames = std::min(SliceFrames, framesToProcess - offset);
+
+            // The lanes padding out the last group filter silence.
+            if (lanes < LaneWidth)
+                memset(interleaved, 0, sizeof(float) * LaneWidth * frames);
+
+            for (unsigned k = 0; k < lanes; ++k) {
+                const float* source = sourcesP[firstLane + k] + offset;
+                for (size_t i = 0; i < frames; ++i)
+                    interleaved[i * LaneWidth + k] = source[i];
+            }
+
+            if (m_precision == DoublePrecision)
+                processGroupDouble(group, frames);
+            else
+                processGroupSingle(group, frames);
+
+            for (unsigned k = 0; k < lanes; ++k) {
+                float* dest = destsP[firstLane + k] + offset;
+                for (size_t i = 0; i < frames; ++i)
+                    dest[i] = interleaved[i * LaneWidth + k];
+            }
+        }
+    }
+
+    if (m_isRamping) {
+        // Arrive exactly, rather than with the rounding of the steps.
+        for (size_t i = 0; i < m_targets.size(); ++i) {
+            if (m_precision == DoublePrecision) {
+                m_doubleCoefficients[i] = m_targets[i];
+                m_doubleIncrements[i] = 0;
+            } else {
+                m_coefficients[i] = static_cast<float>(m_targets[i]);
+                m_increments[i] = 0;
+            }
+        }
+        m_isRamping = false;
+    }
+}
+
+void BiquadBank::processGroupSingle(unsigned group, size_t framesToProcess)
+{
+    float* data = m_interleaved.data();
+
+    // The sections of a cascade each filter the whole slice in turn, keeping their coefficients and state in registers.
+    // While ramping, the coefficients are stepped before each frame and stored back for the next slice.
+    for (unsigned section = 0; section < m_numberOfSections; ++section) {
+        float* coefficients = m_coefficients.data() + coefficientIndex(group * LaneWidth, section, B0);
+        const float* increments = m_increments.data() + coefficientIndex(group * LaneWidth, section, B0);
+        float* state = m_state.data() + (group * m_numberOfSections + section) * 2 * LaneWidth;
+        size_t i = 0;
+
+#ifdef __SSE2__
+        {
+            __m128 b0 = _mm_load_ps(coefficients + B0 * LaneWidth);
+            __m128 b1 = _mm_load_ps(coefficients + B1 * LaneWidth);
+            __m128 b2 = _mm_load_ps(coefficients + B2 * LaneWidth);
+            __m128 a1 = _mm_load_ps(coefficients + A1 * LaneWidth);
+            __m128 a2 = _mm_load_ps(coefficients + A2 * LaneWidth);
+            __m128 s1 = _mm_load_ps(state);
+            __m128 s2 = _mm_load_ps(state + LaneWidth);
+
+            if (m_isRamping) {
+                __m128 db0 = _mm_load_ps(increments + B0 * LaneWidth);
+                __m128 db1 = _mm_load_ps(increments + B1 * LaneWidth);
+                __m128 db2 = _mm_load_ps(increments + B2 * LaneWidth);
+                __m128 da1 = _mm_load_ps(increments + A1 * LaneWidth);
+                __m128 da2 = _mm_load_ps(increments + A2 * LaneWidth);
+
+                for (; i < framesToProcess; ++i) {
+                    b0 = _mm_add_ps(b0, db0);
+                    b1 = _mm_add_ps(b1, db1);
+                    b2 = _mm_add_ps(b2, db2);
+                    a1 = _mm_add_ps(a1, da1);
+                    a2 = _mm_add_ps(a2, da2);
+
+                    __m128 x = _mm_load_ps(data + i * LaneWidth);
+                    __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), s1);
+                    s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), s2);
+                    s2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+                    _mm_store_ps(data + i * LaneWidth, y);
+                }
+
+                _mm_store_ps(coefficients + B0 * LaneWidth, b0);
+                _mm_store_ps(coefficients + B1 * LaneWidth, b1);
+                _mm_store_ps(coefficients + B2 * LaneWidth, b2);
+                _mm_store_ps(coefficients + A1 * LaneWidth, a1);
+                _mm_store_ps(coefficients + A2 * LaneWidth, a2);
+            } else {
+                for (; i < framesToProcess; ++i) {
+                    __m128 x = _mm_load_ps(data + i * LaneWidth);
+                    __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), s1);
+                    s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), s2);
+                    s2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+                    _mm_store_ps(data + i * LaneWidth, y);
+                }
+            }
+
+            _mm_store_ps(state, s1);
+            _mm_store_ps(state + LaneWidth, s2);
+        }
+#elif HAVE(ARM_NEON_INTRINSICS)
+        {
+            float32x4_t b0 = vld1q_f32(coefficients + B0 * LaneWidth);
+            float32x4_t b1 = vld1q_f32(coefficients + B1 * LaneWidth);
+            float32x4_t b2 = vld1q_f32(coefficients + B2 * LaneWidth);
+            float32x4_t a1 = vld1q_f32(coefficients + A1 * LaneWidth);
+            float32x4_t a2 = vld1q_f32(coefficients + A2 * LaneWidth);
+            float32x4_t s1 = vld1q_f32(state);
+            float32x4_t s2 = vld1q_f32(state + LaneWidth);
+
+            if (m_isRamping) {
+                float32x4_t db0 = vld1q_f32(increments + B0 * LaneWidth);
+                float32x4_t db1 = vld1q_f32(increments + B1 * LaneWidth);
+                float32x4_t db2 = vld1q_f32(increments + B2 * LaneWidth);
+                float32x4_t da1 = vld1q_f32(increments + A1 * LaneWidth);
+                float32x4_t da2 = vld1q_f32(increments + A2 * LaneWidth);
+
+                for (; i < framesToProcess; ++i) {
+                    b0 = vaddq_f32(b0, db0);
+                    b1 = vaddq_f32(b1, db1);
+                    b2 = vaddq_f32(b2, db2);
+                    a1 = vaddq_f32(a1, da1);
+                    a2 = vaddq_f32(a2, da2);
+
+                    float32x4_t x = vld1q_f32(data + i * LaneWidth);
+                    float32x4_t y = vmlaq_f32(s1, b0, x);
+                    s1 = vaddq_f32(vmlsq_f32(vmulq_f32(b1, x), a1, y), s2);
+                    s2 = vmlsq_f32(vmulq_f32(b2, x), a2, y);
+                    vst1q_f32(data + i * LaneWidth, y);
+                }
+
+                vst1q_f32(coefficients + B0 * LaneWidth, b0);
+                vst1q_f32(coefficients + B1 * LaneWidth, b1);
+                vst1q_f32(coefficients + B2 * LaneWidth, b2);
+                vst1q_f32(coefficients + A1 * LaneWidth, a1);
+                vst1q_f32(coefficients + A2 * LaneWidth, a2);
+            } else {
+                for (; i < framesToProcess; ++i) {
+                    float32x4_t x = vld1q_f32(data + i * LaneWidth);
+                    float32x4_t y = vmlaq_f32(s1, b0, x);
+                    s1 = vaddq_f32(vmlsq_f32(vmulq_f32(b1, x), a1, y), s2);
+                    s2 = vmlsq_f32(vmulq_f32(b2, x), a2, y);
+                    vst1q_f32(data + i * LaneWidth, y);
+                }
+            }
+
+            vst1q_f32(state, s1);
+            vst1q_f32(state + LaneWidth, s2);
+        }
+#endif
+
+        float* s1 = state;
+        float* s2 = state + LaneWidth;
+        for (; i < framesToProcess; ++i) {
+            float* x = data + i * LaneWidth;
+            if (m_isRamping) {
+                for (unsigned k = 0; k < NumberOfCoefficients * LaneWidth; ++k)
+                    coefficients[k] += increments[k];
+            }
+            for (unsigned k = 0; k < LaneWidth; ++k) {
+                float y = coefficients[B0 * LaneWidth + k] * x[k] + s1[k];
+                s1[k] = coefficients[B1 * LaneWidth + k] * x[k] - coefficients[A1 * LaneWidth + k] * y + s2[k];
+                s2[k] = coefficients[B2 * LaneWidth + k] * x[k] - coefficients[A2 * LaneWidth + k] * y;
+                x[k] = y;
+            }
+        }
+
+        // Flush denormals here so we don't slow down the inner loop above.
+        for (unsigned k = 0; k < 2 * LaneWidth; ++k)
+            state[k] = DenormalDisabler::flushDenormalFloatToZero(state[k]);
+    }
+}
+
+void BiquadBank::processGroupDouble(unsigned group, size_t framesToProcess)
+{
+    float* data = m_interleaved.data();
+
+    for (unsigned section = 0; section < m_numberOfSections; ++section) {
+        double* coefficients = m_doubleCoefficients.data() + coefficientIndex(group * LaneWidth, section, B0);
+        const double* increments = m_doubleIncrements.data() + coefficientIndex(group * LaneWidth, section, B0);
+        double* state = m_doubleState.data() + (group * m_numberOfSections + section) * 2 * LaneWidth;
+
+        double b0[LaneWidth], b1[LaneWidth], b2[LaneWidth], a1[LaneWidth], a2[LaneWidth];
+        double s1[LaneWidth], s2[LaneWidth];
+        for (unsigned k = 0; k < LaneWidth; ++k) {
+            b0[k] = coefficients[B0 * LaneWidth + k];
+            b1[k] = coefficients[B1 * LaneWidth + k];
+            b2[k] = coefficients[B2 * LaneWidth + k];
+            a1[k] = coefficients[A1 * LaneWidth + k];
+            a2[k] = coefficients[A2 * LaneWidth + k];
+            s1[k] = state[k];
+            s2[k] = state[LaneWidth + k];
+        }
+
+        // The lanes are independent, so the compiler is free to run them in vector registers.
+        if (m_isRamping) {
+            for (size_t i = 0; i < framesToProcess; ++i) {
+                float* x = data + i * LaneWidth;
+                for (unsigned k = 0; k < LaneWidth; ++k) {
+                    b0[k] += increments[B0 * LaneWidth + k];
+                    b1[k] += increments[B1 * LaneWidth + k];
+                    b2[k] += increments[B2 * LaneWidth + k];
+                    a1[k] += increments[A1 * LaneWidth + k];
+                    a2[k] += increments[A2 * LaneWidth + k];
+
+                    double y = b0[k] * x[k] + s1[k];
+                    s1[k] = b1[k] * x[k] - a1[k] * y + s2[k];
+                    s2[k] = b2[k] * x[k] - a2[k] * y;
+                    x[k] = static_cast<float>(y);
+                }
+            }
+
+            for (unsigned k = 0; k < LaneWidth; ++k) {
+                coefficients[B0 * LaneWidth + k] = b0[k];
+                coefficients[B1 * LaneWidth + k] = b1[k];
+                coefficients[B2 * LaneWidth + k] = b2[k];
+                coefficients[A1 * LaneWidth + k] = a1[k];
+                coefficients[A2 * LaneWidth + k] = a2[k];
+            }
+        } else {
+            for (size_t i = 0; i < framesToProcess; ++i) {
+                float* x = data + i * LaneWidth;
+                for (unsigned k = 0; k < LaneWidth; ++k) {
+                    double y = b0[k] * x[k] + s1[k];
+                    s1[k] = b1[k] * x[k] - a1[k] * y + s2[k];
+                    s2[k] = b2[k] * x[k] - a2[k] * y;
+                    x[k] = static_cast<float>(y);
+                }
+            }
+        }
+
+        for (unsigned k = 0; k < LaneWidth; ++k) {
+            state[k] = DenormalDisabler::flushDenormalFloatToZero(static_cast<float>(s1[k])) ? s1[k] : 0;
+            state[LaneWidth + k] = DenormalDisabler::flushDenormalFloatToZero(static_cast<float>(s2[k])) ? s2[k] : 0;
+        }
+    }
+}
+
+} // namespace WebCore
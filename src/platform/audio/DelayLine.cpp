@@ -0,0 +1,247 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "DelayLine.h"
+
+#include "VectorMath.h"
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace WebCore {
+
+// Frames written and then read at a time. The buffer holds this many frames beyond the longest delay,
+// plus the taps either side of it that Lagrange interpolation reads.
+const size_t ChunkFrames = 128;
+const size_t ExtraTapFrames = 3;
+
+static size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+// Weights of the four taps around a fraction t of the way from the second tap to the third.
+static inline void lagrangeWeights(float t, float* weights)
+{
+    weights[0] = -t * (t - 1) * (t - 2) / 6;
+    weights[1] = (t + 1) * (t - 1) * (t - 2) / 2;
+    weights[2] = -(t + 1) * t * (t - 2) / 2;
+    weights[3] = (t + 1) * t * (t - 1) / 6;
+}
+
+DelayLine::DelayLine(size_t maxDelayFrames, Interpolation interpolation)
+    : m_maxDelayFrames(maxDelayFrames)
+    , m_writePosition(0)
+    , m_interpolation(interpolation)
+    , m_allpassOutput(0)
+{
+    size_t bufferLength = roundUpToPowerOfTwo(maxDelayFrames + ChunkFrames + ExtraTapFrames);
+    m_buffer.allocate(bufferLength);
+    m_buffer.zero();
+    m_mask = bufferLength - 1;
+}
+
+void DelayLine::setInterpolation(Interpolation interpolation)
+{
+    if (interpolation == m_interpolation)
+        return;
+
+    m_interpolation = interpolation;
+    m_allpassOutput = 0;
+}
+
+void DelayLine::reset()
+{
+    m_buffer.zero();
+    m_allpassOutput = 0;
+}
+
+void DelayLine::process(const float* source, float* destination, size_t framesToProcess, double delayFrames)
+{
+    delayFrames = std::min(static_cast<double>(m_maxDelayFrames), std::max(0.0, delayFrames));
+
+    // Each chunk is written before it is read, so that delays shorter than a chunk read this chunk's frames.
+    for (size_t offset = 0; offset < framesToProcess; offset += ChunkFrames) {
+        size_t frames = std::min(ChunkFrames, framesToProcess - offset);
+        write(source + offset, frames);
+        readConstant(destination + offset, frames, delayFrames);
+    }
+}
+
+void DelayLine::process(const float* source, float* destination, size_t framesToProcess, const float* delayFrames)
+{
+    for (size_t offset = 0; offset < framesToProcess; offset += ChunkFrames) {
+        size_t frames = std::min(ChunkFrames, framesToProcess - offset);
+        write(source + offset, frames);
+        readModulated(destination + offset, frames, delayFrames + offset);
+    }
+}
+
+void DelayLine::write(const float* source, size_t framesToProcess)
+{
+    while (framesToProcess) {
+        size_t index = m_writePosition & m_mask;
+        size_t run = std::min(framesToProcess, m_buffer.size() - index);
+        memcpy(m_buffer.data() + index, source, sizeof(float) * run);
+        m_writePosition += run;
+        source += run;
+        framesToProcess -= run;
+    }
+}
+
+void DelayLine::readTap(size_t position, float scale, float* destination, size_t framesToProcess, bool replace)
+{
+    while (framesToProcess) {
+        size_t index = position & m_mask;
+        size_t run = std::min(framesToProcess, m_buffer.size() - index);
+        const float* source = m_buffer.data() + index;
+
+        if (!replace)
+            VectorMath::vsma(source, 1, &scale, destination, 1, run);
+        else if (scale == 1)
+            memcpy(destination, source, sizeof(float) * run);
+        else
+            VectorMath::vsmul(source, 1, &scale, destination, 1, run);
+
+        position += run;
+        destination += run;
+        framesToProcess -= run;
+    }
+}
+
+void DelayLine::readConstant(float* destination, size_t framesToProcess, double delayFrames)
+{
+    // The chunk just written starts at |first|; a frame |whole| frames back from it is the nearer of the
+    // two that the delay falls between.
+    size_t first = m_writePosition - framesToProcess;
+    size_t whole = static_cast<size_t>(delayFrames);
+    float fraction = static_cast<float>(delayFrames - whole);
+
+    // Keep the allpass's fraction in [0.5, 1.5), where its phase delay is flattest. A delay under half a frame
+    // has no earlier frame to borrow from, and its coefficient would put the pole almost on the unit circle, so
+    // it is interpolated linearly instead, carrying the allpass's state on from the output.
+    if (m_interpolation == AllpassInterpolation && (whole || fraction >= 0.5f)) {
+        if (whole && fraction < 0.5f) {
+            --whole;
+            fraction += 1;
+        }
+
+        const float* buffer = m_buffer.data();
+        float coefficient = (1 - fraction) / (1 + fraction);
+        float output = m_allpassOutput;
+        for (size_t i = 0; i < framesToProcess; ++i) {
+            size_t position = first + i - whole;
+            output = coefficient * (buffer[position & m_mask] - output) + buffer[(position - 1) & m_mask];
+            destination[i] = output;
+        }
+        m_allpassOutput = output;
+        return;
+    }
+
+    if (!fraction) {
+        readTap(first - whole, 1, destination, framesToProcess, true);
+        if (m_interpolation == AllpassInterpolation && framesToProcess)
+            m_allpassOutput = destination[framesToProcess - 1];
+        return;
+    }
+
+    if (m_interpolation == LagrangeInterpolation && whole) {
+        float weights[4];
+        lagrangeWeights(fraction, weights);
+        readTap(first - whole + 1, weights[0], destination, framesToProcess, true);
+        readTap(first - whole, weights[1], destination, framesToProcess, false);
+        readTap(first - whole - 1, weights[2], destination, framesToProcess, false);
+        readTap(first - whole - 2, weights[3], destination, framesToProcess, false);
+        return;
+    }
+
+    readTap(first - whole, 1 - fraction, destination, framesToProcess, true);
+    readTap(first - whole - 1, fraction, destination, framesToProcess, false);
+
+    if (m_interpolation == AllpassInterpolation && framesToProcess)
+        m_allpassOutput = destination[framesToProcess - 1];
+}
+
+void DelayLine::readModulated(float* destination, size_t framesToProcess, const float* delayFrames)
+{
+    const float* buffer = m_buffer.data();
+    const size_t mask = m_mask;
+    const float maxDelay = static_cast<float>(m_maxDelayFrames);
+    size_t first = m_writePosition - framesToProcess;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // The four frames' samples are gathered one at a time, but the delays are split, and the samples
+    // interpolated, a register at a time.
+    if (m_interpolation == LinearInterpolation) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 maxDelays = _mm_set1_ps(maxDelay);
+
+        for (; i + 4 <= framesToProcess; i += 4) {
+            // Max before min, so that a NaN delay becomes zero.
+            __m128 delays = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(delayFrames + i), zero), maxDelays);
+            __m128i whole = _mm_cvttps_epi32(delays);
+            __m128 fraction = _mm_sub_ps(delays, _mm_cvtepi32_ps(whole));
+
+            int32_t offsets[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(offsets), whole);
+            size_t position0 = first + i - offsets[0];
+            size_t position1 = first + i + 1 - offsets[1];
+            size_t position2 = first + i + 2 - offsets[2];
+            size_t position3 = first + i + 3 - offsets[3];
+
+            __m128 sample0 = _mm_setr_ps(buffer[position0 & mask], buffer[position1 & mask], buffer[position2 & mask], buffer[position3 & mask]);
+            __m128 sample1 = _mm_setr_ps(buffer[(position0 - 1) & mask], buffer[(position1 - 1) & mask], buffer[(position2 - 1) & mask], buffer[(position3 - 1) & mask]);
+            _mm_storeu_ps(destination + i, _mm_add_ps(sample0, _mm_mul_ps(fraction, _mm_sub_ps(sample1, sample0))));
+        }
+    }
+#endif
+
+    for (; i < framesToProcess; ++i) {
+        float delay = std::min(maxDelay, std::max(0.0f, delayFrames[i]));
+        size_t whole = static_cast<size_t>(delay);
+        float fraction = delay - whole;
+        size_t position = first + i - whole;
+        float sample0 = buffer[position & mask];
+        float sample1 = buffer[(position - 1) & mask];
+
+        switch (m_interpolation) {
+        case LinearInterpolation:
+            destination[i] = sample0 + fraction * (sample1 - sample0);
+            break;
+
+        case LagrangeInterpolation:
+            if (whole) {
+                float weights[4];
+                lagrangeWeights(fraction, weights);
+                destination[i] = weights[0] * buffer[(position + 1) & mask] + weights[1] * sample0 + weights[2] * sample1 + weights[3] * buffer[(position - 2) & mask];
+            } else
+                destination[i] = sample0 + fraction * (sample1 - sample0);
+            break;
+
+        case AllpassInterpolation:
+            if (!whole && fraction < 0.5f)
+                m_allpassOutput = sample0 + fraction * (sample1 - sample0);
+            else {
+                if (fraction < 0.5f) {
+                    sample1 = sample0;
+                    sample0 = buffer[(position + 1) & mask];
+                    fraction += 1;
+                }
+                m_allpassOutput = (1 - fraction) / (1 + fraction) * (sample0 - m_allpassOutput) + sample1;
+            }
+            destination[i] = m_allpassOutput;
+            break;
+        }
+    }
+}
+
+} // namespace WebCore
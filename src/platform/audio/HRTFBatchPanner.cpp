@@ -0,0 +1,435 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "HRTFBatchPanner.h"
+
+#include "AudioBus.h"
+#include "HRTFDatabase.h"
+#include "HRTFDatabaseLoader.h"
+#include "HRTFPanner.h"
+#include "VectorMath.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+
+namespace WebCore {
+
+using namespace VectorMath;
+
+// As for HRTFPanner, which is larger than the largest delay of any kernel in the database.
+const double MaxDelayTimeSeconds = 0.002;
+
+const int UninitializedAzimuth = -1;
+
+struct HRTFBatchPanner::Source {
+    Source(size_t fftSize, size_t maxDelayFrames)
+        : delayLineL(maxDelayFrames)
+        , delayLineR(maxDelayFrames)
+        , inputL(fftSize) // 2nd half of each block is always zeroed
+        , inputR(fftSize)
+        , desiredAzimuthIndex(UninitializedAzimuth)
+        , azimuthBlend(0)
+        , desiredElevation(0)
+        , gain(1)
+        , lastGain(-1)
+        , isCrossfadeSelection2(false)
+        , azimuthIndex1(UninitializedAzimuth)
+        , elevation1(0)
+        , azimuthIndex2(UninitializedAzimuth)
+        , elevation2(0)
+        , crossfadeX(0)
+        , crossfadeIncr(0)
+        , frameDelayL(-1)
+        , frameDelayR(-1)
+        , soundedThisBlock(false)
+        , soundedLastBlock(false)
+    {
+    }
+
+    DelayLine delayLineL;
+    DelayLine delayLineR;
+    AudioFloatArray inputL;
+    AudioFloatArray inputR;
+
+    // Where the source was last positioned.
+    int desiredAzimuthIndex;
+    double azimuthBlend;
+    double desiredElevation;
+    float gain;
+    float lastGain;
+
+    // Cross-fades between two positions, as HRTFPanner's between its two sets of convolvers.
+    bool isCrossfadeSelection2;
+    int azimuthIndex1;
+    double elevation1;
+    int azimuthIndex2;
+    double elevation2;
+    float crossfadeX;
+    float crossfadeIncr;
+
+    // The inter-aural delays at the end of the last division, which the next division moves on from.
+    double frameDelayL;
+    double frameDelayR;
+
+    // A source which sounded in neither block has nothing left in its delay lines, and can be skipped.
+    bool soundedThisBlock;
+    bool soundedLastBlock;
+};
+
+HRTFBatchPanner::HRTFBatchPanner(float sampleRate, unsigned numberOfSources)
+    : m_sampleRate(sampleRate)
+    , m_fftSize(HRTFPanner::fftSizeForSampleRate(sampleRate))
+    , m_databaseLoader(HRTFDatabaseLoader::createAndLoadAsynchronouslyIfNecessary(sampleRate))
+    , m_readWriteIndex(0)
+    , m_sourceFrame(m_fftSize)
+    , m_blendedKernel(m_fftSize)
+    , m_accumulatorL(m_fftSize)
+    , m_accumulatorR(m_fftSize)
+    , m_outputL(m_fftSize)
+    , m_outputR(m_fftSize)
+    , m_lastOverlapL(m_fftSize / 2)
+    , m_lastOverlapR(m_fftSize / 2)
+    , m_delayRamp(m_fftSize / 2)
+    , m_silence(m_fftSize / 2)
+{
+    size_t maxDelayFrames = static_cast<size_t>(ceil(MaxDelayTimeSeconds * sampleRate));
+    for (unsigned i = 0; i < numberOfSources; ++i)
+        m_sources.push_back(unique_ptr<Source>(new Source(m_fftSize, maxDelayFrames)));
+}
+
+HRTFBatchPanner::~HRTFBatchPanner()
+{
+}
+
+void HRTFBatchPanner::setSource(unsigned index, double desiredAzimuth, double elevation, float gain)
+{
+    ASSERT(index < m_sources.size());
+    if (index >= m_sources.size())
+        return;
+
+    Source& source = *m_sources[index];
+
+    // IRCAM HRTF azimuths values from the loaded database is reversed from the panner's notion of azimuth.
+    double azimuth = -desiredAzimuth;
+    ASSERT(azimuth >= -180.0 && azimuth <= 180.0);
+    if (azimuth < 0)
+        azimuth += 360.0;
+
+    int numberOfAzimuths = HRTFDatabase::numberOfAzimuths();
+    double desiredAzimuthIndexFloat = azimuth / (360.0 / numberOfAzimuths);
+    int desiredAzimuthIndex = static_cast<int>(desiredAzimuthIndexFloat);
+    source.azimuthBlend = desiredAzimuthIndexFloat - static_cast<double>(desiredAzimuthIndex);
+    source.desiredAzimuthIndex = min(numberOfAzimuths - 1, max(0, desiredAzimuthIndex));
+    source.desiredElevation = elevation;
+    source.gain = gain;
+
+    // Initially snap azimuth and elevation values to first values encountered.
+    if (source.azimuthIndex1 == UninitializedAzimuth) {
+        source.azimuthIndex1 = source.azimuthIndex2 = source.desiredAzimuthIndex;
+        source.elevation1 = source.elevation2 = elevation;
+    }
+}
+
+void HRTFBatchPanner::beginBlock()
+{
+    // Cross-fade over around 45 milliseconds, as HRTFPanner does, in steps of a block.
+    const double fadeFrames = m_sampleRate <= 48000 ? 2048 : 4096;
+
+    for (auto& s : m_sources) {
+        Source& source = *s;
+        if (source.desiredAzimuthIndex == UninitializedAzimuth)
+            continue;
+
+        if (!source.crossfadeX && !source.isCrossfadeSelection2) {
+            if (source.desiredAzimuthIndex != source.azimuthIndex1 || source.desiredElevation != source.elevation1) {
+                source.crossfadeIncr = static_cast<float>(1 / fadeFrames);
+                source.azimuthIndex2 = source.desiredAzimuthIndex;
+                source.elevation2 = source.desiredElevation;
+            }
+        }
+        if (source.crossfadeX == 1 && source.isCrossfadeSelection2) {
+            if (source.desiredAzimuthIndex != source.azimuthIndex2 || source.desiredElevation != source.elevation2) {
+                source.crossfadeIncr = static_cast<float>(-1 / fadeFrames);
+                source.azimuthIndex1 = source.desiredAzimuthIndex;
+                source.elevation1 = source.desiredElevation;
+            }
+        }
+
+        source.soundedLastBlock = source.soundedThisBlock;
+        source.soundedThisBlock = false;
+    }
+}
+
+void HRTFBatchPanner::delaySource(HRTFDatabase* database, Source& source, const float* sourceP, size_t framesToProcess)
+{
+    float* inputL = source.inputL.data() + m_readWriteIndex;
+    float* inputR = source.inputR.data() + m_readWriteIndex;
+
+    // A source with nothing left in its delay lines is left alone until it sounds again.
+    if (!sourceP && !source.soundedThisBlock && !source.soundedLastBlock) {
+        memset(inputL, 0, sizeof(float) * framesToProcess);
+        memset(inputR, 0, sizeof(float) * framesToProcess);
+        return;
+    }
+
+    if (sourceP)
+        source.soundedThisBlock = true;
+    else
+        sourceP = m_silence.data();
+
+    HRTFKernel* kernelL;
+    HRTFKernel* kernelR;
+    double frameDelayL1 = 0;
+    double frameDelayR1 = 0;
+    double frameDelayL2 = 0;
+    double frameDelayR2 = 0;
+    if (source.azimuthIndex1 != UninitializedAzimuth) {
+        database->getKernelsFromAzimuthElevation(source.azimuthBlend, source.azimuthIndex1, source.elevation1, kernelL, kernelR, frameDelayL1, frameDelayR1);
+        database->getKernelsFromAzimuthElevation(source.azimuthBlend, source.azimuthIndex2, source.elevation2, kernelL, kernelR, frameDelayL2, frameDelayR2);
+    }
+
+    // Cross-fade inter-aural delays as the kernels are.
+    double x = source.crossfadeX;
+    double frameDelays[2] = { (1 - x) * frameDelayL1 + x * frameDelayL2, (1 - x) * frameDelayR1 + x * frameDelayR2 };
+    double* lastFrameDelays[2] = { &source.frameDelayL, &source.frameDelayR };
+    DelayLine* delayLines[2] = { &source.delayLineL, &source.delayLineR };
+    float* inputs[2] = { inputL, inputR };
+
+    for (unsigned ear = 0; ear < 2; ++ear) {
+        double lastFrameDelay = *lastFrameDelays[ear];
+        if (lastFrameDelay < 0 || lastFrameDelay == frameDelays[ear])
+            delayLines[ear]->process(sourceP, inputs[ear], framesToProcess, frameDelays[ear]);
+        else {
+            // Glide to the new delay over the division, rather than jumping.
+            float start = static_cast<float>(lastFrameDelay);
+            float step = static_cast<float>((frameDelays[ear] - lastFrameDelay) / framesToProcess);
+            vramp(&start, &step, m_delayRamp.data(), 1, framesToProcess);
+            delayLines[ear]->process(sourceP, inputs[ear], framesToProcess, m_delayRamp.data());
+        }
+        *lastFrameDelays[ear] = frameDelays[ear];
+    }
+
+    // Snap to the first gain, and de-zipper changes after that.
+    if (source.lastGain < 0)
+        source.lastGain = source.gain;
+
+    if (source.lastGain == source.gain) {
+        vsmul(inputL, 1, &source.gain, inputL, 1, framesToProcess);
+        vsmul(inputR, 1, &source.gain, inputR, 1, framesToProcess);
+    } else {
+        float gain = source.lastGain;
+        float step = (source.gain - source.lastGain) / framesToProcess;
+        for (size_t i = 0; i < framesToProcess; ++i) {
+            gain += step;
+            inputL[i] *= gain;
+            inputR[i] *= gain;
+        }
+        source.lastGain = source.gain;
+    }
+}
+
+void HRTFBatchPanner::accumulate(const FFTFrame& sourceFrame, const FFTFrame& kernel, FFTFrame& accumulator)
+{
+    size_t halfSize = m_fftSize / 2;
+    const float* realP1 = sourceFrame.realData();
+    const float* imagP1 = sourceFrame.imagData();
+    const float* realP2 = kernel.realData();
+    const float* imagP2 = kernel.imagData();
+    float* realDestP = accumulator.realData();
+    float* imagDestP = accumulator.imagData();
+
+    float real0 = realDestP[0];
+    float imag0 = imagDestP[0];
+
+    zvmula(realP1, imagP1, realP2, imagP2, realDestP, imagDestP, halfSize);
+
+    // Accumulate the packed DC/nyquist component. The product's scaling by half is left to the sum.
+    realDestP[0] = real0 + realP1[0] * realP2[0];
+    imagDestP[0] = imag0 + imagP1[0] * imagP2[0];
+}
+
+void HRTFBatchPanner::processBlock(HRTFDatabase* database)
+{
+    size_t halfSize = m_fftSize / 2;
+    float* accumulators[2][2] = { { m_accumulatorL.realData(), m_accumulatorL.imagData() }, { m_accumulatorR.realData(), m_accumulatorR.imagData() } };
+    for (unsigned ear = 0; ear < 2; ++ear) {
+        memset(accumulators[ear][0], 0, sizeof(float) * halfSize);
+        memset(accumulators[ear][1], 0, sizeof(float) * halfSize);
+    }
+
+    bool isSounding = false;
+    for (auto& s : m_sources) {
+        Source& source = *s;
+
+        bool isActive = source.soundedThisBlock || source.soundedLastBlock;
+        if (isActive && source.azimuthIndex1 != UninitializedAzimuth) {
+            isSounding = true;
+
+            HRTFKernel* kernelL1;
+            HRTFKernel* kernelR1;
+            HRTFKernel* kernelL2;
+            HRTFKernel* kernelR2;
+            double frameDelayL;
+            double frameDelayR;
+            database->getKernelsFromAzimuthElevation(source.azimuthBlend, source.azimuthIndex1, source.elevation1, kernelL1, kernelR1, frameDelayL, frameDelayR);
+            database->getKernelsFromAzimuthElevation(source.azimuthBlend, source.azimuthIndex2, source.elevation2, kernelL2, kernelR2, frameDelayL, frameDelayR);
+
+            HRTFKernel* kernels[2][2] = { { kernelL1, kernelL2 }, { kernelR1, kernelR2 } };
+            const AudioFloatArray* inputs[2] = { &source.inputL, &source.inputR };
+            FFTFrame* accumulatorFrames[2] = { &m_accumulatorL, &m_accumulatorR };
+
+            float x = source.crossfadeX;
+            for (unsigned ear = 0; ear < 2; ++ear) {
+                if (!kernels[ear][0] || !kernels[ear][1])
+                    continue;
+
+                m_sourceFrame.doFFT(inputs[ear]->data());
+
+                if (!source.crossfadeIncr) {
+                    // Not cross-fading: only the selected position's kernel is heard.
+                    accumulate(m_sourceFrame, *kernels[ear][source.isCrossfadeSelection2 ? 1 : 0]->fftFrame(), *accumulatorFrames[ear]);
+                    continue;
+                }
+
+                // The filters are linear, so blending the kernels is blending the two convolutions.
+                const FFTFrame& kernel1 = *kernels[ear][0]->fftFrame();
+                const FFTFrame& kernel2 = *kernels[ear][1]->fftFrame();
+                float weight1 = 1 - x;
+                vsmul(kernel1.realData(), 1, &weight1, m_blendedKernel.realData(), 1, halfSize);
+                vsmul(kernel1.imagData(), 1, &weight1, m_blendedKernel.imagData(), 1, halfSize);
+                vsma(kernel2.realData(), 1, &x, m_blendedKernel.realData(), 1, halfSize);
+                vsma(kernel2.imagData(), 1, &x, m_blendedKernel.imagData(), 1, halfSize);
+                accumulate(m_sourceFrame, m_blendedKernel, *accumulatorFrames[ear]);
+            }
+        }
+
+        // Step cross-fades a block at a time, finishing them as HRTFPanner does.
+        if (source.crossfadeIncr) {
+            source.crossfadeX += source.crossfadeIncr * halfSize;
+            if (source.crossfadeIncr > 0 && source.crossfadeX > 1 - source.crossfadeIncr) {
+                source.isCrossfadeSelection2 = true;
+                source.crossfadeX = 1;
+                source.crossfadeIncr = 0;
+            } else if (source.crossfadeIncr < 0 && source.crossfadeX < -source.crossfadeIncr) {
+                source.isCrossfadeSelection2 = false;
+                source.crossfadeX = 0;
+                source.crossfadeIncr = 0;
+            }
+        }
+    }
+
+    float* outputs[2] = { m_outputL.data(), m_outputR.data() };
+    float* lastOverlaps[2] = { m_lastOverlapL.data(), m_lastOverlapR.data() };
+    FFTFrame* accumulatorFrames[2] = { &m_accumulatorL, &m_accumulatorR };
+
+    for (unsigned ear = 0; ear < 2; ++ear) {
+        float* outputP = outputs[ear];
+        float* lastOverlapP = lastOverlaps[ear];
+
+        // With nothing sounding, only the last block's overlap remains.
+        if (!isSounding) {
+            memcpy(outputP, lastOverlapP, sizeof(float) * halfSize);
+            memset(lastOverlapP, 0, sizeof(float) * halfSize);
+            continue;
+        }
+
+        // The frames hold twice the spectrum, so the sum is scaled back by half, once for all the sources.
+        float scale = 0.5f;
+        vsmul(accumulators[ear][0], 1, &scale, accumulators[ear][0], 1, halfSize);
+        vsmul(accumulators[ear][1], 1, &scale, accumulators[ear][1], 1, halfSize);
+        accumulatorFrames[ear]->doInverseFFT(outputP);
+
+        // Overlap-add 1st half from previous time, and save 2nd half of result.
+        vadd(outputP, 1, lastOverlapP, 1, outputP, 1, halfSize);
+        memcpy(lastOverlapP, outputP + halfSize, sizeof(float) * halfSize);
+    }
+}
+
+void HRTFBatchPanner::pan(const float* const* sourcesP, AudioBus* outputBus, size_t framesToProcess)
+{
+    bool isOutputGood = outputBus && outputBus->numberOfChannels() == 2 && framesToProcess <= outputBus->length();
+    ASSERT(isOutputGood);
+    if (!isOutputGood) {
+        if (outputBus)
+            outputBus->zero();
+        return;
+    }
+
+    // This code only runs after the database for our sample-rate has been loaded.
+    HRTFDatabase* database = m_databaseLoader->database();
+    if (!database) {
+        outputBus->zero();
+        return;
+    }
+
+    size_t halfSize = m_fftSize / 2;
+
+    // framesToProcess must be an exact multiple of halfSize,
+    // or halfSize is a multiple of framesToProcess when halfSize > framesToProcess.
+    bool isGood = !(halfSize % framesToProcess && framesToProcess % halfSize);
+    ASSERT(isGood);
+    if (!isGood) {
+        outputBus->zero();
+        return;
+    }
+
+    size_t numberOfDivisions = halfSize <= framesToProcess ? (framesToProcess / halfSize) : 1;
+    size_t divisionSize = numberOfDivisions == 1 ? framesToProcess : halfSize;
+
+    float* destinationL = outputBus->channelByType(AudioBus::ChannelLeft)->mutableData();
+    float* destinationR = outputBus->channelByType(AudioBus::ChannelRight)->mutableData();
+
+    for (size_t i = 0; i < numberOfDivisions; ++i) {
+        size_t offset = i * divisionSize;
+
+        if (!m_readWriteIndex)
+            beginBlock();
+
+        for (unsigned j = 0; j < m_sources.size(); ++j)
+            delaySource(database, *m_sources[j], sourcesP[j] ? sourcesP[j] + offset : 0, divisionSize);
+
+        memcpy(destinationL + offset, m_outputL.data() + m_readWriteIndex, sizeof(float) * divisionSize);
+        memcpy(destinationR + offset, m_outputR.data() + m_readWriteIndex, sizeof(float) * divisionSize);
+        m_readWriteIndex += divisionSize;
+
+        if (m_readWriteIndex == halfSize) {
+            processBlock(database);
+            m_readWriteIndex = 0;
+        }
+    }
+
+    outputBus->clearSilentFlag();
+}
+
+void HRTFBatchPanner::reset()
+{
+    for (auto& s : m_sources) {
+        Source& source = *s;
+        source.delayLineL.reset();
+        source.delayLineR.reset();
+        source.lastGain = -1;
+        source.frameDelayL = -1;
+        source.frameDelayR = -1;
+        source.soundedThisBlock = false;
+        source.soundedLastBlock = false;
+    }
+
+    m_lastOverlapL.zero();
+    m_lastOverlapR.zero();
+    m_readWriteIndex = 0;
+}
+
+double HRTFBatchPanner::tailTime() const
+{
+    return MaxDelayTimeSeconds + (m_fftSize / 2) / static_cast<double>(m_sampleRate);
+}
+
+double HRTFBatchPanner::latencyTime() const
+{
+    return (m_fftSize / 2) / static_cast<double>(m_sampleRate);
+}
+
+} // namespace WebCore
@@ -29,7 +29,15 @@
 #include "LabSoundConfig.h"
 #include "HRTFDatabase.h"
 
+#include "AudioRenderThreadPool.h"
 #include "HRTFElevation.h"
+#include "HRTFPanner.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
 
 using namespace std;
 
@@ -42,24 +50,86 @@ const unsigned HRTFDatabase::NumberOfRawElevations = 10; // -45 -> +90 (each 15
 const unsigned HRTFDatabase::InterpolationFactor = 1;
 const unsigned HRTFDatabase::NumberOfTotalElevations = NumberOfRawElevations * InterpolationFactor;
 
+// The cache file's header is followed by the elevation angles, then the left and right frame delays of every azimuth
+// of every elevation, then the frequency-domain data of each of those kernels: fftSize / 2 real values, then as many imaginary ones.
+// Bump the version whenever the resources, or the way the kernels are made from them, change.
+struct KernelCacheHeader {
+    char magic[4];
+    uint32_t version;
+    float sampleRate;
+    uint32_t fftSize;
+    uint32_t numberOfElevations;
+    uint32_t numberOfAzimuths;
+    uint8_t padding[40];
+};
+
+static_assert(sizeof(KernelCacheHeader) == 64, "kernel cache header should be 64 bytes");
+
+const char KernelCacheMagic[4] = { 'L', 'S', 'H', 'K' };
+const uint32_t KernelCacheVersion = 2;
+
+// Each participant takes the next raw elevation that nobody has started on, until there are none left.
+class HRTFElevationLoadJob : public AudioRenderThreadPool::Job {
+public:
+    HRTFElevationLoadJob(std::vector<std::unique_ptr<HRTFElevation> >& elevations, int minElevation, unsigned spacing, unsigned interpolationFactor, float sampleRate)
+    : m_elevations(elevations)
+    , m_minElevation(minElevation)
+    , m_spacing(spacing)
+    , m_interpolationFactor(interpolationFactor)
+    , m_sampleRate(sampleRate)
+    , m_next(0)
+    {
+    }
+
+    virtual void run(unsigned) override
+    {
+        for (;;) {
+            unsigned rawIndex = m_next.fetch_add(1);
+            unsigned elevationIndex = rawIndex * m_interpolationFactor;
+            if (elevationIndex >= m_elevations.size())
+                return;
+
+            int elevation = m_minElevation + static_cast<int>(rawIndex * m_spacing);
+            m_elevations[elevationIndex] = HRTFElevation::createForSubject("Composite", elevation, m_sampleRate);
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<HRTFElevation> >& m_elevations;
+    int m_minElevation;
+    unsigned m_spacing;
+    unsigned m_interpolationFactor;
+    float m_sampleRate;
+    std::atomic<unsigned> m_next;
+};
+
 std::unique_ptr<HRTFDatabase> HRTFDatabase::create(float sampleRate)
 {
-    return std::unique_ptr<HRTFDatabase>(new HRTFDatabase(sampleRate));
+    std::unique_ptr<HRTFDatabase> database(new HRTFDatabase(sampleRate));
+    database->loadElevations();
+    return database;
 }
 
 HRTFDatabase::HRTFDatabase(float sampleRate)
     : m_elevations(NumberOfTotalElevations)
     , m_sampleRate(sampleRate)
 {
-    unsigned elevationIndex = 0;
-    for (int elevation = MinElevation; elevation <= MaxElevation; elevation += RawElevationAngleSpacing) {
-        std::unique_ptr<HRTFElevation> hrtfElevation = HRTFElevation::createForSubject("Composite", elevation, sampleRate);
-        // @Lab removed ASSERT(hrtfElevation.get());
-        if (!hrtfElevation.get())
+}
+
+void HRTFDatabase::loadElevations()
+{
+    // Each elevation reads, resamples and transforms its own resources, independently of the others.
+    unsigned numberOfThreads = min(max(std::thread::hardware_concurrency(), 1u), NumberOfRawElevations);
+    {
+        AudioRenderThreadPool pool(numberOfThreads);
+        HRTFElevationLoadJob job(m_elevations, MinElevation, RawElevationAngleSpacing, InterpolationFactor, m_sampleRate);
+        pool.run(job);
+    }
+
+    // A missing resource leaves the database incomplete; there is nothing to interpolate between.
+    for (unsigned i = 0; i < NumberOfTotalElevations; i += InterpolationFactor) {
+        if (!m_elevations[i].get())
             return;
-        
-        m_elevations[elevationIndex] = std::move(hrtfElevation);
-        elevationIndex += InterpolationFactor;
     }
 
     // Now, go back and interpolate elevations.
@@ -72,15 +142,134 @@ HRTFDatabase::HRTFDatabase(float sampleRate)
             // Create the interpolated convolution kernels and delays.
             for (unsigned jj = 1; jj < InterpolationFactor; ++jj) {
                 float x = static_cast<float>(jj) / static_cast<float>(InterpolationFactor);
-                m_elevations[i + jj] = HRTFElevation::createByInterpolatingSlices(m_elevations[i].get(), m_elevations[j].get(), x, sampleRate);
+                m_elevations[i + jj] = HRTFElevation::createByInterpolatingSlices(m_elevations[i].get(), m_elevations[j].get(), x, m_sampleRate);
                 ASSERT(m_elevations[i + jj].get());
             }
         }
     }
 }
 
+std::unique_ptr<HRTFDatabase> HRTFDatabase::createFromCacheFile(const std::string& path, float sampleRate)
+{
+    std::shared_ptr<MappedFile> file = MappedFile::open(path.c_str());
+    if (!file || file->size() < sizeof(KernelCacheHeader))
+        return nullptr;
+
+    const KernelCacheHeader* header = static_cast<const KernelCacheHeader*>(file->data());
+    if (memcmp(header->magic, KernelCacheMagic, sizeof(KernelCacheMagic)) || header->version != KernelCacheVersion)
+        return nullptr;
+
+    const size_t fftSize = HRTFPanner::fftSizeForSampleRate(sampleRate);
+    const size_t halfSize = fftSize / 2;
+    const size_t numberOfAzimuths = HRTFElevation::NumberOfTotalAzimuths;
+    if (header->sampleRate != sampleRate || header->fftSize != fftSize
+        || header->numberOfElevations != NumberOfTotalElevations || header->numberOfAzimuths != numberOfAzimuths)
+        return nullptr;
+
+    const size_t numberOfKernels = NumberOfTotalElevations * numberOfAzimuths * 2;
+    const size_t expectedSize = sizeof(KernelCacheHeader) + sizeof(float) * (NumberOfTotalElevations + numberOfKernels + numberOfKernels * fftSize);
+    if (file->size() != expectedSize)
+        return nullptr;
+
+    file->prefetch();
+
+    const float* angles = reinterpret_cast<const float*>(header + 1);
+    const float* frameDelays = angles + NumberOfTotalElevations;
+    const float* frameData = frameDelays + numberOfKernels;
+
+    std::unique_ptr<HRTFDatabase> database(new HRTFDatabase(sampleRate));
+    for (unsigned i = 0; i < NumberOfTotalElevations; ++i) {
+        std::unique_ptr<HRTFKernelList> kernelListL = std::unique_ptr<HRTFKernelList>(new HRTFKernelList(numberOfAzimuths));
+        std::unique_ptr<HRTFKernelList> kernelListR = std::unique_ptr<HRTFKernelList>(new HRTFKernelList(numberOfAzimuths));
+
+        for (size_t j = 0; j < numberOfAzimuths; ++j) {
+            for (unsigned ear = 0; ear < 2; ++ear) {
+                std::unique_ptr<FFTFrame> frame(new FFTFrame(static_cast<unsigned>(fftSize)));
+                memcpy(frame->realData(), frameData, sizeof(float) * halfSize);
+                memcpy(frame->imagData(), frameData + halfSize, sizeof(float) * halfSize);
+                frameData += fftSize;
+
+                HRTFKernelList& kernelList = ear ? *kernelListR : *kernelListL;
+                kernelList[j] = std::make_shared<HRTFKernel>(std::move(frame), *frameDelays++, sampleRate);
+            }
+        }
+
+        database->m_elevations[i] = std::unique_ptr<HRTFElevation>(new HRTFElevation(std::move(kernelListL), std::move(kernelListR), static_cast<int>(angles[i]), sampleRate));
+    }
+
+    return database;
+}
+
+bool HRTFDatabase::writeCacheFile(const std::string& path) const
+{
+    const size_t numberOfAzimuths = HRTFElevation::NumberOfTotalAzimuths;
+    const size_t fftSize = HRTFPanner::fftSizeForSampleRate(m_sampleRate);
+    const size_t halfSize = fftSize / 2;
+
+    // Only a complete database is worth caching.
+    for (auto& elevation : m_elevations) {
+        if (!elevation)
+            return false;
+
+        for (size_t j = 0; j < numberOfAzimuths; ++j) {
+            HRTFKernel* kernelL = elevation->kernelListL()->at(j).get();
+            HRTFKernel* kernelR = elevation->kernelListR()->at(j).get();
+            if (!kernelL || !kernelR || kernelL->fftSize() != fftSize || kernelR->fftSize() != fftSize)
+                return false;
+        }
+    }
+
+    KernelCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KernelCacheMagic, sizeof(KernelCacheMagic));
+    header.version = KernelCacheVersion;
+    header.sampleRate = m_sampleRate;
+    header.fftSize = static_cast<uint32_t>(fftSize);
+    header.numberOfElevations = NumberOfTotalElevations;
+    header.numberOfAzimuths = static_cast<uint32_t>(numberOfAzimuths);
+
+    std::vector<float> angles;
+    std::vector<float> frameDelays;
+    for (auto& elevation : m_elevations) {
+        angles.push_back(static_cast<float>(elevation->elevationAngle()));
+        for (size_t j = 0; j < numberOfAzimuths; ++j) {
+            frameDelays.push_back(elevation->kernelListL()->at(j)->frameDelay());
+            frameDelays.push_back(elevation->kernelListR()->at(j)->frameDelay());
+        }
+    }
+
+    // Written aside and moved into place, so that a cache file is never seen half written.
+    // Processes loading the same sample-rate at once each write their own temporary file.
+    std::string temporaryPath = temporaryPathFor(path);
+    FILE* f = fopen(temporaryPath.c_str(), "wb");
+    if (!f)
+        return false;
+
+    bool written = fwrite(&header, sizeof(header), 1, f) == 1;
+    written = written && fwrite(angles.data(), sizeof(float), angles.size(), f) == angles.size();
+    written = written && fwrite(frameDelays.data(), sizeof(float), frameDelays.size(), f) == frameDelays.size();
+
+    for (auto& elevation : m_elevations) {
+        for (size_t j = 0; written && j < numberOfAzimuths; ++j) {
+            for (unsigned ear = 0; written && ear < 2; ++ear) {
+                FFTFrame* frame = (ear ? elevation->kernelListR() : elevation->kernelListL())->at(j)->fftFrame();
+                written = fwrite(frame->realData(), sizeof(float), halfSize, f) == halfSize
+                    && fwrite(frame->imagData(), sizeof(float), halfSize, f) == halfSize;
+            }
+        }
+    }
+    written = !fclose(f) && written;
+
+    if (!written || !replaceFile(temporaryPath, path)) {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
 void HRTFDatabase::getKernelsFromAzimuthElevation(double azimuthBlend, unsigned azimuthIndex, double elevationAngle, HRTFKernel* &kernelL, HRTFKernel* &kernelR,
-                                                  double& frameDelayL, double& frameDelayR)
+                                                  double& frameDelayL, double& frameDelayR) const
 {
     unsigned elevationIndex = indexFromElevationAngle(elevationAngle);
     ASSERT_WITH_SECURITY_IMPLICATION(elevationIndex < m_elevations.size() && m_elevations.size() > 0);
@@ -33,23 +33,78 @@
 #include <wtf/MainThread.h>
 
 #include <iostream>
+#include <map>
+#include <stdlib.h>
+#include <string>
 
 namespace WebCore {
 
-// Singleton
-std::shared_ptr<HRTFDatabaseLoader> HRTFDatabaseLoader::s_loader;
+// The loaders, by sample-rate.
+static std::mutex s_loadersLock;
+static std::map<float, std::shared_ptr<HRTFDatabaseLoader> > s_loaders;
+
+static std::mutex s_cacheDirectoryLock;
+static std::string* s_cacheDirectory = 0;
+
+static std::string defaultCacheDirectory()
+{
+#if OS(WINDOWS)
+    const char* directory = getenv("TEMP");
+    return directory ? directory : ".";
+#else
+    const char* directory = getenv("TMPDIR");
+    return directory ? directory : "/tmp";
+#endif
+}
+
+void HRTFDatabaseLoader::setCacheDirectory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> locker(s_cacheDirectoryLock);
+    if (!s_cacheDirectory)
+        s_cacheDirectory = new std::string();
+    *s_cacheDirectory = directory;
+}
+
+std::string HRTFDatabaseLoader::cacheDirectory()
+{
+    std::lock_guard<std::mutex> locker(s_cacheDirectoryLock);
+    if (!s_cacheDirectory)
+        s_cacheDirectory = new std::string(defaultCacheDirectory());
+    return *s_cacheDirectory;
+}
+
+std::string HRTFDatabaseLoader::cacheFilePath(float sampleRate)
+{
+    std::string directory = cacheDirectory();
+    if (directory.empty())
+        return std::string();
+
+    return directory + "/labsound-hrtf-" + std::to_string(static_cast<int>(sampleRate)) + ".kernels";
+}
 
 std::shared_ptr<HRTFDatabaseLoader> HRTFDatabaseLoader::createAndLoadAsynchronouslyIfNecessary(float sampleRate)
 {
-    if (!s_loader) {
-        s_loader = std::make_shared<HRTFDatabaseLoader>(sampleRate);
-        s_loader->loadAsynchronously();
+    std::lock_guard<std::mutex> locker(s_loadersLock);
+
+    std::shared_ptr<HRTFDatabaseLoader>& loader = s_loaders[sampleRate];
+    if (!loader) {
+        loader = std::make_shared<HRTFDatabaseLoader>(sampleRate);
+        loader->loadAsynchronously();
     }
-    return s_loader;
+    return loader;
+}
+
+std::shared_ptr<HRTFDatabaseLoader> HRTFDatabaseLoader::loader(float sampleRate)
+{
+    std::lock_guard<std::mutex> locker(s_loadersLock);
+
+    auto found = s_loaders.find(sampleRate);
+    return found != s_loaders.end() ? found->second : nullptr;
 }
 
 HRTFDatabaseLoader::HRTFDatabaseLoader(float sampleRate)
-    : m_databaseLoaderThread(0)
+    : m_isLoaded(false)
+    , m_databaseLoaderThread(0)
     , m_databaseSampleRate(sampleRate)
 {
 }
@@ -57,11 +112,8 @@ HRTFDatabaseLoader::HRTFDatabaseLoader(float sampleRate)
 HRTFDatabaseLoader::~HRTFDatabaseLoader()
 {
     waitForLoaderThreadCompletion();
+    m_isLoaded = false;
     m_hrtfDatabase.reset();
-    
-    // Clear out singleton.
-    ASSERT(this == s_loader.get());
-    s_loader = 0;
 }
 
 
@@ -76,12 +128,24 @@ static void databaseLoaderEntry(void* threadData)
 void HRTFDatabaseLoader::load()
 {
     if (!m_hrtfDatabase.get()) {
-        // Load the default HRTF database.
-        m_hrtfDatabase = HRTFDatabase::create(m_databaseSampleRate);
+        // The kernels left by an earlier run are mapped rather than computed again.
+        std::string cachePath = cacheFilePath(m_databaseSampleRate);
+        if (!cachePath.empty())
+            m_hrtfDatabase = HRTFDatabase::createFromCacheFile(cachePath, m_databaseSampleRate);
+
+        if (!m_hrtfDatabase.get()) {
+            // Load the default HRTF database.
+            m_hrtfDatabase = HRTFDatabase::create(m_databaseSampleRate);
+            if (!cachePath.empty())
+                m_hrtfDatabase->writeCacheFile(cachePath);
+        }
     }
     if (!m_hrtfDatabase.get()) { // @Lab added error reporting
         std::cerr << "HRTF database not loaded" << std::endl;
+        return;
     }
+
+    m_isLoaded.store(true, std::memory_order_release);
 }
 
 void HRTFDatabaseLoader::loadAsynchronously()
@@ -96,7 +160,7 @@ void HRTFDatabaseLoader::loadAsynchronously()
 
 bool HRTFDatabaseLoader::isLoaded() const
 {
-    return m_hrtfDatabase.get();
+    return m_isLoaded.load(std::memory_order_acquire);
 }
 
 void HRTFDatabaseLoader::waitForLoaderThreadCompletion()
@@ -109,12 +173,4 @@ void HRTFDatabaseLoader::waitForLoaderThreadCompletion()
     m_databaseLoaderThread = 0;
 }
 
-HRTFDatabase* HRTFDatabaseLoader::defaultHRTFDatabase()
-{
-    if (!s_loader)
-        return 0;
-    
-    return s_loader->database();
-}
-
 } // namespace WebCore
@@ -120,6 +120,11 @@ bool HRTFElevation::calculateKernelsForAzimuthElevation(int azimuth, int elevati
     if (!isBusGood)
         return false;
     
+    // The responses were measured at 44.1KHz. Resampling keeps the amplitude of each sample-frame, but changes how many frames
+    // there are, so the response is scaled back to the gain it has at 44.1KHz, whatever the sample-rate.
+    if (sampleRate != 44100)
+        impulseResponse->scale(44100 / sampleRate);
+
     AudioChannel* leftEarImpulseResponse = impulseResponse->channelByType(AudioBus::ChannelLeft);
     AudioChannel* rightEarImpulseResponse = impulseResponse->channelByType(AudioBus::ChannelRight);
 
@@ -231,7 +236,7 @@ std::unique_ptr<HRTFElevation> HRTFElevation::createByInterpolatingSlices(HRTFEl
     return std::unique_ptr<HRTFElevation>(new HRTFElevation(std::move(kernelListL), std::move(kernelListR), static_cast<int>(angle), sampleRate));
 }
 
-void HRTFElevation::getKernelsFromAzimuth(double azimuthBlend, unsigned azimuthIndex, HRTFKernel* &kernelL, HRTFKernel* &kernelR, double& frameDelayL, double& frameDelayR)
+void HRTFElevation::getKernelsFromAzimuth(double azimuthBlend, unsigned azimuthIndex, HRTFKernel* &kernelL, HRTFKernel* &kernelR, double& frameDelayL, double& frameDelayR) const
 {
     bool checkAzimuthBlend = azimuthBlend >= 0.0 && azimuthBlend < 1.0;
     ASSERT(checkAzimuthBlend);
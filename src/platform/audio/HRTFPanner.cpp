@@ -46,6 +46,7 @@ const unsigned RenderingQuantum = 128;
 HRTFPanner::HRTFPanner(float sampleRate)
     : Panner(PanningModelHRTF)
     , m_sampleRate(sampleRate)
+    , m_databaseLoader(HRTFDatabaseLoader::createAndLoadAsynchronouslyIfNecessary(sampleRate))
     , m_crossfadeSelection(CrossfadeSelection1)
     , m_azimuthIndex1(UninitializedAzimuth)
     , m_elevation1(0)
@@ -75,8 +76,18 @@ size_t HRTFPanner::fftSizeForSampleRate(float sampleRate)
     // The HRTF impulse responses (loaded as audio resources) are 512 sample-frames @44.1KHz.
     // Currently, we truncate the impulse responses to half this size, but an FFT-size of twice impulse response size is needed (for convolution).
     // So for sample rates around 44.1KHz an FFT size of 512 is good. We double the FFT-size only for sample rates at least double this.
-    ASSERT(sampleRate >= 44100 && sampleRate <= 96000.0);
-    return (sampleRate < 88200.0) ? 512 : 1024;
+    // In general the FFT-size doubles with each doubling of the sample-rate from 44.1KHz, which keeps the resampled response
+    // at least half the FFT-size, as HRTFKernel needs to measure its delay.
+    ASSERT(sampleRate >= 8000 && sampleRate <= 192000.0);
+    if (sampleRate < 11025.0)
+        return 64;
+    if (sampleRate < 22050.0)
+        return 128;
+    if (sampleRate < 44100.0)
+        return 256;
+    if (sampleRate < 88200.0)
+        return 512;
+    return (sampleRate < 176400.0) ? 1024 : 2048;
 }
 
 void HRTFPanner::reset()
@@ -96,10 +107,7 @@ int HRTFPanner::calculateDesiredAzimuthIndexAndBlend(double azimuth, double& azi
     if (azimuth < 0)
         azimuth += 360.0;
 
-    HRTFDatabase* database = HRTFDatabaseLoader::defaultHRTFDatabase();
-    ASSERT(database);
-
-    int numberOfAzimuths = database->numberOfAzimuths();
+    int numberOfAzimuths = HRTFDatabase::numberOfAzimuths();
     const double angleBetweenAzimuths = 360.0 / numberOfAzimuths;
 
     // Calculate the azimuth index and the blend (0 -> 1) for interpolation.
@@ -130,8 +138,8 @@ void HRTFPanner::pan(ContextGraphLock& g, ContextRenderLock& r, double desiredAz
         return;
     }
 
-    // This code only runs as long as the context is alive and after database has been loaded.
-    HRTFDatabase* database = HRTFDatabaseLoader::defaultHRTFDatabase();
+    // This code only runs after the database for our sample-rate has been loaded.
+    HRTFDatabase* database = m_databaseLoader->database();
     ASSERT(database);
     if (!database) {
         outputBus->zero();
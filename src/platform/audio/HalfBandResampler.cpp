@@ -0,0 +1,130 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "HalfBandResampler.h"
+
+#include "VectorMath.h"
+#include <cmath>
+#include <string.h>
+#include <wtf/MathExtras.h>
+
+namespace WebCore {
+
+// Taps in the half-sample phase; the whole half-band filter is twice this, less one, long.
+// With a Blackman window this rejects aliases by about 70dB, with the passband flat to 0.4 of the input rate.
+const size_t HalfSampleTaps = 32;
+const size_t HalfTaps = HalfSampleTaps / 2;
+
+// A windowed sinc which interpolates half way between its two middle taps, normalized to unity gain.
+static void computeHalfSampleKernel(float* kernel, float scale)
+{
+    double sum = 0;
+    double values[HalfSampleTaps];
+    for (size_t i = 0; i < HalfSampleTaps; ++i) {
+        double x = i + 0.5 - HalfTaps;
+        double sinc = sin(piDouble * x) / (piDouble * x);
+        double phase = 2 * piDouble * (i + 0.5) / HalfSampleTaps;
+        double window = 0.42 - 0.5 * cos(phase) + 0.08 * cos(2 * phase);
+        values[i] = sinc * window;
+        sum += values[i];
+    }
+
+    for (size_t i = 0; i < HalfSampleTaps; ++i)
+        kernel[i] = static_cast<float>(scale * values[i] / sum);
+}
+
+UpSampler::UpSampler(size_t inputBlockSize)
+    : m_inputBlockSize(inputBlockSize)
+    , m_kernel(HalfSampleTaps)
+    , m_input(HalfSampleTaps - 1 + inputBlockSize)
+    , m_halfSamples(inputBlockSize)
+{
+    computeHalfSampleKernel(m_kernel.data(), 1);
+}
+
+void UpSampler::process(const float* source, float* destination, size_t sourceFramesToProcess)
+{
+    ASSERT(sourceFramesToProcess <= m_inputBlockSize);
+    if (sourceFramesToProcess > m_inputBlockSize)
+        return;
+
+    const size_t history = HalfSampleTaps - 1;
+    float* input = m_input.data();
+    float* halfSamples = m_halfSamples.data();
+    memcpy(input + history, source, sizeof(float) * sourceFramesToProcess);
+
+    // The input frames, delayed to line up with the half samples between them.
+    const float* wholeSamples = input + HalfTaps - 1;
+
+    const float* kernel = m_kernel.data();
+    VectorMath::vsmul(input, 1, kernel, halfSamples, 1, sourceFramesToProcess);
+    for (size_t i = 1; i < HalfSampleTaps; ++i)
+        VectorMath::vsma(input + i, 1, kernel + i, halfSamples, 1, sourceFramesToProcess);
+
+    const float* phases[2] = { wholeSamples, halfSamples };
+    const float unity = 1;
+    VectorMath::vinterleave(phases, 2, &unity, destination, sourceFramesToProcess);
+
+    memmove(input, input + sourceFramesToProcess, sizeof(float) * history);
+}
+
+void UpSampler::reset()
+{
+    m_input.zero();
+}
+
+size_t UpSampler::latencyFrames() const
+{
+    return HalfTaps;
+}
+
+DownSampler::DownSampler(size_t inputBlockSize)
+    : m_inputBlockSize(inputBlockSize)
+    , m_kernel(HalfSampleTaps)
+    , m_evenInput(HalfTaps - 1 + inputBlockSize / 2)
+    , m_oddInput(HalfSampleTaps - 1 + inputBlockSize / 2)
+{
+    // The two phases are averaged.
+    computeHalfSampleKernel(m_kernel.data(), 0.5);
+}
+
+void DownSampler::process(const float* source, float* destination, size_t sourceFramesToProcess)
+{
+    ASSERT(sourceFramesToProcess <= m_inputBlockSize && !(sourceFramesToProcess % 2));
+    if (sourceFramesToProcess > m_inputBlockSize || sourceFramesToProcess % 2)
+        return;
+
+    const size_t evenHistory = HalfTaps - 1;
+    const size_t oddHistory = HalfSampleTaps - 1;
+    size_t framesToProcess = sourceFramesToProcess / 2;
+    float* evenInput = m_evenInput.data();
+    float* oddInput = m_oddInput.data();
+
+    float* phases[2] = { evenInput + evenHistory, oddInput + oddHistory };
+    const float unity = 1;
+    VectorMath::vdeinterleave(source, 2, &unity, phases, framesToProcess);
+
+    // The odd frames are interpolated onto the even ones, and the two averaged.
+    const float half = 0.5f;
+    const float* kernel = m_kernel.data();
+    VectorMath::vsmul(evenInput, 1, &half, destination, 1, framesToProcess);
+    for (size_t i = 0; i < HalfSampleTaps; ++i)
+        VectorMath::vsma(oddInput + i, 1, kernel + i, destination, 1, framesToProcess);
+
+    memmove(evenInput, evenInput + framesToProcess, sizeof(float) * evenHistory);
+    memmove(oddInput, oddInput + framesToProcess, sizeof(float) * oddHistory);
+}
+
+void DownSampler::reset()
+{
+    m_evenInput.zero();
+    m_oddInput.zero();
+}
+
+size_t DownSampler::latencyFrames() const
+{
+    return HalfTaps - 1;
+}
+
+} // namespace WebCore
@@ -0,0 +1,119 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "MappedFile.h"
+
+#include <atomic>
+#include <stdio.h>
+
+#if OS(WINDOWS)
+#include <process.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace WebCore {
+
+MappedFile::MappedFile()
+    : m_data(0)
+    , m_size(0)
+    , m_mapping(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+#if OS(WINDOWS)
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+#else
+    if (m_data)
+        munmap(const_cast<void*>(m_data), m_size);
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const char* filePath)
+{
+    std::shared_ptr<MappedFile> file(new MappedFile());
+
+#if OS(WINDOWS)
+    HANDLE handle = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (handle == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || !size.QuadPart) {
+        CloseHandle(handle);
+        return nullptr;
+    }
+
+    // The mapping keeps the file open once its handle is closed.
+    file->m_mapping = CreateFileMappingA(handle, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(handle);
+    if (!file->m_mapping)
+        return nullptr;
+
+    file->m_data = MapViewOfFile(file->m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!file->m_data)
+        return nullptr;
+    file->m_size = static_cast<size_t>(size.QuadPart);
+#else
+    int descriptor = ::open(filePath, O_RDONLY);
+    if (descriptor < 0)
+        return nullptr;
+
+    struct stat status;
+    if (fstat(descriptor, &status) || !status.st_size) {
+        close(descriptor);
+        return nullptr;
+    }
+
+    // The mapping keeps the file open once its descriptor is closed.
+    void* data = mmap(0, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    file->m_data = data;
+    file->m_size = static_cast<size_t>(status.st_size);
+#endif
+
+    return file;
+}
+
+void MappedFile::prefetch() const
+{
+#if !OS(WINDOWS)
+    posix_madvise(const_cast<void*>(m_data), m_size, POSIX_MADV_WILLNEED);
+#endif
+}
+
+std::string temporaryPathFor(const std::string& path)
+{
+    static std::atomic<unsigned> temporaryFileCount(0);
+#if OS(WINDOWS)
+    int processId = _getpid();
+#else
+    int processId = static_cast<int>(getpid());
+#endif
+    return path + "." + std::to_string(processId) + "." + std::to_string(temporaryFileCount.fetch_add(1)) + ".tmp";
+}
+
+bool replaceFile(const std::string& temporaryPath, const std::string& path)
+{
+#if OS(WINDOWS)
+    // rename won't replace a file on Windows.
+    return MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(temporaryPath.c_str(), path.c_str()) == 0;
+#endif
+}
+
+} // namespace WebCore
@@ -30,6 +30,7 @@
 #include "ReverbConvolver.h"
 
 #include "VectorMath.h"
+#include "AudioContext.h"
 #include "AudioContextLock.h"
 #include "AudioBus.h"
 
@@ -67,6 +68,7 @@ ReverbConvolver::ReverbConvolver(AudioChannel* impulseResponse, size_t renderSli
     , m_backgroundThread(0)
     , m_wantsToExit(false)
     , m_moreInputBuffered(false)
+    , m_backgroundWriteIndex(0)
 {
     // If we are using background threads then don't exceed this FFT size for the
     // stages which run in the real-time thread.  This avoids having only one or two
@@ -154,12 +156,13 @@ ReverbConvolver::~ReverbConvolver()
 void ReverbConvolver::backgroundThreadEntry()
 {
     while (!m_wantsToExit) {
-        // Wait for realtime thread to give us more input
-        m_moreInputBuffered = false;        
+        // Wait for realtime thread to give us more input. The flag is cleared under the lock, so that a wake-up
+        // which arrives while the stages are processing isn't lost.
         {
             std::unique_lock<std::mutex> locker(m_backgroundThreadLock);
             while (!m_moreInputBuffered && !m_wantsToExit)
                 m_backgroundThreadCondition.wait(locker);
+            m_moreInputBuffered = false;
         }
 
         // Process all of the stages until their read indices reach the input buffer's write index
@@ -177,10 +180,29 @@ void ReverbConvolver::backgroundThreadEntry()
             for (size_t i = 0; i < m_backgroundStages.size(); ++i)
                 m_backgroundStages[i]->processInBackground(this, SliceSize);
         }
+
+        {
+            std::lock_guard<std::mutex> locker(m_backgroundThreadLock);
+            m_backgroundWriteIndex = writeIndex;
+        }
+        m_backgroundCaughtUpCondition.notify_all();
     }
 }
 
-void ReverbConvolver::process(ContextGraphLock& g, ContextRenderLock&, const AudioChannel* sourceChannel, AudioChannel* destinationChannel, size_t framesToProcess)
+void ReverbConvolver::waitForBackgroundThread()
+{
+    if (!m_backgroundThread)
+        return;
+
+    size_t writeIndex = m_inputBuffer.writeIndex();
+    std::unique_lock<std::mutex> locker(m_backgroundThreadLock);
+    m_moreInputBuffered = true;
+    m_backgroundThreadCondition.notify_one();
+    while (m_backgroundWriteIndex != writeIndex)
+        m_backgroundCaughtUpCondition.wait(locker);
+}
+
+void ReverbConvolver::process(ContextGraphLock& g, ContextRenderLock& r, const AudioChannel* sourceChannel, AudioChannel* destinationChannel, size_t framesToProcess)
 {
     bool isSafe = sourceChannel && destinationChannel && sourceChannel->length() >= framesToProcess && destinationChannel->length() >= framesToProcess;
     ASSERT(isSafe);
@@ -204,6 +226,13 @@ void ReverbConvolver::process(ContextGraphLock& g, ContextRenderLock&, const Aud
     // Finally read from accumulation buffer
     m_accumulationBuffer.readAndClear(destination, framesToProcess);
         
+    // An offline context renders as fast as it can, far ahead of what the background thread would manage,
+    // so it waits for the background stages every time. This also keeps its output independent of scheduling.
+    if (m_backgroundThread && r.context() && r.context()->isOfflineContext()) {
+        waitForBackgroundThread();
+        return;
+    }
+
     // Now that we've buffered more input, wake up our background thread.
     
     // Not using a MutexLocker looks strange, but we use a tryLock() instead because this is run on the real-time
@@ -40,18 +40,21 @@ ReverbInputBuffer::ReverbInputBuffer(size_t length)
 void ReverbInputBuffer::write(const float* sourceP, size_t numberOfFrames)
 {
     size_t bufferLength = m_buffer.size();
-    bool isCopySafe = m_writeIndex + numberOfFrames <= bufferLength;
+    size_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+    bool isCopySafe = writeIndex + numberOfFrames <= bufferLength;
     ASSERT(isCopySafe);
     if (!isCopySafe)
         return;
         
-    memcpy(m_buffer.data() + m_writeIndex, sourceP, sizeof(float) * numberOfFrames);
+    memcpy(m_buffer.data() + writeIndex, sourceP, sizeof(float) * numberOfFrames);
 
-    m_writeIndex += numberOfFrames;
-    ASSERT(m_writeIndex <= bufferLength);
+    writeIndex += numberOfFrames;
+    ASSERT(writeIndex <= bufferLength);
 
-    if (m_writeIndex >= bufferLength)
-        m_writeIndex = 0;
+    if (writeIndex >= bufferLength)
+        writeIndex = 0;
+
+    m_writeIndex.store(writeIndex, std::memory_order_release);
 }
 
 float* ReverbInputBuffer::directReadFrom(int* readIndex, size_t numberOfFrames)
@@ -78,7 +81,7 @@ float* ReverbInputBuffer::directReadFrom(int* readIndex, size_t numberOfFrames)
 void ReverbInputBuffer::reset()
 {
     m_buffer.zero();
-    m_writeIndex = 0;
+    m_writeIndex.store(0, std::memory_order_release);
 }
 
 } // namespace WebCore
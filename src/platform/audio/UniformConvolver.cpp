@@ -0,0 +1,286 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "UniformConvolver.h"
+
+#include "AudioBus.h"
+#include "VectorMath.h"
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+namespace WebCore {
+
+using namespace VectorMath;
+
+struct UniformConvolver::Input {
+    Input(size_t partitionSize, size_t numberOfPartitions)
+        : window(partitionSize * 2)
+        , spectra(max<size_t>(numberOfPartitions, 1) * partitionSize * 2)
+        , frame(static_cast<unsigned>(partitionSize * 2))
+        , sourceP(0)
+    {
+    }
+
+    // The previous partition of input, then the current one as it fills.
+    AudioFloatArray window;
+
+    // The delay line: the spectra of the last numberOfPartitions windows, each as partitionSize reals then
+    // partitionSize imaginaries, packed as FFTFrame packs them.
+    AudioFloatArray spectra;
+
+    FFTFrame frame;
+    const float* sourceP;
+};
+
+struct UniformConvolver::Kernel {
+    Kernel(size_t partitionSize, size_t numberOfPartitions)
+        : head(partitionSize)
+        , headLength(0)
+        , spectra(max<size_t>(numberOfPartitions, 1) * partitionSize * 2)
+    {
+    }
+
+    // The first partition of the response, convolved in the time domain, and the spectra of the rest.
+    AudioFloatArray head;
+    size_t headLength;
+    AudioFloatArray spectra;
+};
+
+vector<UniformConvolver::Path> UniformConvolver::stereoPaths(unsigned numberOfResponseChannels)
+{
+    vector<Path> paths;
+    if (numberOfResponseChannels == 4) {
+        // "True" stereo: each input is heard from both sides.
+        Path truePaths[] = { { 0, 0, 0 }, { 0, 1, 1 }, { 1, 0, 2 }, { 1, 1, 3 } };
+        paths.assign(truePaths, truePaths + 4);
+    } else if (numberOfResponseChannels == 2) {
+        Path stereo[] = { { 0, 0, 0 }, { 1, 1, 1 } };
+        paths.assign(stereo, stereo + 2);
+    } else if (numberOfResponseChannels == 1) {
+        Path mono[] = { { 0, 0, 0 }, { 1, 1, 0 } };
+        paths.assign(mono, mono + 2);
+    }
+    return paths;
+}
+
+UniformConvolver::UniformConvolver(const AudioBus* impulseResponse, const vector<Path>& paths, unsigned numberOfInputs, unsigned numberOfOutputs,
+                                   size_t partitionSize, float scale)
+    : m_impulseResponseLength(impulseResponse->length())
+    , m_partitionSize(partitionSize)
+    , m_numberOfPartitions(0)
+    , m_paths(paths)
+    , m_position(0)
+    , m_partitionsAccumulated(1)
+    , m_newestSpectrum(0)
+    , m_destinations(numberOfOutputs)
+    , m_inverse(partitionSize * 2)
+{
+    ASSERT(partitionSize && !(partitionSize & (partitionSize - 1)));
+
+    if (m_impulseResponseLength > partitionSize)
+        m_numberOfPartitions = (m_impulseResponseLength - partitionSize + partitionSize - 1) / partitionSize;
+
+    for (unsigned i = 0; i < numberOfInputs; ++i)
+        m_inputs.emplace_back(new Input(partitionSize, m_numberOfPartitions));
+
+    for (unsigned i = 0; i < numberOfOutputs; ++i) {
+        m_accumulators.emplace_back(new FFTFrame(static_cast<unsigned>(partitionSize * 2)));
+        m_outputs.emplace_back(new AudioFloatArray(partitionSize));
+    }
+
+    // The frames hold twice the spectrum, so the products are scaled back by half, as FFTFrame::multiply() does.
+    // That is folded into the kernels here, along with the response's scale.
+    FFTFrame frame(static_cast<unsigned>(partitionSize * 2));
+    float spectrumScale = 0.5f * scale;
+
+    for (size_t i = 0; i < m_paths.size(); ++i) {
+        const Path& path = m_paths[i];
+        ASSERT(path.input < numberOfInputs && path.output < numberOfOutputs && path.responseChannel < impulseResponse->numberOfChannels());
+
+        std::unique_ptr<Kernel> kernel(new Kernel(partitionSize, m_numberOfPartitions));
+        const float* response = impulseResponse->channel(path.responseChannel)->data();
+
+        kernel->headLength = min(partitionSize, m_impulseResponseLength);
+        vsmul(response, 1, &scale, kernel->head.data(), 1, kernel->headLength);
+
+        for (size_t p = 0; p < m_numberOfPartitions; ++p) {
+            size_t offset = (p + 1) * partitionSize;
+            frame.doPaddedFFT(response + offset, min(partitionSize, m_impulseResponseLength - offset));
+
+            float* spectrum = kernel->spectra.data() + p * partitionSize * 2;
+            vsmul(frame.realData(), 1, &spectrumScale, spectrum, 1, partitionSize);
+            vsmul(frame.imagData(), 1, &spectrumScale, spectrum + partitionSize, 1, partitionSize);
+        }
+
+        m_kernels.push_back(std::move(kernel));
+    }
+}
+
+UniformConvolver::~UniformConvolver()
+{
+}
+
+void UniformConvolver::process(const AudioBus* sourceBus, AudioBus* destinationBus, size_t framesToProcess)
+{
+    bool isSafeToProcess = sourceBus && destinationBus && sourceBus->numberOfChannels() > 0 && destinationBus->numberOfChannels() >= m_outputs.size()
+        && framesToProcess <= sourceBus->length() && framesToProcess <= destinationBus->length();
+
+    ASSERT(isSafeToProcess);
+    if (!isSafeToProcess)
+        return;
+
+    unsigned lastSourceChannel = sourceBus->numberOfChannels() - 1;
+    for (unsigned i = 0; i < m_inputs.size(); ++i)
+        m_inputs[i]->sourceP = sourceBus->channel(min(i, lastSourceChannel))->data();
+
+    for (unsigned i = static_cast<unsigned>(m_outputs.size()); i < destinationBus->numberOfChannels(); ++i)
+        destinationBus->channel(i)->zero();
+
+    size_t framesProcessed = 0;
+    while (framesProcessed < framesToProcess) {
+        size_t frames = min(framesToProcess - framesProcessed, m_partitionSize - m_position);
+
+        for (size_t i = 0; i < m_inputs.size(); ++i) {
+            Input& input = *m_inputs[i];
+            memcpy(input.window.data() + m_partitionSize + m_position, input.sourceP + framesProcessed, sizeof(float) * frames);
+        }
+
+        // The tail of the response was transformed back at the end of the previous partition, and the head is added to it now.
+        for (size_t i = 0; i < m_outputs.size(); ++i) {
+            m_destinations[i] = destinationBus->channel(i)->mutableData() + framesProcessed;
+            memcpy(m_destinations[i], m_outputs[i]->data() + m_position, sizeof(float) * frames);
+        }
+
+        processHead(frames);
+        m_position += frames;
+        framesProcessed += frames;
+
+        if (m_position == m_partitionSize) {
+            processPartition();
+            m_position = 0;
+        } else if (m_numberOfPartitions > 1) {
+            // Partitions 1 and on only need the spectra of partitions already complete, so those products are
+            // accumulated a share at a time, leaving the last division of each partition no more work than the rest.
+            size_t partitionsDue = 1 + (m_numberOfPartitions - 1) * m_position / m_partitionSize;
+            if (partitionsDue > m_partitionsAccumulated) {
+                accumulate(m_partitionsAccumulated, partitionsDue);
+                m_partitionsAccumulated = partitionsDue;
+            }
+        }
+    }
+
+    destinationBus->clearSilentFlag();
+}
+
+void UniformConvolver::processHead(size_t framesToProcess)
+{
+    for (size_t i = 0; i < m_paths.size(); ++i) {
+        const Kernel& kernel = *m_kernels[i];
+        const float* inputP = m_inputs[m_paths[i].input]->window.data() + m_partitionSize + m_position;
+        float* destP = m_destinations[m_paths[i].output];
+        const float* headP = kernel.head.data();
+
+        // The window holds the whole previous partition, which is as far back as the head reaches.
+        for (size_t k = 0; k < kernel.headLength; ++k)
+            vsma(inputP - k, 1, headP + k, destP, 1, framesToProcess);
+    }
+}
+
+void UniformConvolver::accumulate(size_t begin, size_t end)
+{
+    size_t halfSize = m_partitionSize;
+    size_t spectrumSize = halfSize * 2;
+    size_t numberOfSpectra = max<size_t>(m_numberOfPartitions, 1);
+
+    // Partition by partition, so that the paths from each input find its spectrum in the cache.
+    for (size_t p = begin; p < end; ++p) {
+        // Partition p of the response applies to the input p partitions before the one being filled, whose
+        // spectrum goes in the slot after the newest.
+        size_t spectrumOffset = ((m_newestSpectrum + 1 + numberOfSpectra - p) % numberOfSpectra) * spectrumSize;
+
+        for (size_t i = 0; i < m_paths.size(); ++i) {
+            const float* sourceP = m_inputs[m_paths[i].input]->spectra.data() + spectrumOffset;
+            const float* kernelP = m_kernels[i]->spectra.data() + p * spectrumSize;
+            FFTFrame& accumulator = *m_accumulators[m_paths[i].output];
+            float* realDestP = accumulator.realData();
+            float* imagDestP = accumulator.imagData();
+
+            float real0 = realDestP[0];
+            float imag0 = imagDestP[0];
+
+            zvmula(sourceP, sourceP + halfSize, kernelP, kernelP + halfSize, realDestP, imagDestP, halfSize);
+
+            // Accumulate the packed DC/nyquist component.
+            realDestP[0] = real0 + sourceP[0] * kernelP[0];
+            imagDestP[0] = imag0 + sourceP[halfSize] * kernelP[halfSize];
+        }
+    }
+}
+
+void UniformConvolver::processPartition()
+{
+    size_t halfSize = m_partitionSize;
+
+    if (!m_numberOfPartitions) {
+        // The whole response is in the head, and the window is all that needs keeping.
+        for (size_t i = 0; i < m_inputs.size(); ++i)
+            memcpy(m_inputs[i]->window.data(), m_inputs[i]->window.data() + halfSize, sizeof(float) * halfSize);
+        return;
+    }
+
+    // Catch up on the delayed partitions, in case the last division was larger than the rest.
+    if (m_partitionsAccumulated < m_numberOfPartitions)
+        accumulate(max<size_t>(m_partitionsAccumulated, 1), m_numberOfPartitions);
+
+    // Transform the windows just completed into the slots after the newest in the delay lines.
+    size_t slot = (m_newestSpectrum + 1) % m_numberOfPartitions;
+    for (size_t i = 0; i < m_inputs.size(); ++i) {
+        Input& input = *m_inputs[i];
+        input.frame.doFFT(input.window.data());
+
+        float* spectrum = input.spectra.data() + slot * halfSize * 2;
+        memcpy(spectrum, input.frame.realData(), sizeof(float) * halfSize);
+        memcpy(spectrum + halfSize, input.frame.imagData(), sizeof(float) * halfSize);
+
+        memcpy(input.window.data(), input.window.data() + halfSize, sizeof(float) * halfSize);
+    }
+
+    // The first of the response's partitions in the frequency domain applies to the newest spectra.
+    accumulate(0, 1);
+    m_newestSpectrum = slot;
+
+    // Overlap-save: the second half of each inverse transform is the output for the next partition.
+    for (size_t i = 0; i < m_outputs.size(); ++i) {
+        FFTFrame& accumulator = *m_accumulators[i];
+        accumulator.doInverseFFT(m_inverse.data());
+        memcpy(m_outputs[i]->data(), m_inverse.data() + halfSize, sizeof(float) * halfSize);
+
+        memset(accumulator.realData(), 0, sizeof(float) * halfSize);
+        memset(accumulator.imagData(), 0, sizeof(float) * halfSize);
+    }
+
+    m_partitionsAccumulated = 1;
+}
+
+void UniformConvolver::reset()
+{
+    for (size_t i = 0; i < m_inputs.size(); ++i) {
+        m_inputs[i]->window.zero();
+        m_inputs[i]->spectra.zero();
+    }
+
+    for (size_t i = 0; i < m_outputs.size(); ++i) {
+        m_outputs[i]->zero();
+        memset(m_accumulators[i]->realData(), 0, sizeof(float) * m_partitionSize);
+        memset(m_accumulators[i]->imagData(), 0, sizeof(float) * m_partitionSize);
+    }
+
+    m_position = 0;
+    m_partitionsAccumulated = 1;
+    m_newestSpectrum = 0;
+}
+
+} // namespace WebCore
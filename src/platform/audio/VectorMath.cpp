@@ -39,13 +39,61 @@
 #include <arm_neon.h>
 #endif
 
+#if CPU(X86) || CPU(X86_64)
+#include "VectorMathX86.h"
+#define USE_VECTORMATH_DISPATCH 1
+#else
+#define USE_VECTORMATH_DISPATCH 0
+#endif
+
 #include <algorithm>
+#include <atomic>
 #include <math.h>
+#include <string.h>
 
 namespace WebCore {
 
 namespace VectorMath {
 
+static InstructionSet bestInstructionSet()
+{
+#if USE_VECTORMATH_DISPATCH
+    if (cpuSupportsAVX512())
+        return InstructionSetAVX512;
+    if (cpuSupportsAVX2())
+        return InstructionSetAVX2;
+#endif
+    return InstructionSetPortable;
+}
+
+// -1 until the CPU has been looked at.
+static std::atomic<int> s_instructionSet(-1);
+
+InstructionSet instructionSet()
+{
+    int instructionSet = s_instructionSet.load(std::memory_order_relaxed);
+    if (instructionSet < 0) {
+        instructionSet = bestInstructionSet();
+        s_instructionSet.store(instructionSet, std::memory_order_relaxed);
+    }
+    return static_cast<InstructionSet>(instructionSet);
+}
+
+void setInstructionSet(InstructionSet instructionSet)
+{
+    s_instructionSet.store(std::min(instructionSet, bestInstructionSet()), std::memory_order_relaxed);
+}
+
+#if USE_VECTORMATH_DISPATCH
+// Runs the widest version of a function the CPU supports, and returns from the caller, unless that is the portable one.
+#define DISPATCH_TO_WIDEST(function, ...) \
+    switch (instructionSet()) { \
+    case InstructionSetAVX512: avx512::function(__VA_ARGS__); return; \
+    case InstructionSetAVX2: avx2::function(__VA_ARGS__); return; \
+    case InstructionSetPortable: break; \
+    }
+#endif
+
 #if OS(DARWIN)
 // On the Mac we use the highly optimized versions in Accelerate.framework
 // In 32-bit mode (__ppc__ or __i386__) <Accelerate/Accelerate.h> includes <vecLib/vDSP_translate.h> which defines macros of the same name as
@@ -96,6 +144,20 @@ void zvmul(const float* real1P, const float* imag1P, const float* real2P, const
 #endif
 }
 
+void zvmula(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess)
+{
+    DSPSplitComplex sc1;
+    DSPSplitComplex sc2;
+    DSPSplitComplex dest;
+    sc1.realp = const_cast<float*>(real1P);
+    sc1.imagp = const_cast<float*>(imag1P);
+    sc2.realp = const_cast<float*>(real2P);
+    sc2.imagp = const_cast<float*>(imag2P);
+    dest.realp = realDestP;
+    dest.imagp = imagDestP;
+    vDSP_zvma(&sc1, 1, &sc2, 1, &dest, 1, &dest, 1, framesToProcess);
+}
+
 void vsma(const float* sourceP, int sourceStride, const float* scale, float* destP, int destStride, size_t framesToProcess)
 {
     vDSP_vsma(sourceP, sourceStride, scale, destP, destStride, destP, destStride, framesToProcess);
@@ -119,6 +181,11 @@ void vclip(const float* sourceP, int sourceStride, const float* lowThresholdP, c
 
 void vsma(const float* sourceP, int sourceStride, const float* scale, float* destP, int destStride, size_t framesToProcess)
 {
+#if USE_VECTORMATH_DISPATCH
+    if ((sourceStride == 1) && (destStride == 1))
+        DISPATCH_TO_WIDEST(vsma, sourceP, *scale, destP, framesToProcess)
+#endif
+
     int n = framesToProcess;
 
 #ifdef __SSE2__
@@ -192,6 +259,11 @@ void vsma(const float* sourceP, int sourceStride, const float* scale, float* des
 
 void vsmul(const float* sourceP, int sourceStride, const float* scale, float* destP, int destStride, size_t framesToProcess)
 {
+#if USE_VECTORMATH_DISPATCH
+    if ((sourceStride == 1) && (destStride == 1))
+        DISPATCH_TO_WIDEST(vsmul, sourceP, *scale, destP, framesToProcess)
+#endif
+
     int n = framesToProcess;
 
 #ifdef __SSE2__
@@ -272,6 +344,11 @@ void vsmul(const float* sourceP, int sourceStride, const float* scale, float* de
 
 void vadd(const float* source1P, int sourceStride1, const float* source2P, int sourceStride2, float* destP, int destStride, size_t framesToProcess)
 {
+#if USE_VECTORMATH_DISPATCH
+    if ((sourceStride1 == 1) && (sourceStride2 == 1) && (destStride == 1))
+        DISPATCH_TO_WIDEST(vadd, source1P, source2P, destP, framesToProcess)
+#endif
+
     int n = framesToProcess;
 
 #ifdef __SSE2__
@@ -384,6 +461,10 @@ void vadd(const float* source1P, int sourceStride1, const float* source2P, int s
 
 void vmul(const float* source1P, int sourceStride1, const float* source2P, int sourceStride2, float* destP, int destStride, size_t framesToProcess)
 {
+#if USE_VECTORMATH_DISPATCH
+    if ((sourceStride1 == 1) && (sourceStride2 == 1) && (destStride == 1))
+        DISPATCH_TO_WIDEST(vmul, source1P, source2P, destP, framesToProcess)
+#endif
 
     int n = framesToProcess;
 
@@ -459,6 +540,10 @@ void vmul(const float* source1P, int sourceStride1, const float* source2P, int s
 
 void zvmul(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess)
 {
+#if USE_VECTORMATH_DISPATCH
+    DISPATCH_TO_WIDEST(zvmul, real1P, imag1P, real2P, imag2P, realDestP, imagDestP, framesToProcess)
+#endif
+
     unsigned i = 0;
 #ifdef __SSE2__
     // Only use the SSE optimization in the very common case that all addresses are 16-byte aligned. 
@@ -513,8 +598,73 @@ void zvmul(const float* real1P, const float* imag1P, const float* real2P, const
     }
 }
 
+void zvmula(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess)
+{
+#if USE_VECTORMATH_DISPATCH
+    DISPATCH_TO_WIDEST(zvmula, real1P, imag1P, real2P, imag2P, realDestP, imagDestP, framesToProcess)
+#endif
+
+    unsigned i = 0;
+#ifdef __SSE2__
+    // As zvmul, only the case where all addresses are 16-byte aligned is vectorized.
+    if (!(reinterpret_cast<uintptr_t>(real1P) & 0x0F)
+        && !(reinterpret_cast<uintptr_t>(imag1P) & 0x0F)
+        && !(reinterpret_cast<uintptr_t>(real2P) & 0x0F)
+        && !(reinterpret_cast<uintptr_t>(imag2P) & 0x0F)
+        && !(reinterpret_cast<uintptr_t>(realDestP) & 0x0F)
+        && !(reinterpret_cast<uintptr_t>(imagDestP) & 0x0F)) {
+
+        unsigned endSize = framesToProcess - framesToProcess % 4;
+        while (i < endSize) {
+            __m128 real1 = _mm_load_ps(real1P + i);
+            __m128 real2 = _mm_load_ps(real2P + i);
+            __m128 imag1 = _mm_load_ps(imag1P + i);
+            __m128 imag2 = _mm_load_ps(imag2P + i);
+            __m128 real = _mm_sub_ps(_mm_mul_ps(real1, real2), _mm_mul_ps(imag1, imag2));
+            __m128 imag = _mm_add_ps(_mm_mul_ps(real1, imag2), _mm_mul_ps(imag1, real2));
+            _mm_store_ps(realDestP + i, _mm_add_ps(_mm_load_ps(realDestP + i), real));
+            _mm_store_ps(imagDestP + i, _mm_add_ps(_mm_load_ps(imagDestP + i), imag));
+            i += 4;
+        }
+    }
+#elif HAVE(ARM_NEON_INTRINSICS)
+        unsigned endSize = framesToProcess - framesToProcess % 4;
+        while (i < endSize) {
+            float32x4_t real1 = vld1q_f32(real1P + i);
+            float32x4_t real2 = vld1q_f32(real2P + i);
+            float32x4_t imag1 = vld1q_f32(imag1P + i);
+            float32x4_t imag2 = vld1q_f32(imag2P + i);
+
+            float32x4_t realResult = vmlsq_f32(vmlaq_f32(vld1q_f32(realDestP + i), real1, real2), imag1, imag2);
+            float32x4_t imagResult = vmlaq_f32(vmlaq_f32(vld1q_f32(imagDestP + i), real1, imag2), imag1, real2);
+
+            vst1q_f32(realDestP + i, realResult);
+            vst1q_f32(imagDestP + i, imagResult);
+
+            i += 4;
+        }
+#endif
+    for (; i < framesToProcess; ++i) {
+        float realResult = real1P[i] * real2P[i] - imag1P[i] * imag2P[i];
+        float imagResult = real1P[i] * imag2P[i] + imag1P[i] * real2P[i];
+
+        realDestP[i] += realResult;
+        imagDestP[i] += imagResult;
+    }
+}
+
 void vsvesq(const float* sourceP, int sourceStride, float* sumP, size_t framesToProcess)
 {
+#if USE_VECTORMATH_DISPATCH
+    if (sourceStride == 1) {
+        switch (instructionSet()) {
+        case InstructionSetAVX512: *sumP = avx512::vsvesq(sourceP, framesToProcess); return;
+        case InstructionSetAVX2: *sumP = avx2::vsvesq(sourceP, framesToProcess); return;
+        case InstructionSetPortable: break;
+        }
+    }
+#endif
+
     int n = framesToProcess;
     float sum = 0;
 
@@ -580,6 +730,16 @@ void vsvesq(const float* sourceP, int sourceStride, float* sumP, size_t framesTo
 
 void vmaxmgv(const float* sourceP, int sourceStride, float* maxP, size_t framesToProcess)
 {
+#if USE_VECTORMATH_DISPATCH
+    if (sourceStride == 1) {
+        switch (instructionSet()) {
+        case InstructionSetAVX512: *maxP = avx512::vmaxmgv(sourceP, framesToProcess); return;
+        case InstructionSetAVX2: *maxP = avx2::vmaxmgv(sourceP, framesToProcess); return;
+        case InstructionSetPortable: break;
+        }
+    }
+#endif
+
     int n = framesToProcess;
     float max = 0;
 
@@ -649,12 +809,31 @@ void vmaxmgv(const float* sourceP, int sourceStride, float* maxP, size_t framesT
 
 void vclip(const float* sourceP, int sourceStride, const float* lowThresholdP, const float* highThresholdP, float* destP, int destStride, size_t framesToProcess)
 {
+#if USE_VECTORMATH_DISPATCH
+    if ((sourceStride == 1) && (destStride == 1))
+        DISPATCH_TO_WIDEST(vclip, sourceP, *lowThresholdP, *highThresholdP, destP, framesToProcess)
+#endif
+
     int n = framesToProcess;
     float lowThreshold = *lowThresholdP;
     float highThreshold = *highThresholdP;
 
-    // FIXME: Optimize for SSE2.
-#if HAVE(ARM_NEON_INTRINSICS)
+#ifdef __SSE2__
+    if ((sourceStride == 1) && (destStride == 1)) {
+        int tailFrames = n % 4;
+        const float* endP = destP + n - tailFrames;
+
+        __m128 low = _mm_set_ps1(lowThreshold);
+        __m128 high = _mm_set_ps1(highThreshold);
+        while (destP < endP) {
+            __m128 source = _mm_loadu_ps(sourceP);
+            _mm_storeu_ps(destP, _mm_max_ps(_mm_min_ps(source, high), low));
+            sourceP += 4;
+            destP += 4;
+        }
+        n = tailFrames;
+    }
+#elif HAVE(ARM_NEON_INTRINSICS)
     if ((sourceStride == 1) && (destStride == 1)) {
         int tailFrames = n % 4;
         const float* endP = destP + n - tailFrames;
@@ -679,64 +858,213 @@ void vclip(const float* sourceP, int sourceStride, const float* lowThresholdP, c
 
 #endif // OS(DARWIN)
 
-void vintlve(const float* realSrcP, const float* imagSrcP, float* destP, size_t framesToProcess) {
-	int i = 0;
+void vrampmuladd(const float* sourceP, int sourceStride, float* startP, const float* stepP, float* destP, int destStride, size_t framesToProcess)
+{
+    float start = *startP;
+    float step = *stepP;
+    *startP = start + step * framesToProcess;
+
+#if USE_VECTORMATH_DISPATCH
+    if ((sourceStride == 1) && (destStride == 1))
+        DISPATCH_TO_WIDEST(vrampmuladd, sourceP, start, step, destP, framesToProcess)
+#endif
+
+    size_t i = 0;
 #if HAVE(ARM_NEON_INTRINSICS)
-	int j = 0;
-	int endSize = framesToProcess - framesToProcess % 4;
-	int len = endSize / 2;
-
-	while (i < len) {
-		float32x4_t source1 = vld1q_f32(realSrcP);
-		float32x4_t source2 = vld1q_f32(imagSrcP);
-		float32x4x2_t source = vzipq_f32(source1, source2);
-
-		vst1q_f32(destP + j, source.val[0]);
-		vst1q_f32(destP + j + 4, source.val[1]);
-		realSrcP += 4;
-		imagSrcP += 4;
-
-		i += 4;
-		j += 8;
-	}
-#endif
-	int lenTail = framesToProcess / 2;
-	for (; i < lenTail; ++i) {
-		int baseIndex = 2 * i;
-		destP[baseIndex] = realSrcP[i];
-		destP[baseIndex + 1] = imagSrcP[i];
-	}
+    if ((sourceStride == 1) && (destStride == 1)) {
+        const float indices[4] = { 0, 1, 2, 3 };
+        float32x4_t index = vld1q_f32(indices);
+        float32x4_t ramp0 = vdupq_n_f32(start);
+        for (; i + 4 <= framesToProcess; i += 4) {
+            float32x4_t ramp = vmlaq_n_f32(ramp0, index, step);
+            vst1q_f32(destP + i, vmlaq_f32(vld1q_f32(destP + i), vld1q_f32(sourceP + i), ramp));
+            index = vaddq_f32(index, vdupq_n_f32(4));
+        }
+    }
+#endif
+    // Each value of the ramp is computed from its index rather than accumulated, so that errors don't build up.
+    for (; i < framesToProcess; ++i)
+        destP[i * destStride] += sourceP[i * sourceStride] * (start + step * i);
 }
 
-void vdeintlve(const float* sourceP, float* realDestP, float* imagDestP, size_t framesToProcess) {
-	int i = 0;
+void vramp(float* startP, const float* stepP, float* destP, int destStride, size_t framesToProcess)
+{
+    float start = *startP;
+    float step = *stepP;
+    *startP = start + step * framesToProcess;
+
+#if USE_VECTORMATH_DISPATCH
+    if (destStride == 1)
+        DISPATCH_TO_WIDEST(vramp, start, step, destP, framesToProcess)
+#endif
+
+    size_t i = 0;
 #if HAVE(ARM_NEON_INTRINSICS)
-	int j = 0;
-	int endSize = framesToProcess - framesToProcess % 4;
+    if (destStride == 1) {
+        const float indices[4] = { 0, 1, 2, 3 };
+        float32x4_t index = vld1q_f32(indices);
+        float32x4_t ramp0 = vdupq_n_f32(start);
+        for (; i + 4 <= framesToProcess; i += 4) {
+            vst1q_f32(destP + i, vmlaq_n_f32(ramp0, index, step));
+            index = vaddq_f32(index, vdupq_n_f32(4));
+        }
+    }
+#endif
+    // Computed from the index, as in vrampmuladd.
+    for (; i < framesToProcess; ++i)
+        destP[i * destStride] = start + step * i;
+}
 
-	while (i < endSize) {
-		float32x4_t source1 = vld1q_f32(sourceP);
-		float32x4_t source2 = vld1q_f32(sourceP + 4);
+void vexpramp(float* startP, const float* ratioP, const float* offsetP, float* destP, int destStride, size_t framesToProcess)
+{
+    float term = *startP;
+    float ratio = *ratioP;
+    float offset = *offsetP;
+
+#if USE_VECTORMATH_DISPATCH
+    if (destStride == 1) {
+        switch (instructionSet()) {
+        case InstructionSetAVX512: *startP = avx512::vexpramp(term, ratio, offset, destP, framesToProcess); return;
+        case InstructionSetAVX2: *startP = avx2::vexpramp(term, ratio, offset, destP, framesToProcess); return;
+        case InstructionSetPortable: break;
+        }
+    }
+#endif
 
-		float32x4x2_t source = vuzpq_f32(source1, source2);
+    size_t i = 0;
+#if HAVE(ARM_NEON_INTRINSICS)
+    if (destStride == 1 && framesToProcess >= 4) {
+        // Each lane holds every fourth term of the series, and steps by the fourth power of the ratio.
+        float terms[4] = { term, term * ratio, term * ratio * ratio, term * ratio * ratio * ratio };
+        float32x4_t lanes = vld1q_f32(terms);
+        float32x4_t vOffset = vdupq_n_f32(offset);
+        float ratio4 = powf(ratio, 4);
+        for (; i + 4 <= framesToProcess; i += 4) {
+            vst1q_f32(destP + i, vaddq_f32(lanes, vOffset));
+            lanes = vmulq_n_f32(lanes, ratio4);
+        }
+        vst1q_f32(terms, lanes);
+        term = terms[0];
+    }
+#endif
+    for (; i < framesToProcess; ++i) {
+        destP[i * destStride] = offset + term;
+        term *= ratio;
+    }
+    *startP = term;
+}
 
-		vst1q_f32(realDestP + j, source.val[0]);
-		vst1q_f32(imagDestP + j, source.val[1]);
+void vsum(const float* const* sourcesP, unsigned numberOfSources, float* destP, size_t framesToProcess)
+{
+    if (!numberOfSources) {
+        memset(destP, 0, sizeof(float) * framesToProcess);
+        return;
+    }
 
-		sourceP += 8;
+#if USE_VECTORMATH_DISPATCH
+    DISPATCH_TO_WIDEST(vsum, sourcesP, numberOfSources, destP, framesToProcess)
+#endif
 
-		i += 8;
-		j += 4;
-	}
+    size_t i = 0;
+#if HAVE(ARM_NEON_INTRINSICS)
+    for (; i + 4 <= framesToProcess; i += 4) {
+        float32x4_t sum = vld1q_f32(sourcesP[0] + i);
+        for (unsigned j = 1; j < numberOfSources; ++j)
+            sum = vaddq_f32(sum, vld1q_f32(sourcesP[j] + i));
+        vst1q_f32(destP + i, sum);
+    }
 #endif
-	int lenTail = framesToProcess / 2;
-	for (; i < lenTail; ++i) {
-		int baseIndex = 2 * i;
-		realDestP[i] = sourceP[baseIndex];
-		imagDestP[i] = sourceP[baseIndex + 1];
-	}
+    for (; i < framesToProcess; ++i) {
+        float sum = sourcesP[0][i];
+        for (unsigned j = 1; j < numberOfSources; ++j)
+            sum += sourcesP[j][i];
+        destP[i] = sum;
+    }
 }
 
+void vinterleave(const float* const* sourcesP, unsigned numberOfChannels, const float* scale, float* destP, size_t framesToProcess)
+{
+    float k = *scale;
+
+    if (numberOfChannels == 2) {
+#if USE_VECTORMATH_DISPATCH
+        if (instructionSet() != InstructionSetPortable) {
+            avx2::vinterleave2(sourcesP[0], sourcesP[1], k, destP, framesToProcess);
+            return;
+        }
+#endif
+        size_t i = 0;
+#if HAVE(ARM_NEON_INTRINSICS)
+        for (; i + 4 <= framesToProcess; i += 4) {
+            float32x4x2_t frames;
+            frames.val[0] = vmulq_n_f32(vld1q_f32(sourcesP[0] + i), k);
+            frames.val[1] = vmulq_n_f32(vld1q_f32(sourcesP[1] + i), k);
+            vst2q_f32(destP + 2 * i, frames);
+        }
+#endif
+        for (; i < framesToProcess; ++i) {
+            destP[2 * i] = sourcesP[0][i] * k;
+            destP[2 * i + 1] = sourcesP[1][i] * k;
+        }
+        return;
+    }
+
+    for (unsigned channel = 0; channel < numberOfChannels; ++channel) {
+        const float* sourceP = sourcesP[channel];
+        float* channelDestP = destP + channel;
+        for (size_t i = 0; i < framesToProcess; ++i)
+            channelDestP[i * numberOfChannels] = sourceP[i] * k;
+    }
+}
+
+void vdeinterleave(const float* sourceP, unsigned numberOfChannels, const float* scale, float* const* destsP, size_t framesToProcess)
+{
+    float k = *scale;
+
+    if (numberOfChannels == 2) {
+#if USE_VECTORMATH_DISPATCH
+        if (instructionSet() != InstructionSetPortable) {
+            avx2::vdeinterleave2(sourceP, k, destsP[0], destsP[1], framesToProcess);
+            return;
+        }
+#endif
+        size_t i = 0;
+#if HAVE(ARM_NEON_INTRINSICS)
+        for (; i + 4 <= framesToProcess; i += 4) {
+            float32x4x2_t frames = vld2q_f32(sourceP + 2 * i);
+            vst1q_f32(destsP[0] + i, vmulq_n_f32(frames.val[0], k));
+            vst1q_f32(destsP[1] + i, vmulq_n_f32(frames.val[1], k));
+        }
+#endif
+        for (; i < framesToProcess; ++i) {
+            destsP[0][i] = sourceP[2 * i] * k;
+            destsP[1][i] = sourceP[2 * i + 1] * k;
+        }
+        return;
+    }
+
+    for (unsigned channel = 0; channel < numberOfChannels; ++channel) {
+        const float* channelSourceP = sourceP + channel;
+        float* destP = destsP[channel];
+        for (size_t i = 0; i < framesToProcess; ++i)
+            destP[i] = channelSourceP[i * numberOfChannels] * k;
+    }
+}
+
+// framesToProcess counts the interleaved values, two per complex number.
+void vintlve(const float* realSrcP, const float* imagSrcP, float* destP, size_t framesToProcess)
+{
+    const float* sources[2] = { realSrcP, imagSrcP };
+    const float one = 1;
+    vinterleave(sources, 2, &one, destP, framesToProcess / 2);
+}
+
+void vdeintlve(const float* sourceP, float* realDestP, float* imagDestP, size_t framesToProcess)
+{
+    float* dests[2] = { realDestP, imagDestP };
+    const float one = 1;
+    vdeinterleave(sourceP, 2, &one, dests, framesToProcess / 2);
+}
 
 } // namespace VectorMath
 
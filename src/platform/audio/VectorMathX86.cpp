@@ -0,0 +1,556 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+
+#if CPU(X86) || CPU(X86_64)
+
+#include "VectorMathX86.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstdint>
+#include <math.h>
+
+#if COMPILER(MSVC)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// The kernels are compiled for their instruction set one function at a time, so that the rest of
+// the library keeps running on CPUs without it. Visual Studio allows the intrinsics anywhere.
+#if COMPILER(GCC) || COMPILER(CLANG)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+namespace WebCore {
+
+namespace VectorMath {
+
+static void cpuid(int leaf, int subleaf, unsigned registers[4])
+{
+#if COMPILER(MSVC)
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+    for (int i = 0; i < 4; ++i)
+        registers[i] = static_cast<unsigned>(info[i]);
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// The register state the operating system saves on a context switch.
+static uint64_t enabledRegisterState()
+{
+#if COMPILER(MSVC)
+    return _xgetbv(0);
+#else
+    unsigned low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+
+bool cpuSupportsAVX2()
+{
+    unsigned registers[4];
+    cpuid(0, 0, registers);
+    if (registers[0] < 7)
+        return false;
+
+    // OSXSAVE, AVX and FMA, then the SSE and AVX register state.
+    cpuid(1, 0, registers);
+    const unsigned avxAndFMA = (1u << 27) | (1u << 28) | (1u << 12);
+    if ((registers[2] & avxAndFMA) != avxAndFMA || (enabledRegisterState() & 0x6) != 0x6)
+        return false;
+
+    cpuid(7, 0, registers);
+    return (registers[1] & (1u << 5)) != 0;
+}
+
+bool cpuSupportsAVX512()
+{
+    if (!cpuSupportsAVX2())
+        return false;
+
+    // The opmask and upper ZMM register state as well.
+    if ((enabledRegisterState() & 0xE6) != 0xE6)
+        return false;
+
+    unsigned registers[4];
+    cpuid(7, 0, registers);
+    return (registers[1] & (1u << 16)) != 0;
+}
+
+namespace avx2 {
+
+TARGET_AVX2 static inline float horizontalSum(__m256 v)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+TARGET_AVX2 static inline float horizontalMax(__m256 v)
+{
+    __m128 max = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+    max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+    return _mm_cvtss_f32(max);
+}
+
+TARGET_AVX2 void vsma(const float* sourceP, float scale, float* destP, size_t framesToProcess)
+{
+    __m256 k = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8)
+        _mm256_storeu_ps(destP + i, _mm256_fmadd_ps(_mm256_loadu_ps(sourceP + i), k, _mm256_loadu_ps(destP + i)));
+    for (; i < framesToProcess; ++i)
+        destP[i] += sourceP[i] * scale;
+}
+
+TARGET_AVX2 void vsmul(const float* sourceP, float scale, float* destP, size_t framesToProcess)
+{
+    __m256 k = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8)
+        _mm256_storeu_ps(destP + i, _mm256_mul_ps(_mm256_loadu_ps(sourceP + i), k));
+    for (; i < framesToProcess; ++i)
+        destP[i] = sourceP[i] * scale;
+}
+
+TARGET_AVX2 void vadd(const float* source1P, const float* source2P, float* destP, size_t framesToProcess)
+{
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8)
+        _mm256_storeu_ps(destP + i, _mm256_add_ps(_mm256_loadu_ps(source1P + i), _mm256_loadu_ps(source2P + i)));
+    for (; i < framesToProcess; ++i)
+        destP[i] = source1P[i] + source2P[i];
+}
+
+TARGET_AVX2 void vmul(const float* source1P, const float* source2P, float* destP, size_t framesToProcess)
+{
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8)
+        _mm256_storeu_ps(destP + i, _mm256_mul_ps(_mm256_loadu_ps(source1P + i), _mm256_loadu_ps(source2P + i)));
+    for (; i < framesToProcess; ++i)
+        destP[i] = source1P[i] * source2P[i];
+}
+
+TARGET_AVX2 void zvmul(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess)
+{
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8) {
+        __m256 real1 = _mm256_loadu_ps(real1P + i);
+        __m256 imag1 = _mm256_loadu_ps(imag1P + i);
+        __m256 real2 = _mm256_loadu_ps(real2P + i);
+        __m256 imag2 = _mm256_loadu_ps(imag2P + i);
+        _mm256_storeu_ps(realDestP + i, _mm256_fmsub_ps(real1, real2, _mm256_mul_ps(imag1, imag2)));
+        _mm256_storeu_ps(imagDestP + i, _mm256_fmadd_ps(real1, imag2, _mm256_mul_ps(imag1, real2)));
+    }
+    for (; i < framesToProcess; ++i) {
+        float realResult = real1P[i] * real2P[i] - imag1P[i] * imag2P[i];
+        float imagResult = real1P[i] * imag2P[i] + imag1P[i] * real2P[i];
+        realDestP[i] = realResult;
+        imagDestP[i] = imagResult;
+    }
+}
+
+TARGET_AVX2 void zvmula(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess)
+{
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8) {
+        __m256 real1 = _mm256_loadu_ps(real1P + i);
+        __m256 imag1 = _mm256_loadu_ps(imag1P + i);
+        __m256 real2 = _mm256_loadu_ps(real2P + i);
+        __m256 imag2 = _mm256_loadu_ps(imag2P + i);
+        __m256 real = _mm256_fmadd_ps(real1, real2, _mm256_loadu_ps(realDestP + i));
+        __m256 imag = _mm256_fmadd_ps(real1, imag2, _mm256_loadu_ps(imagDestP + i));
+        _mm256_storeu_ps(realDestP + i, _mm256_fnmadd_ps(imag1, imag2, real));
+        _mm256_storeu_ps(imagDestP + i, _mm256_fmadd_ps(imag1, real2, imag));
+    }
+    for (; i < framesToProcess; ++i) {
+        realDestP[i] += real1P[i] * real2P[i] - imag1P[i] * imag2P[i];
+        imagDestP[i] += real1P[i] * imag2P[i] + imag1P[i] * real2P[i];
+    }
+}
+
+TARGET_AVX2 float vsvesq(const float* sourceP, size_t framesToProcess)
+{
+    // Two accumulators keep the adds from waiting on each other.
+    __m256 sum1 = _mm256_setzero_ps();
+    __m256 sum2 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= framesToProcess; i += 16) {
+        __m256 source1 = _mm256_loadu_ps(sourceP + i);
+        __m256 source2 = _mm256_loadu_ps(sourceP + i + 8);
+        sum1 = _mm256_fmadd_ps(source1, source1, sum1);
+        sum2 = _mm256_fmadd_ps(source2, source2, sum2);
+    }
+    float sum = horizontalSum(_mm256_add_ps(sum1, sum2));
+    for (; i < framesToProcess; ++i)
+        sum += sourceP[i] * sourceP[i];
+    return sum;
+}
+
+TARGET_AVX2 float vmaxmgv(const float* sourceP, size_t framesToProcess)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 max1 = _mm256_setzero_ps();
+    __m256 max2 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= framesToProcess; i += 16) {
+        max1 = _mm256_max_ps(max1, _mm256_and_ps(_mm256_loadu_ps(sourceP + i), absMask));
+        max2 = _mm256_max_ps(max2, _mm256_and_ps(_mm256_loadu_ps(sourceP + i + 8), absMask));
+    }
+    float max = horizontalMax(_mm256_max_ps(max1, max2));
+    for (; i < framesToProcess; ++i)
+        max = std::max(max, fabsf(sourceP[i]));
+    return max;
+}
+
+TARGET_AVX2 void vclip(const float* sourceP, float lowThreshold, float highThreshold, float* destP, size_t framesToProcess)
+{
+    __m256 low = _mm256_set1_ps(lowThreshold);
+    __m256 high = _mm256_set1_ps(highThreshold);
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8)
+        _mm256_storeu_ps(destP + i, _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(sourceP + i), high), low));
+    for (; i < framesToProcess; ++i)
+        destP[i] = std::max(std::min(sourceP[i], highThreshold), lowThreshold);
+}
+
+TARGET_AVX2 void vrampmuladd(const float* sourceP, float start, float step, float* destP, size_t framesToProcess)
+{
+    // Each value of the ramp is computed from its index rather than accumulated, so that errors don't build up.
+    __m256 index = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 eight = _mm256_set1_ps(8);
+    const __m256 vStart = _mm256_set1_ps(start);
+    const __m256 vStep = _mm256_set1_ps(step);
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8) {
+        __m256 ramp = _mm256_fmadd_ps(index, vStep, vStart);
+        _mm256_storeu_ps(destP + i, _mm256_fmadd_ps(_mm256_loadu_ps(sourceP + i), ramp, _mm256_loadu_ps(destP + i)));
+        index = _mm256_add_ps(index, eight);
+    }
+    for (; i < framesToProcess; ++i)
+        destP[i] += sourceP[i] * (start + step * i);
+}
+
+TARGET_AVX2 void vramp(float start, float step, float* destP, size_t framesToProcess)
+{
+    __m256 index = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 eight = _mm256_set1_ps(8);
+    const __m256 vStart = _mm256_set1_ps(start);
+    const __m256 vStep = _mm256_set1_ps(step);
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8) {
+        _mm256_storeu_ps(destP + i, _mm256_fmadd_ps(index, vStep, vStart));
+        index = _mm256_add_ps(index, eight);
+    }
+    for (; i < framesToProcess; ++i)
+        destP[i] = start + step * i;
+}
+
+TARGET_AVX2 float vexpramp(float start, float ratio, float offset, float* destP, size_t framesToProcess)
+{
+    // Each lane holds every eighth term of the series, and steps by the eighth power of the ratio.
+    float terms[8];
+    terms[0] = start;
+    for (int k = 1; k < 8; ++k)
+        terms[k] = terms[k - 1] * ratio;
+    __m256 term = _mm256_loadu_ps(terms);
+    const __m256 vRatio = _mm256_set1_ps(powf(ratio, 8));
+    const __m256 vOffset = _mm256_set1_ps(offset);
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8) {
+        _mm256_storeu_ps(destP + i, _mm256_add_ps(term, vOffset));
+        term = _mm256_mul_ps(term, vRatio);
+    }
+    _mm256_storeu_ps(terms, term);
+    float next = terms[0];
+    for (; i < framesToProcess; ++i) {
+        destP[i] = offset + next;
+        next *= ratio;
+    }
+    return next;
+}
+
+TARGET_AVX2 void vsum(const float* const* sourcesP, unsigned numberOfSources, float* destP, size_t framesToProcess)
+{
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8) {
+        __m256 sum = _mm256_loadu_ps(sourcesP[0] + i);
+        for (unsigned j = 1; j < numberOfSources; ++j)
+            sum = _mm256_add_ps(sum, _mm256_loadu_ps(sourcesP[j] + i));
+        _mm256_storeu_ps(destP + i, sum);
+    }
+    for (; i < framesToProcess; ++i) {
+        float sum = sourcesP[0][i];
+        for (unsigned j = 1; j < numberOfSources; ++j)
+            sum += sourcesP[j][i];
+        destP[i] = sum;
+    }
+}
+
+TARGET_AVX2 void vinterleave2(const float* source1P, const float* source2P, float scale, float* destP, size_t framesToProcess)
+{
+    __m256 k = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8) {
+        __m256 left = _mm256_mul_ps(_mm256_loadu_ps(source1P + i), k);
+        __m256 right = _mm256_mul_ps(_mm256_loadu_ps(source2P + i), k);
+
+        // Unpacking works within each 128 bit lane, so the lanes are put back in order afterwards.
+        __m256 low = _mm256_unpacklo_ps(left, right);
+        __m256 high = _mm256_unpackhi_ps(left, right);
+        _mm256_storeu_ps(destP + 2 * i, _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(destP + 2 * i + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+    for (; i < framesToProcess; ++i) {
+        destP[2 * i] = source1P[i] * scale;
+        destP[2 * i + 1] = source2P[i] * scale;
+    }
+}
+
+TARGET_AVX2 void vdeinterleave2(const float* sourceP, float scale, float* dest1P, float* dest2P, size_t framesToProcess)
+{
+    __m256 k = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= framesToProcess; i += 8) {
+        __m256 first = _mm256_loadu_ps(sourceP + 2 * i);
+        __m256 second = _mm256_loadu_ps(sourceP + 2 * i + 8);
+        __m256 low = _mm256_permute2f128_ps(first, second, 0x20);
+        __m256 high = _mm256_permute2f128_ps(first, second, 0x31);
+        _mm256_storeu_ps(dest1P + i, _mm256_mul_ps(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)), k));
+        _mm256_storeu_ps(dest2P + i, _mm256_mul_ps(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)), k));
+    }
+    for (; i < framesToProcess; ++i) {
+        dest1P[i] = sourceP[2 * i] * scale;
+        dest2P[i] = sourceP[2 * i + 1] * scale;
+    }
+}
+
+} // namespace avx2
+
+namespace avx512 {
+
+// The frames left over after the last full vector, which the masked loads and stores leave alone.
+static inline __mmask16 tailMask(size_t frames)
+{
+    return static_cast<__mmask16>((1u << frames) - 1);
+}
+
+// GCC builds _mm512_reduce_add_ps, _mm512_reduce_max_ps, _mm512_castps512_ps256 and the unmasked _mm512_max_ps
+// and _mm512_min_ps on masked instructions given an uninitialized vector, which -Wmaybe-uninitialized reports.
+// The kernels use the masked forms with a zeroed vector instead. The half is a macro as its index must be an
+// immediate even in unoptimized builds.
+#define AVX512_HALF(v, index) _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xFF, _mm512_castps_pd(v), index))
+
+TARGET_AVX512 static inline float horizontalSum(__m512 v)
+{
+    __m256 half = _mm256_add_ps(AVX512_HALF(v, 0), AVX512_HALF(v, 1));
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+TARGET_AVX512 static inline float horizontalMax(__m512 v)
+{
+    __m256 half = _mm256_max_ps(AVX512_HALF(v, 0), AVX512_HALF(v, 1));
+    __m128 max = _mm_max_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1));
+    max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+    max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+    return _mm_cvtss_f32(max);
+}
+
+TARGET_AVX512 void vsma(const float* sourceP, float scale, float* destP, size_t framesToProcess)
+{
+    __m512 k = _mm512_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= framesToProcess; i += 16)
+        _mm512_storeu_ps(destP + i, _mm512_fmadd_ps(_mm512_loadu_ps(sourceP + i), k, _mm512_loadu_ps(destP + i)));
+    if (i < framesToProcess) {
+        __mmask16 mask = tailMask(framesToProcess - i);
+        __m512 dest = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, sourceP + i), k, _mm512_maskz_loadu_ps(mask, destP + i));
+        _mm512_mask_storeu_ps(destP + i, mask, dest);
+    }
+}
+
+TARGET_AVX512 void vsmul(const float* sourceP, float scale, float* destP, size_t framesToProcess)
+{
+    __m512 k = _mm512_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 16 <= framesToProcess; i += 16)
+        _mm512_storeu_ps(destP + i, _mm512_mul_ps(_mm512_loadu_ps(sourceP + i), k));
+    if (i < framesToProcess) {
+        __mmask16 mask = tailMask(framesToProcess - i);
+        _mm512_mask_storeu_ps(destP + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, sourceP + i), k));
+    }
+}
+
+TARGET_AVX512 void vadd(const float* source1P, const float* source2P, float* destP, size_t framesToProcess)
+{
+    size_t i = 0;
+    for (; i + 16 <= framesToProcess; i += 16)
+        _mm512_storeu_ps(destP + i, _mm512_add_ps(_mm512_loadu_ps(source1P + i), _mm512_loadu_ps(source2P + i)));
+    if (i < framesToProcess) {
+        __mmask16 mask = tailMask(framesToProcess - i);
+        _mm512_mask_storeu_ps(destP + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, source1P + i), _mm512_maskz_loadu_ps(mask, source2P + i)));
+    }
+}
+
+TARGET_AVX512 void vmul(const float* source1P, const float* source2P, float* destP, size_t framesToProcess)
+{
+    size_t i = 0;
+    for (; i + 16 <= framesToProcess; i += 16)
+        _mm512_storeu_ps(destP + i, _mm512_mul_ps(_mm512_loadu_ps(source1P + i), _mm512_loadu_ps(source2P + i)));
+    if (i < framesToProcess) {
+        __mmask16 mask = tailMask(framesToProcess - i);
+        _mm512_mask_storeu_ps(destP + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, source1P + i), _mm512_maskz_loadu_ps(mask, source2P + i)));
+    }
+}
+
+TARGET_AVX512 void zvmul(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess)
+{
+    for (size_t i = 0; i < framesToProcess; i += 16) {
+        __mmask16 mask = framesToProcess - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tailMask(framesToProcess - i);
+        __m512 real1 = _mm512_maskz_loadu_ps(mask, real1P + i);
+        __m512 imag1 = _mm512_maskz_loadu_ps(mask, imag1P + i);
+        __m512 real2 = _mm512_maskz_loadu_ps(mask, real2P + i);
+        __m512 imag2 = _mm512_maskz_loadu_ps(mask, imag2P + i);
+        _mm512_mask_storeu_ps(realDestP + i, mask, _mm512_fmsub_ps(real1, real2, _mm512_mul_ps(imag1, imag2)));
+        _mm512_mask_storeu_ps(imagDestP + i, mask, _mm512_fmadd_ps(real1, imag2, _mm512_mul_ps(imag1, real2)));
+    }
+}
+
+TARGET_AVX512 void zvmula(const float* real1P, const float* imag1P, const float* real2P, const float* imag2P, float* realDestP, float* imagDestP, size_t framesToProcess)
+{
+    for (size_t i = 0; i < framesToProcess; i += 16) {
+        __mmask16 mask = framesToProcess - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tailMask(framesToProcess - i);
+        __m512 real1 = _mm512_maskz_loadu_ps(mask, real1P + i);
+        __m512 imag1 = _mm512_maskz_loadu_ps(mask, imag1P + i);
+        __m512 real2 = _mm512_maskz_loadu_ps(mask, real2P + i);
+        __m512 imag2 = _mm512_maskz_loadu_ps(mask, imag2P + i);
+        __m512 real = _mm512_fmadd_ps(real1, real2, _mm512_maskz_loadu_ps(mask, realDestP + i));
+        __m512 imag = _mm512_fmadd_ps(real1, imag2, _mm512_maskz_loadu_ps(mask, imagDestP + i));
+        _mm512_mask_storeu_ps(realDestP + i, mask, _mm512_fnmadd_ps(imag1, imag2, real));
+        _mm512_mask_storeu_ps(imagDestP + i, mask, _mm512_fmadd_ps(imag1, real2, imag));
+    }
+}
+
+TARGET_AVX512 float vsvesq(const float* sourceP, size_t framesToProcess)
+{
+    __m512 sum1 = _mm512_setzero_ps();
+    __m512 sum2 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= framesToProcess; i += 32) {
+        __m512 source1 = _mm512_loadu_ps(sourceP + i);
+        __m512 source2 = _mm512_loadu_ps(sourceP + i + 16);
+        sum1 = _mm512_fmadd_ps(source1, source1, sum1);
+        sum2 = _mm512_fmadd_ps(source2, source2, sum2);
+    }
+    for (; i < framesToProcess; i += 16) {
+        __mmask16 mask = framesToProcess - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tailMask(framesToProcess - i);
+        __m512 source = _mm512_maskz_loadu_ps(mask, sourceP + i);
+        sum1 = _mm512_fmadd_ps(source, source, sum1);
+    }
+    return horizontalSum(_mm512_add_ps(sum1, sum2));
+}
+
+TARGET_AVX512 float vmaxmgv(const float* sourceP, size_t framesToProcess)
+{
+    __m512 max = _mm512_setzero_ps();
+    for (size_t i = 0; i < framesToProcess; i += 16) {
+        __mmask16 mask = framesToProcess - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tailMask(framesToProcess - i);
+        max = _mm512_mask_max_ps(_mm512_setzero_ps(), 0xFFFF, max, _mm512_abs_ps(_mm512_maskz_loadu_ps(mask, sourceP + i)));
+    }
+    return horizontalMax(max);
+}
+
+TARGET_AVX512 void vclip(const float* sourceP, float lowThreshold, float highThreshold, float* destP, size_t framesToProcess)
+{
+    __m512 low = _mm512_set1_ps(lowThreshold);
+    __m512 high = _mm512_set1_ps(highThreshold);
+    for (size_t i = 0; i < framesToProcess; i += 16) {
+        __mmask16 mask = framesToProcess - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tailMask(framesToProcess - i);
+        __m512 source = _mm512_maskz_loadu_ps(mask, sourceP + i);
+        __m512 clipped = _mm512_mask_min_ps(_mm512_setzero_ps(), 0xFFFF, source, high);
+        _mm512_mask_storeu_ps(destP + i, mask, _mm512_mask_max_ps(_mm512_setzero_ps(), 0xFFFF, clipped, low));
+    }
+}
+
+TARGET_AVX512 void vrampmuladd(const float* sourceP, float start, float step, float* destP, size_t framesToProcess)
+{
+    __m512 index = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512 sixteen = _mm512_set1_ps(16);
+    const __m512 vStart = _mm512_set1_ps(start);
+    const __m512 vStep = _mm512_set1_ps(step);
+    for (size_t i = 0; i < framesToProcess; i += 16) {
+        __mmask16 mask = framesToProcess - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tailMask(framesToProcess - i);
+        __m512 ramp = _mm512_fmadd_ps(index, vStep, vStart);
+        __m512 dest = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, sourceP + i), ramp, _mm512_maskz_loadu_ps(mask, destP + i));
+        _mm512_mask_storeu_ps(destP + i, mask, dest);
+        index = _mm512_add_ps(index, sixteen);
+    }
+}
+
+TARGET_AVX512 void vramp(float start, float step, float* destP, size_t framesToProcess)
+{
+    __m512 index = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512 sixteen = _mm512_set1_ps(16);
+    const __m512 vStart = _mm512_set1_ps(start);
+    const __m512 vStep = _mm512_set1_ps(step);
+    for (size_t i = 0; i < framesToProcess; i += 16) {
+        __mmask16 mask = framesToProcess - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tailMask(framesToProcess - i);
+        _mm512_mask_storeu_ps(destP + i, mask, _mm512_fmadd_ps(index, vStep, vStart));
+        index = _mm512_add_ps(index, sixteen);
+    }
+}
+
+TARGET_AVX512 float vexpramp(float start, float ratio, float offset, float* destP, size_t framesToProcess)
+{
+    float terms[16];
+    terms[0] = start;
+    for (int k = 1; k < 16; ++k)
+        terms[k] = terms[k - 1] * ratio;
+    __m512 term = _mm512_loadu_ps(terms);
+    const __m512 vRatio = _mm512_set1_ps(powf(ratio, 16));
+    const __m512 vOffset = _mm512_set1_ps(offset);
+    size_t i = 0;
+    for (; i + 16 <= framesToProcess; i += 16) {
+        _mm512_storeu_ps(destP + i, _mm512_add_ps(term, vOffset));
+        term = _mm512_mul_ps(term, vRatio);
+    }
+    _mm512_storeu_ps(terms, term);
+    size_t remaining = framesToProcess - i;
+    if (remaining)
+        _mm512_mask_storeu_ps(destP + i, tailMask(remaining), _mm512_add_ps(term, vOffset));
+    return terms[remaining];
+}
+
+TARGET_AVX512 void vsum(const float* const* sourcesP, unsigned numberOfSources, float* destP, size_t framesToProcess)
+{
+    for (size_t i = 0; i < framesToProcess; i += 16) {
+        __mmask16 mask = framesToProcess - i >= 16 ? static_cast<__mmask16>(0xFFFF) : tailMask(framesToProcess - i);
+        __m512 sum = _mm512_maskz_loadu_ps(mask, sourcesP[0] + i);
+        for (unsigned j = 1; j < numberOfSources; ++j)
+            sum = _mm512_add_ps(sum, _mm512_maskz_loadu_ps(mask, sourcesP[j] + i));
+        _mm512_mask_storeu_ps(destP + i, mask, sum);
+    }
+}
+
+} // namespace avx512
+
+} // namespace VectorMath
+
+} // namespace WebCore
+
+#endif // CPU(X86) || CPU(X86_64)
@@ -0,0 +1,348 @@
+// Copyright (c) 2015 Nick Porcino, All rights reserved.
+// License is MIT: http://opensource.org/licenses/MIT
+
+#include "LabSoundConfig.h"
+#include "linux/AudioDestinationLinux.h"
+
+#include "AudioIOCallback.h"
+#include "AudioNode.h"
+#include "AudioPullFIFO.h"
+#include "VectorMath.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace WebCore {
+
+const float kLowThreshold = -1.0f;
+const float kHighThreshold = 1.0f;
+
+// Below the maximum, so that the audio server and the driver's own threads keep precedence.
+const int RealtimePriorityBelowMaximum = 10;
+
+static std::mutex s_settingsMutex;
+
+static AudioDestinationLinux::Settings& storedSettings()
+{
+    static AudioDestinationLinux::Settings settings;
+    return settings;
+}
+
+static unsigned unsignedFromEnvironment(const char* name, unsigned defaultValue)
+{
+    const char* value = getenv(name);
+    if (!value || !*value)
+        return defaultValue;
+    long parsed = strtol(value, 0, 10);
+    return parsed > 0 ? static_cast<unsigned>(parsed) : defaultValue;
+}
+
+AudioDestinationLinux::Settings::Settings()
+: useNullSink(false)
+, api(RtAudio::UNSPECIFIED)
+, channels(2)
+, periodFrames(AudioNode::ProcessingSizeInFrames)
+, sampleRate(44100)
+, realtimePriority(true)
+{
+}
+
+void AudioDestinationLinux::setSettings(const Settings& settings)
+{
+    std::lock_guard<std::mutex> lock(s_settingsMutex);
+    storedSettings() = settings;
+}
+
+AudioDestinationLinux::Settings AudioDestinationLinux::settings()
+{
+    Settings settings;
+    {
+        std::lock_guard<std::mutex> lock(s_settingsMutex);
+        settings = storedSettings();
+    }
+
+    if (const char* backend = getenv("LABSOUND_AUDIO_BACKEND")) {
+        settings.useNullSink = false;
+        if (!strcmp(backend, "alsa"))
+            settings.api = RtAudio::LINUX_ALSA;
+        else if (!strcmp(backend, "pulse"))
+            settings.api = RtAudio::LINUX_PULSE;
+        else if (!strcmp(backend, "jack"))
+            settings.api = RtAudio::UNIX_JACK;
+        else if (!strcmp(backend, "null"))
+            settings.useNullSink = true;
+    }
+
+    settings.periodFrames = unsignedFromEnvironment("LABSOUND_PERIOD_FRAMES", settings.periodFrames);
+    settings.channels = unsignedFromEnvironment("LABSOUND_CHANNELS", settings.channels);
+    settings.sampleRate = static_cast<float>(unsignedFromEnvironment("LABSOUND_SAMPLE_RATE", static_cast<unsigned>(settings.sampleRate)));
+
+    if (const char* sinkFile = getenv("LABSOUND_SINK_FILE"))
+        settings.sinkFile = sinkFile;
+
+    return settings;
+}
+
+// Factory method: Linux-implementation
+AudioDestination* AudioDestination::create(AudioIOCallback& callback, float sampleRate)
+{
+    AudioDestinationLinux::Settings settings = AudioDestinationLinux::settings();
+    if (sampleRate > 0)
+        settings.sampleRate = sampleRate;
+    return new AudioDestinationLinux(callback, settings);
+}
+
+float AudioDestination::hardwareSampleRate()
+{
+    return AudioDestinationLinux::settings().sampleRate;
+}
+
+AudioDestinationLinux::AudioDestinationLinux(AudioIOCallback& callback, const Settings& settings)
+: m_callback(callback)
+, m_settings(settings)
+, m_renderBus(settings.channels, AudioNode::ProcessingSizeInFrames, false)
+, m_periodBus(settings.channels, AudioNode::ProcessingSizeInFrames, false)
+, m_isPlaying(false)
+, m_isRenderThreadPromoted(false)
+, m_xrunCount(0)
+, m_nullSinkThread(0)
+, m_nullSinkRunning(false)
+, m_sinkFile(0)
+{
+    if (m_settings.channels < 1)
+        m_settings.channels = 1;
+    if (m_settings.periodFrames < 1)
+        m_settings.periodFrames = AudioNode::ProcessingSizeInFrames;
+
+    m_renderBus.setSampleRate(m_settings.sampleRate);
+    m_periodBus.setSampleRate(m_settings.sampleRate);
+
+    configure();
+}
+
+AudioDestinationLinux::~AudioDestinationLinux()
+{
+    stop();
+
+    if (m_dac && m_dac->isStreamOpen())
+        m_dac->closeStream();
+
+    if (m_sinkFile)
+        fclose(m_sinkFile);
+}
+
+void AudioDestinationLinux::configure()
+{
+    if (!m_settings.useNullSink) {
+        try {
+            m_dac.reset(new RtAudio(m_settings.api));
+
+            if (m_dac->getDeviceCount() < 1)
+                throw RtAudioError("no audio devices found", RtAudioError::NO_DEVICES_FOUND);
+
+            m_dac->showWarnings(true);
+
+            RtAudio::StreamParameters parameters;
+            parameters.deviceId = m_dac->getDefaultOutputDevice();
+            parameters.nChannels = m_settings.channels;
+            parameters.firstChannel = 0;
+
+            RtAudio::StreamOptions options;
+            options.flags |= RTAUDIO_NONINTERLEAVED;
+            options.streamName = "LabSound";
+
+            // The device may settle on a different period than the one asked for.
+            unsigned int bufferFrames = m_settings.periodFrames;
+            m_dac->openStream(&parameters, 0, RTAUDIO_FLOAT32, static_cast<unsigned int>(m_settings.sampleRate), &bufferFrames, &outputCallback, this, &options);
+            m_settings.periodFrames = bufferFrames;
+        }
+        catch (RtAudioError& e) {
+            e.printMessage();
+            std::cerr << "Falling back to the null audio sink" << std::endl;
+            m_dac.reset();
+            m_settings.useNullSink = true;
+        }
+    }
+
+    if (m_settings.useNullSink) {
+        m_nullSinkBuffer.resize(m_settings.periodFrames * m_settings.channels);
+        if (!m_settings.sinkFile.empty()) {
+            m_interleaved.resize(m_settings.periodFrames * m_settings.channels);
+            m_sinkFile = fopen(m_settings.sinkFile.c_str(), "wb");
+            if (!m_sinkFile)
+                std::cerr << "Couldn't open " << m_settings.sinkFile << " for the null audio sink" << std::endl;
+        }
+    }
+
+    // Periods which are whole numbers of render quanta are rendered directly into the output.
+    if (m_settings.periodFrames % AudioNode::ProcessingSizeInFrames) {
+        size_t fifoLength = m_settings.periodFrames + 2 * AudioNode::ProcessingSizeInFrames;
+        m_fifo.reset(new AudioPullFIFO(*this, m_settings.channels, fifoLength, AudioNode::ProcessingSizeInFrames));
+    }
+}
+
+void AudioDestinationLinux::start()
+{
+    if (m_isPlaying)
+        return;
+
+    if (m_dac) {
+        try {
+            m_dac->startStream();
+            m_isPlaying = true;
+        }
+        catch (RtAudioError& e) {
+            e.printMessage();
+        }
+        return;
+    }
+
+    m_nullSinkRunning = true;
+    m_nullSinkThread = createThread(AudioDestinationLinux::nullSinkEntry, this, "audio null sink");
+    m_isPlaying = m_nullSinkThread != 0;
+}
+
+void AudioDestinationLinux::stop()
+{
+    if (!m_isPlaying)
+        return;
+
+    if (m_dac) {
+        try {
+            m_dac->stopStream();
+            m_isPlaying = false;
+        }
+        catch (RtAudioError& e) {
+            e.printMessage();
+        }
+        return;
+    }
+
+    m_nullSinkRunning = false;
+    waitForThreadCompletion(m_nullSinkThread);
+    m_nullSinkThread = 0;
+    m_isPlaying = false;
+}
+
+// Pulls on our provider to get rendered audio stream.
+void AudioDestinationLinux::render(unsigned numberOfFrames, float* output)
+{
+    const unsigned channels = m_settings.channels;
+    const size_t quantum = AudioNode::ProcessingSizeInFrames;
+
+    if (m_fifo) {
+        for (unsigned i = 0; i < channels; ++i)
+            m_periodBus.setChannelMemory(i, output + i * numberOfFrames, numberOfFrames);
+        m_fifo->consume(&m_periodBus, numberOfFrames);
+    }
+    else {
+        // Each channel of the render bus points at the next quantum of the output buffer, so nothing is copied.
+        for (size_t offset = 0; offset + quantum <= numberOfFrames; offset += quantum) {
+            for (unsigned i = 0; i < channels; ++i)
+                m_renderBus.setChannelMemory(i, output + i * numberOfFrames + offset, quantum);
+            m_callback.render(0, &m_renderBus, quantum);
+        }
+    }
+
+    // Clamp values at 0db (i.e., [-1.0, 1.0])
+    for (unsigned i = 0; i < channels; ++i) {
+        float* channel = output + i * numberOfFrames;
+        VectorMath::vclip(channel, 1, &kLowThreshold, &kHighThreshold, channel, 1, numberOfFrames);
+    }
+}
+
+void AudioDestinationLinux::provideInput(AudioBus* bus, size_t framesToProcess)
+{
+    m_callback.render(0, bus, framesToProcess);
+}
+
+void AudioDestinationLinux::promoteRenderThread()
+{
+    m_isRenderThreadPromoted = true;
+
+    // JACK's process thread already runs with the priority the server was configured with.
+    if (!m_settings.realtimePriority || (m_dac && m_dac->getCurrentApi() == RtAudio::UNIX_JACK))
+        return;
+
+    sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - RealtimePriorityBelowMaximum;
+
+    // Fails with EPERM unless the process has CAP_SYS_NICE or an rtprio limit; the thread then keeps its normal priority.
+    int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result && result != EPERM)
+        std::cerr << "Couldn't raise the audio thread to realtime priority: " << strerror(result) << std::endl;
+}
+
+// RTAudio callback ticks and asks for some output...
+int AudioDestinationLinux::outputCallback(void* outputBuffer, void* inputBuffer, unsigned int numberOfFrames, double streamTime, RtAudioStreamStatus status, void* userData)
+{
+    AudioDestinationLinux* audioOutput = static_cast<AudioDestinationLinux*>(userData);
+
+    if (!audioOutput->m_isRenderThreadPromoted)
+        audioOutput->promoteRenderThread();
+
+    if (status & RTAUDIO_OUTPUT_UNDERFLOW)
+        audioOutput->m_xrunCount.fetch_add(1, std::memory_order_relaxed);
+
+    float* output = static_cast<float*>(outputBuffer);
+    memset(output, 0, sizeof(float) * numberOfFrames * audioOutput->m_settings.channels);
+
+    audioOutput->render(numberOfFrames, output);
+    return 0;
+}
+
+void AudioDestinationLinux::nullSinkEntry(void* threadData)
+{
+    AudioDestinationLinux* audioOutput = reinterpret_cast<AudioDestinationLinux*>(threadData);
+    ASSERT(audioOutput);
+    audioOutput->runNullSink();
+}
+
+void AudioDestinationLinux::runNullSink()
+{
+    promoteRenderThread();
+
+    const unsigned channels = m_settings.channels;
+    const unsigned frames = m_settings.periodFrames;
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(frames / double(m_settings.sampleRate)));
+
+    std::vector<const float*> sinkChannels(channels);
+    for (unsigned i = 0; i < channels; ++i)
+        sinkChannels[i] = m_nullSinkBuffer.data() + i * frames;
+    const float unity = 1;
+
+    auto deadline = std::chrono::steady_clock::now();
+
+    while (m_nullSinkRunning) {
+        memset(m_nullSinkBuffer.data(), 0, sizeof(float) * m_nullSinkBuffer.size());
+        render(frames, m_nullSinkBuffer.data());
+
+        if (m_sinkFile) {
+            VectorMath::vinterleave(sinkChannels.data(), channels, &unity, m_interleaved.data(), frames);
+            fwrite(m_interleaved.data(), sizeof(float), m_interleaved.size(), m_sinkFile);
+        }
+
+        // A period that finishes after the clock wanted it is an underrun, just as it would be on a device.
+        deadline += period;
+        auto now = std::chrono::steady_clock::now();
+        if (now > deadline) {
+            m_xrunCount.fetch_add(1, std::memory_order_relaxed);
+            deadline = now;
+        }
+        else
+            std::this_thread::sleep_until(deadline);
+    }
+
+    if (m_sinkFile)
+        fflush(m_sinkFile);
+}
+
+} // namespace WebCore
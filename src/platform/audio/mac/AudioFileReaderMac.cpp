@@ -30,6 +30,7 @@
 #include "AudioFileReaderMac.h"
 
 #include "AudioBus.h"
+#include "AudioFileDecoder.h"
 #include "AudioFileReader.h"
 #include "FloatConversion.h"
 #include <CoreFoundation/CoreFoundation.h>
@@ -238,16 +239,130 @@ std::unique_ptr<AudioBus> AudioFileReader::createBus(float sampleRate, bool mixT
     return audioBus;
 }
 
+// Files ExtAudioFile can't read, such as FLAC before OS X 10.13, may still be read by AudioFileDecoder.
+
 std::unique_ptr<AudioBus> createBusFromAudioFile(const char* filePath, bool mixToMono, float sampleRate)
 {
     AudioFileReader reader(filePath);
-    return reader.createBus(sampleRate, mixToMono);
+    std::unique_ptr<AudioBus> bus = reader.createBus(sampleRate, mixToMono);
+    if (bus)
+        return bus;
+
+    std::unique_ptr<AudioFileStream> stream = createAudioFileStream(AudioFileDecoder::open(filePath), sampleRate, mixToMono);
+    return stream ? createBusFromAudioFileStream(*stream) : nullptr;
 }
 
 std::unique_ptr<AudioBus> createBusFromInMemoryAudioFile(const void* data, size_t dataSize, bool mixToMono, float sampleRate)
 {
     AudioFileReader reader(data, dataSize);
-    return reader.createBus(sampleRate, mixToMono);
+    std::unique_ptr<AudioBus> bus = reader.createBus(sampleRate, mixToMono);
+    if (bus)
+        return bus;
+
+    std::unique_ptr<AudioFileStream> stream = createAudioFileStream(AudioFileDecoder::open(data, dataSize), sampleRate, mixToMono);
+    return stream ? createBusFromAudioFileStream(*stream) : nullptr;
+}
+
+// Reads through an ExtAudioFile, which converts to the client's sample-rate as it goes.
+class AudioFileStreamMac : public AudioFileStream {
+public:
+    AudioFileStreamMac(ExtAudioFileRef extAudioFileRef, const AudioStreamBasicDescription& fileDataFormat, const AudioStreamBasicDescription& clientDataFormat, SInt64 fileLength)
+        : m_extAudioFileRef(extAudioFileRef)
+        , m_fileSampleRate(fileDataFormat.mSampleRate)
+        , m_sampleRate(clientDataFormat.mSampleRate)
+        , m_numberOfChannels(clientDataFormat.mChannelsPerFrame)
+        , m_length(static_cast<uint64_t>(fileLength * (clientDataFormat.mSampleRate / fileDataFormat.mSampleRate)))
+        , m_bufferList(createAudioBufferList(clientDataFormat.mChannelsPerFrame))
+    {
+    }
+
+    virtual ~AudioFileStreamMac()
+    {
+        destroyAudioBufferList(m_bufferList);
+        ExtAudioFileDispose(m_extAudioFileRef);
+    }
+
+    virtual unsigned numberOfChannels() const override { return m_numberOfChannels; }
+    virtual float sampleRate() const override { return narrowPrecisionToFloat(m_sampleRate); }
+    virtual uint64_t length() const override { return m_length; }
+
+    virtual bool seek(uint64_t frame) override
+    {
+        // ExtAudioFileSeek takes a position at the file's sample-rate.
+        SInt64 fileFrame = static_cast<SInt64>(frame * (m_fileSampleRate / m_sampleRate));
+        return ExtAudioFileSeek(m_extAudioFileRef, fileFrame) == noErr;
+    }
+
+    virtual size_t read(AudioBus* bus, size_t framesToRead) override
+    {
+        ASSERT(bus->numberOfChannels() >= m_numberOfChannels && bus->length() >= framesToRead);
+
+        for (unsigned i = 0; i < m_numberOfChannels; ++i) {
+            m_bufferList->mBuffers[i].mNumberChannels = 1;
+            m_bufferList->mBuffers[i].mDataByteSize = framesToRead * sizeof(float);
+            m_bufferList->mBuffers[i].mData = bus->channel(i)->mutableData();
+        }
+
+        UInt32 framesRead = framesToRead;
+        if (ExtAudioFileRead(m_extAudioFileRef, &framesRead, m_bufferList) != noErr)
+            return 0;
+        return framesRead;
+    }
+
+private:
+    ExtAudioFileRef m_extAudioFileRef;
+    double m_fileSampleRate;
+    double m_sampleRate;
+    unsigned m_numberOfChannels;
+    uint64_t m_length;
+    AudioBufferList* m_bufferList;
+};
+
+std::unique_ptr<AudioFileStream> createAudioFileStream(const char* filePath, float sampleRate)
+{
+    CFStringRef filePathStringRef = CFStringCreateWithCString(kCFAllocatorDefault, filePath, kCFStringEncodingUTF8);
+    CFURLRef urlRef = CFURLCreateWithFileSystemPath(kCFAllocatorDefault, filePathStringRef, kCFURLPOSIXPathStyle, false);
+    CFRelease(filePathStringRef);
+    if (!urlRef)
+        return nullptr;
+
+    ExtAudioFileRef extAudioFileRef = 0;
+    OSStatus result = ExtAudioFileOpenURL(urlRef, &extAudioFileRef);
+    CFRelease(urlRef);
+    if (result != noErr)
+        return createAudioFileStream(AudioFileDecoder::open(filePath), sampleRate, false);
+
+    AudioStreamBasicDescription fileDataFormat;
+    UInt32 size = sizeof(fileDataFormat);
+    result = ExtAudioFileGetProperty(extAudioFileRef, kExtAudioFileProperty_FileDataFormat, &size, &fileDataFormat);
+
+    SInt64 fileLength = 0;
+    if (result == noErr) {
+        size = sizeof(fileLength);
+        result = ExtAudioFileGetProperty(extAudioFileRef, kExtAudioFileProperty_FileLengthFrames, &size, &fileLength);
+    }
+
+    // Non-interleaved floats, as in createBus().
+    AudioStreamBasicDescription clientDataFormat = fileDataFormat;
+    clientDataFormat.mFormatID = kAudioFormatLinearPCM;
+    clientDataFormat.mFormatFlags = kAudioFormatFlagsCanonical | kAudioFormatFlagIsNonInterleaved;
+    clientDataFormat.mBitsPerChannel = 8 * sizeof(AudioSampleType);
+    clientDataFormat.mFramesPerPacket = 1;
+    clientDataFormat.mBytesPerPacket = sizeof(AudioSampleType);
+    clientDataFormat.mBytesPerFrame = sizeof(AudioSampleType);
+
+    if (sampleRate)
+        clientDataFormat.mSampleRate = sampleRate;
+
+    if (result == noErr)
+        result = ExtAudioFileSetProperty(extAudioFileRef, kExtAudioFileProperty_ClientDataFormat, sizeof(AudioStreamBasicDescription), &clientDataFormat);
+
+    if (result != noErr || !fileDataFormat.mChannelsPerFrame) {
+        ExtAudioFileDispose(extAudioFileRef);
+        return nullptr;
+    }
+
+    return std::unique_ptr<AudioFileStream>(new AudioFileStreamMac(extAudioFileRef, fileDataFormat, clientDataFormat, fileLength));
 }
 
 } // WebCore
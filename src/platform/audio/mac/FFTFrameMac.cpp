@@ -33,6 +33,7 @@
 
 #include "FFTFrame.h"
 #include "VectorMath.h"
+#include <mutex>
 
 namespace WebCore {
 
@@ -40,6 +41,9 @@ const int kMaxFFTPow2Size = 24;
 
 FFTSetup* FFTFrame::fftSetups = 0;
 
+// HRTF elevations are loaded on several threads at once, each of them making frames.
+static std::mutex s_fftSetupsLock;
+
 // Normal constructor: allocates for a given fftSize
 FFTFrame::FFTFrame(unsigned fftSize)
     : m_realData(fftSize)
@@ -141,6 +145,8 @@ void FFTFrame::doInverseFFT(float* data)
 
 FFTSetup FFTFrame::fftSetupForSize(unsigned fftSize)
 {
+    std::lock_guard<std::mutex> locker(s_fftSetupsLock);
+
     if (!fftSetups) {
         fftSetups = (FFTSetup*)malloc(sizeof(FFTSetup) * kMaxFFTPow2Size);
         memset(fftSetups, 0, sizeof(FFTSetup) * kMaxFFTPow2Size);
@@ -160,6 +166,8 @@ void FFTFrame::initialize()
 
 void FFTFrame::cleanup()
 {
+    std::lock_guard<std::mutex> locker(s_fftSetupsLock);
+
     if (!fftSetups)
         return;
 
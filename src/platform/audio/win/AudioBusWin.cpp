@@ -24,7 +24,6 @@
  */
 
 #include "LabSoundConfig.h"
-#include "libsndfile\sndfile.h"
 
 #include "AudioBus.h"
 #include "AudioFileReader.h"
@@ -62,7 +61,7 @@ namespace WebCore {
             auto fileDataBuffer = ArrayBuffer::create(reinterpret_cast<float*>(data), l);
             delete [] data;
 
-			return std::unique_ptr<AudioBus>(createBusFromInMemoryAudioFile(fileDataBuffer->data(), fileDataBuffer->byteLength(), false, 44100));
+			return std::unique_ptr<AudioBus>(createBusFromInMemoryAudioFile(fileDataBuffer->data(), fileDataBuffer->byteLength(), false, sampleRate));
         }
 
 		ASSERT_NOT_REACHED();
@@ -40,7 +40,8 @@
 
 // RtAudio: Version 4.1.1
 
-#include "rtaudio\RtAudio.h"
+#include "LabSoundConfig.h"
+#include "rtaudio/RtAudio.h"
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
@@ -48,7 +49,7 @@
 
 #include <algorithm>
 #include <stdio.h>
-#include <WTF\MathExtras.h>
+#include <WTF/MathExtras.h>
 
 // Static variable definitions.
 const unsigned int RtApi::MAX_SAMPLE_RATES = 14;